@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <cstdint>
+#include <vector>
+
+#include "sk/buffer/buffer_checksum.hxx"
+#include "sk/buffer/dynamic_buffer.hxx"
+
+#include "bench_common.hxx"
+
+namespace {
+
+    // The byte-at-a-time table-driven CRC-32C, as a baseline.
+    struct bytewise_crc32c {
+        using value_type = std::uint32_t;
+
+        auto update(std::span<std::byte const> data) -> void {
+            auto const &table = sk::detail::crc32c_table[0];
+
+            for (auto b : data) {
+                auto index = (state ^ std::to_integer<std::uint32_t>(b)) & 0xFF;
+                state = (state >> 8) ^ table[index];
+            }
+        }
+
+        auto value() const -> value_type {
+            return ~state;
+        }
+
+        auto reset() -> void {
+            state = ~value_type(0);
+        }
+
+        value_type state = ~value_type(0);
+    };
+
+    /*
+     * buffer_checksum: checksum the readable ranges of a buffer.
+     */
+    template <typename Checksum>
+    auto buffer_checksum(benchmark::State &state) {
+        auto chunk = static_cast<std::size_t>(state.range(0));
+        sk::dynamic_buffer<char, 4096> buf;
+        buf.write(sk::bench::make_data<char>(chunk));
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            Checksum sum;
+            nbytes += sk::buffer_checksum(buf, sum);
+            benchmark::DoNotOptimize(sum.value());
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+    /*
+     * write_then_checksum: write a chunk to the buffer, then checksum it in
+     * a second pass over the readable ranges.
+     */
+    template <typename Checksum>
+    auto write_then_checksum(benchmark::State &state) {
+        auto chunk = static_cast<std::size_t>(state.range(0));
+        auto in = sk::bench::make_data<char>(chunk);
+        sk::dynamic_buffer<char, 4096> buf;
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            Checksum sum;
+            buf.write(in);
+            sk::buffer_checksum(buf, sum);
+            benchmark::DoNotOptimize(sum.value());
+            nbytes += buf.discard(chunk);
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+    /*
+     * checksummed_write: write a chunk through checksummed_buffer.
+     */
+    template <typename Checksum>
+    auto checksummed_write(benchmark::State &state) {
+        auto chunk = static_cast<std::size_t>(state.range(0));
+        auto in = sk::bench::make_data<char>(chunk);
+        sk::dynamic_buffer<char, 4096> buf;
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            sk::checksummed_buffer wrapped(buf, Checksum());
+            wrapped.write(in);
+            benchmark::DoNotOptimize(wrapped.checksum.value());
+            nbytes += buf.discard(chunk);
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+} // namespace
+
+BENCHMARK_TEMPLATE(buffer_checksum, bytewise_crc32c)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(buffer_checksum, sk::crc32c)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(buffer_checksum, sk::xxh3_64)
+    ->Apply(sk::bench::chunk_sizes);
+
+BENCHMARK_TEMPLATE(write_then_checksum, sk::crc32c)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(checksummed_write, sk::crc32c)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(write_then_checksum, sk::xxh3_64)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(checksummed_write, sk::xxh3_64)
+    ->Apply(sk::bench::chunk_sizes);
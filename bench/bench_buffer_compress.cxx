@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#if defined(SK_BUFFER_BENCH_ZLIB)
+
+#    include <cstddef>
+#    include <vector>
+
+#    include "sk/buffer/buffer_compress.hxx"
+#    include "sk/buffer/dynamic_buffer.hxx"
+
+#    include "bench_common.hxx"
+
+namespace {
+
+    /*
+     * compress_via_vector: compress a chunk into a temporary vector, then
+     * write the result into the output buffer.
+     */
+    auto compress_via_vector(benchmark::State &state) {
+        auto chunk = static_cast<std::size_t>(state.range(0));
+        auto in = sk::bench::make_data<char>(chunk);
+        sk::zlib_compressor codec(Z_BEST_SPEED);
+        sk::dynamic_buffer<char, 4096> out;
+        out.pool.set_high_water(64);
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            std::vector<char> tmp(compressBound(static_cast<uLong>(chunk)));
+
+            auto *zs = codec.native_handle();
+            zs->next_in = reinterpret_cast<Bytef *>(in.data());
+            zs->avail_in = static_cast<uInt>(in.size());
+            zs->next_out = reinterpret_cast<Bytef *>(tmp.data());
+            zs->avail_out = static_cast<uInt>(tmp.size());
+            deflate(zs, Z_FINISH);
+            deflateReset(zs);
+
+            tmp.resize(tmp.size() - zs->avail_out);
+            out.write(tmp);
+            nbytes += chunk;
+            out.clear();
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+    /*
+     * compress_direct: compress a chunk from one buffer straight into the
+     * output buffer's extents with buffer_compress().
+     */
+    auto compress_direct(benchmark::State &state) {
+        auto chunk = static_cast<std::size_t>(state.range(0));
+        auto in = sk::bench::make_data<char>(chunk);
+        sk::zlib_compressor codec(Z_BEST_SPEED);
+        sk::dynamic_buffer<char, 4096> out;
+        out.pool.set_high_water(64);
+        std::size_t nbytes = 0;
+
+        sk::dynamic_buffer<char, 4096> plain;
+        plain.pool.set_high_water(64);
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            // This includes copying the input into a buffer, which
+            // compress_via_vector doesn't do.
+            plain.write(in);
+
+            nbytes += sk::buffer_compress(codec, plain, out,
+                                          sk::codec_flush::finish)
+                          .consumed;
+            out.clear();
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+} // namespace
+
+BENCHMARK(compress_via_vector)->Apply(sk::bench::chunk_sizes);
+BENCHMARK(compress_direct)->Apply(sk::bench::chunk_sizes);
+
+#endif // defined(SK_BUFFER_BENCH_ZLIB)
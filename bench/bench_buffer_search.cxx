@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string>
+#include <string_view>
+
+#include "sk/buffer/buffer_search.hxx"
+#include "sk/buffer/dynamic_buffer.hxx"
+
+#include "bench_common.hxx"
+
+using namespace std::literals;
+
+namespace {
+
+    // Fill a buffer with a chunk of data whose only delimiter is at the end.
+    auto make_buffer(benchmark::State &state, std::string_view delimiter) {
+        auto chunk = static_cast<std::size_t>(state.range(0));
+        std::string data(chunk - delimiter.size(), 'x');
+        data += delimiter;
+
+        sk::dynamic_buffer<char, 4096> buf;
+        buf.write(data);
+        return buf;
+    }
+
+    auto buffer_find_value(benchmark::State &state) {
+        auto buf = make_buffer(state, "\n"sv);
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            auto pos = sk::buffer_find(buf, '\n');
+            benchmark::DoNotOptimize(pos);
+            nbytes += buf.size();
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+    auto buffer_find_needle(benchmark::State &state) {
+        auto buf = make_buffer(state, "\r\n"sv);
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            auto pos = sk::buffer_find(buf, "\r\n"sv);
+            benchmark::DoNotOptimize(pos);
+            nbytes += buf.size();
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+    auto buffer_find_first_of(benchmark::State &state) {
+        auto buf = make_buffer(state, "\0"sv);
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            auto pos = sk::buffer_find_first_of(buf, "\r\n\0"sv);
+            benchmark::DoNotOptimize(pos);
+            nbytes += buf.size();
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+} // namespace
+
+BENCHMARK(buffer_find_value)->Apply(sk::bench::chunk_sizes);
+BENCHMARK(buffer_find_needle)->Apply(sk::bench::chunk_sizes);
+BENCHMARK(buffer_find_first_of)->Apply(sk::bench::chunk_sizes);
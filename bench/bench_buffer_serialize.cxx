@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+#include "sk/buffer/buffer_serialize.hxx"
+#include "sk/buffer/dynamic_buffer.hxx"
+
+#include "bench_common.hxx"
+
+/*
+ * Encoding a frame of range(0) 32-bit integers into a dynamic_buffer, then
+ * decoding it again.
+ */
+
+namespace {
+
+    // Encode each field into a stack array and write() it.
+    auto serialize_write(benchmark::State &state) {
+        auto nfields = static_cast<std::uint32_t>(state.range(0));
+        sk::dynamic_buffer<char> buf;
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            for (std::uint32_t i = 0; i < nfields; ++i) {
+                std::array<char, 4> tmp;
+                for (std::size_t j = 0; j < 4; ++j)
+                    tmp[j] = static_cast<char>(i >> (24 - 8 * j));
+                buf.write(std::span<char const>(tmp));
+            }
+
+            std::uint32_t sum = 0;
+            for (std::uint32_t i = 0; i < nfields; ++i) {
+                std::array<char, 4> tmp;
+                buf.read(tmp);
+                sum += static_cast<unsigned char>(tmp[3]);
+            }
+            benchmark::DoNotOptimize(sum);
+            nbytes += 4 * nfields;
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+    auto serialize_put(benchmark::State &state) {
+        auto nfields = static_cast<std::uint32_t>(state.range(0));
+        sk::dynamic_buffer<char> buf;
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            for (std::uint32_t i = 0; i < nfields; ++i)
+                sk::buffer_put(buf, i);
+
+            std::uint32_t sum = 0;
+            for (std::uint32_t i = 0; i < nfields; ++i)
+                sum += *sk::buffer_get<std::uint32_t>(buf);
+            benchmark::DoNotOptimize(sum);
+            nbytes += 4 * nfields;
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+    auto serialize_writer(benchmark::State &state) {
+        auto nfields = static_cast<std::uint32_t>(state.range(0));
+        sk::dynamic_buffer<char> buf;
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            {
+                sk::buffer_writer writer(buf);
+                for (std::uint32_t i = 0; i < nfields; ++i)
+                    writer.put(i);
+            }
+
+            std::uint32_t sum = 0;
+            {
+                sk::buffer_reader reader(buf);
+                for (std::uint32_t i = 0; i < nfields; ++i)
+                    sum += *reader.get<std::uint32_t>();
+            }
+            benchmark::DoNotOptimize(sum);
+            nbytes += 4 * nfields;
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+    auto serialize_varint(benchmark::State &state) {
+        auto nfields = static_cast<std::uint32_t>(state.range(0));
+        sk::dynamic_buffer<char> buf;
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            for (std::uint32_t i = 0; i < nfields; ++i)
+                sk::buffer_put_varint(buf, i);
+            nbytes += buf.size();
+
+            std::uint32_t sum = 0;
+            for (std::uint32_t i = 0; i < nfields; ++i)
+                sum += *sk::buffer_get_varint<std::uint32_t>(buf);
+            benchmark::DoNotOptimize(sum);
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+} // namespace
+
+BENCHMARK(serialize_write)->Apply(sk::bench::small_chunk_sizes);
+BENCHMARK(serialize_put)->Apply(sk::bench::small_chunk_sizes);
+BENCHMARK(serialize_writer)->Apply(sk::bench::small_chunk_sizes);
+BENCHMARK(serialize_varint)->Apply(sk::bench::small_chunk_sizes);
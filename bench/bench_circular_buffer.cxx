@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <cstdint>
+#include <memory>
+
+#include "sk/buffer/circular_buffer.hxx"
+#include "sk/buffer/masked_circular_buffer.hxx"
+#include "sk/buffer/mirrored_circular_buffer.hxx"
+#include "sk/buffer/spsc_circular_buffer.hxx"
+
+#include "bench_common.hxx"
+
+namespace {
+
+    // Stream data through the buffer with the read pointer partway through,
+    // so that writes and reads wrap around the end of the buffer.
+    template <typename Buffer> auto offset_by_half(Buffer &buf) -> void {
+        using value_type = sk::buffer_value_t<Buffer>;
+        auto half = buf.capacity() / 2 + 1;
+        buf.write(sk::bench::make_data<value_type>(half));
+        buf.discard(half);
+    }
+
+    template <typename Buffer>
+    auto circular_write_read(benchmark::State &state) {
+        auto buf = std::make_unique<Buffer>();
+        offset_by_half(*buf);
+        sk::bench::write_read(state, *buf);
+    }
+
+    template <typename Buffer>
+    auto circular_commit_discard(benchmark::State &state) {
+        auto buf = std::make_unique<Buffer>();
+        offset_by_half(*buf);
+        sk::bench::commit_discard(state, *buf);
+    }
+
+    template <typename Buffer>
+    auto circular_readable_ranges(benchmark::State &state) {
+        auto buf = std::make_unique<Buffer>();
+        offset_by_half(*buf);
+        sk::bench::readable_ranges(state, *buf);
+    }
+
+} // namespace
+
+BENCHMARK_TEMPLATE(circular_write_read, sk::circular_buffer<char, 65536>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(circular_write_read,
+                   sk::circular_buffer<std::uint64_t, 65536>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(circular_commit_discard, sk::circular_buffer<char, 65536>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(circular_readable_ranges,
+                   sk::circular_buffer<char, 65536>)
+    ->Apply(sk::bench::chunk_sizes);
+
+BENCHMARK_TEMPLATE(circular_write_read,
+                   sk::masked_circular_buffer<char, 65536>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(circular_write_read,
+                   sk::masked_circular_buffer<std::uint64_t, 65536>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(circular_commit_discard,
+                   sk::masked_circular_buffer<char, 65536>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(circular_readable_ranges,
+                   sk::masked_circular_buffer<char, 65536>)
+    ->Apply(sk::bench::chunk_sizes);
+
+BENCHMARK_TEMPLATE(circular_write_read,
+                   sk::spsc_circular_buffer<char, 65536>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(circular_commit_discard,
+                   sk::spsc_circular_buffer<char, 65536>)
+    ->Apply(sk::bench::chunk_sizes);
+
+BENCHMARK_TEMPLATE(circular_write_read,
+                   sk::mirrored_circular_buffer<char, 65536>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(circular_commit_discard,
+                   sk::mirrored_circular_buffer<char, 65536>)
+    ->Apply(sk::bench::chunk_sizes);
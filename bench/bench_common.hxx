@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Shared helpers for the sk::buffer benchmarks.
+ */
+
+#ifndef SK_BUFFER_BENCH_COMMON_HXX_INCLUDED
+#define SK_BUFFER_BENCH_COMMON_HXX_INCLUDED
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <ranges>
+#include <span>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "sk/buffer/buffer.hxx"
+
+namespace sk::bench {
+
+    // Return the number of calls to the global operator new so far.  This is
+    // counted by the replacement operator new in bench_main.cxx.
+    auto allocation_count() -> std::size_t;
+
+    // The chunk sizes (in objects) passed to each benchmark as range(0).
+    inline auto chunk_sizes(benchmark::internal::Benchmark *b) -> void {
+        b->RangeMultiplier(16)->Range(16, 65536);
+    }
+
+    // Chunk sizes for buffers which can't hold more than 4096 objects.
+    inline auto small_chunk_sizes(benchmark::internal::Benchmark *b)
+        -> void {
+        b->RangeMultiplier(16)->Range(16, 4096);
+    }
+
+    // Create n objects of test data.
+    template <typename T> auto make_data(std::size_t n) -> std::vector<T> {
+        std::vector<T> data(n);
+        std::iota(data.begin(), data.end(), T{});
+        return data;
+    }
+
+    // Report the data rate and the number of allocations per iteration.
+    inline auto report(benchmark::State &state, std::size_t allocs_before,
+                       std::size_t bytes) -> void {
+        state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+        state.counters["allocs/op"] = benchmark::Counter(
+            static_cast<double>(allocation_count() - allocs_before),
+            benchmark::Counter::kAvgIterations);
+    }
+
+    // An iteration setup function that does nothing.
+    struct no_setup {
+        template <typename Buffer> auto operator()(Buffer &) const -> void {}
+    };
+
+    /*
+     * write_read: write a chunk of data to the buffer with write(), then
+     * read it back with read().
+     */
+    template <typename Buffer, typename Setup = no_setup>
+    auto write_read(benchmark::State &state, Buffer &buf, Setup setup = {})
+        -> void {
+        using value_type = buffer_value_t<Buffer>;
+
+        auto chunk = static_cast<std::size_t>(state.range(0));
+        auto in = make_data<value_type>(chunk);
+        std::vector<value_type> out(chunk);
+        std::size_t nbytes = 0;
+
+        auto allocs = allocation_count();
+        for (auto _ : state) {
+            setup(buf);
+            buf.write(in);
+            nbytes += buf.read(out) * sizeof(value_type);
+            benchmark::DoNotOptimize(out.data());
+            benchmark::ClobberMemory();
+        }
+        report(state, allocs, nbytes);
+    }
+
+    /*
+     * commit_discard: copy a chunk of data into writable_ranges() and
+     * commit() it, then visit readable_ranges() and discard() it.  This is
+     * the pattern used for zero-copy I/O.
+     */
+    template <typename Buffer, typename Setup = no_setup>
+    auto commit_discard(benchmark::State &state, Buffer &buf,
+                        Setup setup = {}) -> void {
+        using value_type = buffer_value_t<Buffer>;
+
+        auto chunk = static_cast<std::size_t>(state.range(0));
+        auto in = make_data<value_type>(chunk);
+        std::size_t nbytes = 0;
+
+        auto allocs = allocation_count();
+        for (auto _ : state) {
+            setup(buf);
+
+            std::size_t n = 0;
+            for (auto &&range : buf.writable_ranges()) {
+                auto m = std::min(std::ranges::size(range), chunk - n);
+                std::copy_n(in.data() + n, m, std::ranges::data(range));
+                n += m;
+                if (n == chunk)
+                    break;
+            }
+            buf.commit(n);
+
+            for (auto &&range : buf.readable_ranges())
+                benchmark::DoNotOptimize(std::ranges::data(range));
+
+            nbytes += buf.discard(n) * sizeof(value_type);
+            benchmark::ClobberMemory();
+        }
+        report(state, allocs, nbytes);
+    }
+
+    /*
+     * readable_ranges: fill the buffer with a chunk of data, then measure
+     * the cost of walking readable_ranges().
+     */
+    template <typename Buffer>
+    auto readable_ranges(benchmark::State &state, Buffer &buf) -> void {
+        using value_type = buffer_value_t<Buffer>;
+
+        auto chunk = static_cast<std::size_t>(state.range(0));
+        buf.write(make_data<value_type>(chunk));
+        std::size_t nbytes = 0;
+
+        auto allocs = allocation_count();
+        for (auto _ : state) {
+            std::size_t n = 0;
+            for (auto &&range : buf.readable_ranges())
+                n += std::ranges::size(range);
+            benchmark::DoNotOptimize(n);
+            nbytes += n * sizeof(value_type);
+        }
+        report(state, allocs, nbytes);
+    }
+
+} // namespace sk::bench
+
+#endif // SK_BUFFER_BENCH_COMMON_HXX_INCLUDED
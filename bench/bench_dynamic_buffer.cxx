@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <cstdint>
+
+#include "sk/buffer/dynamic_buffer.hxx"
+
+#include "bench_common.hxx"
+
+namespace {
+
+    template <typename Buffer>
+    auto dynamic_buffer_write_read(benchmark::State &state) {
+        Buffer buf;
+        sk::bench::write_read(state, buf);
+    }
+
+    template <typename Buffer>
+    auto dynamic_buffer_commit_discard(benchmark::State &state) {
+        Buffer buf;
+        sk::bench::commit_discard(state, buf);
+    }
+
+    template <typename Buffer>
+    auto dynamic_buffer_readable_ranges(benchmark::State &state) {
+        Buffer buf;
+        sk::bench::readable_ranges(state, buf);
+    }
+
+    // Writing a chunk, then splicing it to another buffer and discarding it
+    // there, which transfers the data without copying it.
+    template <typename Buffer>
+    auto dynamic_buffer_splice(benchmark::State &state) {
+        using value_type = sk::buffer_value_t<Buffer>;
+
+        auto chunk = static_cast<std::size_t>(state.range(0));
+        auto in = sk::bench::make_data<value_type>(chunk);
+        Buffer from, to;
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            from.write(in);
+            to.splice(from);
+            nbytes += to.discard(chunk) * sizeof(value_type);
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+    // Queueing a payload which is already in memory, then discarding it,
+    // either by copying it with write() or by adopting it with
+    // append_external().
+    template <typename Buffer>
+    auto dynamic_buffer_queue_write(benchmark::State &state) {
+        using value_type = sk::buffer_value_t<Buffer>;
+
+        auto chunk = static_cast<std::size_t>(state.range(0));
+        auto in = sk::bench::make_data<value_type>(chunk);
+        Buffer buf;
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            buf.write(in);
+            nbytes += buf.discard(chunk) * sizeof(value_type);
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+    template <typename Buffer>
+    auto dynamic_buffer_queue_external(benchmark::State &state) {
+        using value_type = sk::buffer_value_t<Buffer>;
+
+        auto chunk = static_cast<std::size_t>(state.range(0));
+        auto in = sk::bench::make_data<value_type>(chunk);
+        Buffer buf;
+        std::size_t nbytes = 0, released = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            buf.append_external(in, [&] { ++released; });
+            nbytes += buf.discard(chunk) * sizeof(value_type);
+        }
+        sk::bench::report(state, allocs, nbytes);
+        benchmark::DoNotOptimize(released);
+    }
+
+    // Writing a chunk and reading it back through readable_ranges(), with
+    // extents which grow geometrically up to 64 times the base size.
+    template <typename Buffer>
+    auto dynamic_buffer_growth(benchmark::State &state) {
+        Buffer buf;
+        buf.max_extent_size = 64 * Buffer::extent_size;
+        sk::bench::readable_ranges(state, buf);
+    }
+
+    // write_read with the space for each chunk reserved in advance and
+    // allocation disabled, as on a latency-critical path.
+    template <typename Buffer>
+    auto dynamic_buffer_reserved_write_read(benchmark::State &state) {
+        Buffer buf;
+        buf.reserve(static_cast<std::size_t>(state.range(0)));
+        buf.allow_allocation = false;
+        sk::bench::write_read(state, buf);
+    }
+
+} // namespace
+
+// Extent sizes relative to the chunk size.
+BENCHMARK_TEMPLATE(dynamic_buffer_write_read, sk::dynamic_buffer<char, 512>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(dynamic_buffer_write_read, sk::dynamic_buffer<char, 4096>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(dynamic_buffer_write_read,
+                   sk::dynamic_buffer<char, 65536>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(dynamic_buffer_write_read,
+                   sk::dynamic_buffer<std::uint64_t, 4096>)
+    ->Apply(sk::bench::chunk_sizes);
+
+BENCHMARK_TEMPLATE(dynamic_buffer_reserved_write_read,
+                   sk::dynamic_buffer<char, 4096>)
+    ->Apply(sk::bench::chunk_sizes);
+
+BENCHMARK_TEMPLATE(dynamic_buffer_commit_discard,
+                   sk::dynamic_buffer<char, 512>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(dynamic_buffer_commit_discard,
+                   sk::dynamic_buffer<char, 4096>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(dynamic_buffer_commit_discard,
+                   sk::dynamic_buffer<char, 65536>)
+    ->Apply(sk::bench::chunk_sizes);
+
+BENCHMARK_TEMPLATE(dynamic_buffer_readable_ranges,
+                   sk::dynamic_buffer<char, 512>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(dynamic_buffer_readable_ranges,
+                   sk::dynamic_buffer<char, 4096>)
+    ->Apply(sk::bench::chunk_sizes);
+
+BENCHMARK_TEMPLATE(dynamic_buffer_splice, sk::dynamic_buffer<char, 4096>)
+    ->Apply(sk::bench::chunk_sizes);
+
+BENCHMARK_TEMPLATE(dynamic_buffer_queue_write, sk::dynamic_buffer<char, 4096>)
+    ->RangeMultiplier(16)
+    ->Range(4096, 16 * 1024 * 1024);
+BENCHMARK_TEMPLATE(dynamic_buffer_queue_external,
+                   sk::dynamic_buffer<char, 4096>)
+    ->RangeMultiplier(16)
+    ->Range(4096, 16 * 1024 * 1024);
+
+BENCHMARK_TEMPLATE(dynamic_buffer_growth, sk::dynamic_buffer<char, 512>)
+    ->Apply(sk::bench::chunk_sizes);
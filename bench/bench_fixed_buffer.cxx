@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <cstdint>
+#include <memory>
+
+#include "sk/buffer/fixed_buffer.hxx"
+
+#include "bench_common.hxx"
+
+namespace {
+
+    // A fixed_buffer can only be filled once, so reset it before each
+    // iteration.
+    struct reset_buffer {
+        template <typename Buffer> auto operator()(Buffer &buf) const -> void {
+            buf.reset();
+        }
+    };
+
+    template <typename T> auto fixed_buffer_write_read(benchmark::State &state) {
+        auto buf = std::make_unique<sk::fixed_buffer<T, 65536>>();
+        sk::bench::write_read(state, *buf, reset_buffer{});
+    }
+
+    template <typename T>
+    auto fixed_buffer_commit_discard(benchmark::State &state) {
+        auto buf = std::make_unique<sk::fixed_buffer<T, 65536>>();
+        sk::bench::commit_discard(state, *buf, reset_buffer{});
+    }
+
+    template <typename T>
+    auto fixed_buffer_readable_ranges(benchmark::State &state) {
+        auto buf = std::make_unique<sk::fixed_buffer<T, 65536>>();
+        sk::bench::readable_ranges(state, *buf);
+    }
+
+} // namespace
+
+BENCHMARK_TEMPLATE(fixed_buffer_write_read, char)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(fixed_buffer_write_read, std::uint64_t)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(fixed_buffer_commit_discard, char)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(fixed_buffer_commit_discard, std::uint64_t)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(fixed_buffer_readable_ranges, char)
+    ->Apply(sk::bench::chunk_sizes);
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <vector>
+
+#include "sk/buffer/dynamic_buffer.hxx"
+#include "sk/buffer/hybrid_buffer.hxx"
+
+#include "bench_common.hxx"
+
+namespace {
+
+    template <typename Buffer>
+    auto hybrid_buffer_write_read(benchmark::State &state) {
+        Buffer buf;
+        sk::bench::write_read(state, buf);
+    }
+
+    template <typename Buffer>
+    auto hybrid_buffer_commit_discard(benchmark::State &state) {
+        Buffer buf;
+        sk::bench::commit_discard(state, buf);
+    }
+
+    // A short-lived buffer per message, e.g. one per request object:
+    // create the buffer, write a message, read it back and destroy it.
+    template <typename Buffer>
+    auto buffer_per_message(benchmark::State &state) {
+        using value_type = sk::buffer_value_t<Buffer>;
+
+        auto chunk = static_cast<std::size_t>(state.range(0));
+        auto in = sk::bench::make_data<value_type>(chunk);
+        std::vector<value_type> out(chunk);
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            Buffer buf;
+            buf.write(in);
+            nbytes += buf.read(out) * sizeof(value_type);
+            benchmark::DoNotOptimize(out.data());
+            benchmark::ClobberMemory();
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+} // namespace
+
+BENCHMARK_TEMPLATE(hybrid_buffer_write_read, sk::hybrid_buffer<char>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(hybrid_buffer_commit_discard, sk::hybrid_buffer<char>)
+    ->Apply(sk::bench::chunk_sizes);
+
+// Messages which fit in the inline storage, and one which doesn't.
+BENCHMARK_TEMPLATE(buffer_per_message, sk::hybrid_buffer<char, 512>)
+    ->Arg(40)
+    ->Arg(512)
+    ->Arg(4096);
+BENCHMARK_TEMPLATE(buffer_per_message, sk::dynamic_buffer<char>)
+    ->Arg(40)
+    ->Arg(512)
+    ->Arg(4096);
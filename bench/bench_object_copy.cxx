@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "sk/buffer/object_copy.hxx"
+
+#include "bench_common.hxx"
+
+namespace {
+
+    // Larger copies than the buffer benchmarks, to reach the point where
+    // non-temporal stores help.
+    auto copy_sizes(benchmark::internal::Benchmark *b) -> void {
+        b->RangeMultiplier(16)->Range(256, 16 * 1024 * 1024);
+    }
+
+    template <typename Copy>
+    auto copy_bench(benchmark::State &state, Copy copy) -> void {
+        auto n = static_cast<std::size_t>(state.range(0));
+        auto in = sk::bench::make_data<std::uint8_t>(n);
+        std::vector<std::uint8_t> out(n);
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            copy(out.data(), in.data(), n);
+            benchmark::ClobberMemory();
+            nbytes += n;
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+    auto copy_ranges_copy(benchmark::State &state) {
+        copy_bench(state, [](auto *dst, auto const *src, std::size_t n) {
+            std::ranges::copy(std::span(src, n), dst);
+        });
+    }
+
+    auto copy_objects(benchmark::State &state) {
+        copy_bench(state, [](auto *dst, auto const *src, std::size_t n) {
+            sk::copy_objects(dst, src, n);
+        });
+    }
+
+    auto copy_objects_nontemporal(benchmark::State &state) {
+        copy_bench(state, [](auto *dst, auto const *src, std::size_t n) {
+            sk::copy_objects_nontemporal(dst, src, n);
+        });
+    }
+
+} // namespace
+
+BENCHMARK(copy_ranges_copy)->Apply(copy_sizes);
+BENCHMARK(copy_objects)->Apply(copy_sizes);
+BENCHMARK(copy_objects_nontemporal)->Apply(copy_sizes);
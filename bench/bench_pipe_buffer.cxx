@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#if defined(__linux__)
+
+#    include <cstdlib>
+
+#    include <fcntl.h>
+#    include <unistd.h>
+
+#    include "sk/buffer/buffer_io.hxx"
+#    include "sk/buffer/dynamic_buffer.hxx"
+#    include "sk/buffer/pipe_buffer.hxx"
+
+#    include "bench_common.hxx"
+
+/*
+ * Forwarding a file to /dev/null, either through a pipe_buffer with
+ * splice() or by reading it into a dynamic_buffer and writing it out.  The
+ * file stays in the page cache, so this measures the copying and system
+ * call overhead rather than the disk.
+ */
+
+namespace {
+
+    // A temporary file of the given size.
+    struct bench_file {
+        int fd;
+
+        explicit bench_file(std::size_t size) {
+            char name[] = "/tmp/bench_pipe_buffer.XXXXXX";
+            fd = ::mkstemp(name);
+            ::unlink(name);
+
+            auto data = sk::bench::make_data<char>(size);
+            if (::write(fd, data.data(), data.size()) !=
+                static_cast<ssize_t>(data.size()))
+                std::abort();
+        }
+
+        ~bench_file() {
+            ::close(fd);
+        }
+    };
+
+    auto file_sizes(benchmark::internal::Benchmark *b) -> void {
+        b->RangeMultiplier(16)->Range(4096, 16 * 1024 * 1024);
+    }
+
+    auto forward_splice(benchmark::State &state) {
+        auto size = static_cast<std::size_t>(state.range(0));
+        bench_file file(size);
+        int null = ::open("/dev/null", O_WRONLY);
+        sk::pipe_buffer<char> buf;
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            ::lseek(file.fd, 0, SEEK_SET);
+            while (buf.splice_from(file.fd) > 0)
+                while (!buf.empty())
+                    nbytes += buf.splice_to(null);
+        }
+        sk::bench::report(state, allocs, nbytes);
+        ::close(null);
+    }
+
+    auto forward_copy(benchmark::State &state) {
+        auto size = static_cast<std::size_t>(state.range(0));
+        bench_file file(size);
+        int null = ::open("/dev/null", O_WRONLY);
+        sk::dynamic_buffer<char, 65536> buf;
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            ::lseek(file.fd, 0, SEEK_SET);
+            while (sk::buffer_read_from(file.fd, buf) > 0)
+                while (!buf.empty())
+                    nbytes += sk::buffer_write_to(null, buf);
+        }
+        sk::bench::report(state, allocs, nbytes);
+        ::close(null);
+    }
+
+} // namespace
+
+BENCHMARK(forward_splice)->Apply(file_sizes);
+BENCHMARK(forward_copy)->Apply(file_sizes);
+
+#endif // defined(__linux__)
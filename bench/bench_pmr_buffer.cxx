@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <array>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "sk/buffer/circular_buffer.hxx"
+#include "sk/buffer/dynamic_buffer.hxx"
+#include "sk/buffer/pmr_buffer.hxx"
+
+#include "bench_common.hxx"
+
+/*
+ * These measure the cost of going through pmr_buffer_adapter compared to
+ * using the wrapped buffer directly; compare with the corresponding
+ * benchmarks in bench_circular_buffer.cxx and bench_dynamic_buffer.cxx.
+ */
+
+namespace {
+
+    // Call write() and read() through the virtual interface.
+    template <typename Buffer>
+    auto pmr_adapter_write_read(benchmark::State &state) {
+        using value_type = sk::buffer_value_t<Buffer>;
+
+        auto base = std::make_unique<Buffer>();
+        auto adapter = sk::make_pmr_buffer_adapter(*base);
+        sk::pmr_readable_buffer<value_type> &reader = adapter;
+        sk::pmr_writable_buffer<value_type> &writer = adapter;
+
+        auto chunk = static_cast<std::size_t>(state.range(0));
+        auto in = sk::bench::make_data<value_type>(chunk);
+        std::vector<value_type> out(chunk);
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            writer.write(std::span<value_type const>(in));
+            nbytes += reader.read(out) * sizeof(value_type);
+            benchmark::DoNotOptimize(out.data());
+            benchmark::ClobberMemory();
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+    // Use writable_ranges(), commit(), readable_ranges() and discard()
+    // through the virtual interface.  Each range list is a std::vector, so
+    // this shows the allocation cost of crossing the interface.
+    template <typename Buffer>
+    auto pmr_adapter_commit_discard(benchmark::State &state) {
+        using value_type = sk::buffer_value_t<Buffer>;
+
+        auto base = std::make_unique<Buffer>();
+        auto adapter = sk::make_pmr_buffer_adapter(*base);
+        sk::pmr_readable_buffer<value_type> &reader = adapter;
+        sk::pmr_writable_buffer<value_type> &writer = adapter;
+
+        auto chunk = static_cast<std::size_t>(state.range(0));
+        auto in = sk::bench::make_data<value_type>(chunk);
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            std::size_t n = 0;
+            for (auto &&range : writer.writable_ranges()) {
+                auto m = std::min(range.size(), chunk - n);
+                std::copy_n(in.data() + n, m, range.data());
+                n += m;
+                if (n == chunk)
+                    break;
+            }
+            writer.commit(n);
+
+            for (auto &&range : reader.readable_ranges())
+                benchmark::DoNotOptimize(range.data());
+
+            nbytes += reader.discard(n) * sizeof(value_type);
+            benchmark::ClobberMemory();
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+    // The same as pmr_adapter_commit_discard, using the batched interface,
+    // which doesn't allocate.
+    template <typename Buffer>
+    auto pmr_adapter_batched(benchmark::State &state) {
+        using value_type = sk::buffer_value_t<Buffer>;
+
+        auto base = std::make_unique<Buffer>();
+        auto adapter = sk::make_pmr_buffer_adapter(*base);
+        sk::pmr_readable_buffer<value_type> &reader = adapter;
+        sk::pmr_writable_buffer<value_type> &writer = adapter;
+
+        auto chunk = static_cast<std::size_t>(state.range(0));
+        auto in = sk::bench::make_data<value_type>(chunk);
+        std::array<std::span<value_type>, 16> wranges;
+        std::array<std::span<value_type const>, 16> rranges;
+        std::size_t nbytes = 0;
+
+        auto nw = writer.fill_writable_ranges(wranges);
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            std::size_t n = 0;
+            for (auto &range : std::span(wranges).first(nw)) {
+                auto m = std::min(range.size(), chunk - n);
+                std::copy_n(in.data() + n, m, range.data());
+                n += m;
+                if (n == chunk)
+                    break;
+            }
+
+            writer.commit(n);
+            auto nr = reader.fill_readable_ranges(rranges);
+            for (auto &range : std::span(rranges).first(nr))
+                benchmark::DoNotOptimize(range.data());
+
+            auto result = reader.discard_and_fill_readable_ranges(n, rranges);
+            nbytes += result.count * sizeof(value_type);
+            nw = writer.fill_writable_ranges(wranges);
+            benchmark::ClobberMemory();
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+    // write() and read() through an any_buffer holding the buffer inline.
+    auto any_buffer_write_read(benchmark::State &state) {
+        sk::any_buffer<char> buf(sk::dynamic_buffer<char, 4096>{});
+
+        auto chunk = static_cast<std::size_t>(state.range(0));
+        auto in = sk::bench::make_data<char>(chunk);
+        std::vector<char> out(chunk);
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            buf.write(in);
+            nbytes += buf.read(out);
+            benchmark::DoNotOptimize(out.data());
+            benchmark::ClobberMemory();
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+} // namespace
+
+BENCHMARK_TEMPLATE(pmr_adapter_write_read, sk::circular_buffer<char, 65536>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(pmr_adapter_write_read, sk::dynamic_buffer<char, 4096>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(pmr_adapter_commit_discard,
+                   sk::circular_buffer<char, 65536>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(pmr_adapter_commit_discard,
+                   sk::dynamic_buffer<char, 4096>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(pmr_adapter_batched, sk::circular_buffer<char, 65536>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(pmr_adapter_batched, sk::dynamic_buffer<char, 4096>)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK(any_buffer_write_read)->Apply(sk::bench::chunk_sizes);
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <cstdint>
+#include <vector>
+
+#include "sk/buffer/range_buffer.hxx"
+
+#include "bench_common.hxx"
+
+namespace {
+
+    // Read a chunk from a readable_range_buffer over a vector.
+    template <typename T>
+    auto readable_range_buffer_read(benchmark::State &state) {
+        auto chunk = static_cast<std::size_t>(state.range(0));
+        auto in = sk::bench::make_data<T>(chunk);
+        std::vector<T> out(chunk);
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            auto buf = sk::make_readable_range_buffer(in);
+            nbytes += buf.read(out) * sizeof(T);
+            benchmark::DoNotOptimize(out.data());
+            benchmark::ClobberMemory();
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+    // Write a chunk to a writable_range_buffer over a vector.
+    template <typename T>
+    auto writable_range_buffer_write(benchmark::State &state) {
+        auto chunk = static_cast<std::size_t>(state.range(0));
+        auto in = sk::bench::make_data<T>(chunk);
+        std::vector<T> out(chunk);
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            auto buf = sk::make_writable_range_buffer(out);
+            nbytes += buf.write(in) * sizeof(T);
+            benchmark::DoNotOptimize(out.data());
+            benchmark::ClobberMemory();
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+    // Visit readable_ranges() and discard() a chunk.
+    template <typename T>
+    auto readable_range_buffer_discard(benchmark::State &state) {
+        auto chunk = static_cast<std::size_t>(state.range(0));
+        auto in = sk::bench::make_data<T>(chunk);
+        std::size_t nbytes = 0;
+
+        auto allocs = sk::bench::allocation_count();
+        for (auto _ : state) {
+            auto buf = sk::make_readable_range_buffer(in);
+            for (auto &&range : buf.readable_ranges())
+                benchmark::DoNotOptimize(range.data());
+            nbytes += buf.discard(chunk) * sizeof(T);
+        }
+        sk::bench::report(state, allocs, nbytes);
+    }
+
+} // namespace
+
+BENCHMARK_TEMPLATE(readable_range_buffer_read, char)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(readable_range_buffer_read, std::uint64_t)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(writable_range_buffer_write, char)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(writable_range_buffer_write, std::uint64_t)
+    ->Apply(sk::bench::chunk_sizes);
+BENCHMARK_TEMPLATE(readable_range_buffer_discard, char)
+    ->Apply(sk::bench::chunk_sizes);
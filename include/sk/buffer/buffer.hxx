@@ -34,12 +34,16 @@
 #define SK_BUFFER_BUFFER_HXX_INCLUDED
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
+#include <initializer_list>
 #include <ranges>
 #include <span>
 #include <type_traits>
 
+#include "sk/buffer/object_copy.hxx"
+
 namespace sk {
 
     /*
@@ -63,6 +67,17 @@ namespace sk {
         std::ranges::contiguous_range<T>
         and range_of<T, Value>;
 
+    /*
+     * Concept of a list of ranges, as returned by readable_ranges() and
+     * writable_ranges().  Any forward range whose elements are of type Range
+     * is acceptable, so buffers can return a list without allocating
+     * memory for it.
+     */
+    template <typename T, typename Range>
+    concept range_list_of =
+        std::ranges::forward_range<T>
+        and std::same_as<std::ranges::range_value_t<T>, Range>;
+
     /*************************************************************************
      * 
      * Concept of a buffer that holds objects of type Char.
@@ -95,9 +110,8 @@ namespace sk {
 
             // Get the buffer's readable extents.
             { b.readable_ranges() } 
-                -> std::same_as<
-                    std::vector<
-                        std::span<typename Buffer::const_value_type>>>;
+                -> range_list_of<
+                    std::span<typename Buffer::const_value_type>>;
 
             // Remove data from the start of the buffer.
             { b.discard(nbytes) } -> std::same_as<typename Buffer::size_type>;
@@ -123,9 +137,8 @@ namespace sk {
 
             // Get the buffer's writable extents.
             { b.writable_ranges() }
-                -> std::same_as<
-                    std::vector<
-                        std::span<typename Buffer::value_type>>>;
+                -> range_list_of<
+                    std::span<typename Buffer::value_type>>;
 
             // Mark empty space as readable.
             { b.commit(nbytes) } -> std::same_as<typename Buffer::size_type>;
@@ -151,6 +164,26 @@ namespace sk {
         and readable_buffer_of<Buffer, Char>
         and writable_buffer_of<Buffer, Char>;
 
+    /*************************************************************************
+     * 
+     * sized_buffer: concept of a buffer which can report how much data and
+     * space it contains in constant time.
+     */
+    template<typename Buffer>
+    concept sized_buffer =
+        basic_buffer<Buffer>
+        and requires(Buffer const &b) {
+            // The number of objects that can be read from the buffer.
+            { b.size() } -> std::same_as<typename Buffer::size_type>;
+
+            // The number of objects the buffer can hold without allocating
+            // more memory, i.e. size() plus the space available for writing.
+            { b.capacity() } -> std::same_as<typename Buffer::size_type>;
+
+            // True if size() == 0.
+            { b.empty() } -> std::same_as<bool>;
+        };
+
     // clang-format on
 
     /*************************************************************************
@@ -178,38 +211,231 @@ namespace sk {
      */
     template <typename T> concept extent = contiguous_range_of<T, std::byte>;
 
+    /*************************************************************************
+     *
+     * static_range_list: a list of ranges with a fixed maximum size, stored
+     * inline.  Buffers which know the upper bound on how many ranges they can
+     * return (for example, fixed_buffer always returns one range and
+     * circular_buffer at most two) use this for readable_ranges() and
+     * writable_ranges(), so returning the list doesn't allocate memory.
+     */
+    template <typename Range, std::size_t max_ranges>
+    struct static_range_list {
+        using value_type = Range;
+        using size_type = std::size_t;
+        using iterator = value_type *;
+        using const_iterator = value_type const *;
+
+        // Create an empty list.
+        static_range_list() = default;
+
+        // Create a list containing the given ranges.
+        static_range_list(std::initializer_list<value_type> init) {
+            assert(init.size() <= max_ranges);
+            for (auto &&range : init)
+                push_back(range);
+        }
+
+        // Add a range to the end of the list.
+        auto push_back(value_type const &range) -> void {
+            assert(nranges < max_ranges);
+            ranges[nranges++] = range;
+        }
+
+        auto size() const -> size_type {
+            return nranges;
+        }
+
+        auto empty() const -> bool {
+            return nranges == 0;
+        }
+
+        static constexpr auto capacity() -> size_type {
+            return max_ranges;
+        }
+
+        auto operator[](size_type n) -> value_type & {
+            assert(n < nranges);
+            return ranges[n];
+        }
+
+        auto operator[](size_type n) const -> value_type const & {
+            assert(n < nranges);
+            return ranges[n];
+        }
+
+        auto begin() -> iterator {
+            return ranges.data();
+        }
+
+        auto begin() const -> const_iterator {
+            return ranges.data();
+        }
+
+        auto end() -> iterator {
+            return ranges.data() + nranges;
+        }
+
+        auto end() const -> const_iterator {
+            return ranges.data() + nranges;
+        }
+
+      private:
+        std::array<value_type, max_ranges> ranges{};
+        size_type nranges = 0;
+    };
+
     /*************************************************************************
      *
      * Buffer utility functions.
      *
      */
 
+    /**
+     * buffer_size(b): return the number of objects that can be read from `b`.
+     * This is b.size() if the buffer is a sized_buffer, otherwise the total
+     * size of its readable ranges.
+     */
+    template <readable_buffer Buffer>
+    auto buffer_size(Buffer &b) -> buffer_size_t<Buffer> {
+        if constexpr (sized_buffer<Buffer>) {
+            return b.size();
+        } else {
+            buffer_size_t<Buffer> n = 0;
+            for (auto &&range : b.readable_ranges())
+                n += std::ranges::size(range);
+            return n;
+        }
+    }
+
     /**
      * buffer_copy(from, to): append all of the data in `from` to `to`, as if
-     * calling from.read(buf) then to.write(buf).
+     * calling from.read(buf) then to.write(buf), except that no data is
+     * removed from `from`.  Returns the number of objects copied, which may
+     * be less than the size of `from` if `to` is full.
      */
-    template <typename Char>
-    auto buffer_copy(readable_buffer_of<Char> auto const &from,
-                     writable_buffer_of<Char> auto &to) {
+    template <readable_buffer From, writable_buffer To>
+    auto buffer_copy(From &from, To &to) -> buffer_size_t<To>
+        requires std::same_as<buffer_value_t<From>, buffer_value_t<To>> {
+
+        buffer_size_t<To> ncopied = 0;
+
         for (auto &&range : from.readable_ranges()) {
-            to.write(range);
+            auto n = to.write(range);
+            ncopied += n;
+
+            // Stop if the destination buffer is full.
+            if (n < std::ranges::size(range))
+                break;
         }
+
+        return ncopied;
     }
 
     /**
      * buffer_move(from, to): append all of the data in `from` to `to`, then
-     * remove all the data in `from`, as if calling buffer_copy(from, to)
-     * followed by from.clear();
+     * remove the copied data from `from`, as if calling buffer_copy(from, to)
+     * followed by from.discard().  Returns the number of objects moved.
      */
     template <readable_buffer From, writable_buffer To>
-    auto buffer_move(From &from, To &to) requires std::same_as<
-        buffer_value_t<From>, buffer_value_t<To>> {
+    auto buffer_move(From &from, To &to) -> buffer_size_t<To>
+        requires std::same_as<buffer_value_t<From>, buffer_value_t<To>> {
 
-        for (auto &&range : from.readable_ranges()) {
-            to.write(range);
+        auto n = buffer_copy(from, to);
+        from.discard(n);
+        return n;
+    }
+
+    /**
+     * buffer_write_nontemporal(buf, data): write as much of `data` to `buf`
+     * as possible, as if by buf.write(data), but copying with
+     * copy_objects_nontemporal() so that large writes don't displace other
+     * data from the cache.  Returns the number of objects written.
+     */
+    template <writable_buffer Buffer, std::ranges::contiguous_range Range>
+    auto buffer_write_nontemporal(Buffer &buf, Range &&data)
+        -> buffer_size_t<Buffer>
+        requires std::same_as<
+            buffer_const_value_t<Buffer>,
+            std::add_const_t<std::ranges::range_value_t<Range>>> {
+
+        std::span<buffer_const_value_t<Buffer>> data_left(data);
+        buffer_size_t<Buffer> nwritten = 0;
+
+        // A buffer which grows, such as dynamic_buffer, may have more
+        // writable space after a commit, so keep going until the data is
+        // all written or the buffer is full.
+        while (!data_left.empty()) {
+            buffer_size_t<Buffer> ncopied = 0;
+
+            for (auto &&range : buf.writable_ranges()) {
+                auto n = std::min<std::size_t>(std::ranges::size(range),
+                                               data_left.size());
+                copy_objects_nontemporal(std::ranges::data(range),
+                                         data_left.data(), n);
+                data_left = data_left.subspan(n);
+                ncopied += n;
+
+                if (data_left.empty())
+                    break;
+            }
+
+            if (ncopied == 0)
+                break;
+
+            nwritten += buf.commit(ncopied);
         }
 
-        from.clear();
+        return nwritten;
+    }
+
+    /**
+     * buffer_peek_contiguous(buf, n, scratch): return a span containing the
+     * first n objects in `buf` without removing them.  If they are already
+     * contiguous (for example, they don't cross an extent boundary), the span
+     * refers to the buffer's own storage and nothing is copied; otherwise
+     * they are copied into `scratch`, and the span refers to that.  Call
+     * discard(n) to remove the data afterwards.
+     *
+     * Returns an empty span if the buffer has fewer than n objects, or if
+     * they need to be copied and `scratch` is smaller than n.  The span is
+     * valid until the buffer is next modified.
+     */
+    template <readable_buffer Buffer>
+    auto buffer_peek_contiguous(Buffer &buf, buffer_size_t<Buffer> n,
+                                std::span<buffer_value_t<Buffer>> scratch)
+        -> std::span<buffer_const_value_t<Buffer>> {
+        using span_type = std::span<buffer_const_value_t<Buffer>>;
+
+        auto ranges = buf.readable_ranges();
+        auto it = std::ranges::begin(ranges);
+        auto end = std::ranges::end(ranges);
+
+        while (it != end && std::ranges::empty(*it))
+            ++it;
+
+        if (it == end)
+            return {};
+
+        // The fast path: all the data is in the first range.
+        if (span_type first(*it); first.size() >= n)
+            return first.first(n);
+
+        if (scratch.size() < n)
+            return {};
+
+        buffer_size_t<Buffer> ncopied = 0;
+        for (; it != end && ncopied < n; ++it) {
+            span_type range(*it);
+            auto m = std::min<std::size_t>(range.size(), n - ncopied);
+            copy_objects(scratch.data() + ncopied, range.data(), m);
+            ncopied += m;
+        }
+
+        if (ncopied < n)
+            return {};
+
+        return span_type(scratch.first(n));
     }
 
 } // namespace sk
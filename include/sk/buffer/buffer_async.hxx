@@ -0,0 +1,808 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Coroutine-based asynchronous I/O between buffers and streams.
+ */
+
+#ifndef SK_BUFFER_BUFFER_ASYNC_HXX_INCLUDED
+#define SK_BUFFER_BUFFER_ASYNC_HXX_INCLUDED
+
+#include <array>
+#include <cassert>
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <new>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#if !defined(_WIN32)
+#    include <poll.h>
+#endif
+
+#include "sk/buffer/buffer.hxx"
+#include "sk/buffer/buffer_io.hxx"
+#include "sk/buffer/buffer_search.hxx"
+
+namespace sk {
+
+    /*************************************************************************
+     *
+     * Asynchronous buffer I/O using C++20 coroutines.
+     *
+     * co_await async_fill(stream, buf, min_size): read from the stream into
+     * buf until at least min_size bytes have been read, the stream reaches
+     * end of file, or buf is full.  Returns the number of bytes read.
+     *
+     * co_await async_drain(stream, buf): write all the data in buf to the
+     * stream.  Returns the number of bytes written.
+     *
+     * co_await async_read_until(stream, buf, delimiter[, max_size]): read
+     * from the stream into buf until buf contains delimiter.  Returns the
+     * offset just past the end of the first delimiter, or std::nullopt if
+     * the stream reached end of file first.  If there is no delimiter in
+     * the first max_size bytes, or buf fills up before the delimiter is
+     * read, the error is std::errc::message_size.
+     *
+     * Each transfer is a buffer_read_from() or buffer_write_to() call, which
+     * passes all of the buffer's ranges to the system in one scatter/gather
+     * call.  When the stream would block, the coroutine awaits the stream's
+     * wait_readable() or wait_writable(), which is where it connects to the
+     * caller's event loop: an awaitable which suspends until epoll, kqueue
+     * or similar reports that the descriptor is ready, then resumes the
+     * coroutine.  blocking_stream is a simple stream which waits with poll()
+     * instead of suspending.
+     *
+     * As with buffer_io, errors are reported by throwing std::system_error,
+     * or through a std::error_code & for the overloads which take one.
+     *
+     * Each operation is an async_task, which allocates its coroutine frame
+     * from a per-thread cache of recently freed frames, so a connection which
+     * repeatedly fills and drains its buffers doesn't allocate memory in the
+     * steady state.  To allocate frames elsewhere, pass std::allocator_arg
+     * and an allocator as the first two arguments, as with
+     * std::allocator_arg constructors.
+     */
+
+    // clang-format off
+
+    // Concept of a stream which can be used for asynchronous I/O.
+    template <typename Stream>
+    concept async_stream =
+        requires(Stream &stream) {
+            // The descriptor or socket to transfer data with, which should be
+            // non-blocking.
+            { stream.native_handle() } -> std::convertible_to<io_handle_type>;
+
+            // Return an awaitable which completes when the stream is ready
+            // for reading resp. writing.
+            stream.wait_readable();
+            stream.wait_writable();
+        };
+
+    // clang-format on
+
+    namespace detail {
+
+        /*
+         * Coroutine frame allocation.  Every frame is followed by a pointer
+         * to the function which frees it, so operator delete can free frames
+         * from any allocator.
+         */
+        using frame_free_function = void (*)(void *frame, std::size_t size);
+
+        struct alignas(std::max_align_t) frame_unit {
+            std::byte bytes[alignof(std::max_align_t)];
+        };
+
+        inline auto align_up(std::size_t n, std::size_t align) -> std::size_t {
+            return (n + align - 1) & ~(align - 1);
+        }
+
+        inline auto frame_free_offset(std::size_t size) -> std::size_t {
+            return align_up(size, alignof(frame_free_function));
+        }
+
+        template <typename Allocator> struct frame_allocation {
+            using unit_allocator = typename std::allocator_traits<
+                Allocator>::template rebind_alloc<frame_unit>;
+            using traits = std::allocator_traits<unit_allocator>;
+
+            static_assert(alignof(unit_allocator) <= alignof(frame_unit));
+
+            // The allocator is stored after the free function.
+            static auto allocator_offset(std::size_t size) -> std::size_t {
+                return align_up(frame_free_offset(size) +
+                                    sizeof(frame_free_function),
+                                alignof(unit_allocator));
+            }
+
+            static auto nunits(std::size_t size) -> std::size_t {
+                return (allocator_offset(size) + sizeof(unit_allocator) +
+                        sizeof(frame_unit) - 1) /
+                       sizeof(frame_unit);
+            }
+
+            static auto allocate(Allocator const &alloc, std::size_t size)
+                -> void * {
+                unit_allocator ualloc(alloc);
+                auto *frame = traits::allocate(ualloc, nunits(size));
+                auto *bytes = reinterpret_cast<std::byte *>(frame);
+
+                ::new (static_cast<void *>(bytes + frame_free_offset(size)))
+                    frame_free_function(&deallocate);
+                ::new (static_cast<void *>(bytes + allocator_offset(size)))
+                    unit_allocator(std::move(ualloc));
+                return frame;
+            }
+
+            static auto deallocate(void *frame, std::size_t size) -> void {
+                auto *bytes = static_cast<std::byte *>(frame);
+                auto *stored = std::launder(reinterpret_cast<unit_allocator *>(
+                    bytes + allocator_offset(size)));
+
+                unit_allocator ualloc(std::move(*stored));
+                stored->~unit_allocator();
+                traits::deallocate(ualloc, static_cast<frame_unit *>(frame),
+                                   nunits(size));
+            }
+        };
+
+        inline auto free_frame(void *frame, std::size_t size) -> void {
+            auto *bytes = static_cast<std::byte *>(frame);
+            auto fn = *std::launder(reinterpret_cast<frame_free_function *>(
+                bytes + frame_free_offset(size)));
+            fn(frame, size);
+        }
+
+        /*
+         * The per-thread cache used by recycling_frame_allocator.  Blocks
+         * are kept by size, rounded up to a multiple of 64 bytes, so a
+         * coroutine of the same type always fits in its predecessor's block.
+         */
+        struct frame_cache {
+            static constexpr std::size_t nslots = 8;
+            static constexpr std::size_t granularity = 64;
+
+            struct slot {
+                void *block = nullptr;
+                std::size_t size = 0;
+            };
+
+            std::array<slot, nslots> slots;
+
+            frame_cache() = default;
+            frame_cache(frame_cache const &) = delete;
+            frame_cache &operator=(frame_cache const &) = delete;
+
+            ~frame_cache() {
+                for (auto &s : slots)
+                    if (s.block)
+                        ::operator delete(s.block);
+            }
+
+            static auto get() -> frame_cache & {
+                thread_local frame_cache cache;
+                return cache;
+            }
+
+            auto allocate(std::size_t size) -> void * {
+                size = align_up(size, granularity);
+
+                for (auto &s : slots) {
+                    if (s.block && s.size == size)
+                        return std::exchange(s.block, nullptr);
+                }
+
+                return ::operator new(size);
+            }
+
+            auto deallocate(void *block, std::size_t size) -> void {
+                size = align_up(size, granularity);
+
+                for (auto &s : slots) {
+                    if (!s.block) {
+                        s.block = block;
+                        s.size = size;
+                        return;
+                    }
+                }
+
+                ::operator delete(block);
+            }
+        };
+
+    } // namespace detail
+
+    /*************************************************************************
+     *
+     * recycling_frame_allocator: an allocator which keeps a few recently
+     * freed blocks per thread and reuses them for allocations of the same
+     * size.  This is the default allocator for async_task frames.  Memory
+     * freed on a different thread from the one which allocated it goes into
+     * that thread's cache.
+     */
+
+    template <typename T> struct recycling_frame_allocator {
+        using value_type = T;
+
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+        recycling_frame_allocator() = default;
+
+        template <typename U>
+        recycling_frame_allocator(recycling_frame_allocator<U> const &) {}
+
+        auto allocate(std::size_t n) -> T * {
+            return static_cast<T *>(
+                detail::frame_cache::get().allocate(n * sizeof(T)));
+        }
+
+        auto deallocate(T *p, std::size_t n) -> void {
+            detail::frame_cache::get().deallocate(p, n * sizeof(T));
+        }
+
+        friend auto operator==(recycling_frame_allocator const &,
+                               recycling_frame_allocator const &) -> bool {
+            return true;
+        }
+    };
+
+    template <typename T> struct async_task;
+
+    namespace detail {
+
+        struct async_promise_base {
+            // The coroutine awaiting this one, if any.
+            std::coroutine_handle<> continuation;
+            std::exception_ptr exception;
+
+            auto initial_suspend() noexcept -> std::suspend_always {
+                return {};
+            }
+
+            struct final_awaiter {
+                auto await_ready() noexcept -> bool {
+                    return false;
+                }
+
+                template <typename Promise>
+                auto await_suspend(std::coroutine_handle<Promise> h) noexcept
+                    -> std::coroutine_handle<> {
+                    if (auto c = h.promise().continuation)
+                        return c;
+                    return std::noop_coroutine();
+                }
+
+                auto await_resume() noexcept -> void {}
+            };
+
+            auto final_suspend() noexcept -> final_awaiter {
+                return {};
+            }
+
+            auto unhandled_exception() -> void {
+                exception = std::current_exception();
+            }
+
+            auto rethrow_if_exception() -> void {
+                if (exception)
+                    std::rethrow_exception(exception);
+            }
+
+            // Allocate the frame with an allocator passed after
+            // std::allocator_arg, or else from the per-thread cache.
+            template <typename Allocator, typename... Args>
+            static auto operator new(std::size_t size, std::allocator_arg_t,
+                                     Allocator const &alloc, Args const &...)
+                -> void * {
+                return frame_allocation<Allocator>::allocate(alloc, size);
+            }
+
+            static auto operator new(std::size_t size) -> void * {
+                return frame_allocation<recycling_frame_allocator<
+                    std::byte>>::allocate({}, size);
+            }
+
+            static auto operator delete(void *frame, std::size_t size)
+                -> void {
+                free_frame(frame, size);
+            }
+        };
+
+        template <typename T> struct async_promise : async_promise_base {
+            std::optional<T> value;
+
+            template <typename U>
+            auto return_value(U &&v) -> void
+                requires std::convertible_to<U, T> {
+                value.emplace(std::forward<U>(v));
+            }
+
+            auto result() -> T {
+                rethrow_if_exception();
+                return std::move(*value);
+            }
+        };
+
+        template <> struct async_promise<void> : async_promise_base {
+            auto return_void() -> void {}
+
+            auto result() -> void {
+                rethrow_if_exception();
+            }
+        };
+
+    } // namespace detail
+
+    /*************************************************************************
+     *
+     * async_task<T>: a coroutine which produces a T.  The task doesn't run
+     * until it is awaited, and awaiting it returns its result or rethrows
+     * its exception.
+     *
+     * A task which isn't awaited by another coroutine, such as the top-level
+     * task for a connection, is started with start(); once done() is true,
+     * get() returns the result.
+     */
+
+    template <typename T> struct async_task {
+        struct promise_type : detail::async_promise<T> {
+            auto get_return_object() -> async_task {
+                return async_task(
+                    std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+        };
+
+        using handle_type = std::coroutine_handle<promise_type>;
+
+        async_task(async_task &&other) noexcept
+            : handle(std::exchange(other.handle, nullptr)) {}
+
+        async_task &operator=(async_task &&other) noexcept {
+            if (this != &other) {
+                if (handle)
+                    handle.destroy();
+                handle = std::exchange(other.handle, nullptr);
+            }
+            return *this;
+        }
+
+        async_task(async_task const &) = delete;
+        async_task &operator=(async_task const &) = delete;
+
+        ~async_task() {
+            if (handle)
+                handle.destroy();
+        }
+
+        // Run the task until it completes or first suspends.
+        auto start() -> void {
+            assert(handle && !handle.done());
+            handle.resume();
+        }
+
+        // Return true if the task has completed.
+        auto done() const -> bool {
+            return handle && handle.done();
+        }
+
+        // Return the result of a completed task, or rethrow its exception.
+        auto get() -> T {
+            assert(done());
+            return handle.promise().result();
+        }
+
+        auto operator co_await() && {
+            struct awaiter {
+                handle_type handle;
+
+                auto await_ready() noexcept -> bool {
+                    return false;
+                }
+
+                auto await_suspend(std::coroutine_handle<> awaiting) noexcept
+                    -> std::coroutine_handle<> {
+                    handle.promise().continuation = awaiting;
+                    return handle;
+                }
+
+                auto await_resume() -> T {
+                    return handle.promise().result();
+                }
+            };
+
+            assert(handle && !handle.done());
+            return awaiter{handle};
+        }
+
+      private:
+        explicit async_task(handle_type handle_) : handle(handle_) {}
+
+        handle_type handle;
+    };
+
+    /*************************************************************************
+     *
+     * blocking_stream: an async_stream which, when the descriptor isn't
+     * ready, waits for it with poll() (WSAPoll() on Windows) without
+     * suspending the coroutine.  This is useful for tests and for programs
+     * without an event loop.
+     */
+
+    struct blocking_stream {
+        io_handle_type handle;
+
+        auto native_handle() const -> io_handle_type {
+            return handle;
+        }
+
+        struct wait_awaiter {
+            io_handle_type handle;
+            short events;
+
+            auto await_ready() -> bool {
+#if defined(_WIN32)
+                WSAPOLLFD pfd{handle, events, 0};
+                ::WSAPoll(&pfd, 1, -1);
+#else
+                pollfd pfd{handle, events, 0};
+                while (::poll(&pfd, 1, -1) == -1 && errno == EINTR)
+                    ;
+#endif
+                return true;
+            }
+
+            auto await_suspend(std::coroutine_handle<>) -> void {}
+            auto await_resume() -> void {}
+        };
+
+        auto wait_readable() const -> wait_awaiter {
+            return {handle, POLLIN};
+        }
+
+        auto wait_writable() const -> wait_awaiter {
+            return {handle, POLLOUT};
+        }
+    };
+
+    static_assert(async_stream<blocking_stream>);
+
+    namespace detail {
+
+// GCC warns that the frames of the coroutines below, which are allocated
+// with the promise's allocator operator new, are freed with its usual
+// operator delete; that is how coroutine frames are always freed.
+#if defined(__GNUC__) && !defined(__clang__)
+#    pragma GCC diagnostic push
+#    pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+        inline auto would_block(std::error_code const &ec) -> bool {
+            return ec == std::errc::operation_would_block ||
+                   ec == std::errc::resource_unavailable_try_again;
+        }
+
+        // Report an error through ec, or by throwing if ec is null.
+        inline auto async_error(std::error_code *ec, std::error_code error,
+                                char const *what) -> void {
+            if (!ec)
+                throw std::system_error(error, what);
+            *ec = error;
+        }
+
+        template <typename Allocator, async_stream Stream,
+                  writable_buffer Buffer>
+        auto async_fill(std::allocator_arg_t, Allocator,
+                        Stream &stream, Buffer &buf,
+                        buffer_size_t<Buffer> min_size, std::error_code *ec)
+            -> async_task<buffer_size_t<Buffer>> {
+            buffer_size_t<Buffer> total = 0;
+
+            if (ec)
+                ec->clear();
+
+            while (total < min_size) {
+                std::error_code error;
+                auto n = buffer_read_from(stream.native_handle(), buf, error);
+
+                if (would_block(error)) {
+                    co_await stream.wait_readable();
+                    continue;
+                }
+
+                if (error) {
+                    async_error(ec, error, "async_fill");
+                    break;
+                }
+
+                // End of file, or the buffer is full.
+                if (n == 0)
+                    break;
+
+                total += n;
+            }
+
+            co_return total;
+        }
+
+        template <typename Allocator, async_stream Stream,
+                  readable_buffer Buffer>
+        auto async_drain(std::allocator_arg_t, Allocator,
+                         Stream &stream, Buffer &buf, std::error_code *ec)
+            -> async_task<buffer_size_t<Buffer>> {
+            buffer_size_t<Buffer> total = 0;
+
+            if (ec)
+                ec->clear();
+
+            for (;;) {
+                std::error_code error;
+                auto n = buffer_write_to(stream.native_handle(), buf, error);
+
+                if (would_block(error)) {
+                    co_await stream.wait_writable();
+                    continue;
+                }
+
+                if (error) {
+                    async_error(ec, error, "async_drain");
+                    break;
+                }
+
+                // The buffer is empty.
+                if (n == 0)
+                    break;
+
+                total += n;
+            }
+
+            co_return total;
+        }
+
+        // Return true if buf has any space to write to.
+        template <writable_buffer Buffer>
+        auto has_writable_space(Buffer &buf) -> bool {
+            for (auto &&range : buf.writable_ranges())
+                if (!std::ranges::empty(range))
+                    return true;
+            return false;
+        }
+
+        template <typename Allocator, async_stream Stream, buffer Buffer,
+                  typename Delimiter>
+        auto async_read_until(std::allocator_arg_t, Allocator,
+                              Stream &stream, Buffer &buf, Delimiter delimiter,
+                              buffer_size_t<Buffer> max_size,
+                              std::error_code *ec)
+            -> async_task<std::optional<buffer_size_t<Buffer>>> {
+            using value_type = buffer_value_t<Buffer>;
+
+            std::span<value_type const> delimiter_span(delimiter);
+            buffer_size_t<Buffer> from = 0;
+
+            if (ec)
+                ec->clear();
+
+            for (;;) {
+                if (auto pos = buffer_find(buf, delimiter_span, from)) {
+                    auto end = *pos + delimiter_span.size();
+                    if (end <= max_size)
+                        co_return end;
+                }
+
+                // Next time, only search the new data and the end of the old
+                // data, in case the delimiter crosses the boundary.
+                auto have = buffer_size(buf);
+                from = have >= delimiter_span.size()
+                           ? have - delimiter_span.size() + 1
+                           : 0;
+
+                // A full buffer can't hold the delimiter either, and reading
+                // into it would look like end of file.
+                if (have >= max_size || !has_writable_space(buf)) {
+                    async_error(ec,
+                                std::make_error_code(std::errc::message_size),
+                                "async_read_until");
+                    co_return std::nullopt;
+                }
+
+                std::error_code error;
+                auto n = buffer_read_from(stream.native_handle(), buf, error);
+
+                if (would_block(error)) {
+                    co_await stream.wait_readable();
+                    continue;
+                }
+
+                if (error) {
+                    async_error(ec, error, "async_read_until");
+                    co_return std::nullopt;
+                }
+
+                // End of file.
+                if (n == 0)
+                    co_return std::nullopt;
+            }
+        }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#    pragma GCC diagnostic pop
+#endif
+
+        using default_frame_allocator = recycling_frame_allocator<std::byte>;
+
+    } // namespace detail
+
+    /*
+     * async_fill(stream, buf, min_size = 1)
+     */
+    template <async_stream Stream, writable_buffer Buffer>
+    auto async_fill(Stream &stream, Buffer &buf,
+                    buffer_size_t<Buffer> min_size = 1)
+        -> async_task<buffer_size_t<Buffer>> requires io_buffer<Buffer> {
+        return detail::async_fill(std::allocator_arg,
+                                  detail::default_frame_allocator(), stream,
+                                  buf, min_size, nullptr);
+    }
+
+    template <async_stream Stream, writable_buffer Buffer>
+    auto async_fill(Stream &stream, Buffer &buf,
+                    buffer_size_t<Buffer> min_size, std::error_code &ec)
+        -> async_task<buffer_size_t<Buffer>> requires io_buffer<Buffer> {
+        return detail::async_fill(std::allocator_arg,
+                                  detail::default_frame_allocator(), stream,
+                                  buf, min_size, &ec);
+    }
+
+    template <typename Allocator, async_stream Stream, writable_buffer Buffer>
+    auto async_fill(std::allocator_arg_t, Allocator const &alloc,
+                    Stream &stream, Buffer &buf,
+                    buffer_size_t<Buffer> min_size = 1)
+        -> async_task<buffer_size_t<Buffer>> requires io_buffer<Buffer> {
+        return detail::async_fill(std::allocator_arg, alloc, stream, buf,
+                                  min_size, nullptr);
+    }
+
+    template <typename Allocator, async_stream Stream, writable_buffer Buffer>
+    auto async_fill(std::allocator_arg_t, Allocator const &alloc,
+                    Stream &stream, Buffer &buf,
+                    buffer_size_t<Buffer> min_size, std::error_code &ec)
+        -> async_task<buffer_size_t<Buffer>> requires io_buffer<Buffer> {
+        return detail::async_fill(std::allocator_arg, alloc, stream, buf,
+                                  min_size, &ec);
+    }
+
+    /*
+     * async_drain(stream, buf)
+     */
+    template <async_stream Stream, readable_buffer Buffer>
+    auto async_drain(Stream &stream, Buffer &buf)
+        -> async_task<buffer_size_t<Buffer>> requires io_buffer<Buffer> {
+        return detail::async_drain(std::allocator_arg,
+                                   detail::default_frame_allocator(), stream,
+                                   buf, nullptr);
+    }
+
+    template <async_stream Stream, readable_buffer Buffer>
+    auto async_drain(Stream &stream, Buffer &buf, std::error_code &ec)
+        -> async_task<buffer_size_t<Buffer>> requires io_buffer<Buffer> {
+        return detail::async_drain(std::allocator_arg,
+                                   detail::default_frame_allocator(), stream,
+                                   buf, &ec);
+    }
+
+    template <typename Allocator, async_stream Stream, readable_buffer Buffer>
+    auto async_drain(std::allocator_arg_t, Allocator const &alloc,
+                     Stream &stream, Buffer &buf)
+        -> async_task<buffer_size_t<Buffer>> requires io_buffer<Buffer> {
+        return detail::async_drain(std::allocator_arg, alloc, stream, buf,
+                                   nullptr);
+    }
+
+    template <typename Allocator, async_stream Stream, readable_buffer Buffer>
+    auto async_drain(std::allocator_arg_t, Allocator const &alloc,
+                     Stream &stream, Buffer &buf, std::error_code &ec)
+        -> async_task<buffer_size_t<Buffer>> requires io_buffer<Buffer> {
+        return detail::async_drain(std::allocator_arg, alloc, stream, buf,
+                                   &ec);
+    }
+
+    /*
+     * async_read_until(stream, buf, delimiter, max_size = unlimited)
+     *
+     * The delimiter is copied into the coroutine, so a temporary can be
+     * passed.  For a string literal, pass a std::string_view, since a char
+     * array includes the terminating NUL.
+     */
+    template <async_stream Stream, buffer Buffer,
+              std::ranges::contiguous_range Delimiter>
+    auto async_read_until(Stream &stream, Buffer &buf, Delimiter delimiter,
+                          buffer_size_t<Buffer> max_size =
+                              std::numeric_limits<buffer_size_t<Buffer>>::max())
+        -> async_task<std::optional<buffer_size_t<Buffer>>> requires
+        io_buffer<Buffer> && std::same_as<
+            buffer_value_t<Buffer>,
+            std::remove_const_t<std::ranges::range_value_t<Delimiter>>> {
+        return detail::async_read_until(
+            std::allocator_arg, detail::default_frame_allocator(), stream, buf,
+            std::move(delimiter), max_size, nullptr);
+    }
+
+    template <async_stream Stream, buffer Buffer,
+              std::ranges::contiguous_range Delimiter>
+    auto async_read_until(Stream &stream, Buffer &buf, Delimiter delimiter,
+                          buffer_size_t<Buffer> max_size, std::error_code &ec)
+        -> async_task<std::optional<buffer_size_t<Buffer>>> requires
+        io_buffer<Buffer> && std::same_as<
+            buffer_value_t<Buffer>,
+            std::remove_const_t<std::ranges::range_value_t<Delimiter>>> {
+        return detail::async_read_until(
+            std::allocator_arg, detail::default_frame_allocator(), stream, buf,
+            std::move(delimiter), max_size, &ec);
+    }
+
+    template <typename Allocator, async_stream Stream, buffer Buffer,
+              std::ranges::contiguous_range Delimiter>
+    auto async_read_until(std::allocator_arg_t, Allocator const &alloc,
+                          Stream &stream, Buffer &buf, Delimiter delimiter,
+                          buffer_size_t<Buffer> max_size =
+                              std::numeric_limits<buffer_size_t<Buffer>>::max())
+        -> async_task<std::optional<buffer_size_t<Buffer>>> requires
+        io_buffer<Buffer> && std::same_as<
+            buffer_value_t<Buffer>,
+            std::remove_const_t<std::ranges::range_value_t<Delimiter>>> {
+        return detail::async_read_until(std::allocator_arg, alloc, stream, buf,
+                                        std::move(delimiter), max_size,
+                                        nullptr);
+    }
+
+    template <typename Allocator, async_stream Stream, buffer Buffer,
+              std::ranges::contiguous_range Delimiter>
+    auto async_read_until(std::allocator_arg_t, Allocator const &alloc,
+                          Stream &stream, Buffer &buf, Delimiter delimiter,
+                          buffer_size_t<Buffer> max_size, std::error_code &ec)
+        -> async_task<std::optional<buffer_size_t<Buffer>>> requires
+        io_buffer<Buffer> && std::same_as<
+            buffer_value_t<Buffer>,
+            std::remove_const_t<std::ranges::range_value_t<Delimiter>>> {
+        return detail::async_read_until(std::allocator_arg, alloc, stream, buf,
+                                        std::move(delimiter), max_size, &ec);
+    }
+
+} // namespace sk
+
+#endif // SK_BUFFER_BUFFER_ASYNC_HXX_INCLUDED
@@ -0,0 +1,872 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Checksums and hashes over the data in a buffer.
+ */
+
+#ifndef SK_BUFFER_BUFFER_CHECKSUM_HXX_INCLUDED
+#define SK_BUFFER_BUFFER_CHECKSUM_HXX_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <ranges>
+#include <span>
+
+#if defined(__SSE4_2__) && defined(__x86_64__)
+#    include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#    include <arm_acle.h>
+#endif
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) ||                                 \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#endif
+
+#include "sk/buffer/buffer.hxx"
+
+namespace sk {
+
+    /*************************************************************************
+     *
+     * Incremental checksums: a checksum is fed data in any number of pieces
+     * with update(), and value() returns the checksum of all the data seen
+     * so far.  Feeding the data one range at a time gives the same result as
+     * feeding it all at once, so a checksum can be computed over the
+     * readable ranges of a buffer without copying the data into a
+     * contiguous block first.
+     *
+     * crc32c is the Castagnoli CRC-32 (as used by iSCSI, SCTP and ext4).  It
+     * uses the CRC32 instruction when the target has SSE 4.2 or the ARMv8
+     * CRC extension, and a table-driven slice-by-8 loop otherwise.
+     *
+     * xxh3_64 is the 64-bit XXH3 hash from xxHash, with an optional seed.
+     * Its result is the same as XXH3_64bits_withSeed().  The inner loop is
+     * vectorised with AVX2 or SSE2 where available.
+     *
+     * buffer_checksum(buf, sum, n) feeds the first n objects of readable
+     * data in buf into sum, without removing them from the buffer.
+     *
+     * checksummed_buffer wraps a writable buffer and feeds data into a
+     * checksum as it is written or committed, while the data is still in the
+     * cache.
+     */
+
+    // clang-format off
+
+    // Concept of an incremental checksum.
+    template <typename T>
+    concept checksum =
+        requires(T &sum, T const &csum, std::span<std::byte const> data) {
+            typename T::value_type;
+
+            // Add data to the checksum.
+            { sum.update(data) } -> std::same_as<void>;
+
+            // Return the checksum of the data added so far.
+            { csum.value() } -> std::same_as<typename T::value_type>;
+
+            // Return to the initial state.
+            { sum.reset() } -> std::same_as<void>;
+        };
+
+    // clang-format on
+
+    namespace detail {
+
+        inline auto byteswap32(std::uint32_t v) -> std::uint32_t {
+            return ((v & 0x000000FFU) << 24) | ((v & 0x0000FF00U) << 8) |
+                   ((v & 0x00FF0000U) >> 8) | ((v & 0xFF000000U) >> 24);
+        }
+
+        inline auto byteswap64(std::uint64_t v) -> std::uint64_t {
+            return (std::uint64_t(byteswap32(static_cast<std::uint32_t>(v)))
+                    << 32) |
+                   byteswap32(static_cast<std::uint32_t>(v >> 32));
+        }
+
+        inline auto load_le32(std::byte const *p) -> std::uint32_t {
+            std::uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            if constexpr (std::endian::native == std::endian::big)
+                v = byteswap32(v);
+            return v;
+        }
+
+        inline auto load_le64(std::byte const *p) -> std::uint64_t {
+            return std::uint64_t(load_le32(p)) |
+                   (std::uint64_t(load_le32(p + 4)) << 32);
+        }
+
+        inline auto store_le64(std::byte *p, std::uint64_t v) -> void {
+            if constexpr (std::endian::native == std::endian::big)
+                v = byteswap64(v);
+            std::memcpy(p, &v, sizeof(v));
+        }
+
+        /*
+         * CRC-32C.
+         */
+
+        // The reflected Castagnoli polynomial.
+        inline constexpr std::uint32_t crc32c_polynomial = 0x82F63B78U;
+
+        // Tables for slice-by-8: table[0] is the usual byte-at-a-time table
+        // and table[k][b] is the CRC of b followed by k zero bytes.
+        inline constexpr auto crc32c_table = [] {
+            std::array<std::array<std::uint32_t, 256>, 8> table{};
+
+            for (std::uint32_t i = 0; i < 256; ++i) {
+                auto crc = i;
+                for (int bit = 0; bit < 8; ++bit)
+                    crc = (crc >> 1) ^ (crc32c_polynomial & (0U - (crc & 1)));
+                table[0][i] = crc;
+            }
+
+            for (std::size_t i = 0; i < 256; ++i)
+                for (std::size_t k = 1; k < 8; ++k)
+                    table[k][i] = (table[k - 1][i] >> 8) ^
+                                  table[0][table[k - 1][i] & 0xFF];
+
+            return table;
+        }();
+
+        inline auto crc32c_update_software(std::uint32_t crc,
+                                           std::byte const *p,
+                                           std::size_t n) -> std::uint32_t {
+            auto const &t = crc32c_table;
+
+            for (; n >= 8; n -= 8, p += 8) {
+                auto lo = load_le32(p) ^ crc;
+                auto hi = load_le32(p + 4);
+                crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^
+                      t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+                      t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^
+                      t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+            }
+
+            for (; n > 0; --n, ++p)
+                crc = (crc >> 8) ^
+                      t[0][(crc ^ std::to_integer<std::uint32_t>(*p)) & 0xFF];
+
+            return crc;
+        }
+
+        inline auto crc32c_update(std::uint32_t crc, std::byte const *p,
+                                  std::size_t n) -> std::uint32_t {
+#if defined(__SSE4_2__) && defined(__x86_64__)
+            std::uint64_t crc64 = crc;
+            for (; n >= 8; n -= 8, p += 8)
+                crc64 = _mm_crc32_u64(crc64, load_le64(p));
+            crc = static_cast<std::uint32_t>(crc64);
+
+            for (; n > 0; --n, ++p)
+                crc = _mm_crc32_u8(crc, std::to_integer<std::uint8_t>(*p));
+            return crc;
+#elif defined(__ARM_FEATURE_CRC32)
+            for (; n >= 8; n -= 8, p += 8)
+                crc = __crc32cd(crc, load_le64(p));
+
+            for (; n > 0; --n, ++p)
+                crc = __crc32cb(crc, std::to_integer<std::uint8_t>(*p));
+            return crc;
+#else
+            return crc32c_update_software(crc, p, n);
+#endif
+        }
+
+        /*
+         * XXH3.
+         */
+
+        inline constexpr std::uint32_t xxh_prime32_1 = 0x9E3779B1U;
+        inline constexpr std::uint32_t xxh_prime32_2 = 0x85EBCA77U;
+        inline constexpr std::uint32_t xxh_prime32_3 = 0xC2B2AE3DU;
+        inline constexpr std::uint64_t xxh_prime64_1 = 0x9E3779B185EBCA87ULL;
+        inline constexpr std::uint64_t xxh_prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+        inline constexpr std::uint64_t xxh_prime64_3 = 0x165667B19E3779F9ULL;
+        inline constexpr std::uint64_t xxh_prime64_4 = 0x85EBCA77C2B2AE63ULL;
+        inline constexpr std::uint64_t xxh_prime64_5 = 0x27D4EB2F165667C5ULL;
+        inline constexpr std::uint64_t xxh_prime_mx1 = 0x165667919E3779F9ULL;
+        inline constexpr std::uint64_t xxh_prime_mx2 = 0x9FB21C651E98DF25ULL;
+
+        inline constexpr std::size_t xxh3_stripe_size = 64;
+        inline constexpr std::size_t xxh3_secret_size = 192;
+        inline constexpr std::size_t xxh3_midsize_max = 240;
+
+        // The default secret.
+        alignas(64) inline constexpr std::uint8_t xxh3_default_secret[] = {
+            0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81,
+            0x2c, 0xf7, 0x21, 0xad, 0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90,
+            0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f, 0xcb,
+            0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d,
+            0xcc, 0xff, 0x72, 0x21, 0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24,
+            0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28,
+            0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b,
+            0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e,
+            0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8, 0xa8, 0xfa, 0x76,
+            0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b,
+            0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8,
+            0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83,
+            0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63,
+            0xeb, 0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16,
+            0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d,
+            0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+            0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb,
+            0xca, 0xbb, 0x4b, 0x40, 0x7e,
+        };
+
+        static_assert(sizeof(xxh3_default_secret) == xxh3_secret_size);
+
+        inline auto xxh3_secret_bytes(std::size_t offset) -> std::byte const * {
+            return reinterpret_cast<std::byte const *>(xxh3_default_secret) +
+                   offset;
+        }
+
+        // Multiply two 64-bit values and fold the 128-bit product by XORing
+        // its two halves.
+        inline auto xxh_mul128_fold64(std::uint64_t a, std::uint64_t b)
+            -> std::uint64_t {
+#if defined(__SIZEOF_INT128__)
+            auto product = static_cast<unsigned __int128>(a) * b;
+            return static_cast<std::uint64_t>(product) ^
+                   static_cast<std::uint64_t>(product >> 64);
+#else
+            auto lo_lo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+            auto hi_lo = (a >> 32) * (b & 0xFFFFFFFF);
+            auto lo_hi = (a & 0xFFFFFFFF) * (b >> 32);
+            auto hi_hi = (a >> 32) * (b >> 32);
+            auto cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+            auto upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+            auto lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+            return lower ^ upper;
+#endif
+        }
+
+        inline auto xxh64_avalanche(std::uint64_t h) -> std::uint64_t {
+            h ^= h >> 33;
+            h *= xxh_prime64_2;
+            h ^= h >> 29;
+            h *= xxh_prime64_3;
+            h ^= h >> 32;
+            return h;
+        }
+
+        inline auto xxh3_avalanche(std::uint64_t h) -> std::uint64_t {
+            h ^= h >> 37;
+            h *= xxh_prime_mx1;
+            h ^= h >> 32;
+            return h;
+        }
+
+        inline auto xxh3_rrmxmx(std::uint64_t h, std::uint64_t len)
+            -> std::uint64_t {
+            h ^= std::rotl(h, 49) ^ std::rotl(h, 24);
+            h *= xxh_prime_mx2;
+            h ^= (h >> 35) + len;
+            h *= xxh_prime_mx2;
+            return h ^ (h >> 28);
+        }
+
+        inline auto xxh3_mix16(std::byte const *p, std::byte const *secret,
+                               std::uint64_t seed) -> std::uint64_t {
+            return xxh_mul128_fold64(
+                load_le64(p) ^ (load_le64(secret) + seed),
+                load_le64(p + 8) ^ (load_le64(secret + 8) - seed));
+        }
+
+        // Hash an input of up to xxh3_midsize_max bytes, using the default
+        // secret.
+        inline auto xxh3_64_short(std::byte const *p, std::size_t len,
+                                  std::uint64_t seed) -> std::uint64_t {
+            auto secret = xxh3_secret_bytes(0);
+
+            if (len == 0)
+                return xxh64_avalanche(seed ^ load_le64(secret + 56) ^
+                                       load_le64(secret + 64));
+
+            if (len <= 3) {
+                auto c1 = std::to_integer<std::uint32_t>(p[0]);
+                auto c2 = std::to_integer<std::uint32_t>(p[len >> 1]);
+                auto c3 = std::to_integer<std::uint32_t>(p[len - 1]);
+                auto combined = (c1 << 16) | (c2 << 24) | c3 |
+                                (static_cast<std::uint32_t>(len) << 8);
+                auto bitflip =
+                    (load_le32(secret) ^ load_le32(secret + 4)) + seed;
+                return xxh64_avalanche(std::uint64_t(combined) ^ bitflip);
+            }
+
+            if (len <= 8) {
+                seed ^= std::uint64_t(
+                            byteswap32(static_cast<std::uint32_t>(seed)))
+                        << 32;
+                auto in1 = load_le32(p);
+                auto in2 = load_le32(p + len - 4);
+                auto bitflip =
+                    (load_le64(secret + 8) ^ load_le64(secret + 16)) - seed;
+                auto in64 = in2 + (std::uint64_t(in1) << 32);
+                return xxh3_rrmxmx(in64 ^ bitflip, len);
+            }
+
+            if (len <= 16) {
+                auto bitflip1 =
+                    (load_le64(secret + 24) ^ load_le64(secret + 32)) + seed;
+                auto bitflip2 =
+                    (load_le64(secret + 40) ^ load_le64(secret + 48)) - seed;
+                auto lo = load_le64(p) ^ bitflip1;
+                auto hi = load_le64(p + len - 8) ^ bitflip2;
+                auto acc = len + byteswap64(lo) + hi +
+                           xxh_mul128_fold64(lo, hi);
+                return xxh3_avalanche(acc);
+            }
+
+            auto acc = len * xxh_prime64_1;
+
+            if (len <= 128) {
+                if (len > 32) {
+                    if (len > 64) {
+                        if (len > 96) {
+                            acc += xxh3_mix16(p + 48, secret + 96, seed);
+                            acc += xxh3_mix16(p + len - 64, secret + 112,
+                                              seed);
+                        }
+                        acc += xxh3_mix16(p + 32, secret + 64, seed);
+                        acc += xxh3_mix16(p + len - 48, secret + 80, seed);
+                    }
+                    acc += xxh3_mix16(p + 16, secret + 32, seed);
+                    acc += xxh3_mix16(p + len - 32, secret + 48, seed);
+                }
+                acc += xxh3_mix16(p, secret, seed);
+                acc += xxh3_mix16(p + len - 16, secret + 16, seed);
+                return xxh3_avalanche(acc);
+            }
+
+            for (std::size_t i = 0; i < 8; ++i)
+                acc += xxh3_mix16(p + 16 * i, secret + 16 * i, seed);
+            acc = xxh3_avalanche(acc);
+
+            // 136 is the minimum secret size, and 17 and 3 are the offsets
+            // into it which the reference implementation uses here.
+            auto acc_end = xxh3_mix16(p + len - 16, secret + 136 - 17, seed);
+            for (std::size_t i = 8, rounds = len / 16; i < rounds; ++i)
+                acc_end += xxh3_mix16(p + 16 * i, secret + 16 * (i - 8) + 3,
+                                      seed);
+            return xxh3_avalanche(acc + acc_end);
+        }
+
+        // Mix one 64-byte stripe into the accumulators.
+        inline auto xxh3_accumulate_512_scalar(std::uint64_t *acc,
+                                               std::byte const *p,
+                                               std::byte const *secret)
+            -> void {
+            for (std::size_t i = 0; i < 8; ++i) {
+                auto data = load_le64(p + 8 * i);
+                auto key = data ^ load_le64(secret + 8 * i);
+                acc[i ^ 1] += data;
+                acc[i] += (key & 0xFFFFFFFF) * (key >> 32);
+            }
+        }
+
+        // Scramble the accumulators at the end of each block.
+        inline auto xxh3_scramble_scalar(std::uint64_t *acc,
+                                         std::byte const *secret) -> void {
+            for (std::size_t i = 0; i < 8; ++i) {
+                auto a = acc[i];
+                a ^= a >> 47;
+                a ^= load_le64(secret + 8 * i);
+                a *= xxh_prime32_1;
+                acc[i] = a;
+            }
+        }
+
+        inline auto xxh3_accumulate_512(std::uint64_t *acc,
+                                        std::byte const *p,
+                                        std::byte const *secret) -> void {
+#if defined(__AVX2__)
+            for (std::size_t i = 0; i < 2; ++i) {
+                auto *accp = reinterpret_cast<__m256i *>(acc) + i;
+                auto data = _mm256_loadu_si256(
+                    reinterpret_cast<__m256i const *>(p) + i);
+                auto key = _mm256_loadu_si256(
+                    reinterpret_cast<__m256i const *>(secret) + i);
+                auto data_key = _mm256_xor_si256(data, key);
+                auto data_key_lo =
+                    _mm256_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+                auto product = _mm256_mul_epu32(data_key, data_key_lo);
+                auto data_swap =
+                    _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+                auto sum =
+                    _mm256_add_epi64(_mm256_loadu_si256(accp), data_swap);
+                _mm256_storeu_si256(accp, _mm256_add_epi64(product, sum));
+            }
+#elif defined(__SSE2__) || defined(_M_X64) ||                                 \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+            for (std::size_t i = 0; i < 4; ++i) {
+                auto *accp = reinterpret_cast<__m128i *>(acc) + i;
+                auto data =
+                    _mm_loadu_si128(reinterpret_cast<__m128i const *>(p) + i);
+                auto key = _mm_loadu_si128(
+                    reinterpret_cast<__m128i const *>(secret) + i);
+                auto data_key = _mm_xor_si128(data, key);
+                auto data_key_lo =
+                    _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+                auto product = _mm_mul_epu32(data_key, data_key_lo);
+                auto data_swap =
+                    _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+                auto sum = _mm_add_epi64(_mm_loadu_si128(accp), data_swap);
+                _mm_storeu_si128(accp, _mm_add_epi64(product, sum));
+            }
+#else
+            xxh3_accumulate_512_scalar(acc, p, secret);
+#endif
+        }
+
+        inline auto xxh3_scramble(std::uint64_t *acc, std::byte const *secret)
+            -> void {
+#if defined(__AVX2__)
+            auto prime = _mm256_set1_epi32(static_cast<int>(xxh_prime32_1));
+            for (std::size_t i = 0; i < 2; ++i) {
+                auto *accp = reinterpret_cast<__m256i *>(acc) + i;
+                auto a = _mm256_loadu_si256(accp);
+                a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+                a = _mm256_xor_si256(
+                    a, _mm256_loadu_si256(
+                           reinterpret_cast<__m256i const *>(secret) + i));
+                auto a_hi = _mm256_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1));
+                auto product_lo = _mm256_mul_epu32(a, prime);
+                auto product_hi = _mm256_mul_epu32(a_hi, prime);
+                _mm256_storeu_si256(
+                    accp, _mm256_add_epi64(product_lo,
+                                           _mm256_slli_epi64(product_hi, 32)));
+            }
+#elif defined(__SSE2__) || defined(_M_X64) ||                                 \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+            auto prime = _mm_set1_epi32(static_cast<int>(xxh_prime32_1));
+            for (std::size_t i = 0; i < 4; ++i) {
+                auto *accp = reinterpret_cast<__m128i *>(acc) + i;
+                auto a = _mm_loadu_si128(accp);
+                a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+                a = _mm_xor_si128(
+                    a, _mm_loadu_si128(
+                           reinterpret_cast<__m128i const *>(secret) + i));
+                auto a_hi = _mm_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1));
+                auto product_lo = _mm_mul_epu32(a, prime);
+                auto product_hi = _mm_mul_epu32(a_hi, prime);
+                _mm_storeu_si128(
+                    accp,
+                    _mm_add_epi64(product_lo, _mm_slli_epi64(product_hi, 32)));
+            }
+#else
+            xxh3_scramble_scalar(acc, secret);
+#endif
+        }
+
+    } // namespace detail
+
+    /*************************************************************************
+     *
+     * crc32c: incremental CRC-32C.
+     */
+
+    struct crc32c {
+        using value_type = std::uint32_t;
+
+        // True if the CRC is computed with a CPU instruction rather than
+        // with tables.
+        static constexpr bool hardware_accelerated =
+#if (defined(__SSE4_2__) && defined(__x86_64__)) ||                           \
+    defined(__ARM_FEATURE_CRC32)
+            true;
+#else
+            false;
+#endif
+
+        // Add data to the checksum.
+        auto update(std::span<std::byte const> data) -> void {
+            state = detail::crc32c_update(state, data.data(), data.size());
+        }
+
+        // Return the CRC of the data added so far.
+        auto value() const -> value_type {
+            return ~state;
+        }
+
+        // Start a new CRC.
+        auto reset() -> void {
+            state = ~value_type(0);
+        }
+
+      private:
+        value_type state = ~value_type(0);
+    };
+
+    static_assert(checksum<crc32c>);
+
+    /*************************************************************************
+     *
+     * xxh3_64: incremental 64-bit XXH3.
+     *
+     * Input is collected in a 256-byte internal buffer, so short messages
+     * can be hashed with the special cases XXH3 uses for inputs of up to 240
+     * bytes.  For longer input, whole stripes are fed to the accumulators
+     * directly from the caller's data.
+     */
+
+    struct xxh3_64 {
+        using value_type = std::uint64_t;
+
+        // Create a hash with the given seed.
+        explicit xxh3_64(std::uint64_t seed_ = 0);
+
+        // Add data to the hash.
+        auto update(std::span<std::byte const> data) -> void;
+
+        // Return the hash of the data added so far.
+        auto value() const -> value_type;
+
+        // Start a new hash with the same seed.
+        auto reset() -> void;
+
+      private:
+        static constexpr std::size_t stripe_size = detail::xxh3_stripe_size;
+        static constexpr std::size_t secret_size = detail::xxh3_secret_size;
+
+        // Each block uses the secret at offsets 0, 8, 16... for successive
+        // stripes, and the last 64 bytes of the secret to scramble.
+        static constexpr std::size_t stripes_per_block =
+            (secret_size - stripe_size) / 8;
+
+        static constexpr std::size_t buffer_size = 4 * stripe_size;
+
+        // Accumulate stripes, scrambling the accumulators at the end of each
+        // block.
+        auto consume_stripes(std::uint64_t *accp, std::size_t &stripes_done,
+                             std::byte const *p, std::size_t nstripes) const
+            -> void;
+
+        alignas(64) std::uint64_t acc[8];
+        alignas(64) std::byte secret[secret_size];
+        alignas(64) std::byte data_buffer[buffer_size];
+
+        std::uint64_t seed;
+        std::uint64_t total_size = 0;
+        std::size_t buffered = 0;
+        std::size_t stripes_in_block = 0;
+    };
+
+    static_assert(checksum<xxh3_64>);
+
+    /*
+     * xxh3_64::xxh3_64()
+     */
+    inline xxh3_64::xxh3_64(std::uint64_t seed_) : seed(seed_) {
+        // Derive the secret for long input from the seed.  A seed of 0
+        // gives the default secret.
+        for (std::size_t i = 0; i < secret_size; i += 16) {
+            detail::store_le64(
+                secret + i,
+                detail::load_le64(detail::xxh3_secret_bytes(i)) + seed);
+            detail::store_le64(
+                secret + i + 8,
+                detail::load_le64(detail::xxh3_secret_bytes(i + 8)) - seed);
+        }
+
+        reset();
+    }
+
+    /*
+     * xxh3_64::reset()
+     */
+    inline auto xxh3_64::reset() -> void {
+        acc[0] = detail::xxh_prime32_3;
+        acc[1] = detail::xxh_prime64_1;
+        acc[2] = detail::xxh_prime64_2;
+        acc[3] = detail::xxh_prime64_3;
+        acc[4] = detail::xxh_prime64_4;
+        acc[5] = detail::xxh_prime32_2;
+        acc[6] = detail::xxh_prime64_5;
+        acc[7] = detail::xxh_prime32_1;
+
+        total_size = 0;
+        buffered = 0;
+        stripes_in_block = 0;
+    }
+
+    /*
+     * xxh3_64::consume_stripes()
+     */
+    inline auto xxh3_64::consume_stripes(std::uint64_t *accp,
+                                         std::size_t &stripes_done,
+                                         std::byte const *p,
+                                         std::size_t nstripes) const -> void {
+        while (nstripes > 0) {
+            auto n = std::min(nstripes, stripes_per_block - stripes_done);
+
+            for (std::size_t i = 0; i < n; ++i)
+                detail::xxh3_accumulate_512(accp, p + i * stripe_size,
+                                            secret + (stripes_done + i) * 8);
+
+            p += n * stripe_size;
+            nstripes -= n;
+            stripes_done += n;
+
+            if (stripes_done == stripes_per_block) {
+                detail::xxh3_scramble(accp, secret + secret_size - stripe_size);
+                stripes_done = 0;
+            }
+        }
+    }
+
+    /*
+     * xxh3_64::update()
+     */
+    inline auto xxh3_64::update(std::span<std::byte const> data) -> void {
+        auto const *p = data.data();
+        auto n = data.size();
+
+        total_size += n;
+
+        if (buffered + n <= buffer_size) {
+            if (n > 0)
+                std::memcpy(data_buffer + buffered, p, n);
+            buffered += n;
+            return;
+        }
+
+        // The last stripe of the input is processed differently, so input
+        // is only consumed when there is more after it; at least one byte
+        // is always left in the buffer.
+        if (buffered > 0) {
+            auto fill = buffer_size - buffered;
+            std::memcpy(data_buffer + buffered, p, fill);
+            p += fill;
+            n -= fill;
+
+            consume_stripes(acc, stripes_in_block, data_buffer,
+                            buffer_size / stripe_size);
+            buffered = 0;
+        }
+
+        if (n > buffer_size) {
+            auto nstripes = (n - 1) / stripe_size;
+            consume_stripes(acc, stripes_in_block, p, nstripes);
+            p += nstripes * stripe_size;
+            n -= nstripes * stripe_size;
+
+            // Keep the stripe before the remaining input, which value()
+            // needs if less than a stripe is left.
+            std::memcpy(data_buffer + buffer_size - stripe_size,
+                        p - stripe_size, stripe_size);
+        }
+
+        std::memcpy(data_buffer, p, n);
+        buffered = n;
+    }
+
+    /*
+     * xxh3_64::value()
+     */
+    inline auto xxh3_64::value() const -> value_type {
+        if (total_size <= detail::xxh3_midsize_max)
+            return detail::xxh3_64_short(data_buffer, buffered, seed);
+
+        alignas(64) std::uint64_t final_acc[8];
+        std::memcpy(final_acc, acc, sizeof(acc));
+        auto stripes_done = stripes_in_block;
+
+        // Accumulate the remaining whole stripes and the last stripe, which
+        // overlaps the previous one if the input isn't a multiple of the
+        // stripe size.
+        std::byte last_stripe[stripe_size];
+        std::byte const *last;
+
+        if (buffered >= stripe_size) {
+            consume_stripes(final_acc, stripes_done, data_buffer,
+                            (buffered - 1) / stripe_size);
+            last = data_buffer + buffered - stripe_size;
+        } else {
+            auto catchup = stripe_size - buffered;
+            std::memcpy(last_stripe, data_buffer + buffer_size - catchup,
+                        catchup);
+            std::memcpy(last_stripe + catchup, data_buffer, buffered);
+            last = last_stripe;
+        }
+
+        detail::xxh3_accumulate_512(final_acc, last,
+                                    secret + secret_size - stripe_size - 7);
+
+        value_type result = total_size * detail::xxh_prime64_1;
+        for (std::size_t i = 0; i < 4; ++i)
+            result += detail::xxh_mul128_fold64(
+                final_acc[2 * i] ^ detail::load_le64(secret + 11 + 16 * i),
+                final_acc[2 * i + 1] ^
+                    detail::load_le64(secret + 11 + 16 * i + 8));
+        return detail::xxh3_avalanche(result);
+    }
+
+    /*************************************************************************
+     *
+     * buffer_checksum(buf, sum, n): add up to n objects of readable data from
+     * the start of buf to sum, without removing it from the buffer.  Returns
+     * the number of objects added, which is less than n if the buffer holds
+     * less than n objects.
+     */
+
+    template <readable_buffer Buffer, checksum Checksum>
+    auto buffer_checksum(
+        Buffer &buf, Checksum &sum,
+        buffer_size_t<Buffer> n = std::numeric_limits<buffer_size_t<Buffer>>::max())
+        -> buffer_size_t<Buffer> {
+        buffer_size_t<Buffer> done = 0;
+
+        for (auto &&range : buf.readable_ranges()) {
+            if (done == n)
+                break;
+
+            auto span = std::span(range).subspan(
+                0, std::min<std::size_t>(range.size(), n - done));
+            sum.update(std::as_bytes(span));
+            done += span.size();
+        }
+
+        return done;
+    }
+
+    /*************************************************************************
+     *
+     * checksummed_buffer: a writable buffer which adds data to a checksum as
+     * it is written to or committed into the underlying buffer, so the data
+     * is only read back from the cache, not from memory.
+     *
+     * If the underlying buffer is also readable, reading from the wrapper
+     * reads from the underlying buffer without affecting the checksum.
+     */
+
+    template <writable_buffer Buffer, checksum Checksum>
+    struct checksummed_buffer {
+        using value_type = buffer_value_t<Buffer>;
+        using const_value_type = buffer_const_value_t<Buffer>;
+        using size_type = buffer_size_t<Buffer>;
+
+        // The buffer being written to.
+        Buffer &buffer_base;
+
+        // The checksum of everything written or committed so far.
+        Checksum checksum;
+
+        explicit checksummed_buffer(Buffer &buffer_base_,
+                                    Checksum checksum_ = Checksum())
+            : buffer_base(buffer_base_), checksum(std::move(checksum_)) {}
+
+        // Write data to the underlying buffer and add whatever was written
+        // to the checksum.
+        template <std::ranges::contiguous_range Range>
+        auto write(Range &&data) -> size_type {
+            std::span<const_value_type> span(data);
+            auto n = buffer_base.write(span);
+            checksum.update(std::as_bytes(span.subspan(0, n)));
+            return n;
+        }
+
+        auto writable_ranges() {
+            return buffer_base.writable_ranges();
+        }
+
+        // Commit the next n objects of writable space, and add whatever the
+        // underlying buffer accepted to the checksum.  The ranges are
+        // captured before committing, since committing can change them, a
+        // batch at a time so this doesn't allocate.
+        auto commit(size_type n) -> size_type {
+            std::array<std::span<const_value_type>, 16> spans;
+            size_type total = 0;
+
+            while (total < n) {
+                std::size_t nspans = 0;
+                size_type batch = 0;
+
+                for (auto &&range : buffer_base.writable_ranges()) {
+                    if (nspans == spans.size() || batch == n - total)
+                        break;
+
+                    auto span = std::span<const_value_type>(range).subspan(
+                        0, std::min<std::size_t>(range.size(),
+                                                 n - total - batch));
+                    spans[nspans++] = span;
+                    batch += span.size();
+                }
+
+                if (batch == 0)
+                    break;
+
+                auto committed = buffer_base.commit(batch);
+                total += committed;
+
+                auto left = committed;
+                for (auto span : std::span(spans).first(nspans)) {
+                    if (left == 0)
+                        break;
+                    span = span.first(std::min<std::size_t>(span.size(), left));
+                    checksum.update(std::as_bytes(span));
+                    left -= span.size();
+                }
+
+                // Stop if the buffer didn't accept all of it.
+                if (committed < batch)
+                    break;
+            }
+
+            return total;
+        }
+
+        template <std::ranges::contiguous_range Range>
+        auto read(Range &&data)
+            -> size_type requires readable_buffer<Buffer> {
+            return buffer_base.read(std::forward<Range>(data));
+        }
+
+        auto readable_ranges() requires readable_buffer<Buffer> {
+            return buffer_base.readable_ranges();
+        }
+
+        auto discard(size_type n) -> size_type requires readable_buffer<Buffer> {
+            return buffer_base.discard(n);
+        }
+    };
+
+} // namespace sk
+
+#endif // SK_BUFFER_BUFFER_CHECKSUM_HXX_INCLUDED
@@ -0,0 +1,869 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Streaming compression and decompression between buffers.
+ */
+
+#ifndef SK_BUFFER_BUFFER_COMPRESS_HXX_INCLUDED
+#define SK_BUFFER_BUFFER_COMPRESS_HXX_INCLUDED
+
+#include <algorithm>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+#include <ranges>
+#include <span>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#if __has_include(<zstd.h>)
+#    include <zstd.h>
+#    include <zstd_errors.h>
+#endif
+
+#if __has_include(<lz4frame.h>)
+#    include <lz4frame.h>
+#endif
+
+#if __has_include(<zlib.h>)
+#    include <zlib.h>
+#endif
+
+#include "sk/buffer/buffer.hxx"
+#include "sk/buffer/buffer_io.hxx"
+
+namespace sk {
+
+    /*************************************************************************
+     *
+     * buffer_compress(codec, in, out, flush) and buffer_decompress(codec, in,
+     * out) run a streaming codec over the data in one buffer, writing the
+     * result directly into another buffer's writable ranges.  The codec is
+     * given each readable range of `in` and each writable range of `out` in
+     * turn, so no temporary copy of the input or output is made; the bytes
+     * produced are committed to `out` and the bytes consumed are discarded
+     * from `in`.  Both buffers must hold byte-sized objects.
+     *
+     * Processing continues, fetching more ranges as needed, until the input
+     * has been consumed (and, for flush or finish, all pending output has
+     * been written), `out` has no more space, or the codec reports the end
+     * of a frame.  If `out` fills up, call again once it has been drained;
+     * a buffer which grows, such as dynamic_buffer, never fills up.
+     *
+     * The flush mode applies once the last of the input has been given to
+     * the codec:
+     *
+     *   codec_flush::none     The codec may hold back output until it has
+     *                         more input.
+     *   codec_flush::flush    All output for the input so far is written,
+     *                         so the peer can decompress it, but the frame
+     *                         stays open.
+     *   codec_flush::finish   The frame is ended.  The next call starts a
+     *                         new frame.  Don't add more input until
+     *                         result.finished is true.
+     *
+     * Decompression stops at the end of each frame with result.finished set,
+     * leaving any following data in `in`.
+     *
+     * Codecs for zstd, LZ4 (frame format) and zlib/deflate are provided when
+     * the library's header is available; the program must then be linked
+     * with the library (-lzstd, -llz4 or -lz).  Any type which satisfies the
+     * buffer_codec concept can be used as well.
+     *
+     * As with buffer_io, each function has an overload which reports errors
+     * through a std::error_code, and one which throws std::system_error.  If
+     * `out` commits less than the space it offered, the output is lost and
+     * the error is std::errc::no_buffer_space.
+     */
+
+    enum struct codec_flush { none, flush, finish };
+
+    struct codec_result {
+        // The number of bytes taken from the input.
+        std::size_t consumed = 0;
+
+        // The number of bytes written to the output.
+        std::size_t produced = 0;
+
+        // True if the flush or finish is complete, or (when decompressing)
+        // the end of a frame was reached.
+        bool finished = false;
+    };
+
+    /*
+     * A codec transforms bytes from `in` into bytes in `out`.  process()
+     * is called repeatedly with the remaining input and output space, and
+     * returns how much of each it used; it must make progress unless it
+     * needs more input or more output space.  `flush` is codec_flush::none
+     * until the last of the input is passed.
+     */
+    template <typename Codec>
+    concept buffer_codec = requires(Codec &codec,
+                                    std::span<std::byte const> in,
+                                    std::span<std::byte> out,
+                                    codec_flush flush,
+                                    std::error_code &ec) {
+        { codec.process(in, out, flush, ec) } -> std::same_as<codec_result>;
+    };
+
+    namespace detail {
+
+        // Walks a range list as a sequence of non-empty byte spans.
+        template <typename RangeList> struct codec_cursor {
+            using iterator = std::ranges::iterator_t<RangeList>;
+            using range_type = std::ranges::range_value_t<RangeList>;
+            using element_type =
+                std::remove_reference_t<std::ranges::range_reference_t<
+                    range_type>>;
+            using byte_type = std::conditional_t<std::is_const_v<element_type>,
+                                                 std::byte const, std::byte>;
+
+            explicit codec_cursor(RangeList &ranges)
+                : it(std::ranges::begin(ranges)),
+                  end(std::ranges::end(ranges)) {
+                next();
+            }
+
+            // The current span, which is empty at the end of the list.
+            std::span<byte_type> current;
+
+            // True if there are no more spans after the current one.
+            auto last() const -> bool {
+                return it == end;
+            }
+
+            auto advance(std::size_t n) -> void {
+                current = current.subspan(n);
+                if (current.empty())
+                    next();
+            }
+
+          private:
+            auto next() -> void {
+                while (current.empty() && it != end) {
+                    auto span = std::span(*it++);
+                    if constexpr (std::is_const_v<element_type>)
+                        current = std::as_bytes(span);
+                    else
+                        current = std::as_writable_bytes(span);
+                }
+
+                // Skip empty ranges now, so last() is true for the last
+                // non-empty range.
+                while (it != end && std::ranges::empty(*it))
+                    ++it;
+            }
+
+            iterator it, end;
+        };
+
+        template <typename Codec, typename InBuffer, typename OutBuffer>
+        auto run_codec(Codec &codec, InBuffer &in, OutBuffer &out,
+                       codec_flush flush, std::error_code &ec)
+            -> codec_result {
+            codec_result total;
+            ec.clear();
+
+            for (;;) {
+                auto in_ranges = in.readable_ranges();
+                auto out_ranges = out.writable_ranges();
+                codec_cursor src(in_ranges);
+                codec_cursor dst(out_ranges);
+                codec_result pass;
+
+                while (!dst.current.empty()) {
+                    auto mode = (src.current.empty() || src.last())
+                                    ? flush
+                                    : codec_flush::none;
+                    auto step =
+                        codec.process(src.current, dst.current, mode, ec);
+                    if (ec)
+                        break;
+
+                    src.advance(step.consumed);
+                    dst.advance(step.produced);
+                    pass.consumed += step.consumed;
+                    pass.produced += step.produced;
+
+                    if (step.finished) {
+                        pass.finished = true;
+                        break;
+                    }
+
+                    if (step.consumed == 0 && step.produced == 0)
+                        break;
+                }
+
+                // The codec's state has already moved past this output, so
+                // if `out` doesn't take all of it, the stream is broken.
+                auto committed = out.commit(pass.produced);
+                total.consumed += in.discard(pass.consumed);
+                total.produced += committed;
+
+                if (committed < pass.produced && !ec)
+                    ec = std::make_error_code(std::errc::no_buffer_space);
+
+                if (ec || pass.finished ||
+                    (pass.consumed == 0 && pass.produced == 0)) {
+                    total.finished = pass.finished;
+                    return total;
+                }
+            }
+        }
+
+    } // namespace detail
+
+    /*
+     * buffer_compress(codec, in, out, flush): compress the data in `in`
+     * into `out`.
+     */
+    template <buffer_codec Codec, readable_buffer InBuffer,
+              writable_buffer OutBuffer>
+    auto buffer_compress(Codec &codec, InBuffer &in, OutBuffer &out,
+                         codec_flush flush, std::error_code &ec)
+        -> codec_result requires io_buffer<InBuffer> && io_buffer<OutBuffer> {
+        return detail::run_codec(codec, in, out, flush, ec);
+    }
+
+    template <buffer_codec Codec, readable_buffer InBuffer,
+              writable_buffer OutBuffer>
+    auto buffer_compress(Codec &codec, InBuffer &in, OutBuffer &out,
+                         codec_flush flush = codec_flush::none)
+        -> codec_result requires io_buffer<InBuffer> && io_buffer<OutBuffer> {
+        std::error_code ec;
+        auto ret = detail::run_codec(codec, in, out, flush, ec);
+        if (ec)
+            throw std::system_error(ec, "buffer_compress");
+        return ret;
+    }
+
+    /*
+     * buffer_decompress(codec, in, out): decompress the data in `in` into
+     * `out`, stopping at the end of a frame.
+     */
+    template <buffer_codec Codec, readable_buffer InBuffer,
+              writable_buffer OutBuffer>
+    auto buffer_decompress(Codec &codec, InBuffer &in, OutBuffer &out,
+                           std::error_code &ec)
+        -> codec_result requires io_buffer<InBuffer> && io_buffer<OutBuffer> {
+        return detail::run_codec(codec, in, out, codec_flush::none, ec);
+    }
+
+    template <buffer_codec Codec, readable_buffer InBuffer,
+              writable_buffer OutBuffer>
+    auto buffer_decompress(Codec &codec, InBuffer &in, OutBuffer &out)
+        -> codec_result requires io_buffer<InBuffer> && io_buffer<OutBuffer> {
+        std::error_code ec;
+        auto ret = detail::run_codec(codec, in, out, codec_flush::none, ec);
+        if (ec)
+            throw std::system_error(ec, "buffer_decompress");
+        return ret;
+    }
+
+#if __has_include(<zstd.h>)
+
+    /*************************************************************************
+     *
+     * zstd_compressor and zstd_decompressor: zstd streaming compression.
+     * Errors are reported in zstd_category(), with the values of
+     * ZSTD_ErrorCode.
+     */
+
+    namespace detail {
+
+        struct zstd_category_type final : std::error_category {
+            auto name() const noexcept -> char const * override {
+                return "zstd";
+            }
+
+            auto message(int code) const -> std::string override {
+                return ZSTD_getErrorString(static_cast<ZSTD_ErrorCode>(code));
+            }
+        };
+
+    } // namespace detail
+
+    inline auto zstd_category() -> std::error_category const & {
+        static detail::zstd_category_type category;
+        return category;
+    }
+
+    namespace detail {
+
+        inline auto zstd_error(std::size_t r) -> std::error_code {
+            return {static_cast<int>(ZSTD_getErrorCode(r)), zstd_category()};
+        }
+
+    } // namespace detail
+
+    struct zstd_compressor {
+        explicit zstd_compressor(int level = ZSTD_CLEVEL_DEFAULT)
+            : ctx(ZSTD_createCCtx()) {
+            if (!ctx)
+                throw std::bad_alloc();
+
+            auto r = ZSTD_CCtx_setParameter(ctx.get(), ZSTD_c_compressionLevel,
+                                            level);
+            if (ZSTD_isError(r))
+                throw std::system_error(detail::zstd_error(r),
+                                        "ZSTD_CCtx_setParameter");
+        }
+
+        auto process(std::span<std::byte const> in, std::span<std::byte> out,
+                     codec_flush flush, std::error_code &ec) -> codec_result {
+            ZSTD_inBuffer src{in.data(), in.size(), 0};
+            ZSTD_outBuffer dst{out.data(), out.size(), 0};
+
+            auto directive = flush == codec_flush::finish  ? ZSTD_e_end
+                             : flush == codec_flush::flush ? ZSTD_e_flush
+                                                           : ZSTD_e_continue;
+
+            auto r = ZSTD_compressStream2(ctx.get(), &dst, &src, directive);
+            if (ZSTD_isError(r)) {
+                ec = detail::zstd_error(r);
+                return {};
+            }
+
+            return {src.pos, dst.pos, flush != codec_flush::none && r == 0};
+        }
+
+        // Abandon the current frame.
+        auto reset() -> void {
+            ZSTD_CCtx_reset(ctx.get(), ZSTD_reset_session_only);
+        }
+
+        // The zstd context, e.g. to set other parameters.
+        auto native_handle() -> ZSTD_CCtx * {
+            return ctx.get();
+        }
+
+      private:
+        struct deleter {
+            auto operator()(ZSTD_CCtx *p) const noexcept -> void {
+                ZSTD_freeCCtx(p);
+            }
+        };
+
+        std::unique_ptr<ZSTD_CCtx, deleter> ctx;
+    };
+
+    struct zstd_decompressor {
+        zstd_decompressor() : ctx(ZSTD_createDCtx()) {
+            if (!ctx)
+                throw std::bad_alloc();
+        }
+
+        auto process(std::span<std::byte const> in, std::span<std::byte> out,
+                     codec_flush, std::error_code &ec) -> codec_result {
+            ZSTD_inBuffer src{in.data(), in.size(), 0};
+            ZSTD_outBuffer dst{out.data(), out.size(), 0};
+
+            auto r = ZSTD_decompressStream(ctx.get(), &dst, &src);
+            if (ZSTD_isError(r)) {
+                ec = detail::zstd_error(r);
+                return {};
+            }
+
+            // 0 means a frame has been completely decoded and flushed.
+            return {src.pos, dst.pos, r == 0};
+        }
+
+        // Abandon the current frame.
+        auto reset() -> void {
+            ZSTD_DCtx_reset(ctx.get(), ZSTD_reset_session_only);
+        }
+
+        // The zstd context, e.g. to set other parameters.
+        auto native_handle() -> ZSTD_DCtx * {
+            return ctx.get();
+        }
+
+      private:
+        struct deleter {
+            auto operator()(ZSTD_DCtx *p) const noexcept -> void {
+                ZSTD_freeDCtx(p);
+            }
+        };
+
+        std::unique_ptr<ZSTD_DCtx, deleter> ctx;
+    };
+
+    static_assert(buffer_codec<zstd_compressor>);
+    static_assert(buffer_codec<zstd_decompressor>);
+
+#endif // __has_include(<zstd.h>)
+
+#if __has_include(<lz4frame.h>)
+
+    /*************************************************************************
+     *
+     * lz4_compressor and lz4_decompressor: LZ4 frame format compression.
+     * Errors are reported in lz4_category(), with the values of
+     * LZ4F_errorCodes.
+     *
+     * LZ4F collects input into whole blocks, and LZ4F_compressUpdate()
+     * needs room in its output for everything it might emit.  When the
+     * output range has that much room, the compressor writes into it
+     * directly; otherwise (for example, with extents smaller than the
+     * 64KB block size) the compressed data goes through a block-sized
+     * staging area which is allocated with the codec.
+     */
+
+    namespace detail {
+
+        struct lz4_category_type final : std::error_category {
+            auto name() const noexcept -> char const * override {
+                return "lz4";
+            }
+
+            auto message(int code) const -> std::string override {
+                return LZ4F_getErrorName(
+                    static_cast<LZ4F_errorCode_t>(-std::ptrdiff_t(code)));
+            }
+        };
+
+    } // namespace detail
+
+    inline auto lz4_category() -> std::error_category const & {
+        static detail::lz4_category_type category;
+        return category;
+    }
+
+    namespace detail {
+
+        inline auto lz4_error(std::size_t r) -> std::error_code {
+            return {static_cast<int>(-static_cast<std::ptrdiff_t>(r)),
+                    lz4_category()};
+        }
+
+    } // namespace detail
+
+    struct lz4_compressor {
+        // `level` is the LZ4F compression level: 0 is the default fast
+        // mode, and values from 3 use LZ4 HC.
+        explicit lz4_compressor(int level = 0) {
+            LZ4F_cctx *p = nullptr;
+            if (LZ4F_isError(
+                    LZ4F_createCompressionContext(&p, LZ4F_VERSION)))
+                throw std::bad_alloc();
+            ctx.reset(p);
+
+            prefs.compressionLevel = level;
+            prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+            prefs.frameInfo.blockMode = LZ4F_blockLinked;
+
+            staged.resize(LZ4F_compressBound(block_size, &prefs));
+        }
+
+        auto process(std::span<std::byte const> in, std::span<std::byte> out,
+                     codec_flush flush, std::error_code &ec)
+            -> codec_result;
+
+        // Abandon the current frame.
+        auto reset() -> void {
+            state = frame_state::idle;
+            completing = false;
+            staged_begin = staged_end = 0;
+        }
+
+      private:
+        static constexpr std::size_t block_size = 64 * 1024;
+
+        enum struct frame_state { idle, open };
+
+        // Call fn(dst, capacity) to produce at most `bound` bytes of
+        // output, writing it directly to `out` if there's room, otherwise
+        // into the staging area.  Returns the number of bytes written to
+        // `out`, which is advanced past them.
+        template <typename Fn>
+        auto emit(std::span<std::byte> &out, std::size_t bound, Fn &&fn,
+                  std::error_code &ec) -> std::size_t {
+            if (out.size() >= bound) {
+                auto r = fn(out.data(), out.size());
+                if (LZ4F_isError(r)) {
+                    ec = detail::lz4_error(r);
+                    return 0;
+                }
+                out = out.subspan(r);
+                return r;
+            }
+
+            assert(bound <= staged.size());
+            auto r = fn(staged.data(), staged.size());
+            if (LZ4F_isError(r)) {
+                ec = detail::lz4_error(r);
+                return 0;
+            }
+            staged_begin = 0;
+            staged_end = r;
+            return drain(out);
+        }
+
+        // Copy staged output to `out`, returning the number of bytes
+        // copied.
+        auto drain(std::span<std::byte> &out) -> std::size_t {
+            auto n = std::min(out.size(), staged_end - staged_begin);
+            if (n > 0)
+                std::memcpy(out.data(), staged.data() + staged_begin, n);
+            staged_begin += n;
+            out = out.subspan(n);
+            return n;
+        }
+
+        auto has_staged() const -> bool {
+            return staged_begin < staged_end;
+        }
+
+        struct deleter {
+            auto operator()(LZ4F_cctx *p) const noexcept -> void {
+                LZ4F_freeCompressionContext(p);
+            }
+        };
+
+        std::unique_ptr<LZ4F_cctx, deleter> ctx;
+        LZ4F_preferences_t prefs{};
+        frame_state state = frame_state::idle;
+
+        // True if a flush or finish is waiting for its staged output to be
+        // drained.
+        bool completing = false;
+
+        std::vector<std::byte> staged;
+        std::size_t staged_begin = 0, staged_end = 0;
+    };
+
+    /* lz4_compressor::process() */
+    inline auto lz4_compressor::process(std::span<std::byte const> in,
+                                        std::span<std::byte> out,
+                                        codec_flush flush,
+                                        std::error_code &ec)
+        -> codec_result {
+        codec_result ret;
+
+        ret.produced = drain(out);
+        if (has_staged())
+            return ret;
+
+        if (completing) {
+            completing = false;
+            ret.finished = true;
+            return ret;
+        }
+
+        if (state == frame_state::idle) {
+            // Don't start a frame until there's something to put in it, or
+            // the caller asks for an (empty) frame to be finished.
+            if (in.empty() && flush != codec_flush::finish) {
+                ret.finished = flush == codec_flush::flush;
+                return ret;
+            }
+
+            ret.produced += emit(
+                out, LZ4F_HEADER_SIZE_MAX,
+                [&](std::byte *p, std::size_t n) {
+                    return LZ4F_compressBegin(ctx.get(), p, n, &prefs);
+                },
+                ec);
+            if (ec)
+                return ret;
+            state = frame_state::open;
+        }
+
+        while (!in.empty() && !has_staged()) {
+            // Compress everything straight into `out` if it has room;
+            // otherwise, a block at a time through the staging area.
+            auto chunk = in.size();
+            if (out.size() < LZ4F_compressBound(chunk, &prefs))
+                chunk = std::min(chunk, block_size);
+
+            ret.produced += emit(
+                out, LZ4F_compressBound(chunk, &prefs),
+                [&](std::byte *p, std::size_t n) {
+                    return LZ4F_compressUpdate(ctx.get(), p, n, in.data(),
+                                               chunk, nullptr);
+                },
+                ec);
+            if (ec)
+                return ret;
+
+            in = in.subspan(chunk);
+            ret.consumed += chunk;
+        }
+
+        if (!in.empty() || has_staged() || flush == codec_flush::none)
+            return ret;
+
+        // Write out the partial block LZ4F is holding, and for a finish,
+        // the end of the frame.
+        ret.produced += emit(
+            out, LZ4F_compressBound(0, &prefs),
+            [&](std::byte *p, std::size_t n) {
+                return flush == codec_flush::finish
+                           ? LZ4F_compressEnd(ctx.get(), p, n, nullptr)
+                           : LZ4F_flush(ctx.get(), p, n, nullptr);
+            },
+            ec);
+        if (ec)
+            return ret;
+
+        if (flush == codec_flush::finish)
+            state = frame_state::idle;
+
+        if (has_staged())
+            completing = true;
+        else
+            ret.finished = true;
+
+        return ret;
+    }
+
+    struct lz4_decompressor {
+        lz4_decompressor() {
+            LZ4F_dctx *p = nullptr;
+            if (LZ4F_isError(
+                    LZ4F_createDecompressionContext(&p, LZ4F_VERSION)))
+                throw std::bad_alloc();
+            ctx.reset(p);
+        }
+
+        auto process(std::span<std::byte const> in, std::span<std::byte> out,
+                     codec_flush, std::error_code &ec) -> codec_result {
+            auto src_size = in.size();
+            auto dst_size = out.size();
+
+            auto r = LZ4F_decompress(ctx.get(), out.data(), &dst_size,
+                                     in.data(), &src_size, nullptr);
+            if (LZ4F_isError(r)) {
+                ec = detail::lz4_error(r);
+                return {};
+            }
+
+            // 0 means a frame has been completely decoded and flushed.
+            return {src_size, dst_size, r == 0};
+        }
+
+        // Abandon the current frame.
+        auto reset() -> void {
+            LZ4F_resetDecompressionContext(ctx.get());
+        }
+
+      private:
+        struct deleter {
+            auto operator()(LZ4F_dctx *p) const noexcept -> void {
+                LZ4F_freeDecompressionContext(p);
+            }
+        };
+
+        std::unique_ptr<LZ4F_dctx, deleter> ctx;
+    };
+
+    static_assert(buffer_codec<lz4_compressor>);
+    static_assert(buffer_codec<lz4_decompressor>);
+
+#endif // __has_include(<lz4frame.h>)
+
+#if __has_include(<zlib.h>)
+
+    /*************************************************************************
+     *
+     * zlib_compressor and zlib_decompressor: deflate compression with zlib.
+     * `window_bits` is as for deflateInit2() and inflateInit2(): 15 gives
+     * the zlib format, 31 gzip and -15 raw deflate; 47 lets the
+     * decompressor accept either zlib or gzip.  A flush uses Z_SYNC_FLUSH.
+     * Errors are reported in zlib_category(), with zlib's Z_* values.
+     */
+
+    namespace detail {
+
+        struct zlib_category_type final : std::error_category {
+            auto name() const noexcept -> char const * override {
+                return "zlib";
+            }
+
+            auto message(int code) const -> std::string override {
+                return zError(code);
+            }
+        };
+
+    } // namespace detail
+
+    inline auto zlib_category() -> std::error_category const & {
+        static detail::zlib_category_type category;
+        return category;
+    }
+
+    namespace detail {
+
+        // zlib keeps a pointer to the z_stream in its state, so the stream
+        // lives on the heap where it won't move with the codec.
+        template <int (*end)(z_streamp)> struct zlib_stream_deleter {
+            auto operator()(z_stream *zs) const noexcept -> void {
+                end(zs);
+                delete zs;
+            }
+        };
+
+        // Point the stream at the input and output, clipping them to the
+        // size zlib can describe.
+        inline auto zlib_set_buffers(z_stream &zs,
+                                     std::span<std::byte const> in,
+                                     std::span<std::byte> out) -> void {
+            constexpr std::size_t max = std::numeric_limits<uInt>::max();
+            zs.next_in = const_cast<Bytef *>(
+                reinterpret_cast<Bytef const *>(in.data()));
+            zs.avail_in = static_cast<uInt>(std::min(in.size(), max));
+            zs.next_out = reinterpret_cast<Bytef *>(out.data());
+            zs.avail_out = static_cast<uInt>(std::min(out.size(), max));
+        }
+
+        [[noreturn]] inline auto zlib_init_error(int r, char const *what)
+            -> void {
+            if (r == Z_MEM_ERROR)
+                throw std::bad_alloc();
+            throw std::system_error(r, zlib_category(), what);
+        }
+
+    } // namespace detail
+
+    struct zlib_compressor {
+        explicit zlib_compressor(int level = Z_DEFAULT_COMPRESSION,
+                                 int window_bits = 15, int mem_level = 8)
+            : zs(new z_stream{}) {
+            auto r = deflateInit2(zs.get(), level, Z_DEFLATED, window_bits,
+                                  mem_level, Z_DEFAULT_STRATEGY);
+            if (r != Z_OK) {
+                delete zs.release();
+                detail::zlib_init_error(r, "deflateInit2");
+            }
+        }
+
+        auto process(std::span<std::byte const> in, std::span<std::byte> out,
+                     codec_flush flush, std::error_code &ec)
+            -> codec_result {
+            detail::zlib_set_buffers(*zs, in, out);
+
+            // The flush only applies once zlib has been given all the input.
+            int mode = Z_NO_FLUSH;
+            if (zs->avail_in == in.size())
+                mode = flush == codec_flush::finish  ? Z_FINISH
+                       : flush == codec_flush::flush ? Z_SYNC_FLUSH
+                                                     : Z_NO_FLUSH;
+
+            auto in_size = zs->avail_in, out_size = zs->avail_out;
+            auto r = deflate(zs.get(), mode);
+
+            codec_result ret{in_size - zs->avail_in,
+                             out_size - zs->avail_out};
+
+            if (r == Z_STREAM_END) {
+                deflateReset(zs.get());
+                ret.finished = true;
+            } else if (r == Z_OK || r == Z_BUF_ERROR) {
+                // A sync flush is complete once zlib stops filling the
+                // output.
+                ret.finished = mode == Z_SYNC_FLUSH && zs->avail_in == 0 &&
+                               zs->avail_out > 0;
+            } else {
+                ec.assign(r, zlib_category());
+            }
+
+            return ret;
+        }
+
+        // Abandon the current stream.
+        auto reset() -> void {
+            deflateReset(zs.get());
+        }
+
+        // The zlib stream, e.g. for deflateParams().
+        auto native_handle() -> z_stream * {
+            return zs.get();
+        }
+
+      private:
+        std::unique_ptr<z_stream, detail::zlib_stream_deleter<deflateEnd>> zs;
+    };
+
+    struct zlib_decompressor {
+        explicit zlib_decompressor(int window_bits = 15)
+            : zs(new z_stream{}) {
+            auto r = inflateInit2(zs.get(), window_bits);
+            if (r != Z_OK) {
+                delete zs.release();
+                detail::zlib_init_error(r, "inflateInit2");
+            }
+        }
+
+        auto process(std::span<std::byte const> in, std::span<std::byte> out,
+                     codec_flush, std::error_code &ec) -> codec_result {
+            detail::zlib_set_buffers(*zs, in, out);
+
+            auto in_size = zs->avail_in, out_size = zs->avail_out;
+            auto r = inflate(zs.get(), Z_NO_FLUSH);
+
+            codec_result ret{in_size - zs->avail_in,
+                             out_size - zs->avail_out};
+
+            if (r == Z_STREAM_END) {
+                inflateReset(zs.get());
+                ret.finished = true;
+            } else if (r != Z_OK && r != Z_BUF_ERROR) {
+                ec.assign(r, zlib_category());
+            }
+
+            return ret;
+        }
+
+        // Abandon the current stream.
+        auto reset() -> void {
+            inflateReset(zs.get());
+        }
+
+        // The zlib stream, e.g. for inflateSetDictionary().
+        auto native_handle() -> z_stream * {
+            return zs.get();
+        }
+
+      private:
+        std::unique_ptr<z_stream, detail::zlib_stream_deleter<inflateEnd>> zs;
+    };
+
+    static_assert(buffer_codec<zlib_compressor>);
+    static_assert(buffer_codec<zlib_decompressor>);
+
+#endif // __has_include(<zlib.h>)
+
+} // namespace sk
+
+#endif // SK_BUFFER_BUFFER_COMPRESS_HXX_INCLUDED
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Scatter/gather I/O between buffers and file descriptors or sockets.
+ */
+
+#ifndef SK_BUFFER_BUFFER_IO_HXX_INCLUDED
+#define SK_BUFFER_BUFFER_IO_HXX_INCLUDED
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <ranges>
+#include <span>
+#include <system_error>
+
+#if defined(_WIN32)
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <winsock2.h>
+#    ifdef _MSC_VER
+#        pragma comment(lib, "ws2_32.lib")
+#    endif
+#else
+#    include <sys/uio.h>
+#    include <unistd.h>
+#endif
+
+#include "sk/buffer/buffer.hxx"
+
+namespace sk {
+
+    /*************************************************************************
+     *
+     * buffer_read_from(fd, buf) and buffer_write_to(fd, buf) transfer data
+     * directly between a file descriptor (or socket, on Windows) and a
+     * buffer's extents.  The buffer's writable resp. readable ranges are
+     * turned into an array of I/O vectors on the stack and passed to a single
+     * readv()/writev() (WSARecv()/WSASend() on Windows) call, then the number
+     * of bytes transferred is committed to or discarded from the buffer.
+     *
+     * Only buffers of byte-sized objects can be used, since the system
+     * might transfer a partial object otherwise.
+     *
+     * Each function has two overloads: one which reports errors by setting a
+     * std::error_code, and one which throws std::system_error.  If the
+     * descriptor is non-blocking and no data can be transferred, the error is
+     * std::errc::operation_would_block (or resource_unavailable_try_again).
+     * At end of file, buffer_read_from() returns 0 without an error.
+     */
+
+#if defined(_WIN32)
+    using io_handle_type = SOCKET;
+    using io_vector_type = WSABUF;
+
+    // The maximum number of ranges passed to the system in a single call.
+    inline constexpr std::size_t io_max_ranges = 64;
+#else
+    using io_handle_type = int;
+    using io_vector_type = struct iovec;
+
+    // The maximum number of ranges passed to the system in a single call.
+    inline constexpr std::size_t io_max_ranges =
+        IOV_MAX < 1024 ? IOV_MAX : 1024;
+#endif
+
+    // Concept of a buffer which can be used for scatter/gather I/O.
+    template <typename Buffer>
+    concept io_buffer = basic_buffer<Buffer>
+        and (sizeof(buffer_value_t<Buffer>) == 1);
+
+    namespace detail {
+
+        // Fill `vecs` with the ranges in `ranges`, returning the number of
+        // vectors used.  Ranges that don't fit are ignored.
+        template <typename RangeList>
+        auto fill_io_vectors(RangeList &&ranges,
+                             std::span<io_vector_type> vecs) -> std::size_t {
+            std::size_t n = 0;
+
+            for (auto &&range : ranges) {
+                if (n == vecs.size())
+                    break;
+
+                if (std::ranges::empty(range))
+                    continue;
+
+#if defined(_WIN32)
+                // WSABUF can only describe 4GB, so large ranges are clipped.
+                vecs[n].buf = const_cast<CHAR *>(
+                    reinterpret_cast<CHAR const *>(std::ranges::data(range)));
+                vecs[n].len = static_cast<ULONG>(std::min<std::size_t>(
+                    std::ranges::size(range), ULONG_MAX));
+#else
+                vecs[n].iov_base =
+                    const_cast<void *>(static_cast<void const *>(
+                        std::ranges::data(range)));
+                vecs[n].iov_len = std::ranges::size(range);
+#endif
+                ++n;
+            }
+
+            return n;
+        }
+
+    } // namespace detail
+
+    /*
+     * buffer_read_from(fd, buf): read as much data as possible from `fd`
+     * into the space in `buf` with a single system call, then commit the
+     * data to the buffer.  Returns the number of bytes read.
+     */
+    template <writable_buffer Buffer>
+    auto buffer_read_from(io_handle_type fd, Buffer &buf, std::error_code &ec)
+        -> buffer_size_t<Buffer> requires io_buffer<Buffer> {
+
+        io_vector_type vecs[io_max_ranges];
+        auto nvecs = detail::fill_io_vectors(buf.writable_ranges(), vecs);
+
+        ec.clear();
+
+        if (nvecs == 0)
+            return 0;
+
+#if defined(_WIN32)
+        DWORD nbytes = 0, flags = 0;
+        if (WSARecv(fd, vecs, static_cast<DWORD>(nvecs), &nbytes, &flags,
+                    nullptr, nullptr) != 0) {
+            ec.assign(WSAGetLastError(), std::system_category());
+            return 0;
+        }
+#else
+        ssize_t nbytes;
+        do {
+            nbytes = ::readv(fd, vecs, static_cast<int>(nvecs));
+        } while (nbytes == -1 && errno == EINTR);
+
+        if (nbytes == -1) {
+            ec.assign(errno, std::system_category());
+            return 0;
+        }
+#endif
+
+        return buf.commit(static_cast<buffer_size_t<Buffer>>(nbytes));
+    }
+
+    template <writable_buffer Buffer>
+    auto buffer_read_from(io_handle_type fd, Buffer &buf)
+        -> buffer_size_t<Buffer> requires io_buffer<Buffer> {
+        std::error_code ec;
+        auto n = buffer_read_from(fd, buf, ec);
+        if (ec)
+            throw std::system_error(ec, "buffer_read_from");
+        return n;
+    }
+
+    /*
+     * buffer_write_to(fd, buf): write as much of the data in `buf` as
+     * possible to `fd` with a single system call, then discard the written
+     * data from the buffer.  Returns the number of bytes written.
+     */
+    template <readable_buffer Buffer>
+    auto buffer_write_to(io_handle_type fd, Buffer &buf, std::error_code &ec)
+        -> buffer_size_t<Buffer> requires io_buffer<Buffer> {
+
+        io_vector_type vecs[io_max_ranges];
+        auto nvecs = detail::fill_io_vectors(buf.readable_ranges(), vecs);
+
+        ec.clear();
+
+        if (nvecs == 0)
+            return 0;
+
+#if defined(_WIN32)
+        DWORD nbytes = 0;
+        if (WSASend(fd, vecs, static_cast<DWORD>(nvecs), &nbytes, 0, nullptr,
+                    nullptr) != 0) {
+            ec.assign(WSAGetLastError(), std::system_category());
+            return 0;
+        }
+#else
+        ssize_t nbytes;
+        do {
+            nbytes = ::writev(fd, vecs, static_cast<int>(nvecs));
+        } while (nbytes == -1 && errno == EINTR);
+
+        if (nbytes == -1) {
+            ec.assign(errno, std::system_category());
+            return 0;
+        }
+#endif
+
+        return buf.discard(static_cast<buffer_size_t<Buffer>>(nbytes));
+    }
+
+    template <readable_buffer Buffer>
+    auto buffer_write_to(io_handle_type fd, Buffer &buf)
+        -> buffer_size_t<Buffer> requires io_buffer<Buffer> {
+        std::error_code ec;
+        auto n = buffer_write_to(fd, buf, ec);
+        if (ec)
+            throw std::system_error(ec, "buffer_write_to");
+        return n;
+    }
+
+} // namespace sk
+
+#endif // SK_BUFFER_BUFFER_IO_HXX_INCLUDED
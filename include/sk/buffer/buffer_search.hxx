@@ -0,0 +1,452 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Searching the data in a buffer.
+ */
+
+#ifndef SK_BUFFER_BUFFER_SEARCH_HXX_INCLUDED
+#define SK_BUFFER_BUFFER_SEARCH_HXX_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) ||                                 \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#    include <arm_neon.h>
+#endif
+
+#include "sk/buffer/buffer.hxx"
+
+namespace sk {
+
+    /*************************************************************************
+     *
+     * Buffer search algorithms.  These search all of a buffer's readable
+     * ranges as if they were a single sequence, so matches which cross the
+     * boundary between two extents (or the wrap point of a circular buffer)
+     * are found.  Each returns the offset of the match from the start of the
+     * buffer's data, which can be passed straight to discard(), or
+     * std::nullopt if there is no match.  The buffer is not modified.
+     *
+     * buffer_find(buf, value[, from]): find the first object equal to value.
+     *
+     * buffer_find(buf, needle[, from]): find the first occurrence of the
+     * sequence needle.  For a string literal, pass a std::string_view, since
+     * a char array includes the terminating NUL.
+     *
+     * buffer_find_first_of(buf, set[, from]): find the first object equal
+     * to any object in set.
+     *
+     * buffer_split(buf, delimiter, fn): call fn(offset, size) for each
+     * complete delimited segment of the data, and return the offset just
+     * past the last delimiter.
+     *
+     * The search starts at offset `from`.  For buffers of byte-sized
+     * objects, the search uses AVX2, SSE2 or NEON if they are enabled for the
+     * target.
+     */
+
+    namespace detail {
+
+        // Objects which can be searched as bytes.
+        template <typename T>
+        concept search_byte = sizeof(T) == 1 and std::is_trivially_copyable_v<T>;
+
+        // Searches of up to this many objects in a set use SIMD.
+        inline constexpr std::size_t max_simd_set = 16;
+
+        /*
+         * find_byte(p, n, c): return the index of the first c in [p, p + n),
+         * or n if there isn't one.
+         */
+        inline auto find_byte(unsigned char const *p, std::size_t n,
+                              unsigned char c) -> std::size_t {
+            std::size_t i = 0;
+
+#if defined(__AVX2__)
+            auto vc = _mm256_set1_epi8(static_cast<char>(c));
+            for (; i + 32 <= n; i += 32) {
+                auto v = _mm256_loadu_si256(
+                    reinterpret_cast<__m256i const *>(p + i));
+                auto mask = static_cast<std::uint32_t>(
+                    _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, vc)));
+                if (mask)
+                    return i + static_cast<std::size_t>(std::countr_zero(mask));
+            }
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+            auto vc16 = _mm_set1_epi8(static_cast<char>(c));
+            for (; i + 16 <= n; i += 16) {
+                auto v =
+                    _mm_loadu_si128(reinterpret_cast<__m128i const *>(p + i));
+                auto mask = static_cast<std::uint32_t>(
+                    _mm_movemask_epi8(_mm_cmpeq_epi8(v, vc16)));
+                if (mask)
+                    return i + static_cast<std::size_t>(std::countr_zero(mask));
+            }
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+            auto vc = vdupq_n_u8(c);
+            for (; i + 16 <= n; i += 16) {
+                auto eq = vceqq_u8(vld1q_u8(p + i), vc);
+                // Narrow each byte of the result to 4 bits, giving a 64-bit
+                // mask with a nibble per byte.
+                auto mask = vget_lane_u64(
+                    vreinterpret_u64_u8(
+                        vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)),
+                    0);
+                if (mask)
+                    return i +
+                           static_cast<std::size_t>(std::countr_zero(mask)) / 4;
+            }
+#endif
+
+            for (; i < n; ++i)
+                if (p[i] == c)
+                    return i;
+            return n;
+        }
+
+        /*
+         * find_first_of_bytes(p, n, set): return the index of the first byte
+         * in [p, p + n) which is in set, or n if there isn't one.
+         */
+        inline auto find_first_of_bytes(unsigned char const *p, std::size_t n,
+                                        std::span<unsigned char const> set)
+            -> std::size_t {
+            if (set.empty())
+                return n;
+
+            if (set.size() == 1)
+                return find_byte(p, n, set[0]);
+
+            std::size_t i = 0;
+
+            if (set.size() <= max_simd_set) {
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+                __m128i vset[max_simd_set];
+                for (std::size_t k = 0; k < set.size(); ++k)
+                    vset[k] = _mm_set1_epi8(static_cast<char>(set[k]));
+
+                for (; i + 16 <= n; i += 16) {
+                    auto v = _mm_loadu_si128(
+                        reinterpret_cast<__m128i const *>(p + i));
+                    auto acc = _mm_cmpeq_epi8(v, vset[0]);
+                    for (std::size_t k = 1; k < set.size(); ++k)
+                        acc = _mm_or_si128(acc, _mm_cmpeq_epi8(v, vset[k]));
+
+                    auto mask =
+                        static_cast<std::uint32_t>(_mm_movemask_epi8(acc));
+                    if (mask)
+                        return i +
+                               static_cast<std::size_t>(std::countr_zero(mask));
+                }
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+                uint8x16_t vset[max_simd_set];
+                for (std::size_t k = 0; k < set.size(); ++k)
+                    vset[k] = vdupq_n_u8(set[k]);
+
+                for (; i + 16 <= n; i += 16) {
+                    auto v = vld1q_u8(p + i);
+                    auto acc = vceqq_u8(v, vset[0]);
+                    for (std::size_t k = 1; k < set.size(); ++k)
+                        acc = vorrq_u8(acc, vceqq_u8(v, vset[k]));
+
+                    auto mask = vget_lane_u64(
+                        vreinterpret_u64_u8(
+                            vshrn_n_u16(vreinterpretq_u16_u8(acc), 4)),
+                        0);
+                    if (mask)
+                        return i + static_cast<std::size_t>(
+                                       std::countr_zero(mask)) /
+                                       4;
+                }
+#endif
+            }
+
+            // Large sets, and the tail: use a lookup table.
+            std::array<bool, 256> table{};
+            for (auto c : set)
+                table[c] = true;
+
+            for (; i < n; ++i)
+                if (table[p[i]])
+                    return i;
+            return n;
+        }
+
+        // Return the index of value in s, or s.size().
+        template <typename T>
+        auto search_value(std::span<T const> s, T const &value)
+            -> std::size_t {
+            if constexpr (search_byte<T>) {
+                return find_byte(
+                    reinterpret_cast<unsigned char const *>(s.data()),
+                    s.size(), std::bit_cast<unsigned char>(value));
+            } else {
+                return static_cast<std::size_t>(
+                    std::ranges::find(s, value) - s.begin());
+            }
+        }
+
+        // Return the index of the first object of s in set, or s.size().
+        template <typename T>
+        auto search_set(std::span<T const> s, std::span<T const> set)
+            -> std::size_t {
+            if constexpr (search_byte<T>) {
+                return find_first_of_bytes(
+                    reinterpret_cast<unsigned char const *>(s.data()),
+                    s.size(),
+                    std::span(reinterpret_cast<unsigned char const *>(
+                                  set.data()),
+                              set.size()));
+            } else {
+                return static_cast<std::size_t>(
+                    std::ranges::find_first_of(s, set) - s.begin());
+            }
+        }
+
+        /*
+         * search_cursor: a position in a buffer's readable ranges.  `it` is
+         * the current range and `pos` the offset within it; `base` is the
+         * offset of the current range from the start of the buffer.  Empty
+         * ranges are skipped, so unless the cursor is at the end, pos is
+         * always inside the current range.
+         */
+        template <typename T, typename Iterator, typename Sentinel>
+        struct search_cursor {
+            Iterator it;
+            Sentinel last;
+            std::size_t base = 0;
+            std::size_t pos = 0;
+
+            search_cursor(Iterator it_, Sentinel last_, std::size_t from)
+                : it(it_), last(last_) {
+                advance(from);
+            }
+
+            auto at_end() const -> bool {
+                return it == last;
+            }
+
+            auto offset() const -> std::size_t {
+                return base + pos;
+            }
+
+            // The rest of the current range.
+            auto current() const -> std::span<T const> {
+                return std::span<T const>(*it).subspan(pos);
+            }
+
+            // Move forward n objects.
+            auto advance(std::size_t n) -> void {
+                pos += n;
+                while (it != last) {
+                    auto size = std::ranges::size(*it);
+                    if (pos < size)
+                        break;
+                    pos -= size;
+                    base += size;
+                    ++it;
+                }
+            }
+
+            // Move to the first object for which scan(range) finds a match.
+            // Returns false, leaving the cursor at the end, if there is none.
+            template <typename Scan> auto scan(Scan &&scan) -> bool {
+                while (!at_end()) {
+                    auto s = current();
+                    auto i = scan(s);
+                    if (i < s.size()) {
+                        pos += i;
+                        return true;
+                    }
+                    advance(s.size());
+                }
+                return false;
+            }
+
+            // Return true if the data at the cursor starts with needle.
+            auto starts_with(std::span<T const> needle) const -> bool {
+                auto c = *this;
+                while (!needle.empty()) {
+                    if (c.at_end())
+                        return false;
+
+                    auto s = c.current();
+                    auto n = std::min(s.size(), needle.size());
+                    if (!std::ranges::equal(s.first(n), needle.first(n)))
+                        return false;
+
+                    needle = needle.subspan(n);
+                    c.advance(n);
+                }
+                return true;
+            }
+
+            // Move to the next occurrence of needle, which must not be
+            // empty.
+            auto find(std::span<T const> needle) -> bool {
+                for (;;) {
+                    if (!scan([&](auto s) {
+                            return search_value(s, needle.front());
+                        }))
+                        return false;
+
+                    if (starts_with(needle))
+                        return true;
+
+                    advance(1);
+                }
+            }
+        };
+
+        template <typename Buffer, typename Ranges>
+        auto make_search_cursor(Ranges &ranges, std::size_t from) {
+            return search_cursor<buffer_value_t<Buffer>,
+                                 std::ranges::iterator_t<Ranges>,
+                                 std::ranges::sentinel_t<Ranges>>(
+                std::ranges::begin(ranges), std::ranges::end(ranges), from);
+        }
+
+    } // namespace detail
+
+    template <readable_buffer Buffer>
+    auto buffer_find(Buffer &buf, buffer_value_t<Buffer> const &value,
+                     buffer_size_t<Buffer> from = 0)
+        -> std::optional<buffer_size_t<Buffer>> {
+        using value_type = buffer_value_t<Buffer>;
+
+        auto ranges = buf.readable_ranges();
+        auto cursor = detail::make_search_cursor<Buffer>(ranges, from);
+
+        if (!cursor.scan([&](std::span<value_type const> s) {
+                return detail::search_value(s, value);
+            }))
+            return std::nullopt;
+
+        return static_cast<buffer_size_t<Buffer>>(cursor.offset());
+    }
+
+    template <readable_buffer Buffer, std::ranges::contiguous_range Needle>
+    auto buffer_find(Buffer &buf, Needle const &needle,
+                     buffer_size_t<Buffer> from = 0)
+        -> std::optional<buffer_size_t<Buffer>> requires std::same_as<
+            buffer_value_t<Buffer>,
+            std::remove_const_t<std::ranges::range_value_t<Needle>>> {
+        using value_type = buffer_value_t<Buffer>;
+
+        auto ranges = buf.readable_ranges();
+        auto cursor = detail::make_search_cursor<Buffer>(ranges, from);
+        std::span<value_type const> needle_span(needle);
+
+        // An empty needle matches at the starting position.
+        if (needle_span.empty())
+            return from <= buffer_size(buf) ? std::optional(from)
+                                            : std::nullopt;
+
+        if (!cursor.find(needle_span))
+            return std::nullopt;
+
+        return static_cast<buffer_size_t<Buffer>>(cursor.offset());
+    }
+
+    template <readable_buffer Buffer, std::ranges::contiguous_range Set>
+    auto buffer_find_first_of(Buffer &buf, Set const &set,
+                              buffer_size_t<Buffer> from = 0)
+        -> std::optional<buffer_size_t<Buffer>> requires std::same_as<
+            buffer_value_t<Buffer>,
+            std::remove_const_t<std::ranges::range_value_t<Set>>> {
+        using value_type = buffer_value_t<Buffer>;
+
+        auto ranges = buf.readable_ranges();
+        auto cursor = detail::make_search_cursor<Buffer>(ranges, from);
+        std::span<value_type const> set_span(set);
+
+        if (!cursor.scan([&](std::span<value_type const> s) {
+                return detail::search_set(s, set_span);
+            }))
+            return std::nullopt;
+
+        return static_cast<buffer_size_t<Buffer>>(cursor.offset());
+    }
+
+    /*
+     * buffer_split(buf, delimiter, fn): for each segment of the data which
+     * is followed by delimiter, call fn(offset, size) with the segment's
+     * offset and size, not including the delimiter.  Data after the last
+     * delimiter is not passed to fn, since the rest of the segment might not
+     * have arrived yet.  Returns the offset just past the last delimiter,
+     * which can be passed to discard() once the segments have been handled.
+     *
+     * fn must not modify the buffer.  The delimiter must not be empty.
+     */
+    template <readable_buffer Buffer, std::ranges::contiguous_range Delimiter,
+              typename Fn>
+    auto buffer_split(Buffer &buf, Delimiter const &delimiter, Fn &&fn)
+        -> buffer_size_t<Buffer> requires std::same_as<
+            buffer_value_t<Buffer>,
+            std::remove_const_t<std::ranges::range_value_t<Delimiter>>> {
+        using value_type = buffer_value_t<Buffer>;
+
+        std::span<value_type const> delimiter_span(delimiter);
+        assert(!delimiter_span.empty());
+
+        auto ranges = buf.readable_ranges();
+        auto cursor = detail::make_search_cursor<Buffer>(ranges, 0);
+        std::size_t start = 0;
+
+        while (cursor.find(delimiter_span)) {
+            auto end = cursor.offset();
+            fn(static_cast<buffer_size_t<Buffer>>(start),
+               static_cast<buffer_size_t<Buffer>>(end - start));
+            cursor.advance(delimiter_span.size());
+            start = end + delimiter_span.size();
+        }
+
+        return static_cast<buffer_size_t<Buffer>>(start);
+    }
+
+} // namespace sk
+
+#endif // SK_BUFFER_BUFFER_SEARCH_HXX_INCLUDED
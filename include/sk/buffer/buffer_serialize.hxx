@@ -0,0 +1,623 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Encoding and decoding typed values directly in buffers.
+ */
+
+#ifndef SK_BUFFER_BUFFER_SERIALIZE_HXX_INCLUDED
+#define SK_BUFFER_BUFFER_SERIALIZE_HXX_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <climits>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <system_error>
+#include <type_traits>
+
+#include "sk/buffer/buffer.hxx"
+
+namespace sk {
+
+    /*************************************************************************
+     *
+     * Serialization helpers for buffers of bytes:
+     *
+     * buffer_put(buf, value, order) and buffer_get<T>(buf, order) write and
+     * read integers, enums and floating-point values in big- or
+     * little-endian byte order.
+     *
+     * buffer_put_varint(buf, value) and buffer_get_varint<T>(buf) use LEB128:
+     * unsigned LEB128 for unsigned types, and signed LEB128 for signed types.
+     *
+     * buffer_put_blob(buf, data) and buffer_get_blob(buf, out) write and read
+     * a sequence of bytes preceded by its length as an unsigned LEB128.
+     *
+     * When the first writable (or readable) range is large enough, values are
+     * encoded (or decoded) in place and committed (or discarded) in one call.
+     * Only a value which crosses a range boundary, such as the end of an
+     * extent, is copied through a temporary.
+     *
+     * The put functions return false if the buffer couldn't hold the whole
+     * value.  As with write(), a buffer which is nearly full might then hold
+     * part of it.  The get functions return std::nullopt (or false) if the
+     * buffer doesn't yet hold the whole value, and in that case don't remove
+     * anything from the buffer.  Malformed input, such as a varint which is
+     * too large for its type, is reported by throwing std::system_error; the
+     * overloads which take a std::error_code & report it there instead.
+     */
+
+    // Concept of a buffer whose objects are bytes.
+    template <typename Buffer>
+    concept byte_buffer = basic_buffer<Buffer>
+        and (sizeof(buffer_value_t<Buffer>) == 1);
+
+    // Concept of a type which can be written by buffer_put().
+    template <typename T>
+    concept serializable_scalar = (std::integral<T> and
+                                   not std::same_as<T, bool>)
+        or std::is_enum_v<T>
+        or (std::floating_point<T> and
+            (sizeof(T) == 4 or sizeof(T) == 8));
+
+    namespace detail {
+
+        template <std::size_t n> struct uint_of_size;
+        template <> struct uint_of_size<1> { using type = std::uint8_t; };
+        template <> struct uint_of_size<2> { using type = std::uint16_t; };
+        template <> struct uint_of_size<4> { using type = std::uint32_t; };
+        template <> struct uint_of_size<8> { using type = std::uint64_t; };
+
+        template <typename T>
+        using bits_type = typename uint_of_size<sizeof(T)>::type;
+
+        // Convert a value to and from the unsigned integer that represents
+        // it on the wire.
+        template <serializable_scalar T>
+        constexpr auto to_bits(T value) -> bits_type<T> {
+            if constexpr (std::is_enum_v<T>)
+                return static_cast<bits_type<T>>(
+                    static_cast<std::underlying_type_t<T>>(value));
+            else if constexpr (std::floating_point<T>)
+                return std::bit_cast<bits_type<T>>(value);
+            else
+                return static_cast<bits_type<T>>(value);
+        }
+
+        template <serializable_scalar T>
+        constexpr auto from_bits(bits_type<T> bits) -> T {
+            if constexpr (std::is_enum_v<T>)
+                return static_cast<T>(
+                    static_cast<std::underlying_type_t<T>>(bits));
+            else if constexpr (std::floating_point<T>)
+                return std::bit_cast<T>(bits);
+            else
+                return static_cast<T>(bits);
+        }
+
+        // Encode and decode a fixed-width unsigned integer.  Compilers turn
+        // these loops into a single load or store, plus a byte swap if
+        // needed.
+        template <typename Char, std::unsigned_integral U>
+        auto encode_fixed(Char *p, U bits, std::endian order) -> void {
+            constexpr auto n = sizeof(U);
+
+            for (std::size_t i = 0; i < n; ++i) {
+                auto shift = (order == std::endian::big) ? 8 * (n - 1 - i)
+                                                         : 8 * i;
+                p[i] = static_cast<Char>(
+                    static_cast<unsigned char>(bits >> shift));
+            }
+        }
+
+        template <std::unsigned_integral U, typename Char>
+        auto decode_fixed(Char const *p, std::endian order) -> U {
+            constexpr auto n = sizeof(U);
+            U bits = 0;
+
+            for (std::size_t i = 0; i < n; ++i) {
+                auto shift = (order == std::endian::big) ? 8 * (n - 1 - i)
+                                                         : 8 * i;
+                bits |= static_cast<U>(static_cast<unsigned char>(p[i]))
+                        << shift;
+            }
+
+            return bits;
+        }
+
+        // The maximum encoded size of a varint of type T.
+        template <std::integral T>
+        inline constexpr std::size_t max_varint_size =
+            (sizeof(T) * CHAR_BIT + 6) / 7;
+
+        // Encode a LEB128 varint at p, returning its length.
+        template <typename Char, std::integral T>
+        auto encode_varint(Char *p, T value) -> std::size_t {
+            std::size_t n = 0;
+
+            if constexpr (std::is_unsigned_v<T>) {
+                do {
+                    auto byte = static_cast<unsigned char>(value & 0x7F);
+                    value >>= 7;
+                    if (value != 0)
+                        byte |= 0x80;
+                    p[n++] = static_cast<Char>(byte);
+                } while (value != 0);
+            } else {
+                for (;;) {
+                    auto byte = static_cast<unsigned char>(value & 0x7F);
+                    value >>= 7; // arithmetic shift
+
+                    if ((value == 0 && !(byte & 0x40)) ||
+                        (value == -1 && (byte & 0x40))) {
+                        p[n++] = static_cast<Char>(byte);
+                        break;
+                    }
+
+                    p[n++] = static_cast<Char>(byte | 0x80);
+                }
+            }
+
+            return n;
+        }
+
+        enum struct varint_status { ok, incomplete, malformed };
+
+        // Decode a LEB128 varint from the start of a buffer without removing
+        // it, storing the value and its encoded length.
+        template <std::integral T, readable_buffer Buffer>
+        auto peek_varint(Buffer &buf, T &value, std::size_t &length)
+            -> varint_status {
+            using U = std::make_unsigned_t<T>;
+            constexpr auto bits = static_cast<unsigned>(sizeof(T) * CHAR_BIT);
+
+            U result = 0;
+            unsigned shift = 0;
+            std::size_t n = 0;
+
+            for (auto &&range : buf.readable_ranges()) {
+                for (auto c : range) {
+                    auto byte = static_cast<unsigned char>(c);
+                    auto payload = static_cast<unsigned>(byte & 0x7F);
+
+                    if (n == max_varint_size<T>)
+                        return varint_status::malformed;
+
+                    // In the last byte which can hold bits of the value,
+                    // the unused high bits must be zero, or for a signed
+                    // type, copies of the sign bit.
+                    if (auto used = bits - shift; used < 7) {
+                        auto extra = payload >> (used - (std::is_signed_v<T>
+                                                             ? 1
+                                                             : 0));
+                        auto ones = 0x7Fu >> (used - (std::is_signed_v<T>
+                                                          ? 1
+                                                          : 0));
+                        if (extra != 0 && (std::is_unsigned_v<T> ||
+                                           extra != ones))
+                            return varint_status::malformed;
+                    }
+
+                    result |= static_cast<U>(payload) << shift;
+                    shift += 7;
+                    ++n;
+
+                    if (!(byte & 0x80)) {
+                        // Sign-extend a negative signed value.
+                        if constexpr (std::is_signed_v<T>) {
+                            if (shift < bits && (payload & 0x40))
+                                result |= static_cast<U>(~U(0)) << shift;
+                        }
+
+                        value = static_cast<T>(result);
+                        length = n;
+                        return varint_status::ok;
+                    }
+                }
+            }
+
+            return varint_status::incomplete;
+        }
+
+        // Write an encoded value of n bytes.  If the first writable range is
+        // large enough, encode() is called on it directly; otherwise the
+        // value is encoded into a temporary and written with write().
+        template <writable_buffer Buffer, std::size_t max_size,
+                  typename Encode>
+        auto put_encoded(Buffer &buf, Encode &&encode) -> bool {
+            using value_type = buffer_value_t<Buffer>;
+
+            auto ranges = buf.writable_ranges();
+            for (auto &&range : ranges) {
+                if (std::ranges::empty(range))
+                    continue;
+
+                if (std::ranges::size(range) >= max_size) {
+                    auto n = encode(std::ranges::data(range));
+                    return buf.commit(n) == n;
+                }
+                break;
+            }
+
+            std::array<value_type, max_size> tmp;
+            auto n = encode(tmp.data());
+            return buf.write(std::span<value_type const>(tmp.data(), n)) == n;
+        }
+
+        inline auto throw_if(std::error_code const &ec, char const *what)
+            -> void {
+            if (ec)
+                throw std::system_error(ec, what);
+        }
+
+    } // namespace detail
+
+    /*
+     * buffer_put(buf, value, order): write a scalar in the given byte order,
+     * which is big-endian (network byte order) by default.
+     */
+    template <writable_buffer Buffer, serializable_scalar T>
+    auto buffer_put(Buffer &buf, T value,
+                    std::endian order = std::endian::big) -> bool
+        requires byte_buffer<Buffer> {
+        return detail::put_encoded<Buffer, sizeof(T)>(
+            buf, [&](auto *p) {
+                detail::encode_fixed(p, detail::to_bits(value), order);
+                return sizeof(T);
+            });
+    }
+
+    /*
+     * buffer_get<T>(buf, order): read a scalar written by buffer_put().
+     */
+    template <serializable_scalar T, readable_buffer Buffer>
+    auto buffer_get(Buffer &buf, std::endian order = std::endian::big)
+        -> std::optional<T> requires byte_buffer<Buffer> {
+        using bits_type = detail::bits_type<T>;
+
+        std::array<buffer_value_t<Buffer>, sizeof(T)> scratch;
+        auto data = buffer_peek_contiguous(buf, sizeof(T), scratch);
+        if (data.empty())
+            return std::nullopt;
+
+        auto value = detail::from_bits<T>(
+            detail::decode_fixed<bits_type>(data.data(), order));
+        buf.discard(sizeof(T));
+        return value;
+    }
+
+    /*
+     * buffer_put_varint(buf, value): write an integer as a LEB128 varint.
+     */
+    template <writable_buffer Buffer, std::integral T>
+    auto buffer_put_varint(Buffer &buf, T value) -> bool
+        requires byte_buffer<Buffer> && (!std::same_as<T, bool>) {
+        return detail::put_encoded<Buffer, detail::max_varint_size<T>>(
+            buf, [&](auto *p) { return detail::encode_varint(p, value); });
+    }
+
+    /*
+     * buffer_get_varint<T>(buf): read a LEB128 varint.  The encoding is
+     * malformed (std::errc::value_too_large) if it doesn't fit in T.
+     */
+    template <std::integral T, readable_buffer Buffer>
+    auto buffer_get_varint(Buffer &buf, std::error_code &ec)
+        -> std::optional<T> requires byte_buffer<Buffer> {
+        ec.clear();
+
+        T value;
+        std::size_t length;
+
+        switch (detail::peek_varint(buf, value, length)) {
+        case detail::varint_status::ok:
+            buf.discard(length);
+            return value;
+
+        case detail::varint_status::malformed:
+            ec = std::make_error_code(std::errc::value_too_large);
+            return std::nullopt;
+
+        case detail::varint_status::incomplete:
+            break;
+        }
+
+        return std::nullopt;
+    }
+
+    template <std::integral T, readable_buffer Buffer>
+    auto buffer_get_varint(Buffer &buf) -> std::optional<T>
+        requires byte_buffer<Buffer> {
+        std::error_code ec;
+        auto value = buffer_get_varint<T>(buf, ec);
+        detail::throw_if(ec, "buffer_get_varint");
+        return value;
+    }
+
+    /*
+     * buffer_put_blob(buf, data): write the size of `data` as a varint,
+     * followed by the data.
+     */
+    template <writable_buffer Buffer, std::ranges::contiguous_range Range>
+    auto buffer_put_blob(Buffer &buf, Range &&data) -> bool
+        requires byte_buffer<Buffer> && std::same_as<
+            buffer_const_value_t<Buffer>,
+            std::add_const_t<std::ranges::range_value_t<Range>>> {
+
+        std::span<buffer_const_value_t<Buffer>> bytes(data);
+        return buffer_put_varint(buf, std::uint64_t{bytes.size()}) &&
+               buf.write(bytes) == bytes.size();
+    }
+
+    /*
+     * buffer_get_blob(buf, out, max_size): read a blob written by
+     * buffer_put_blob() into `out`, which is resized to fit, e.g. a
+     * std::string or std::vector.  Returns false if the buffer doesn't hold
+     * the whole blob yet.  A blob larger than max_size is malformed
+     * (std::errc::message_size).
+     */
+    template <readable_buffer Buffer, typename Container>
+    auto buffer_get_blob(Buffer &buf, Container &out, std::error_code &ec,
+                         std::size_t max_size =
+                             std::numeric_limits<std::size_t>::max()) -> bool
+        requires byte_buffer<Buffer> && requires(Container &c) {
+            c.resize(std::size_t{});
+            { std::span<buffer_value_t<Buffer>>(c) };
+        } {
+        ec.clear();
+
+        std::uint64_t size;
+        std::size_t length;
+
+        switch (detail::peek_varint(buf, size, length)) {
+        case detail::varint_status::ok:
+            break;
+
+        case detail::varint_status::malformed:
+            ec = std::make_error_code(std::errc::value_too_large);
+            return false;
+
+        case detail::varint_status::incomplete:
+            return false;
+        }
+
+        if (size > max_size) {
+            ec = std::make_error_code(std::errc::message_size);
+            return false;
+        }
+
+        if (buffer_size(buf) - length < size)
+            return false;
+
+        buf.discard(length);
+        out.resize(static_cast<std::size_t>(size));
+        buf.read(std::span<buffer_value_t<Buffer>>(out));
+        return true;
+    }
+
+    template <readable_buffer Buffer, typename Container>
+    auto buffer_get_blob(Buffer &buf, Container &out,
+                         std::size_t max_size =
+                             std::numeric_limits<std::size_t>::max()) -> bool
+        requires byte_buffer<Buffer> && requires(Container &c) {
+            c.resize(std::size_t{});
+            { std::span<buffer_value_t<Buffer>>(c) };
+        } {
+        std::error_code ec;
+        auto ok = buffer_get_blob(buf, out, ec, max_size);
+        detail::throw_if(ec, "buffer_get_blob");
+        return ok;
+    }
+
+    /*************************************************************************
+     *
+     * buffer_writer and buffer_reader: encode or decode a sequence of values
+     * with a single commit() or discard().  The writer holds on to the
+     * buffer's first writable range and encodes values into it, committing
+     * them all when the range is full, when commit() is called, or when the
+     * writer is destroyed.  The reader does the same with the first readable
+     * range.
+     *
+     * The buffer must not be used directly while a writer or reader refers
+     * to it, except after calling commit() or discard() respectively.
+     */
+
+    template <writable_buffer Buffer>
+        requires byte_buffer<Buffer>
+    struct buffer_writer {
+        using value_type = buffer_value_t<Buffer>;
+        using size_type = buffer_size_t<Buffer>;
+
+        explicit buffer_writer(Buffer &buf_) : buf(buf_) {}
+
+        buffer_writer(buffer_writer const &) = delete;
+        buffer_writer &operator=(buffer_writer const &) = delete;
+
+        ~buffer_writer() {
+            commit();
+        }
+
+        template <serializable_scalar T>
+        auto put(T value, std::endian order = std::endian::big) -> bool {
+            if (auto *p = reserve(sizeof(T))) {
+                detail::encode_fixed(p, detail::to_bits(value), order);
+                pending += sizeof(T);
+                return true;
+            }
+            return buffer_put(buf, value, order);
+        }
+
+        template <std::integral T>
+            requires(!std::same_as<T, bool>)
+        auto put_varint(T value) -> bool {
+            if (auto *p = reserve(detail::max_varint_size<T>)) {
+                pending += detail::encode_varint(p, value);
+                return true;
+            }
+            return buffer_put_varint(buf, value);
+        }
+
+        template <std::ranges::contiguous_range Range>
+        auto put_blob(Range &&data) -> bool {
+            commit();
+            return buffer_put_blob(buf, std::forward<Range>(data));
+        }
+
+        // Commit the values written so far.
+        auto commit() -> void {
+            if (pending > 0)
+                buf.commit(pending);
+            window = {};
+            pending = 0;
+        }
+
+      private:
+        // Return a pointer to n bytes of space in the window, refilling it
+        // if necessary, or nullptr if the first writable range is too small.
+        auto reserve(std::size_t n) -> value_type * {
+            if (window.size() - pending >= n)
+                return window.data() + pending;
+
+            commit();
+
+            for (auto &&range : buf.writable_ranges()) {
+                if (!std::ranges::empty(range)) {
+                    window = std::span<value_type>(range);
+                    break;
+                }
+            }
+
+            // If the range is too small, the caller will use the buffer
+            // directly, which invalidates it.
+            if (window.size() < n) {
+                window = {};
+                return nullptr;
+            }
+
+            return window.data();
+        }
+
+        Buffer &buf;
+        std::span<value_type> window;
+        size_type pending = 0;
+    };
+
+    template <readable_buffer Buffer>
+        requires byte_buffer<Buffer>
+    struct buffer_reader {
+        using value_type = buffer_const_value_t<Buffer>;
+        using size_type = buffer_size_t<Buffer>;
+
+        explicit buffer_reader(Buffer &buf_) : buf(buf_) {}
+
+        buffer_reader(buffer_reader const &) = delete;
+        buffer_reader &operator=(buffer_reader const &) = delete;
+
+        ~buffer_reader() {
+            discard();
+        }
+
+        template <serializable_scalar T>
+        auto get(std::endian order = std::endian::big) -> std::optional<T> {
+            using bits_type = detail::bits_type<T>;
+
+            if (auto *p = available(sizeof(T))) {
+                consumed += sizeof(T);
+                return detail::from_bits<T>(
+                    detail::decode_fixed<bits_type>(p, order));
+            }
+            return buffer_get<T>(buf, order);
+        }
+
+        template <std::integral T>
+        auto get_varint(std::error_code &ec) -> std::optional<T> {
+            discard();
+            return buffer_get_varint<T>(buf, ec);
+        }
+
+        template <std::integral T> auto get_varint() -> std::optional<T> {
+            discard();
+            return buffer_get_varint<T>(buf);
+        }
+
+        template <typename Container>
+        auto get_blob(Container &out,
+                      std::size_t max_size =
+                          std::numeric_limits<std::size_t>::max()) -> bool {
+            discard();
+            return buffer_get_blob(buf, out, max_size);
+        }
+
+        // Discard the values read so far from the buffer.
+        auto discard() -> void {
+            if (consumed > 0)
+                buf.discard(consumed);
+            window = {};
+            consumed = 0;
+        }
+
+      private:
+        // Return a pointer to n bytes of data in the window, refilling it if
+        // necessary, or nullptr if the first readable range is too small.
+        auto available(std::size_t n) -> value_type * {
+            if (window.size() - consumed >= n)
+                return window.data() + consumed;
+
+            discard();
+
+            for (auto &&range : buf.readable_ranges()) {
+                if (!std::ranges::empty(range)) {
+                    window = std::span<value_type>(range);
+                    break;
+                }
+            }
+
+            // If the range is too small, the caller will use the buffer
+            // directly, which invalidates it.
+            if (window.size() < n) {
+                window = {};
+                return nullptr;
+            }
+
+            return window.data();
+        }
+
+        Buffer &buf;
+        std::span<value_type> window;
+        size_type consumed = 0;
+    };
+
+} // namespace sk
+
+#endif // SK_BUFFER_BUFFER_SERIALIZE_HXX_INCLUDED
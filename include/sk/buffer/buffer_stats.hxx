@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Statistics policies for buffers.
+ */
+
+#ifndef SK_BUFFER_BUFFER_STATS_HXX_INCLUDED
+#define SK_BUFFER_BUFFER_STATS_HXX_INCLUDED
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+
+#if __has_include(<sys/sdt.h>)
+#    include <sys/sdt.h>
+#endif
+
+namespace sk {
+
+    /*************************************************************************
+     *
+     * Buffer statistics.  dynamic_buffer and circular_buffer take a Stats
+     * policy as their last template parameter, and call its hooks from
+     * their hot paths:
+     *
+     *   on_write(requested, written)  write() copied `written` objects of
+     *                                 `requested` into the buffer
+     *   on_read(requested, read)      read() copied `read` objects out
+     *   on_commit(n, size)            n objects were added, by any means,
+     *                                 leaving `size` readable
+     *   on_discard(n, size)           n objects were removed, by any means
+     *   on_extent_add(n)              an extent of n objects was added
+     *   on_extent_remove(n)           an extent of n objects was removed
+     *
+     * write() and read() also call on_commit() and on_discard(), so the
+     * data which was transferred without copying (through writable_ranges()
+     * and commit(), readable_ranges() and discard(), or shared extents) is
+     * the difference between the two.
+     *
+     * The default policy, null_buffer_stats, is empty and does nothing, so
+     * it costs no space (the member is [[no_unique_address]]) and no time.
+     * buffer_stats counts events for one buffer; thread_buffer_stats adds
+     * them to a per-thread total shared by every buffer on the thread which
+     * uses it.  Other policies can be written to feed a profiler, e.g. a
+     * Tracy policy which calls TracyPlot() from on_commit(), and
+     * usdt_buffer_stats fires USDT probes where <sys/sdt.h> is available.
+     */
+
+    // clang-format off
+
+    // Concept of a statistics policy for buffers.
+    template <typename Stats>
+    concept buffer_stats_policy =
+        requires(Stats &stats, std::size_t n) {
+            stats.on_write(n, n);
+            stats.on_read(n, n);
+            stats.on_commit(n, n);
+            stats.on_discard(n, n);
+            stats.on_extent_add(n);
+            stats.on_extent_remove(n);
+        };
+
+    // clang-format on
+
+    // The default policy, which records nothing.
+    struct null_buffer_stats {
+        constexpr auto on_write(std::size_t, std::size_t) noexcept -> void {}
+        constexpr auto on_read(std::size_t, std::size_t) noexcept -> void {}
+        constexpr auto on_commit(std::size_t, std::size_t) noexcept -> void {}
+        constexpr auto on_discard(std::size_t, std::size_t) noexcept -> void {}
+        constexpr auto on_extent_add(std::size_t) noexcept -> void {}
+        constexpr auto on_extent_remove(std::size_t) noexcept -> void {}
+    };
+
+    static_assert(buffer_stats_policy<null_buffer_stats>);
+
+    // A policy which counts events for a single buffer.  Sizes are in
+    // objects.
+    struct buffer_stats {
+        // Calls to write(), and those which couldn't write all the data.
+        std::uint64_t writes = 0;
+        std::uint64_t short_writes = 0;
+
+        // Calls to read().
+        std::uint64_t reads = 0;
+
+        // Data copied in by write() and out by read().
+        std::uint64_t copied_in = 0;
+        std::uint64_t copied_out = 0;
+
+        // All data added to and removed from the buffer.
+        std::uint64_t committed = 0;
+        std::uint64_t discarded = 0;
+
+        // The largest amount of readable data the buffer has held.
+        std::uint64_t peak_size = 0;
+
+        // Extents added to and removed from the buffer, and the size of
+        // the largest one.
+        std::uint64_t extents_added = 0;
+        std::uint64_t extents_removed = 0;
+        std::uint64_t largest_extent = 0;
+
+        // Data which was added resp. removed without being copied.
+        auto zero_copy_in() const noexcept -> std::uint64_t {
+            return committed - copied_in;
+        }
+
+        auto zero_copy_out() const noexcept -> std::uint64_t {
+            return discarded - copied_out;
+        }
+
+        auto on_write(std::size_t requested, std::size_t written) noexcept
+            -> void {
+            ++writes;
+            copied_in += written;
+            if (written < requested)
+                ++short_writes;
+        }
+
+        auto on_read(std::size_t, std::size_t read) noexcept -> void {
+            ++reads;
+            copied_out += read;
+        }
+
+        auto on_commit(std::size_t n, std::size_t size) noexcept -> void {
+            committed += n;
+            peak_size = std::max<std::uint64_t>(peak_size, size);
+        }
+
+        auto on_discard(std::size_t n, std::size_t) noexcept -> void {
+            discarded += n;
+        }
+
+        auto on_extent_add(std::size_t n) noexcept -> void {
+            ++extents_added;
+            largest_extent = std::max<std::uint64_t>(largest_extent, n);
+        }
+
+        auto on_extent_remove(std::size_t) noexcept -> void {
+            ++extents_removed;
+        }
+
+        // Add another set of statistics to this one, e.g. to total the
+        // statistics of several buffers or threads.  The peak size and the
+        // largest extent are the larger of the two.
+        auto operator+=(buffer_stats const &other) noexcept -> buffer_stats & {
+            writes += other.writes;
+            short_writes += other.short_writes;
+            reads += other.reads;
+            copied_in += other.copied_in;
+            copied_out += other.copied_out;
+            committed += other.committed;
+            discarded += other.discarded;
+            peak_size = std::max(peak_size, other.peak_size);
+            extents_added += other.extents_added;
+            extents_removed += other.extents_removed;
+            largest_extent = std::max(largest_extent, other.largest_extent);
+            return *this;
+        }
+
+        auto operator==(buffer_stats const &) const -> bool = default;
+    };
+
+    static_assert(buffer_stats_policy<buffer_stats>);
+
+    // A policy which adds events to a total for the calling thread.  The
+    // policy object is empty; the totals are in thread_totals().
+    struct thread_buffer_stats {
+        // Return the calling thread's totals.
+        static auto thread_totals() noexcept -> buffer_stats & {
+            thread_local buffer_stats totals;
+            return totals;
+        }
+
+        auto on_write(std::size_t requested, std::size_t written) noexcept
+            -> void {
+            thread_totals().on_write(requested, written);
+        }
+
+        auto on_read(std::size_t requested, std::size_t read) noexcept
+            -> void {
+            thread_totals().on_read(requested, read);
+        }
+
+        auto on_commit(std::size_t n, std::size_t size) noexcept -> void {
+            thread_totals().on_commit(n, size);
+        }
+
+        auto on_discard(std::size_t n, std::size_t size) noexcept -> void {
+            thread_totals().on_discard(n, size);
+        }
+
+        auto on_extent_add(std::size_t n) noexcept -> void {
+            thread_totals().on_extent_add(n);
+        }
+
+        auto on_extent_remove(std::size_t n) noexcept -> void {
+            thread_totals().on_extent_remove(n);
+        }
+    };
+
+    static_assert(buffer_stats_policy<thread_buffer_stats>);
+
+#if defined(DTRACE_PROBE2)
+    // A policy which fires a USDT probe for each event, in the provider
+    // sk_buffer, so the events can be traced with bpftrace, perf or
+    // SystemTap, e.g. `bpftrace -e 'usdt:./app:sk_buffer:commit
+    // { @sizes = hist(arg1); }'`.  The probes are a single nop each when
+    // nothing is tracing them.
+    struct usdt_buffer_stats {
+        auto on_write(std::size_t requested, std::size_t written) noexcept
+            -> void {
+            DTRACE_PROBE2(sk_buffer, write, requested, written);
+        }
+
+        auto on_read(std::size_t requested, std::size_t read) noexcept
+            -> void {
+            DTRACE_PROBE2(sk_buffer, read, requested, read);
+        }
+
+        auto on_commit(std::size_t n, std::size_t size) noexcept -> void {
+            DTRACE_PROBE2(sk_buffer, commit, n, size);
+        }
+
+        auto on_discard(std::size_t n, std::size_t size) noexcept -> void {
+            DTRACE_PROBE2(sk_buffer, discard, n, size);
+        }
+
+        auto on_extent_add(std::size_t n) noexcept -> void {
+            DTRACE_PROBE1(sk_buffer, extent_add, n);
+        }
+
+        auto on_extent_remove(std::size_t n) noexcept -> void {
+            DTRACE_PROBE1(sk_buffer, extent_remove, n);
+        }
+    };
+
+    static_assert(buffer_stats_policy<usdt_buffer_stats>);
+#endif
+
+} // namespace sk
+
+#endif // SK_BUFFER_BUFFER_STATS_HXX_INCLUDED
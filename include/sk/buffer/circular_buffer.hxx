@@ -36,6 +36,7 @@
 #include <span>
 
 #include "sk/buffer/buffer.hxx"
+#include "sk/buffer/buffer_stats.hxx"
 
 namespace sk {
 
@@ -47,15 +48,31 @@ namespace sk {
      * read once, circular_buffer can be continually read and written forever.
      * However, it can never contain more data at once than its fixed size.
      *
+     * The data is aligned to `alignment` bytes, for direct I/O from the
+     * buffer.  Stats is a statistics policy (see buffer_stats.hxx); by
+     * default, nothing is recorded.
      */
 
-    template <typename Char, std::size_t buffer_size = 4096>
+    template <typename Char, std::size_t buffer_size = 4096,
+              std::size_t alignment = alignof(Char),
+              buffer_stats_policy Stats = null_buffer_stats>
     struct circular_buffer {
+        static_assert(alignment >= alignof(Char) &&
+                          (alignment & (alignment - 1)) == 0,
+                      "alignment must be a power of two, and at least the "
+                      "alignment of Char");
+
         using array_type = std::array<Char, buffer_size + 1>;
         using size_type = std::size_t;
         using value_type = Char;
         using const_value_type = std::add_const_t<Char>;
 
+        // When the data wraps around the end of the buffer, the readable or
+        // writable space is split into two ranges.
+        using readable_range_list =
+            static_range_list<std::span<const_value_type>, 2>;
+        using writable_range_list = static_range_list<std::span<value_type>, 2>;
+
         // Create a new, empty buffer.
         circular_buffer() = default;
 
@@ -70,10 +87,14 @@ namespace sk {
         circular_buffer &operator=(circular_buffer &&) = delete;
 
         // The data stored in this buffer.
-        array_type data;
+        alignas(alignment) array_type data;
+
+        // The statistics recorded for this buffer.
+        [[no_unique_address]] Stats stats;
 
         // Reset the buffer.
         auto clear() -> void {
+            stats.on_discard(size(), 0);
             read_pointer = data.begin();
             write_pointer = data.begin();
         }
@@ -153,7 +174,7 @@ namespace sk {
         //
         // After reading the data, discard() should be called to remove the
         // data from the buffer.
-        auto readable_ranges() -> std::vector<std::span<const_value_type>>;
+        auto readable_ranges() -> readable_range_list;
 
         // Discard up to n bytes of readable data from the start of the buffer.
         // Returns the number of bytes discarded.
@@ -162,18 +183,46 @@ namespace sk {
         // Return a list of ranges representing space in the buffer
         // which can be written to.  After writing the data, commit() should be
         // called to mark the space as used.
-        auto writable_ranges() -> std::vector<std::span<value_type>>;
+        auto writable_ranges() -> writable_range_list;
 
         // Mark n bytes of previously empty space as containing data.
         auto commit(size_type n) -> size_type;
+
+        // Return the number of objects which can be read.
+        auto size() const -> size_type {
+            auto r = read_pointer - data.begin();
+            auto w = write_pointer - data.begin();
+
+            // If the write pointer has wrapped, the data runs from the read
+            // pointer to the end of the buffer and then from the start to
+            // the write pointer.
+            if (w >= r)
+                return static_cast<size_type>(w - r);
+            return data.size() - static_cast<size_type>(r - w);
+        }
+
+        // Return the number of objects the buffer can hold.
+        auto capacity() const -> size_type {
+            return buffer_size;
+        }
+
+        // Return true if there is no data to read.
+        auto empty() const -> bool {
+            return read_pointer == write_pointer;
+        }
     };
 
+    static_assert(buffer<circular_buffer<char>>);
+    static_assert(sized_buffer<circular_buffer<char>>);
+
     /*
      * circular_buffer::write()
      */
-    template <typename Char, std::size_t buffer_size>
+    template <typename Char, std::size_t buffer_size, std::size_t alignment,
+              buffer_stats_policy Stats>
     template <std::ranges::contiguous_range InRange>
-    auto circular_buffer<Char, buffer_size>::write(InRange &&buf) -> size_type
+    auto circular_buffer<Char, buffer_size, alignment, Stats>::write(
+        InRange &&buf) -> size_type
         requires std::same_as<
             const_value_type,
             std::add_const_t<std::ranges::range_value_t<InRange>>> {
@@ -184,8 +233,8 @@ namespace sk {
         for (auto &&range : writable_ranges()) {
             auto can_write =
                 std::min(data_left.size(), std::ranges::size(range));
-            std::ranges::copy(data_left.subspan(0, can_write),
-                              std::ranges::begin(range));
+            copy_objects(std::ranges::data(range), data_left.data(),
+                         can_write);
             data_left = data_left.subspan(can_write);
             bytes_written += can_write;
 
@@ -193,6 +242,7 @@ namespace sk {
                 break;
         }
 
+        stats.on_write(std::ranges::size(buf), bytes_written);
         commit(bytes_written);
         return bytes_written;
     }
@@ -200,11 +250,12 @@ namespace sk {
     /*
      * circular_buffer::writable_ranges()
      */
-    template <typename Char, std::size_t buffer_size>
-    auto circular_buffer<Char, buffer_size>::writable_ranges()
-        -> std::vector<std::span<value_type>> {
+    template <typename Char, std::size_t buffer_size, std::size_t alignment,
+              buffer_stats_policy Stats>
+    auto circular_buffer<Char, buffer_size, alignment, Stats>::writable_ranges()
+        -> writable_range_list {
 
-        std::vector<std::span<value_type>> ret;
+        writable_range_list ret;
         auto theoretical_write_pointer = write_pointer;
 
         // If read ptr == write ptr, we can write to the entire buffer.
@@ -250,8 +301,10 @@ namespace sk {
     /*
      * circular_buffer::commit()
      */
-    template <typename Char, std::size_t buffer_size>
-    auto circular_buffer<Char, buffer_size>::commit(size_type n) -> size_type {
+    template <typename Char, std::size_t buffer_size, std::size_t alignment,
+              buffer_stats_policy Stats>
+    auto circular_buffer<Char, buffer_size, alignment, Stats>::commit(
+        size_type n) -> size_type {
         auto bytes_left = n;
         size_type bytes_written = 0;
 
@@ -303,23 +356,31 @@ namespace sk {
             assert(write_pointer < read_pointer);
         }
 
+        stats.on_commit(bytes_written, size());
         return bytes_written;
     }
 
     /*
      * circular_buffer::read()
      */
-    template <typename Char, std::size_t buffer_size>
+    template <typename Char, std::size_t buffer_size, std::size_t alignment,
+              buffer_stats_policy Stats>
     template <std::ranges::contiguous_range InRange>
-    auto circular_buffer<Char, buffer_size>::read(InRange &&buf) -> size_type
+    auto circular_buffer<Char, buffer_size, alignment, Stats>::read(
+        InRange &&buf) -> size_type
         requires std::same_as<value_type, std::ranges::range_value_t<InRange>> {
 
         size_type bytes_read = 0;
         std::span<value_type> data_left{buf};
 
+        if (empty() || data_left.empty()) {
+            stats.on_read(data_left.size(), 0);
+            return 0;
+        }
+
         for (auto &&range : readable_ranges()) {
             auto can_read = std::min(data_left.size(), range.size());
-            std::ranges::copy(range.subspan(0, can_read), data_left.begin());
+            copy_objects(data_left.data(), range.data(), can_read);
             data_left = data_left.subspan(can_read);
             bytes_read += can_read;
 
@@ -327,6 +388,7 @@ namespace sk {
                 break;
         }
 
+        stats.on_read(std::ranges::size(buf), bytes_read);
         discard(bytes_read);
         return bytes_read;
     }
@@ -334,11 +396,12 @@ namespace sk {
     /*
      * circular_buffer::readable_ranges()
      */
-    template <typename Char, std::size_t buffer_size>
-    auto circular_buffer<Char, buffer_size>::readable_ranges()
-        -> std::vector<std::span<const_value_type>> {
+    template <typename Char, std::size_t buffer_size, std::size_t alignment,
+              buffer_stats_policy Stats>
+    auto circular_buffer<Char, buffer_size, alignment, Stats>::readable_ranges()
+        -> readable_range_list {
 
-        std::vector<std::span<const_value_type>> ret;
+        readable_range_list ret;
 
         // If read_pointer == write_pointer, the buffer is empty.
         if (read_pointer == write_pointer)
@@ -394,8 +457,10 @@ namespace sk {
     /*
      * circular_buffer::discard()
      */
-    template <typename Char, std::size_t buffer_size>
-    auto circular_buffer<Char, buffer_size>::discard(size_type n) -> size_type {
+    template <typename Char, std::size_t buffer_size, std::size_t alignment,
+              buffer_stats_policy Stats>
+    auto circular_buffer<Char, buffer_size, alignment, Stats>::discard(
+        size_type n) -> size_type {
 
         // If read_pointer == write_pointer, the buffer is empty.
         if (read_pointer == write_pointer)
@@ -437,6 +502,7 @@ namespace sk {
         }
 
         assert(read_pointer < data.end());
+        stats.on_discard(bytes_read, size());
         return bytes_read;
     }
 
@@ -30,15 +30,24 @@
 #define SK_BUFFER_DYNAMIC_BUFFER_HXX_INCLUDED
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <concepts>
 #include <cstddef>
-#include <deque>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <memory_resource>
 #include <ranges>
 #include <span>
 #include <type_traits>
+#include <utility>
 
 #include "sk/buffer/buffer.hxx"
-#include "sk/buffer/fixed_buffer.hxx"
+#include "sk/buffer/buffer_stats.hxx"
+#include "sk/buffer/extent_pool.hxx"
+#include "sk/buffer/extent_ring.hxx"
 
 namespace sk {
 
@@ -46,14 +55,52 @@ namespace sk {
      *
      * dynamic_buffer: a buffer which grows and contracts dynamically as
      * required. Growth is managed efficiently so the data is never copied, and
-     * there is no upper bound on the size of the buffer (other than available
-     * memory).
+     * by default there is no upper bound on the size of the buffer (other
+     * than available memory).  Setting size_limit caps the amount of data the
+     * buffer will accept, and the high and low watermarks let the user apply
+     * backpressure before the limit is reached.
      *
-     * A dynamic buffer consists of a series of fixed_buffers, which are
-     * contiguous ranges of objects of a fixed size, organised into a deque. New
-     * fixed_buffers will be automatically added and removed as the buffer is
-     * used.
+     * A dynamic buffer consists of a series of extents, which are contiguous
+     * ranges of objects of a fixed size.  The buffer keeps a list of them in
+     * an extent_ring, where each entry is a pointer to the extent and 32-bit
+     * offsets of the data and free space within it, so walking the list
+     * touches a small, contiguous array.  New extents will be automatically
+     * added and removed as the buffer is used.
      *
+     * Extents are taken from and returned to an extent_pool, so a buffer which
+     * is continually written to and read from reuses its extents rather than
+     * allocating new ones.  The pool can optionally be backed by an
+     * extent_provider, such as a shared_extent_pool which is shared between
+     * buffers.
+     *
+     * The extents and the extent list are allocated using Allocator, so the
+     * buffer can be placed in an arena or other specific memory by using a
+     * suitable allocator; pmr_dynamic_buffer is a dynamic_buffer which uses
+     * std::pmr::polymorphic_allocator.
+     *
+     * The data in each extent is aligned to extent_alignment, which can be
+     * raised to a cache line or device block size; aligned_dynamic_buffer
+     * is a shorthand for this.  Note that the extent header is padded to
+     * the same alignment, so large alignments are best used with large
+     * extents.
+     *
+     * Extents are reference-counted, so data can be moved or shared between
+     * buffers without copying it: splice() moves data from another buffer,
+     * and append_shared() appends a reference to another buffer's data while
+     * leaving it in place.  Data in an extent is never modified once it has
+     * been committed, so shared data can be read by each buffer
+     * independently.  Only the buffer which allocated an extent writes into
+     * it; a buffer which receives shared data writes new data to its own
+     * extents.
+     *
+     * For latency-sensitive code, reserve() allocates the space for the
+     * next writes in advance, and clearing allow_allocation stops the buffer
+     * allocating memory at all: it then only takes extents from its pool,
+     * and write() returns a short count when it runs out of space.
+     *
+     * Stats is a statistics policy (see buffer_stats.hxx) which can count
+     * copies, extent churn, peak size and so on; by default, nothing is
+     * recorded.
      */
 
     // Calculate how large a buffer extent should be if we want to use
@@ -63,16 +110,224 @@ namespace sk {
         return nbytes / sizeof(Char);
     }
 
-    template <typename Char, std::size_t extent_bytes = 4096>
+    /*************************************************************************
+     *
+     * dynamic_buffer_extent: the storage for one extent of a dynamic_buffer.
+     * `refs` counts the buffers which refer to the extent; it is returned to
+     * a pool when the last reference is released.
+     *
+     * Extents larger than the buffer's extent size, used when the buffer
+     * grows geometrically, have the same header but are allocated directly
+     * with the buffer's allocator, with their data following the header.
+     *
+     * External extents refer to read-only memory which the buffer doesn't
+     * own (see dynamic_buffer::append_external()).  Their header is a
+     * dynamic_buffer_external_extent, which holds the function that gives
+     * the memory back to its owner.
+     */
+
+    template <typename Char> struct dynamic_buffer_extent_base {
+        dynamic_buffer_extent_base() = default;
+        dynamic_buffer_extent_base(dynamic_buffer_extent_base const &) =
+            delete;
+        dynamic_buffer_extent_base &
+        operator=(dynamic_buffer_extent_base const &) = delete;
+
+        // The number of extent list entries which refer to this extent.
+        std::atomic<std::size_t> refs = 0;
+
+        // For a large or external extent, the number of objects it holds;
+        // 0 for an extent from the pool.
+        std::size_t large_size = 0;
+
+        // For an external extent, the function which releases it.
+        void (*release_external)(dynamic_buffer_extent_base *) noexcept =
+            nullptr;
+    };
+
+    template <typename Char, typename Allocator, typename Releaser>
+    struct dynamic_buffer_external_extent : dynamic_buffer_extent_base<Char> {
+        using allocator_type = typename std::allocator_traits<
+            Allocator>::template rebind_alloc<dynamic_buffer_external_extent>;
+        using traits = std::allocator_traits<allocator_type>;
+
+        dynamic_buffer_external_extent(std::span<Char const> data_,
+                                       allocator_type const &alloc_,
+                                       Releaser &&releaser_)
+            : data(data_), alloc(alloc_), releaser(std::move(releaser_)) {
+            this->large_size = data.size();
+            this->release_external = &release;
+        }
+
+        // The memory this extent refers to.
+        std::span<Char const> data;
+
+        // The allocator which allocated this header.
+        allocator_type alloc;
+
+        // Called with the data when the extent is released.
+        Releaser releaser;
+
+        // Allocate an extent header.  If this fails, the releaser is called
+        // before the exception is rethrown.
+        static auto create(Allocator const &buffer_alloc,
+                           std::span<Char const> data, Releaser &releaser)
+            -> dynamic_buffer_external_extent * {
+            try {
+                allocator_type header_alloc(buffer_alloc);
+                auto *ext = traits::allocate(header_alloc, 1);
+                try {
+                    traits::construct(header_alloc, ext, data, header_alloc,
+                                      std::move(releaser));
+                } catch (...) {
+                    traits::deallocate(header_alloc, ext, 1);
+                    throw;
+                }
+                return ext;
+            } catch (...) {
+                call_releaser(releaser, data);
+                throw;
+            }
+        }
+
+        // Call the releaser, with the data if it takes it.
+        static auto call_releaser(Releaser &releaser,
+                                  std::span<Char const> data) noexcept
+            -> void {
+            if constexpr (std::invocable<Releaser &, std::span<Char const>>)
+                releaser(data);
+            else
+                releaser();
+        }
+
+        static auto release(dynamic_buffer_extent_base<Char> *base) noexcept
+            -> void {
+            auto *ext = static_cast<dynamic_buffer_external_extent *>(base);
+            call_releaser(ext->releaser, ext->data);
+
+            allocator_type header_alloc(std::move(ext->alloc));
+            traits::destroy(header_alloc, ext);
+            traits::deallocate(header_alloc, ext, 1);
+        }
+    };
+
+    template <typename Char, std::size_t extent_size,
+              std::size_t alignment = alignof(Char)>
+    struct dynamic_buffer_extent : dynamic_buffer_extent_base<Char> {
+        using value_type = Char;
+
+        // The data stored in this extent.
+        alignas(alignment) std::array<Char, extent_size> data;
+
+        // Called by extent_pool before the extent is reused.
+        auto reset() -> void {
+            this->refs.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    template <typename Char, std::size_t extent_bytes = 4096,
+              typename Allocator = std::allocator<Char>,
+              buffer_stats_policy Stats = null_buffer_stats,
+              std::size_t extent_alignment = alignof(Char)>
     struct dynamic_buffer {
+        static_assert(extent_alignment >= alignof(Char) &&
+                          (extent_alignment & (extent_alignment - 1)) == 0,
+                      "extent_alignment must be a power of two, and at least "
+                      "the alignment of Char");
+
         using size_type = std::size_t;
         using value_type = Char;
         using const_value_type = std::add_const_t<Char>;
+        using allocator_type = Allocator;
 
         static constexpr std::size_t extent_size =
             extent_size_from_bytes<value_type>(extent_bytes);
-        using extent_type = fixed_buffer<value_type, extent_size>;
-        using extent_list_type = std::deque<extent_type>;
+        using extent_type =
+            dynamic_buffer_extent<value_type, extent_size, extent_alignment>;
+        using extent_base_type = dynamic_buffer_extent_base<value_type>;
+
+        // The most objects a single extent list entry can refer to.  Large
+        // extents are never bigger than this, and longer external data is
+        // split between several entries.
+        static constexpr size_type max_window =
+            std::numeric_limits<std::uint32_t>::max();
+
+        static_assert(extent_size <= max_window,
+                      "extent_bytes is too large for an extent list entry");
+
+        // An entry in the extent list: a reference to an extent, and the
+        // parts of it which this buffer can read and write, as offsets from
+        // data.  The read window is [read_offset, write_offset) and the
+        // write window is [write_offset, end_offset).  For an extent this
+        // buffer allocated, data is the start of the extent; for shared
+        // data, the write window is empty.
+        struct extent_ref {
+            extent_base_type *ext;
+            value_type *data;
+            std::uint32_t read_offset;
+            std::uint32_t write_offset;
+            std::uint32_t end_offset;
+
+            // Return an entry for an extent's free space, which has no data.
+            static auto space(extent_base_type *ext,
+                              std::span<value_type> window) -> extent_ref {
+                assert(window.size() <= max_window);
+                return {ext, window.data(), 0, 0,
+                        static_cast<std::uint32_t>(window.size())};
+            }
+
+            // Return an entry for data in an extent, with no write window.
+            static auto data_window(extent_base_type *ext,
+                                    std::span<value_type> window)
+                -> extent_ref {
+                assert(window.size() <= max_window);
+                auto n = static_cast<std::uint32_t>(window.size());
+                return {ext, window.data(), 0, n, n};
+            }
+
+            auto read_window() const -> std::span<value_type> {
+                return {data + read_offset, data + write_offset};
+            }
+
+            auto write_window() const -> std::span<value_type> {
+                return {data + write_offset, data + end_offset};
+            }
+
+            // Mark up to n objects at the start of the write window as data.
+            auto commit(size_type n) -> size_type {
+                auto m = static_cast<std::uint32_t>(
+                    std::min<size_type>(n, end_offset - write_offset));
+                write_offset += m;
+                return m;
+            }
+
+            // Remove up to n objects from the start of the read window.
+            auto discard(size_type n) -> size_type {
+                auto m = static_cast<std::uint32_t>(
+                    std::min<size_type>(n, write_offset - read_offset));
+                read_offset += m;
+                return m;
+            }
+
+            // Give up the write window, so no more data can be added to
+            // this entry.  Returns the amount of space given up.
+            auto close() -> size_type {
+                return std::exchange(end_offset, write_offset) - write_offset;
+            }
+
+            // Return true if this entry can no longer be read or written.
+            auto dead() const -> bool {
+                return read_offset == end_offset;
+            }
+        };
+
+        using extent_list_type =
+            extent_ring<extent_ref, typename std::allocator_traits<
+                                        Allocator>::template rebind_alloc<
+                                        extent_ref>>;
+        using extent_pool_type = extent_pool<extent_type, Allocator>;
+        using shared_extent_pool_type = shared_extent_pool<extent_type>;
+        using extent_provider_type = extent_provider<extent_type>;
 
         // The minimum amount of space to keep available for writing; if the
         // write window is small than this, we will allocate a new extent.
@@ -80,14 +335,189 @@ namespace sk {
         // space to write into.
         static constexpr std::size_t minfree = extent_size / 2;
 
-        // Create a new, empty buffer with a single extent.
-        dynamic_buffer() = default;
+        // Create a new, empty buffer.
+        dynamic_buffer() : dynamic_buffer(Allocator()) {}
+
+        // Create a new, empty buffer which allocates memory using alloc.
+        explicit dynamic_buffer(Allocator const &alloc)
+            : pool(extent_pool_type::default_high_water,
+                   typename extent_pool_type::allocator_type(alloc)),
+              extents(typename extent_list_type::allocator_type(alloc)) {}
+
+        // Create a new, empty buffer whose extent pool takes extents from
+        // and returns them to the given provider, such as a shared pool.
+        explicit dynamic_buffer(extent_provider_type &upstream,
+                                Allocator const &alloc = Allocator())
+            : pool(extent_pool_type::default_high_water, &upstream,
+                   typename extent_pool_type::allocator_type(alloc)),
+              extents(typename extent_list_type::allocator_type(alloc)) {}
 
         // dynamic_buffer is not copyable, but can be moved.
         dynamic_buffer(dynamic_buffer const &) = delete;
         dynamic_buffer &operator=(dynamic_buffer const &) = delete;
-        dynamic_buffer(dynamic_buffer &&) = default;
-        dynamic_buffer &operator=(dynamic_buffer &&) = default;
+
+        dynamic_buffer(dynamic_buffer &&other) noexcept
+            : pool(std::move(other.pool)), extents(std::move(other.extents)),
+              write_pointer(std::exchange(other.write_pointer, 0)),
+              max_extent_size(other.max_extent_size),
+              size_limit(other.size_limit),
+              high_watermark(other.high_watermark),
+              low_watermark(other.low_watermark),
+              allow_allocation(other.allow_allocation),
+              stats(std::move(other.stats)),
+              readable_size(std::exchange(other.readable_size, 0)),
+              writable_size(std::exchange(other.writable_size, 0)),
+              next_extent_size(
+                  std::exchange(other.next_extent_size, extent_size)),
+              above_high(std::exchange(other.above_high, false)) {
+            other.extents.clear();
+        }
+
+        // Moving a buffer takes ownership of its extents if both buffers use
+        // the same allocator and upstream provider, otherwise the data is
+        // copied.  Either way, the buffer takes other's configuration, so all
+        // of other's data is moved even if this buffer's size_limit was
+        // smaller.
+        dynamic_buffer &operator=(dynamic_buffer &&other) {
+            if (this == &other)
+                return *this;
+
+            clear();
+
+            max_extent_size = other.max_extent_size;
+            high_watermark = other.high_watermark;
+            low_watermark = other.low_watermark;
+
+            if (can_share_with(other)) {
+                extents = std::move(other.extents);
+                write_pointer = std::exchange(other.write_pointer, 0);
+                readable_size = std::exchange(other.readable_size, 0);
+                writable_size = std::exchange(other.writable_size, 0);
+                next_extent_size =
+                    std::exchange(other.next_extent_size, extent_size);
+                above_high = std::exchange(other.above_high, false);
+                other.extents.clear();
+                size_limit = other.size_limit;
+            } else {
+                // Don't let the old size limit, or a lack of reserved
+                // extents, stop the copy short.
+                size_limit = std::numeric_limits<size_type>::max();
+                allow_allocation = true;
+                buffer_move(other, *this);
+                assert(other.size() == 0);
+                other.clear();
+                size_limit = other.size_limit;
+            }
+
+            allow_allocation = other.allow_allocation;
+
+            return *this;
+        }
+
+        // Return the allocator used to allocate memory.
+        auto get_allocator() const -> allocator_type {
+            return allocator_type(pool.get_allocator());
+        }
+
+        ~dynamic_buffer() {
+            clear();
+        }
+
+        // Discard all data in the buffer and release its extents.
+        auto clear() -> void {
+            stats.on_discard(readable_size, 0);
+            for (auto &ref : extents)
+                release(ref.ext);
+            extents.clear();
+            write_pointer = 0;
+            readable_size = 0;
+            writable_size = 0;
+            next_extent_size = extent_size;
+            update_watermark();
+        }
+
+        // Release the empty extents at the end of the buffer, and the spare
+        // extents in the pool, so the buffer only holds the memory it needs
+        // for its data.  This invalidates range lists returned by this
+        // buffer.
+        auto shrink_to_fit() -> void;
+
+        // Allocate enough extents now that writing or committing the next
+        // n objects doesn't allocate memory.  The extents are taken from the
+        // pool, whose high water mark is raised so it keeps them once their
+        // data is discarded; a buffer which never holds more than n objects
+        // therefore doesn't allocate again, as long as max_extent_size is
+        // left at extent_size or allow_allocation is false.
+        //
+        // n is limited by size_limit.  Data added with append_shared(),
+        // append_external() or linearize() can still allocate.
+        auto reserve(size_type n) -> void;
+
+        // Return true if this buffer can refer to other's extents, which
+        // requires that extents released by either buffer go back to the
+        // same place.
+        auto can_share_with(dynamic_buffer const &other) const -> bool {
+            return get_allocator() == other.get_allocator() &&
+                   pool.upstream == other.pool.upstream;
+        }
+
+        // Append up to n objects of other's data, starting at offset, to this
+        // buffer without copying it.  other is not modified, and the data is
+        // shared by both buffers.  Returns the number of objects appended.
+        //
+        // If can_share_with(other) is false, the data is copied instead.
+        // This invalidates range lists returned by this buffer.
+        auto append_shared(dynamic_buffer const &other, size_type offset = 0,
+                           size_type n = std::numeric_limits<size_type>::max())
+            -> size_type;
+
+        // Append data in memory which the buffer doesn't own, such as a
+        // decoded message or a mapped file, without copying it.  The data
+        // becomes a read-only extent, and releaser is called once no buffer
+        // refers to it: when it has all been discarded, or the buffer is
+        // cleared or destroyed.  Until then, the caller must not modify or
+        // free the data.  The releaser is called with the data if it accepts
+        // a std::span<const_value_type>, otherwise with no arguments.
+        //
+        // Returns the number of objects appended, which is less than
+        // data.size() if the buffer reaches size_limit.  The releaser is
+        // called exactly once, even if nothing was appended or an exception
+        // is thrown, and must not throw.  This invalidates range lists
+        // returned by this buffer.
+        template <typename Releaser>
+        auto append_external(std::span<const_value_type> data,
+                             Releaser releaser) -> size_type
+            requires(std::invocable<Releaser &, std::span<const_value_type>> ||
+                     std::invocable<Releaser &>);
+
+        // Append data which outlives the buffer, such as a string literal,
+        // without copying it.
+        auto append_external(std::span<const_value_type> data) -> size_type {
+            return append_external(data, [] {});
+        }
+
+        // Move up to n objects from the start of other's data to the end of
+        // this buffer, the same as append_shared() followed by
+        // other.discard().  Returns the number of objects moved.
+        auto splice(dynamic_buffer &other,
+                    size_type n = std::numeric_limits<size_type>::max())
+            -> size_type {
+            auto m = append_shared(other, 0, n);
+            other.discard(m);
+            return m;
+        }
+
+        // Make the first n objects of data contiguous, and return a span
+        // containing them.  If they are already in a single extent, nothing
+        // is copied; otherwise they are moved into a new extent at the front
+        // of the buffer.  Returns an empty span if the buffer has fewer than
+        // n objects or n is larger than extent_size.  This invalidates range
+        // lists returned by this buffer.
+        auto linearize(size_type n) -> std::span<const_value_type>;
+
+        // The pool our extents are allocated from.  This must be declared
+        // before the extents so it outlives them.
+        extent_pool_type pool;
 
         // The extents in this buffer.
         extent_list_type extents;
@@ -95,6 +525,78 @@ namespace sk {
         // Index of the first buffer we can write data into.
         typename extent_list_type::size_type write_pointer = 0;
 
+        // The size of the largest extent to allocate, in objects.  Each new
+        // extent is twice the size of the previous one, starting from
+        // extent_size, up to max_extent_size; once the buffer has been
+        // emptied, the next extent is extent_size again.  This means bulk
+        // transfers use few, large extents while short messages use small
+        // ones.  Extents larger than extent_size are allocated directly with
+        // the allocator, not taken from the pool.
+        //
+        // The default, extent_size, means every extent is the same size.
+        size_type max_extent_size = extent_size;
+
+        // The maximum amount of data the buffer will hold.  Once size()
+        // reaches this, write() and commit() return a short count, as they do
+        // for a fixed_buffer, and writable_ranges() stops adding extents, so
+        // the buffer uses at most about one extent more than this.  Lowering
+        // the limit below size() doesn't remove any data.
+        size_type size_limit = std::numeric_limits<size_type>::max();
+
+        // Watermarks for flow control.  above_high_watermark() becomes true
+        // when size() reaches high_watermark, and false again once size() has
+        // fallen to low_watermark, so a user can stop filling the buffer (for
+        // example, stop reading from a socket) at the high watermark and
+        // resume at the low one without flapping in between.
+        size_type high_watermark = std::numeric_limits<size_type>::max();
+        size_type low_watermark = 0;
+
+        // If false, the buffer never allocates memory: new extents are only
+        // taken from the pool's spare extents, so write() returns a short
+        // count, and writable_ranges() returns less space, once the reserved
+        // space has been used.  Set this after calling reserve().
+        bool allow_allocation = true;
+
+        // The statistics recorded for this buffer.
+        [[no_unique_address]] Stats stats;
+
+        // Function objects which return an extent's read resp. write window,
+        // used to build the range lists below.
+        struct extent_read_window {
+            auto operator()(extent_ref const &ref) const
+                -> std::span<const_value_type> {
+                // Only extents with data should be in the readable list.
+                assert(ref.read_window().size() > 0);
+                return ref.read_window();
+            }
+        };
+
+        struct extent_write_window {
+            // If size_limit leaves less room than the extents' free space,
+            // the window of the last extent in the list is cut to
+            // last_size, so no more space is offered than commit() accepts.
+            extent_ref const *last = nullptr;
+            size_type last_size = 0;
+
+            auto operator()(extent_ref const &ref) const
+                -> std::span<value_type> {
+                if (&ref == last)
+                    return ref.write_window().first(last_size);
+                return ref.write_window();
+            }
+        };
+
+        // The range lists returned by readable_ranges() and writable_ranges().
+        // These are views over the extent list, so returning them does not
+        // allocate memory.
+        using readable_range_list = std::ranges::transform_view<
+            std::ranges::subrange<typename extent_list_type::const_iterator>,
+            extent_read_window>;
+
+        using writable_range_list = std::ranges::transform_view<
+            std::ranges::subrange<typename extent_list_type::const_iterator>,
+            extent_write_window>;
+
         // Write data to the buffer.  All of the data will be written, and the
         // buffer will be expanded to fit the data if necessary.
         template <std::ranges::contiguous_range Range>
@@ -117,7 +619,7 @@ namespace sk {
         //
         // After reading the data, discard() should be called to remove the
         // data from the buffer.
-        auto readable_ranges() -> std::vector<std::span<const_value_type>>;
+        auto readable_ranges() -> readable_range_list;
 
         // Discard up to n bytes of readable data from the start of the buffer.
         // Returns the number of bytes discarded.
@@ -126,71 +628,580 @@ namespace sk {
         // Return a list of ranges representing space in the buffer
         // which can be written to.  After writing the data, commit() should be
         // called to mark the space as used.
-        auto writable_ranges() -> std::vector<std::span<value_type>>;
+        auto writable_ranges() -> writable_range_list;
 
         // Mark n bytes of previously empty space as containing data.
         auto commit(size_type n) -> size_type;
 
-        // Ensure that at least minfree objects of write space is available.
+        // Return the number of objects which can be read.
+        auto size() const -> size_type {
+            return readable_size;
+        }
+
+        // Return the number of objects the buffer can hold without adding
+        // more extents.
+        auto capacity() const -> size_type {
+            return readable_size + writable_size;
+        }
+
+        // Return true if there is no data to read.
+        auto empty() const -> bool {
+            return readable_size == 0;
+        }
+
+        // Return true if the buffer has reached its high watermark and not
+        // yet drained to its low watermark.
+        auto above_high_watermark() const -> bool {
+            return above_high;
+        }
+
+        // Ensure that at least minfree objects of write space is available,
+        // unless the buffer has reached its size limit.
         auto ensure_minfree() -> void {
             // Add more space if needed.
-            if (extents.empty() ||
-                extents.back().write_window.size() < minfree) {
-
-                extents.emplace_back();
-                // Make sure write_pointer doesn't point at an empty extent.
-                if (extents[write_pointer].write_window.size() == 0)
-                    ++write_pointer;
-            }
+            if ((extents.empty() ||
+                 (extents.back().write_window().size() < minfree &&
+                  capacity() < size_limit)) &&
+                can_add_extent())
+                add_extent();
+
+            // Make sure write_pointer doesn't point at a full extent.  This
+            // can happen even if no extent was added, when the write
+            // pointer's extent was filled exactly and a later one has space.
+            if (write_pointer + 1 < extents.size() &&
+                extents[write_pointer].write_window().empty())
+                ++write_pointer;
         }
 
       private:
+        // The number of objects of readable data in the buffer.
+        size_type readable_size = 0;
+
+        // The amount of writable space in the buffer's extents.
+        size_type writable_size = 0;
+
+        // The size of the next extent to be added.
+        size_type next_extent_size = extent_size;
+
+        // The watermark state returned by above_high_watermark().
+        bool above_high = false;
+
+        // Return the amount of data which can be added before reaching
+        // size_limit.
+        auto room() const -> size_type {
+            return size_limit > readable_size ? size_limit - readable_size : 0;
+        }
+
+        // Update above_high after the amount of data has changed.
+        auto update_watermark() -> void {
+            if (!above_high && readable_size >= high_watermark)
+                above_high = true;
+            else if (above_high && readable_size <= low_watermark)
+                above_high = false;
+        }
+
+        // Add a new extent to the end of the buffer.
+        auto add_extent() -> void;
+
+        // Add an extent to the end of the buffer's extent list.  If this
+        // throws, the extent is released.
+        auto push_extent(extent_base_type *ext, std::span<value_type> data)
+            -> void;
+
+        // Return true if add_extent() can be called, which is always the
+        // case unless allow_allocation is false.
+        auto can_add_extent() const -> bool {
+            return allow_allocation ||
+                   (pool.spare() > 0 && extents.size() < extents.capacity());
+        }
+
+        // Allocate and free extents larger than extent_size.  Their storage
+        // is allocated in units which are suitably aligned for the header
+        // and the data, and at least extent_alignment.
+        struct alignas(extent_base_type) alignas(value_type)
+            alignas(extent_alignment) large_unit {
+            std::byte bytes[std::max({alignof(extent_base_type),
+                                      alignof(value_type), extent_alignment})];
+        };
+
+        using large_allocator_type = typename std::allocator_traits<
+            Allocator>::template rebind_alloc<large_unit>;
+
+        static constexpr std::size_t large_header_units =
+            (sizeof(extent_base_type) + sizeof(large_unit) - 1) /
+            sizeof(large_unit);
+
+        static auto large_units(size_type n) -> std::size_t {
+            return large_header_units +
+                   (n * sizeof(value_type) + sizeof(large_unit) - 1) /
+                       sizeof(large_unit);
+        }
+
+        static auto large_data(extent_base_type *ext) -> std::span<value_type> {
+            auto *units = reinterpret_cast<large_unit *>(ext);
+            return std::span(std::launder(reinterpret_cast<value_type *>(
+                                 units + large_header_units)),
+                             ext->large_size);
+        }
+
+        auto allocate_large(size_type n) -> extent_base_type *;
+        auto free_large(extent_base_type *ext) -> void;
+
+        // Update state once all data has been removed from the buffer.
+        auto drained() -> void {
+            next_extent_size = extent_size;
+        }
+
+        // Return the number of objects an extent can hold.
+        static auto extent_objects(extent_base_type const *ext) -> size_type {
+            return ext->large_size ? ext->large_size : extent_size;
+        }
+
         // Remove the first element of the buffer.
         auto remove_front() -> void;
+
+        // Return the position in the extent list where shared or external
+        // extents should be inserted: where the next data would be written.
+        auto shared_position() -> typename extent_list_type::size_type;
+
+        // Drop a reference to an extent, returning it to the pool if this
+        // was the last one.
+        auto release(extent_base_type *ext) -> void {
+            stats.on_extent_remove(extent_objects(ext));
+
+            if (ext->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                return;
+
+            if (ext->release_external)
+                ext->release_external(ext);
+            else if (ext->large_size)
+                free_large(ext);
+            else
+                pool.deallocate(static_cast<extent_type *>(ext));
+        }
     };
 
     static_assert(buffer<dynamic_buffer<char>>);
+    static_assert(sized_buffer<dynamic_buffer<char>>);
+
+    // A dynamic_buffer which allocates its memory from a
+    // std::pmr::memory_resource.
+    template <typename Char, std::size_t extent_bytes = 4096>
+    using pmr_dynamic_buffer =
+        dynamic_buffer<Char, extent_bytes,
+                       std::pmr::polymorphic_allocator<Char>>;
+
+    // A dynamic_buffer whose extents are aligned to `alignment` bytes, for
+    // example to a cache line or to the device block size for O_DIRECT.
+    template <typename Char, std::size_t alignment,
+              std::size_t extent_bytes = 4096,
+              typename Allocator = std::allocator<Char>>
+    using aligned_dynamic_buffer =
+        dynamic_buffer<Char, extent_bytes, Allocator, null_buffer_stats,
+                       alignment>;
+
+    template <typename Char, std::size_t extent_size, typename Allocator,
+              buffer_stats_policy Stats, std::size_t extent_alignment>
+    auto dynamic_buffer<Char, extent_size, Allocator, Stats,
+                        extent_alignment>::add_extent() -> void {
+        extent_base_type *ext;
+        std::span<value_type> data;
+
+        // Don't grow past the size limit by more than a pool extent.  If
+        // the buffer can't allocate, the extent has to come from the pool.
+        auto want = std::min(next_extent_size, max_window);
+        if (size_limit - std::min(size_limit, capacity()) < want)
+            want = std::max(size_limit - std::min(size_limit, capacity()),
+                            extent_size);
+        if (!allow_allocation)
+            want = extent_size;
+
+        if (want > extent_size) {
+            ext = allocate_large(want);
+            data = large_data(ext);
+        } else {
+            auto *pool_ext = pool.allocate();
+            ext = pool_ext;
+            data = pool_ext->data;
+        }
+
+        push_extent(ext, data);
+
+        next_extent_size =
+            std::max(std::min(next_extent_size * 2, max_extent_size),
+                     extent_size);
+    }
+
+    template <typename Char, std::size_t extent_size, typename Allocator,
+              buffer_stats_policy Stats, std::size_t extent_alignment>
+    auto dynamic_buffer<Char, extent_size, Allocator, Stats,
+                        extent_alignment>::push_extent(
+        extent_base_type *ext, std::span<value_type> data) -> void {
+        stats.on_extent_add(data.size());
+
+        try {
+            extents.push_back(extent_ref::space(ext, data));
+        } catch (...) {
+            ext->refs.store(1, std::memory_order_relaxed);
+            release(ext);
+            throw;
+        }
+
+        ext->refs.store(1, std::memory_order_relaxed);
+        writable_size += data.size();
+    }
+
+    template <typename Char, std::size_t extent_size, typename Allocator,
+              buffer_stats_policy Stats, std::size_t extent_alignment>
+    auto dynamic_buffer<Char, extent_size, Allocator, Stats,
+                        extent_alignment>::allocate_large(
+        size_type n) -> extent_base_type * {
+        using traits = std::allocator_traits<large_allocator_type>;
+        large_allocator_type alloc(get_allocator());
+
+        auto nunits = large_units(n);
+        auto *units = traits::allocate(alloc, nunits);
+
+        auto *ext = ::new (static_cast<void *>(units)) extent_base_type();
+        ext->large_size = n;
+
+        try {
+            std::uninitialized_default_construct_n(
+                reinterpret_cast<value_type *>(units + large_header_units), n);
+        } catch (...) {
+            ext->~extent_base_type();
+            traits::deallocate(alloc, units, nunits);
+            throw;
+        }
+
+        return ext;
+    }
+
+    template <typename Char, std::size_t extent_size, typename Allocator,
+              buffer_stats_policy Stats, std::size_t extent_alignment>
+    auto dynamic_buffer<Char, extent_size, Allocator, Stats,
+                        extent_alignment>::free_large(
+        extent_base_type *ext) -> void {
+        using traits = std::allocator_traits<large_allocator_type>;
+        large_allocator_type alloc(get_allocator());
+
+        auto nunits = large_units(ext->large_size);
+        std::destroy_n(large_data(ext).data(), ext->large_size);
+        ext->~extent_base_type();
+        traits::deallocate(alloc, reinterpret_cast<large_unit *>(ext), nunits);
+    }
 
-    template <typename Char, std::size_t extent_size>
-    auto dynamic_buffer<Char, extent_size>::remove_front() -> void {
+    template <typename Char, std::size_t extent_size, typename Allocator,
+              buffer_stats_policy Stats, std::size_t extent_alignment>
+    auto dynamic_buffer<Char, extent_size, Allocator, Stats,
+                        extent_alignment>::remove_front() -> void {
         assert(!extents.empty());
-        assert(write_pointer > 0 || extents.front().write_window.size() == 0);
+        assert(write_pointer > 0 || extents.front().write_window().size() == 0);
 
         if (write_pointer > 0)
             --write_pointer;
 
+        release(extents.front().ext);
         extents.pop_front();
     }
 
-    template <typename Char, std::size_t extent_size>
-    auto dynamic_buffer<Char, extent_size>::writable_ranges()
-        -> std::vector<std::span<Char>> {
-        std::vector<std::span<Char>> ret;
+    template <typename Char, std::size_t extent_size, typename Allocator,
+              buffer_stats_policy Stats, std::size_t extent_alignment>
+    auto dynamic_buffer<Char, extent_size, Allocator, Stats,
+                        extent_alignment>::append_shared(
+        dynamic_buffer const &other, size_type offset, size_type n)
+        -> size_type {
+        assert(&other != this);
+
+        if (offset >= other.readable_size)
+            return 0;
+
+        n = std::min({n, other.readable_size - offset, room()});
+        if (n == 0)
+            return 0;
+
+        if (!can_share_with(other)) {
+            // Extents can't be shared, so copy the data instead.
+            auto left = n;
+            for (auto &ref : other.extents) {
+                if (left == 0)
+                    break;
+
+                auto window = std::span<const_value_type>(ref.read_window());
+                if (offset >= window.size()) {
+                    offset -= window.size();
+                    continue;
+                }
+
+                window = window.subspan(offset).first(
+                    std::min(left, window.size() - offset));
+                offset = 0;
+                write(window);
+                left -= window.size();
+            }
+            return n;
+        }
+
+        auto pos = shared_position();
+        auto left = n;
+        for (auto &ref : other.extents) {
+            if (left == 0)
+                break;
+
+            auto window = ref.read_window();
+            if (offset >= window.size()) {
+                offset -= window.size();
+                continue;
+            }
+
+            window = window.subspan(offset).first(
+                std::min(left, window.size() - offset));
+            offset = 0;
+
+            extents.insert(pos, extent_ref::data_window(ref.ext, window));
+            ref.ext->refs.fetch_add(1, std::memory_order_relaxed);
+            stats.on_extent_add(extent_objects(ref.ext));
+
+            ++pos;
+            write_pointer = pos;
+            readable_size += window.size();
+            left -= window.size();
+        }
+
+        update_watermark();
+        stats.on_commit(n, readable_size);
+        return n;
+    }
+
+    template <typename Char, std::size_t extent_size, typename Allocator,
+              buffer_stats_policy Stats, std::size_t extent_alignment>
+    auto dynamic_buffer<Char, extent_size, Allocator, Stats,
+                        extent_alignment>::shared_position()
+        -> typename extent_list_type::size_type {
+        // If the extent at write_pointer already has data, it can't take any
+        // more, since new data must follow the inserted data; give up the
+        // rest of its space.
+        auto pos = write_pointer;
+        if (pos < extents.size() && !extents[pos].read_window().empty()) {
+            writable_size -= extents[pos].close();
+            ++pos;
+        }
+        return pos;
+    }
+
+    template <typename Char, std::size_t extent_size, typename Allocator,
+              buffer_stats_policy Stats, std::size_t extent_alignment>
+    template <typename Releaser>
+    auto dynamic_buffer<Char, extent_size, Allocator, Stats,
+                        extent_alignment>::append_external(
+        std::span<const_value_type> data, Releaser releaser) -> size_type
+        requires(std::invocable<Releaser &, std::span<const_value_type>> ||
+                 std::invocable<Releaser &>) {
+        using external_type =
+            dynamic_buffer_external_extent<value_type, Allocator, Releaser>;
+
+        auto n = std::min(data.size(), room());
+        if (n == 0) {
+            external_type::call_releaser(releaser, data);
+            return 0;
+        }
+
+        auto *ext = external_type::create(get_allocator(), data, releaser);
+        ext->refs.store(1, std::memory_order_relaxed);
+        stats.on_extent_add(extent_objects(ext));
+
+        // Data longer than max_window needs more than one entry; make room
+        // for all of them first, so adding them can't fail.
+        auto nrefs = (n + max_window - 1) / max_window;
+        try {
+            extents.reserve(extents.size() + nrefs);
+        } catch (...) {
+            release(ext);
+            throw;
+        }
 
+        // The data is never written through the extent, since it has no
+        // write window.
+        auto window = std::span(const_cast<value_type *>(data.data()), n);
+        auto pos = shared_position();
+        for (size_type i = 0; i < nrefs; ++i) {
+            if (i > 0) {
+                ext->refs.fetch_add(1, std::memory_order_relaxed);
+                stats.on_extent_add(extent_objects(ext));
+            }
+
+            auto part = window.first(std::min(window.size(), max_window));
+            extents.insert(pos++, extent_ref::data_window(ext, part));
+            window = window.subspan(part.size());
+        }
+        write_pointer = pos;
+
+        readable_size += n;
+        update_watermark();
+        stats.on_commit(n, readable_size);
+        return n;
+    }
+
+    template <typename Char, std::size_t extent_size, typename Allocator,
+              buffer_stats_policy Stats, std::size_t extent_alignment>
+    auto dynamic_buffer<Char, extent_size, Allocator, Stats,
+                        extent_alignment>::linearize(
+        size_type n) -> std::span<const_value_type> {
+        if (n == 0 || n > readable_size)
+            return {};
+
+        // Extents with no data before write_pointer are always removed, so
+        // the front extent has data.
+        if (extents.front().read_window().size() >= n)
+            return extents.front().read_window().first(n);
+
+        if (n > extent_size)
+            return {};
+
+        auto *ext = pool.allocate();
+        auto data = std::span(ext->data).first(n);
+
+        // Copy the data into the new extent.
+        auto copied = std::span(data);
+        for (auto &ref : extents) {
+            auto m = std::min(copied.size(), ref.read_window().size());
+            copy_objects(copied.data(), ref.read_window().data(), m);
+            copied = copied.subspan(m);
+            if (copied.empty())
+                break;
+        }
+
+        // The new extent has no write window, since the data after it is in
+        // the following extents.
+        try {
+            extents.push_front(extent_ref::data_window(ext, data));
+        } catch (...) {
+            pool.deallocate(ext);
+            throw;
+        }
+
+        stats.on_extent_add(extent_size);
+
+        ext->refs.store(1, std::memory_order_relaxed);
+        ++write_pointer;
+
+        // Remove the copied data from the old extents, which now start at
+        // index 1.
+        for (auto left = n; left > 0;) {
+            auto &ref = extents[1];
+            left -= ref.discard(left);
+
+            if (ref.dead()) {
+                release(ref.ext);
+                extents.erase(1);
+                --write_pointer;
+            }
+        }
+
+        return data;
+    }
+
+    template <typename Char, std::size_t extent_size, typename Allocator,
+              buffer_stats_policy Stats, std::size_t extent_alignment>
+    auto dynamic_buffer<Char, extent_size, Allocator, Stats,
+                        extent_alignment>::shrink_to_fit() -> void {
+        // Extents after write_pointer are always empty; the one at
+        // write_pointer can be removed too if it has no data.
+        while (extents.size() > write_pointer &&
+               extents.back().read_window().empty()) {
+            writable_size -= extents.back().write_window().size();
+            release(extents.back().ext);
+            extents.pop_back();
+        }
+
+        write_pointer = std::min(write_pointer, extents.size());
+        pool.release();
+    }
+
+    template <typename Char, std::size_t extent_size, typename Allocator,
+              buffer_stats_policy Stats, std::size_t extent_alignment>
+    auto dynamic_buffer<Char, extent_size, Allocator, Stats,
+                        extent_alignment>::reserve(size_type n) -> void {
+        // Leave minfree objects of space after the reserved space, so
+        // ensure_minfree() doesn't add an extent after the last write.
+        auto want = std::min(n, room()) + minfree;
+        if (want <= writable_size)
+            return;
+
+        auto nextents = (want - writable_size + extent_size - 1) / extent_size;
+        extents.reserve(extents.size() + nextents + 1);
+
+        // Keep one more spare extent in the pool, since once data has been
+        // discarded, the space before it in the first extent is unusable.
+        pool.reserve(nextents + 1);
+
+        for (size_type i = 0; i < nextents; ++i) {
+            auto *ext = pool.allocate();
+            push_extent(ext, ext->data);
+        }
+    }
+
+    template <typename Char, std::size_t extent_size, typename Allocator,
+              buffer_stats_policy Stats, std::size_t extent_alignment>
+    auto dynamic_buffer<Char, extent_size, Allocator, Stats,
+                        extent_alignment>::writable_ranges()
+        -> writable_range_list {
         // Make sure we always return a reasonable amount of writable space.
         ensure_minfree();
 
-        assert(write_pointer >= 0 && write_pointer < extents.size());
+        // If the buffer is at its size limit, there might be no space left.
+        auto left = room();
+        if (write_pointer == extents.size() ||
+            extents[write_pointer].write_window().empty() || left == 0)
+            return writable_range_list(
+                std::ranges::subrange(extents.cend(), extents.cend()),
+                extent_write_window{});
 
+#ifndef NDEBUG
         for (auto i = write_pointer, end = extents.size(); i < end; ++i) {
             // Every extent from write_pointer onwards must have free space.
-            assert(extents[i].write_window.size() > 0);
+            assert(extents[i].write_window().size() > 0);
 
             // Every extent aside from the current write pointer must be empty,
             // or else we have written data in front of the pointer without
             // adjusting it, which is a bug.
-            assert(i == write_pointer ||
-                   (extents[i].write_window.size() == extent_size));
-
-            // Add this extent to the range list.
-            ret.push_back(extents[i].write_window);
+            assert(i == write_pointer || extents[i].read_window().empty());
+        }
+#endif
+
+        // Don't offer more space than size_limit allows.
+        auto end = extents.size();
+        extent_write_window window;
+
+        if (left < writable_size) {
+            for (auto i = write_pointer; i < extents.size(); ++i) {
+                auto free = extents[i].write_window().size();
+                if (free >= left) {
+                    window.last = &extents[i];
+                    window.last_size = left;
+                    end = i + 1;
+                    break;
+                }
+                left -= free;
+            }
         }
 
-        return ret;
+        using difference_type = typename extent_list_type::difference_type;
+        auto begin =
+            extents.cbegin() + static_cast<difference_type>(write_pointer);
+        return writable_range_list(
+            std::ranges::subrange(begin, extents.cbegin() +
+                                             static_cast<difference_type>(end)),
+            window);
     }
 
-    template <typename Char, std::size_t extent_size>
-    auto dynamic_buffer<Char, extent_size>::commit(std::size_t n) -> size_type {
+    template <typename Char, std::size_t extent_size, typename Allocator,
+              buffer_stats_policy Stats, std::size_t extent_alignment>
+    auto dynamic_buffer<Char, extent_size, Allocator, Stats,
+                        extent_alignment>::commit(std::size_t n) -> size_type {
+        // writable_ranges() doesn't offer more space than this, so this only
+        // shortens a commit of more than was offered.
+        n = std::min(n, room());
         size_type left = n;
 
         if (n == 0)
@@ -220,6 +1231,11 @@ namespace sk {
             // If we committed all of it, return.
             left -= m;
             if (left == 0) {
+                readable_size += n;
+                writable_size -= n;
+                update_watermark();
+                stats.on_commit(n, readable_size);
+
                 // Call ensure_minfree() here to avoid the situation where we
                 // committed exactly the available size of the last extent,
                 // which will leave write_pointer pointing at a full extent.
@@ -232,122 +1248,152 @@ namespace sk {
         }
     }
 
-    template <typename Char, std::size_t extent_size>
+    template <typename Char, std::size_t extent_size, typename Allocator,
+              buffer_stats_policy Stats, std::size_t extent_alignment>
     template <std::ranges::contiguous_range Range>
-    auto dynamic_buffer<Char, extent_size>::write(Range &&data) -> size_type
-        requires std::same_as<
+    auto dynamic_buffer<Char, extent_size, Allocator, Stats,
+                        extent_alignment>::write(
+        Range &&data) -> size_type requires std::same_as<
             const_value_type,
             std::add_const_t<std::ranges::range_value_t<Range>>> {
 
         std::span<std::add_const_t<std::ranges::range_value_t<Range>>> buf =
             data;
+        auto requested = buf.size();
+        buf = buf.first(std::min(buf.size(), room()));
 
-        if (buf.size() == 0)
+        if (buf.size() == 0) {
+            stats.on_write(requested, 0);
             return 0;
+        }
+
+        auto nwritten = buf.size();
 
         assert(write_pointer >= 0 && write_pointer <= extents.size());
 
         for (;;) {
-            // If we're at the end of the buffer, add another extent to the end.
-            if (write_pointer == extents.size())
-                extents.emplace_back();
+            // If we're at the end of the buffer, add another extent to the
+            // end, unless we can't allocate one.
+            if (write_pointer == extents.size()) {
+                if (!can_add_extent())
+                    break;
+                add_extent();
+            }
 
             // Write as much data as possible.
-            auto n = extents[write_pointer].write(buf);
+            auto &ref = extents[write_pointer];
+            auto n = std::min(buf.size(), ref.write_window().size());
+            copy_objects(ref.write_window().data(), buf.data(), n);
+            ref.commit(n);
             buf = buf.subspan(n);
 
-            // If we wrote all of it, return.
-            if (buf.size() == 0) {
-                // Make sure we don't leave write_pointer pointing at a
-                // full extent.
-                ensure_minfree();
-                return std::ranges::size(data);
-            }
+            // If we wrote all of it, we're done.
+            if (buf.size() == 0)
+                break;
 
             // Move to the next extent and try again.
             ++write_pointer;
         }
-    }
-
-    template <typename Char, std::size_t extent_size>
-    auto dynamic_buffer<Char, extent_size>::readable_ranges()
-        -> std::vector<std::span<const_value_type>> {
-        std::vector<std::span<const_value_type>> ret;
 
-        for (auto const &ext : extents) {
-            if (ext.read_window.size() == 0)
-                continue;
-
-            ret.push_back(ext.read_window);
-        }
+        nwritten -= buf.size();
+        readable_size += nwritten;
+        writable_size -= nwritten;
+        update_watermark();
+        stats.on_write(requested, nwritten);
+        stats.on_commit(nwritten, readable_size);
 
-        return ret;
+        // Make sure we don't leave write_pointer pointing at a full extent.
+        ensure_minfree();
+        return nwritten;
     }
 
-    template <typename Char, std::size_t extent_size>
-    auto dynamic_buffer<Char, extent_size>::discard(size_type n) -> size_type {
-        std::size_t discards = 0;
-        std::size_t nleft = n;
+    template <typename Char, std::size_t extent_size, typename Allocator,
+              buffer_stats_policy Stats, std::size_t extent_alignment>
+    auto dynamic_buffer<Char, extent_size, Allocator, Stats,
+                        extent_alignment>::readable_ranges()
+        -> readable_range_list {
+        // Every extent before write_pointer contains data, since extents are
+        // removed as soon as all their data has been discarded.  The extent
+        // at write_pointer might or might not contain data, and every extent
+        // after it is empty.
+        auto nreadable = write_pointer;
+        if (write_pointer < extents.size() &&
+            extents[write_pointer].read_window().size() > 0)
+            ++nreadable;
+
+        auto begin = extents.cbegin();
+        auto end =
+            begin + static_cast<typename extent_list_type::difference_type>(
+                        nreadable);
+        return readable_range_list(std::ranges::subrange(begin, end),
+                                   extent_read_window{});
+    }
 
-        for (;;) {
-            if (extents.empty())
-                return discards;
+    template <typename Char, std::size_t extent_size, typename Allocator,
+              buffer_stats_policy Stats, std::size_t extent_alignment>
+    auto dynamic_buffer<Char, extent_size, Allocator, Stats,
+                        extent_alignment>::discard(size_type n) -> size_type {
+        // We know how much data we have, so we never need to look past the
+        // last readable extent.
+        auto discards = std::min(n, readable_size);
+        auto nleft = discards;
 
+        while (nleft > 0) {
             auto &front = extents.front();
 
-            // If there's no data to discard, return.
-            if (front.read_window.size() == 0)
-                return discards;
-
             // Discard as much as possible.
             auto m = front.discard(nleft);
+            assert(m > 0);
             nleft -= m;
-            discards += m;
 
             // If the extent we read from is dead, remove it.
-            if (front.read_window.size() == 0 && front.write_window.size() == 0)
+            if (front.dead())
                 remove_front();
-
-            // If we discarded everything, return.
-            if (discards == n)
-                return discards;
         }
+
+        readable_size -= discards;
+        if (readable_size == 0)
+            drained();
+        update_watermark();
+        stats.on_discard(discards, readable_size);
+        return discards;
     }
 
-    template <typename Char, std::size_t extent_size>
+    template <typename Char, std::size_t extent_size, typename Allocator,
+              buffer_stats_policy Stats, std::size_t extent_alignment>
     template <std::ranges::contiguous_range Range>
-    auto dynamic_buffer<Char, extent_size>::read(Range &&data) -> size_type
+    auto dynamic_buffer<Char, extent_size, Allocator, Stats,
+                        extent_alignment>::read(Range &&data)
+        -> size_type
         requires std::same_as<value_type, std::ranges::range_value_t<Range>> {
 
         std::span<std::ranges::range_value_t<Range>> buf = data;
-        std::size_t bytes_read = 0;
+        auto requested = buf.size();
 
-        if (buf.size() == 0)
-            return 0;
-
-        for (;;) {
-            if (extents.empty())
-                return bytes_read;
+        auto bytes_read = std::min(buf.size(), readable_size);
+        buf = buf.subspan(0, bytes_read);
 
+        while (!buf.empty()) {
             auto &front = extents.front();
 
-            // If there's no data to read, return.
-            if (front.read_window.size() == 0)
-                return bytes_read;
-
             // Read as much as possible.
-            auto n = front.read(buf);
+            auto n = std::min(buf.size(), front.read_window().size());
+            copy_objects(buf.data(), front.read_window().data(), n);
+            front.discard(n);
             buf = buf.subspan(n);
-            bytes_read += n;
 
             // If the extent we read from is dead, remove it.
-            if (front.read_window.size() == 0 && front.write_window.size() == 0)
+            if (front.dead())
                 remove_front();
-
-            // If we read everything, return.
-            if (bytes_read == std::ranges::size(data))
-                return bytes_read;
         }
+
+        readable_size -= bytes_read;
+        if (readable_size == 0)
+            drained();
+        update_watermark();
+        stats.on_read(requested, bytes_read);
+        stats.on_discard(bytes_read, readable_size);
+        return bytes_read;
     }
 
 } // namespace sk
@@ -0,0 +1,397 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SK_BUFFER_EXTENT_POOL_HXX_INCLUDED
+#define SK_BUFFER_EXTENT_POOL_HXX_INCLUDED
+
+#include <algorithm>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace sk {
+
+    /*************************************************************************
+     *
+     * Extent pools: free-lists of unused extents, which allow a buffer to
+     * reuse extents instead of allocating and freeing memory each time an
+     * extent is added or removed.
+     *
+     * extent_pool is a per-buffer free-list which is not thread-safe.  It
+     * keeps up to `high_water` spare extents; any extents returned beyond
+     * that are passed to its upstream pool, if it has one, or freed.
+     *
+     * shared_extent_pool is a thread-safe pool which can be used as the
+     * upstream of any number of extent_pools.  Each thread keeps a small
+     * cache of extents so most allocations don't need to take the lock.
+     *
+     * The Extent type must be default-constructible and have a reset()
+     * function which returns it to the empty state.
+     *
+     * extent_pool allocates extents using its Allocator, which lets the
+     * caller control where the extents are placed in memory (for example,
+     * with a std::pmr::polymorphic_allocator).  Alternatively, it can take
+     * its extents from an upstream extent_provider, in which case every
+     * extent is returned to the provider it came from.
+     *
+     * extent_provider is the interface for upstream sources of extents.
+     * shared_extent_pool is one; others can place extents in memory with
+     * special properties, such as memory registered for kernel I/O.
+     */
+
+    namespace detail {
+
+        // Allocate and construct a single extent using an allocator.
+        template <typename Allocator>
+        auto new_extent(Allocator &alloc) ->
+            typename std::allocator_traits<Allocator>::value_type * {
+            using traits = std::allocator_traits<Allocator>;
+
+            auto *ext = traits::allocate(alloc, 1);
+            try {
+                traits::construct(alloc, ext);
+            } catch (...) {
+                traits::deallocate(alloc, ext, 1);
+                throw;
+            }
+            return ext;
+        }
+
+        // Destroy and free an extent allocated with new_extent().
+        template <typename Allocator>
+        auto delete_extent(
+            Allocator &alloc,
+            typename std::allocator_traits<Allocator>::value_type *ext)
+            -> void {
+            using traits = std::allocator_traits<Allocator>;
+
+            traits::destroy(alloc, ext);
+            traits::deallocate(alloc, ext, 1);
+        }
+
+    } // namespace detail
+
+    template <typename Extent> struct extent_provider {
+        using extent_type = Extent;
+
+        virtual ~extent_provider() = default;
+
+        // Return an empty extent.  Throws std::bad_alloc if no extent can
+        // be provided.
+        virtual auto allocate() -> extent_type * = 0;
+
+        // Return an extent previously returned by allocate().
+        virtual auto deallocate(extent_type *ext) -> void = 0;
+    };
+
+    template <typename Extent>
+    struct shared_extent_pool final : extent_provider<Extent> {
+        using extent_type = Extent;
+        using size_type = std::size_t;
+
+        // Default number of spare extents to keep.
+        static constexpr size_type default_high_water = 64;
+        static constexpr size_type default_thread_high_water = 16;
+
+        explicit shared_extent_pool(
+            size_type high_water_ = default_high_water,
+            size_type thread_high_water_ = default_thread_high_water)
+            : high_water(high_water_), thread_high_water(thread_high_water_) {}
+
+        // The pool is shared by reference, so it cannot be copied or moved.
+        shared_extent_pool(shared_extent_pool const &) = delete;
+        shared_extent_pool &operator=(shared_extent_pool const &) = delete;
+        shared_extent_pool(shared_extent_pool &&) = delete;
+        shared_extent_pool &operator=(shared_extent_pool &&) = delete;
+
+        ~shared_extent_pool() {
+            release();
+        }
+
+        // Return a process-wide pool for this extent type.
+        static auto global() -> shared_extent_pool & {
+            static shared_extent_pool pool;
+            return pool;
+        }
+
+        // Return an empty extent, either from the pool or newly allocated.
+        auto allocate() -> extent_type * override {
+            if (auto &cache = thread_cache(); cache.owner == this) {
+                if (!cache.extents.empty()) {
+                    auto *ext = cache.extents.back();
+                    cache.extents.pop_back();
+                    ext->reset();
+                    return ext;
+                }
+            }
+
+            {
+                std::lock_guard lock(mutex);
+                if (!extents.empty()) {
+                    auto *ext = extents.back();
+                    extents.pop_back();
+                    ext->reset();
+                    return ext;
+                }
+            }
+
+            std::allocator<extent_type> alloc;
+            return detail::new_extent(alloc);
+        }
+
+        // Return an extent to the pool.  If the pool already has high_water
+        // spare extents, the extent is freed.
+        auto deallocate(extent_type *ext) -> void override {
+            assert(ext);
+
+            auto &cache = thread_cache();
+
+            // The thread cache belongs to the first pool used on this thread.
+            if (cache.owner == nullptr)
+                cache.owner = this;
+
+            if (cache.owner == this &&
+                cache.extents.size() < thread_high_water) {
+                cache.extents.reserve(thread_high_water);
+                cache.extents.push_back(ext);
+                return;
+            }
+
+            {
+                std::lock_guard lock(mutex);
+                if (extents.size() < high_water) {
+                    extents.reserve(high_water);
+                    extents.push_back(ext);
+                    return;
+                }
+            }
+
+            free_extent(ext);
+        }
+
+        // Free all the spare extents in the shared list, and in the calling
+        // thread's cache, which is then free for the next pool used on this
+        // thread.  Other threads' caches are only freed when those threads
+        // exit.
+        auto release() -> void {
+            if (auto &cache = thread_cache(); cache.owner == this) {
+                cache.clear();
+                cache.owner = nullptr;
+            }
+
+            std::lock_guard lock(mutex);
+            for (auto *ext : extents)
+                free_extent(ext);
+            extents.clear();
+        }
+
+        // Return the number of spare extents in the shared list.  This does
+        // not include extents held in per-thread caches.
+        auto spare() -> size_type {
+            std::lock_guard lock(mutex);
+            return extents.size();
+        }
+
+        // The maximum number of spare extents to keep in the shared list.
+        size_type const high_water;
+
+        // The maximum number of spare extents to keep in each thread's cache.
+        size_type const thread_high_water;
+
+      private:
+        // The per-thread cache.  Extents left in the cache when the thread
+        // exits are freed.  Extents from different pools are allocated the
+        // same way, so a cache whose pool has been destroyed on another
+        // thread can safely be taken over by a new pool at the same address.
+        struct thread_cache_type {
+            shared_extent_pool *owner = nullptr;
+            std::vector<extent_type *> extents;
+
+            auto clear() -> void {
+                for (auto *ext : extents)
+                    free_extent(ext);
+                extents.clear();
+            }
+
+            ~thread_cache_type() {
+                clear();
+            }
+        };
+
+        static auto free_extent(extent_type *ext) -> void {
+            std::allocator<extent_type> alloc;
+            detail::delete_extent(alloc, ext);
+        }
+
+        static auto thread_cache() -> thread_cache_type & {
+            thread_local thread_cache_type cache;
+            return cache;
+        }
+
+        std::mutex mutex;
+        std::vector<extent_type *> extents;
+    };
+
+    template <typename Extent, typename Allocator = std::allocator<Extent>>
+    struct extent_pool {
+        using extent_type = Extent;
+        using size_type = std::size_t;
+        using upstream_type = extent_provider<extent_type>;
+        using allocator_type = typename std::allocator_traits<
+            Allocator>::template rebind_alloc<extent_type>;
+
+        // By default, keep one spare extent.  This is enough for a buffer
+        // which is being continually written to and read from to never
+        // allocate memory.
+        static constexpr size_type default_high_water = 1;
+
+        // Create a pool which allocates extents using the given allocator.
+        explicit extent_pool(size_type high_water_ = default_high_water,
+                             allocator_type const &alloc_ = allocator_type())
+            : high_water(high_water_), upstream(nullptr), alloc(alloc_),
+              extents(alloc_) {}
+
+        // Create a pool which takes extents from an upstream provider.  The
+        // allocator is then only used for the pool's own free-list.
+        extent_pool(size_type high_water_, upstream_type *upstream_,
+                    allocator_type const &alloc_ = allocator_type())
+            : high_water(high_water_), upstream(upstream_), alloc(alloc_),
+              extents(alloc_) {}
+
+        // extent_pool is not copyable, but can be moved.
+        extent_pool(extent_pool const &) = delete;
+        extent_pool &operator=(extent_pool const &) = delete;
+        extent_pool &operator=(extent_pool &&) = delete;
+
+        extent_pool(extent_pool &&other) noexcept
+            : high_water(other.high_water), upstream(other.upstream),
+              alloc(other.alloc), extents(std::move(other.extents)) {
+            other.extents.clear();
+        }
+
+        ~extent_pool() {
+            release();
+        }
+
+        // Return an empty extent, either from the pool or newly allocated.
+        auto allocate() -> extent_type * {
+            if (!extents.empty()) {
+                auto *ext = extents.back();
+                extents.pop_back();
+                ext->reset();
+                return ext;
+            }
+
+            if (upstream)
+                return upstream->allocate();
+
+            return detail::new_extent(alloc);
+        }
+
+        // Return an extent to the pool.  If the pool already has high_water
+        // spare extents, the extent is given to the upstream pool or freed.
+        auto deallocate(extent_type *ext) -> void {
+            assert(ext);
+
+            if (extents.size() < high_water) {
+                extents.reserve(high_water);
+                extents.push_back(ext);
+                return;
+            }
+
+            free_extent(ext);
+        }
+
+        // Change the high water mark, releasing any spare extents above it.
+        auto set_high_water(size_type n) -> void {
+            high_water = n;
+
+            while (extents.size() > high_water) {
+                free_extent(extents.back());
+                extents.pop_back();
+            }
+        }
+
+        // Allocate spare extents until the pool has at least n, raising the
+        // high water mark to n if it's lower, so that n extents can be taken
+        // from the pool and returned to it without allocating memory.
+        auto reserve(size_type n) -> void {
+            high_water = std::max(high_water, n);
+            extents.reserve(high_water);
+
+            while (extents.size() < n)
+                extents.push_back(upstream ? upstream->allocate()
+                                           : detail::new_extent(alloc));
+        }
+
+        // Release all spare extents.
+        auto release() -> void {
+            for (auto *ext : extents)
+                free_extent(ext);
+            extents.clear();
+        }
+
+        // Return the number of spare extents in the pool.
+        auto spare() const -> size_type {
+            return extents.size();
+        }
+
+        // Return the allocator used to allocate extents.
+        auto get_allocator() const -> allocator_type {
+            return alloc;
+        }
+
+        // The maximum number of spare extents to keep.
+        size_type high_water;
+
+        // The provider that extents are taken from when this pool is empty
+        // and returned to when it's full, or nullptr to use the allocator.
+        upstream_type *upstream;
+
+      private:
+        auto free_extent(extent_type *ext) -> void {
+            if (upstream)
+                upstream->deallocate(ext);
+            else
+                detail::delete_extent(alloc, ext);
+        }
+
+        allocator_type alloc;
+
+        std::vector<extent_type *, typename std::allocator_traits<Allocator>::
+                                       template rebind_alloc<extent_type *>>
+            extents;
+    };
+
+} // namespace sk
+
+#endif // SK_BUFFER_EXTENT_POOL_HXX_INCLUDED
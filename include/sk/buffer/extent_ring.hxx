@@ -0,0 +1,432 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SK_BUFFER_EXTENT_RING_HXX_INCLUDED
+#define SK_BUFFER_EXTENT_RING_HXX_INCLUDED
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace sk {
+
+    /*************************************************************************
+     *
+     * extent_ring: a double-ended list of small, trivially copyable entries
+     * held in one contiguous array, used as a ring whose capacity is a power
+     * of two.  dynamic_buffer uses it as its extent list.
+     *
+     * Unlike a std::deque, the ring makes a single allocation, finding an
+     * element is an add and a mask with no extra indirection, and the
+     * entries are packed together in memory, so walking the list is cheap.
+     * Elements can also be inserted or erased in the middle; whichever side
+     * of the ring is shorter is moved to make room.
+     *
+     * Each element has a position, which is one more than the position of
+     * the element before it and doesn't change when elements are added or
+     * removed at either end.  Iterators hold the ring and a position, so,
+     * as with a std::deque, they stay valid when other elements are added
+     * or removed at the ends, even if the ring grows.  Inserting or erasing
+     * an element shifts the positions of the elements on one side of it.
+     */
+
+    template <typename T, typename Allocator = std::allocator<T>>
+    struct extent_ring {
+        static_assert(std::is_trivially_copyable_v<T>,
+                      "extent_ring elements must be trivially copyable");
+
+        using value_type = T;
+        using size_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using reference = value_type &;
+        using const_reference = value_type const &;
+        using allocator_type = typename std::allocator_traits<
+            Allocator>::template rebind_alloc<value_type>;
+
+        // The capacity of the ring when the first element is added.
+        static constexpr size_type min_capacity = 8;
+
+        struct const_iterator {
+            using iterator_concept = std::random_access_iterator_tag;
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using reference = T const &;
+            using pointer = T const *;
+
+            const_iterator() = default;
+            const_iterator(extent_ring const *ring_, size_type index_)
+                : ring(ring_), index(index_) {}
+
+            auto operator*() const -> reference {
+                return ring->at_position(index);
+            }
+
+            auto operator->() const -> pointer {
+                return &ring->at_position(index);
+            }
+
+            auto operator[](difference_type n) const -> reference {
+                return *(*this + n);
+            }
+
+            auto operator++() -> const_iterator & {
+                ++index;
+                return *this;
+            }
+
+            auto operator++(int) -> const_iterator {
+                auto ret = *this;
+                ++index;
+                return ret;
+            }
+
+            auto operator--() -> const_iterator & {
+                --index;
+                return *this;
+            }
+
+            auto operator--(int) -> const_iterator {
+                auto ret = *this;
+                --index;
+                return ret;
+            }
+
+            auto operator+=(difference_type n) -> const_iterator & {
+                index += static_cast<size_type>(n);
+                return *this;
+            }
+
+            auto operator-=(difference_type n) -> const_iterator & {
+                index -= static_cast<size_type>(n);
+                return *this;
+            }
+
+            friend auto operator+(const_iterator it, difference_type n)
+                -> const_iterator {
+                return it += n;
+            }
+
+            friend auto operator+(difference_type n, const_iterator it)
+                -> const_iterator {
+                return it += n;
+            }
+
+            friend auto operator-(const_iterator it, difference_type n)
+                -> const_iterator {
+                return it -= n;
+            }
+
+            friend auto operator-(const_iterator const &a,
+                                  const_iterator const &b)
+                -> difference_type {
+                return static_cast<difference_type>(a.index - b.index);
+            }
+
+            friend auto operator==(const_iterator const &a,
+                                   const_iterator const &b) -> bool {
+                return a.index == b.index;
+            }
+
+            friend auto operator<=>(const_iterator const &a,
+                                    const_iterator const &b)
+                -> std::strong_ordering {
+                return (a - b) <=> 0;
+            }
+
+          private:
+            extent_ring const *ring = nullptr;
+
+            // The position of the element, which wraps around.
+            size_type index = 0;
+        };
+
+        using iterator = const_iterator;
+
+        extent_ring() : extent_ring(allocator_type()) {}
+
+        explicit extent_ring(allocator_type const &alloc_) noexcept
+            : alloc(alloc_) {}
+
+        // extent_ring is not copyable, but can be moved.
+        extent_ring(extent_ring const &) = delete;
+        extent_ring &operator=(extent_ring const &) = delete;
+
+        extent_ring(extent_ring &&other) noexcept
+            : alloc(other.alloc), slots(std::exchange(other.slots, nullptr)),
+              slots_size(std::exchange(other.slots_size, 0)),
+              first(std::exchange(other.first, 0)),
+              count(std::exchange(other.count, 0)) {}
+
+        // Moving a ring takes its storage if the allocators allow it,
+        // otherwise the elements are copied into this ring's storage.
+        extent_ring &operator=(extent_ring &&other) {
+            if (this == &other)
+                return *this;
+
+            constexpr bool propagate = std::allocator_traits<
+                allocator_type>::propagate_on_container_move_assignment::value;
+
+            if (propagate || alloc == other.alloc) {
+                free_slots();
+                if constexpr (propagate)
+                    alloc = other.alloc;
+                slots = std::exchange(other.slots, nullptr);
+                slots_size = std::exchange(other.slots_size, 0);
+                first = std::exchange(other.first, 0);
+                count = std::exchange(other.count, 0);
+            } else {
+                clear();
+                reserve(other.size());
+                for (auto const &value : other)
+                    push_back(value);
+                other.clear();
+            }
+
+            return *this;
+        }
+
+        ~extent_ring() {
+            free_slots();
+        }
+
+        auto get_allocator() const -> allocator_type {
+            return alloc;
+        }
+
+        auto size() const -> size_type {
+            return count;
+        }
+
+        auto empty() const -> bool {
+            return count == 0;
+        }
+
+        // Return the number of elements the ring can hold without
+        // allocating.
+        auto capacity() const -> size_type {
+            return slots_size;
+        }
+
+        auto operator[](size_type i) -> reference {
+            assert(i < count);
+            return slots[slot(i)];
+        }
+
+        auto operator[](size_type i) const -> const_reference {
+            assert(i < count);
+            return slots[slot(i)];
+        }
+
+        auto front() -> reference {
+            return (*this)[0];
+        }
+
+        auto front() const -> const_reference {
+            return (*this)[0];
+        }
+
+        auto back() -> reference {
+            return (*this)[count - 1];
+        }
+
+        auto back() const -> const_reference {
+            return (*this)[count - 1];
+        }
+
+        auto begin() const -> const_iterator {
+            return const_iterator(this, first);
+        }
+
+        auto end() const -> const_iterator {
+            return const_iterator(this, first + count);
+        }
+
+        auto cbegin() const -> const_iterator {
+            return begin();
+        }
+
+        auto cend() const -> const_iterator {
+            return end();
+        }
+
+        // Make sure the ring can hold n elements without allocating.  If
+        // this throws, the ring is unchanged.
+        auto reserve(size_type n) -> void;
+
+        auto push_back(value_type const &value) -> void {
+            if (count == slots_size)
+                reserve(count + 1);
+            put(slot(count), value);
+            ++count;
+        }
+
+        auto push_front(value_type const &value) -> void {
+            if (count == slots_size)
+                reserve(count + 1);
+            --first;
+            put(slot(0), value);
+            ++count;
+        }
+
+        auto pop_front() -> void {
+            assert(count > 0);
+            ++first;
+            --count;
+        }
+
+        auto pop_back() -> void {
+            assert(count > 0);
+            --count;
+        }
+
+        // Insert an element before the element at index pos.
+        auto insert(size_type pos, value_type const &value) -> void;
+
+        // Remove the element at index pos.
+        auto erase(size_type pos) -> void;
+
+        // Remove all elements.  The storage is kept for reuse.
+        auto clear() -> void {
+            count = 0;
+        }
+
+      private:
+        using traits = std::allocator_traits<allocator_type>;
+
+        // Return the slot which holds the element at index i.
+        auto slot(size_type i) const -> size_type {
+            return (first + i) & (slots_size - 1);
+        }
+
+        auto at_position(size_type pos) const -> const_reference {
+            assert(pos - first < count);
+            return slots[pos & (slots_size - 1)];
+        }
+
+        auto put(size_type s, value_type const &value) -> void {
+            traits::construct(alloc, slots + s, value);
+        }
+
+        auto free_slots() -> void {
+            if (slots)
+                traits::deallocate(alloc, slots, slots_size);
+            slots = nullptr;
+            slots_size = 0;
+            first = 0;
+            count = 0;
+        }
+
+        [[no_unique_address]] allocator_type alloc;
+
+        // The storage, which holds slots_size elements: 0, or a power of two.
+        value_type *slots = nullptr;
+        size_type slots_size = 0;
+
+        // The position of the first element, and the number of elements.
+        // An element at position p is held in slot p modulo slots_size.
+        size_type first = 0;
+        size_type count = 0;
+    };
+
+    /* extent_ring::reserve() */
+    template <typename T, typename Allocator>
+    auto extent_ring<T, Allocator>::reserve(size_type n) -> void {
+        if (n <= slots_size)
+            return;
+
+        auto new_size = std::bit_ceil(std::max(n, min_capacity));
+        auto *new_slots = traits::allocate(alloc, new_size);
+
+        // Nothing below can throw.  The elements keep their positions, so
+        // iterators remain valid.
+        for (size_type i = 0; i < count; ++i)
+            traits::construct(alloc, new_slots + ((first + i) & (new_size - 1)),
+                              slots[slot(i)]);
+
+        if (slots)
+            traits::deallocate(alloc, slots, slots_size);
+
+        slots = new_slots;
+        slots_size = new_size;
+    }
+
+    /* extent_ring::insert() */
+    template <typename T, typename Allocator>
+    auto extent_ring<T, Allocator>::insert(size_type pos,
+                                           value_type const &value) -> void {
+        assert(pos <= count);
+
+        if (count == slots_size)
+            reserve(count + 1);
+
+        if (pos < count / 2) {
+            // Move the elements before pos down by one.
+            --first;
+            for (size_type i = 0; i < pos; ++i)
+                put(slot(i), slots[slot(i + 1)]);
+        } else {
+            // Move the elements from pos onwards up by one.
+            for (auto i = count; i > pos; --i)
+                put(slot(i), slots[slot(i - 1)]);
+        }
+
+        put(slot(pos), value);
+        ++count;
+    }
+
+    /* extent_ring::erase() */
+    template <typename T, typename Allocator>
+    auto extent_ring<T, Allocator>::erase(size_type pos) -> void {
+        assert(pos < count);
+
+        if (pos < count / 2) {
+            // Move the elements before pos up by one.
+            for (auto i = pos; i > 0; --i)
+                put(slot(i), slots[slot(i - 1)]);
+            ++first;
+        } else {
+            // Move the elements after pos down by one.
+            for (auto i = pos; i + 1 < count; ++i)
+                put(slot(i), slots[slot(i + 1)]);
+        }
+
+        --count;
+    }
+
+    static_assert(std::random_access_iterator<extent_ring<int>::iterator>);
+
+} // namespace sk
+
+#endif // SK_BUFFER_EXTENT_RING_HXX_INCLUDED
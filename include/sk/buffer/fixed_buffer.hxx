@@ -48,16 +48,30 @@ namespace sk {
      * from the start of the buffer to the end.  Once the entire buffer has
      * been filled, it cannot be used until reset() is called to return it to
      * the empty state.
-     * 
+     *
+     * The data is aligned to `alignment` bytes, e.g. 512 or 4096 for direct
+     * I/O (O_DIRECT or FILE_FLAG_NO_BUFFERING) straight from the buffer.
      */
 
-    template <typename Char, std::size_t buffer_size> struct fixed_buffer {
+    template <typename Char, std::size_t buffer_size,
+              std::size_t alignment = alignof(Char)>
+    struct fixed_buffer {
+        static_assert(alignment >= alignof(Char) &&
+                          (alignment & (alignment - 1)) == 0,
+                      "alignment must be a power of two, and at least the "
+                      "alignment of Char");
+
         using array_type = std::array<Char, buffer_size>;
         using value_type = typename array_type::value_type;
         using const_value_type = std::add_const_t<value_type>;
         using iterator = typename array_type::iterator;
         using size_type = typename array_type::size_type;
 
+        // fixed_buffer only has a single read window and write window.
+        using readable_range_list =
+            static_range_list<std::span<const_value_type>, 1>;
+        using writable_range_list = static_range_list<std::span<value_type>, 1>;
+
         // Create a new, empty buffer.
         fixed_buffer()
             : data(data_array)
@@ -74,7 +88,7 @@ namespace sk {
         fixed_buffer &operator=(fixed_buffer &&) = delete;
 
         // The data stored in this buffer.
-        std::array<Char, buffer_size> data_array;
+        alignas(alignment) std::array<Char, buffer_size> data_array;
 
         // A span of the the entire data.
         std::span<Char, buffer_size> data;
@@ -119,14 +133,30 @@ namespace sk {
         auto discard(size_type n) -> size_type;
 
         // Return our read window.
-        auto readable_ranges() -> std::vector<std::span<const_value_type>>;
+        auto readable_ranges() -> readable_range_list;
 
         // Return our write window.
-        auto writable_ranges() -> std::vector<std::span<value_type>>;
+        auto writable_ranges() -> writable_range_list;
+
+        // Return the number of objects in the read window.
+        auto size() const -> size_type {
+            return read_window.size();
+        }
+
+        // Return the size of the read and write windows; this is less than
+        // buffer_size once data has been discarded.
+        auto capacity() const -> size_type {
+            return read_window.size() + write_window.size();
+        }
+
+        // Return true if there is no data to read.
+        auto empty() const -> bool {
+            return read_window.empty();
+        }
     };
 
-    template <typename Char, std::size_t buffer_size>
-    auto fixed_buffer<Char, buffer_size>::reset() -> void {
+    template <typename Char, std::size_t buffer_size, std::size_t alignment>
+    auto fixed_buffer<Char, buffer_size, alignment>::reset() -> void {
         data = std::span<Char, buffer_size>(data_array);
 
         // No data to read.
@@ -136,9 +166,10 @@ namespace sk {
         write_window = data;
     }
 
-    template <typename Char, std::size_t buffer_size>
+    template <typename Char, std::size_t buffer_size, std::size_t alignment>
     template <std::ranges::contiguous_range InRange>
-    auto fixed_buffer<Char, buffer_size>::write(InRange &&buf) -> size_type
+    auto fixed_buffer<Char, buffer_size, alignment>::write(InRange &&buf)
+        -> size_type
         requires std::same_as<
             const_value_type,
             std::add_const_t<std::ranges::range_value_t<InRange>>> {
@@ -146,9 +177,7 @@ namespace sk {
         // Determine how many objects we want to write.
         auto can_write = std::min(std::ranges::size(buf), write_window.size());
 
-        // Create a subrange of the input buf for the data we want to write.
-        auto will_write = buf | std::ranges::views::take(can_write);
-        std::ranges::copy(will_write, write_window.begin());
+        copy_objects(write_window.data(), std::ranges::data(buf), can_write);
 
         // Remove the used space from the write window
         write_window = write_window.subspan(can_write);
@@ -165,8 +194,9 @@ namespace sk {
     /*
      * fixed_buffer::commit()
      */
-    template <typename Char, std::size_t buffer_size>
-    auto fixed_buffer<Char, buffer_size>::commit(size_type n) -> size_type {
+    template <typename Char, std::size_t buffer_size, std::size_t alignment>
+    auto fixed_buffer<Char, buffer_size, alignment>::commit(size_type n)
+        -> size_type {
         auto can_commit = std::min(n, write_window.size());
 
         // Remove the used space from the write window
@@ -183,15 +213,15 @@ namespace sk {
     /*
      * fixed_buffer::read()
      */
-    template <typename Char, std::size_t buffer_size>
+    template <typename Char, std::size_t buffer_size, std::size_t alignment>
     template <std::ranges::contiguous_range InRange>
-    auto fixed_buffer<Char, buffer_size>::read(InRange &&buf) -> size_type
+    auto fixed_buffer<Char, buffer_size, alignment>::read(InRange &&buf)
+        -> size_type
         requires std::same_as<value_type, std::ranges::range_value_t<InRange>> {
 
         auto can_read = std::min(std::ranges::size(buf), read_window.size());
 
-        auto will_read = read_window.subspan(0, can_read);
-        std::ranges::copy(will_read, std::ranges::begin(buf));
+        copy_objects(std::ranges::data(buf), read_window.data(), can_read);
         read_window = read_window.subspan(can_read);
         return can_read;
     }
@@ -199,8 +229,9 @@ namespace sk {
     /*
      * fixed_buffer::discard()
      */
-    template <typename Char, std::size_t buffer_size>
-    auto fixed_buffer<Char, buffer_size>::discard(size_type n) -> size_type {
+    template <typename Char, std::size_t buffer_size, std::size_t alignment>
+    auto fixed_buffer<Char, buffer_size, alignment>::discard(size_type n)
+        -> size_type {
         auto can_remove = std::min(n, read_window.size());
         read_window = read_window.subspan(can_remove);
         return can_remove;
@@ -209,9 +240,9 @@ namespace sk {
     /*
      * fixed_buffer::readable_ranges()
      */
-    template <typename Char, std::size_t buffer_size>
-    auto fixed_buffer<Char, buffer_size>::readable_ranges()
-        -> std::vector<std::span<const_value_type>> {
+    template <typename Char, std::size_t buffer_size, std::size_t alignment>
+    auto fixed_buffer<Char, buffer_size, alignment>::readable_ranges()
+        -> readable_range_list {
 
         return { read_window };
     }
@@ -219,15 +250,16 @@ namespace sk {
     /*
      * fixed_buffer::writable_ranges()
      */
-    template <typename Char, std::size_t buffer_size>
-    auto fixed_buffer<Char, buffer_size>::writable_ranges()
-        -> std::vector<std::span<value_type>> {
+    template <typename Char, std::size_t buffer_size, std::size_t alignment>
+    auto fixed_buffer<Char, buffer_size, alignment>::writable_ranges()
+        -> writable_range_list {
 
         return { write_window };
     }
 
     // fixed_buffer is a buffer.
     static_assert(buffer<fixed_buffer<char, 4096>>);
+    static_assert(sized_buffer<fixed_buffer<char, 4096>>);
 
 } // namespace sk
 
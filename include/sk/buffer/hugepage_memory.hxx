@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Buffer memory backed by huge pages.
+ */
+
+#ifndef SK_BUFFER_HUGEPAGE_MEMORY_HXX_INCLUDED
+#define SK_BUFFER_HUGEPAGE_MEMORY_HXX_INCLUDED
+
+#if !defined(__linux__)
+#    error "sk/buffer/hugepage_memory.hxx requires Linux"
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <sys/mman.h>
+
+#include "sk/buffer/extent_pool.hxx"
+
+namespace sk {
+
+    /*************************************************************************
+     *
+     * Huge page memory.  Buffers which hold a lot of data, or which are
+     * accessed at random by many threads, can spend a noticeable amount of
+     * time on TLB misses; placing them in 2MB pages instead of 4KB pages
+     * reduces the number of TLB entries needed by a factor of 512.
+     *
+     * Memory is mapped with MAP_HUGETLB if the system has huge pages
+     * reserved (see /proc/sys/vm/nr_hugepages).  Otherwise, the mapping is
+     * aligned to the huge page size and marked with MADV_HUGEPAGE, so the
+     * kernel can back it with transparent huge pages.  In either case the
+     * memory is usable, but only in the first case is it guaranteed to be
+     * in huge pages.
+     *
+     * hugepage_extent_provider is an extent_provider for dynamic_buffer
+     * whose extents are carved out of huge page mappings.  make_hugepage()
+     * constructs a single object, such as a fixed_buffer or a
+     * circular_buffer, in its own huge page mapping.
+     */
+
+    namespace detail {
+
+        inline constexpr std::size_t hugepage_size = std::size_t(2) << 20;
+
+        // Round n up to a whole number of huge pages.
+        constexpr auto hugepage_round(std::size_t n) -> std::size_t {
+            return (n + hugepage_size - 1) & ~(hugepage_size - 1);
+        }
+
+        struct hugepage_mapping {
+            std::byte *base = nullptr;
+            std::size_t size = 0;
+            // True if the mapping is in reserved huge pages.
+            bool hugetlb = false;
+        };
+
+        // Map at least size bytes of anonymous memory aligned to the huge
+        // page size.  Throws std::bad_alloc if no memory can be mapped.
+        inline auto map_hugepages(std::size_t size) -> hugepage_mapping {
+            size = hugepage_round(size);
+
+            int hugetlb_flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#if defined(MAP_HUGE_SHIFT)
+            hugetlb_flags |= 21 << MAP_HUGE_SHIFT;
+#endif
+            auto *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                             hugetlb_flags, -1, 0);
+            if (p != MAP_FAILED)
+                return {static_cast<std::byte *>(p), size, true};
+
+            // No reserved huge pages; over-map so the mapping can be trimmed
+            // to a huge page boundary, and ask for transparent huge pages.
+            auto mapped = size + hugepage_size;
+            p = ::mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED)
+                throw std::bad_alloc();
+
+            auto *begin = static_cast<std::byte *>(p);
+            auto *aligned = reinterpret_cast<std::byte *>(hugepage_round(
+                reinterpret_cast<std::uintptr_t>(begin)));
+            auto *end = begin + mapped;
+
+            if (aligned != begin)
+                ::munmap(begin, static_cast<std::size_t>(aligned - begin));
+            if (aligned + size != end)
+                ::munmap(aligned + size,
+                         static_cast<std::size_t>(end - (aligned + size)));
+
+#if defined(MADV_HUGEPAGE)
+            // This is only advice, so failure is not an error.
+            (void)::madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+            return {aligned, size, false};
+        }
+
+        inline auto unmap_hugepages(hugepage_mapping const &m) -> void {
+            if (m.base)
+                ::munmap(m.base, m.size);
+        }
+
+    } // namespace detail
+
+    /*************************************************************************
+     *
+     * hugepage_extent_provider: an extent_provider whose extents are placed
+     * in huge page mappings.  Memory is mapped in chunks of chunk_size bytes
+     * (rounded up to the huge page size) as extents are needed, and is only
+     * unmapped when the provider is destroyed.
+     *
+     * The provider is not thread-safe, so buffers on different threads
+     * should use different providers.  It must outlive any buffer using it.
+     */
+
+    template <typename Extent>
+    struct hugepage_extent_provider final : extent_provider<Extent> {
+        using extent_type = Extent;
+        using size_type = std::size_t;
+
+        static constexpr size_type default_chunk_size = detail::hugepage_size;
+
+        explicit hugepage_extent_provider(
+            size_type chunk_size = default_chunk_size);
+
+        hugepage_extent_provider(hugepage_extent_provider const &) = delete;
+        hugepage_extent_provider &
+        operator=(hugepage_extent_provider const &) = delete;
+
+        ~hugepage_extent_provider();
+
+        auto allocate() -> extent_type * override;
+        auto deallocate(extent_type *ext) -> void override;
+
+        // Return true if every chunk mapped so far is in reserved huge
+        // pages, rather than relying on transparent huge pages.
+        auto uses_hugetlb() const -> bool {
+            for (auto const &chunk : chunks)
+                if (!chunk.hugetlb)
+                    return false;
+            return true;
+        }
+
+        // Return the total number of extents in the mapped chunks.
+        auto capacity() const -> size_type {
+            return nslots;
+        }
+
+        // Return the number of extents which can be allocated without
+        // mapping another chunk.
+        auto available() const -> size_type {
+            return free_slots.size();
+        }
+
+      private:
+        // Size of each slot; rounded to a cache line, or the extent
+        // alignment if that's larger, so extents don't share lines.
+        static constexpr size_type slot_align =
+            std::max(size_type(64), size_type(alignof(extent_type)));
+        static constexpr size_type slot_size =
+            (sizeof(extent_type) + slot_align - 1) & ~(slot_align - 1);
+        static_assert(slot_align <= detail::hugepage_size);
+
+        // Map another chunk and add its slots to the free list.
+        auto grow() -> void;
+
+        size_type const chunk_size;
+        size_type nslots = 0;
+        std::vector<detail::hugepage_mapping> chunks;
+        std::vector<void *> free_slots;
+    };
+
+    /* hugepage_extent_provider::hugepage_extent_provider() */
+    template <typename Extent>
+    hugepage_extent_provider<Extent>::hugepage_extent_provider(
+        size_type chunk_size_)
+        : chunk_size(detail::hugepage_round(
+              std::max(chunk_size_, size_type(slot_size)))) {}
+
+    /* hugepage_extent_provider::~hugepage_extent_provider() */
+    template <typename Extent>
+    hugepage_extent_provider<Extent>::~hugepage_extent_provider() {
+        for (auto const &chunk : chunks)
+            detail::unmap_hugepages(chunk);
+    }
+
+    /* hugepage_extent_provider::grow() */
+    template <typename Extent>
+    auto hugepage_extent_provider<Extent>::grow() -> void {
+        auto n = chunk_size / slot_size;
+
+        // Reserve everything first, so nothing can throw once the chunk is
+        // mapped, and deallocate() never needs to allocate.
+        chunks.reserve(chunks.size() + 1);
+        free_slots.reserve(nslots + n);
+
+        auto chunk = detail::map_hugepages(chunk_size);
+        chunks.push_back(chunk);
+        nslots += n;
+
+        // Push in reverse so extents are handed out in address order.
+        for (auto i = n; i > 0; --i)
+            free_slots.push_back(chunk.base + (i - 1) * slot_size);
+    }
+
+    /* hugepage_extent_provider::allocate() */
+    template <typename Extent>
+    auto hugepage_extent_provider<Extent>::allocate() -> extent_type * {
+        if (free_slots.empty())
+            grow();
+
+        auto *ext = ::new (free_slots.back()) extent_type();
+        free_slots.pop_back();
+        return ext;
+    }
+
+    /* hugepage_extent_provider::deallocate() */
+    template <typename Extent>
+    auto hugepage_extent_provider<Extent>::deallocate(extent_type *ext)
+        -> void {
+        assert(ext);
+
+        ext->~extent_type();
+        // The vector's capacity is the number of slots, so this can't throw.
+        free_slots.push_back(ext);
+    }
+
+    /*************************************************************************
+     *
+     * make_hugepage: construct an object in its own huge page mapping, and
+     * return a hugepage_ptr which destroys it and unmaps the memory.  This
+     * is intended for large fixed-size buffers:
+     *
+     *   auto buf = sk::make_hugepage<sk::circular_buffer<char, 1 << 20>>();
+     *
+     * Throws std::bad_alloc if the memory can't be mapped, or anything
+     * thrown by T's constructor.
+     */
+
+    template <typename T> struct hugepage_deleter {
+        auto operator()(T *p) const noexcept -> void {
+            p->~T();
+            ::munmap(p, detail::hugepage_round(sizeof(T)));
+        }
+    };
+
+    template <typename T>
+    using hugepage_ptr = std::unique_ptr<T, hugepage_deleter<T>>;
+
+    template <typename T, typename... Args>
+    auto make_hugepage(Args &&...args) -> hugepage_ptr<T> {
+        static_assert(alignof(T) <= detail::hugepage_size);
+
+        auto mapping = detail::map_hugepages(sizeof(T));
+        try {
+            return hugepage_ptr<T>(
+                ::new (mapping.base) T(std::forward<Args>(args)...));
+        } catch (...) {
+            detail::unmap_hugepages(mapping);
+            throw;
+        }
+    }
+
+} // namespace sk
+
+#endif // SK_BUFFER_HUGEPAGE_MEMORY_HXX_INCLUDED
@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SK_BUFFER_HYBRID_BUFFER_HXX_INCLUDED
+#define SK_BUFFER_HYBRID_BUFFER_HXX_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include "sk/buffer/buffer.hxx"
+#include "sk/buffer/dynamic_buffer.hxx"
+#include "sk/buffer/object_copy.hxx"
+
+namespace sk {
+
+    /*************************************************************************
+     *
+     * hybrid_buffer: a buffer which holds up to inline_size objects in
+     * storage inside the buffer object, like a fixed_buffer, and only
+     * allocates memory when that overflows.  Data which doesn't fit is
+     * written to an overflow dynamic_buffer, and is read after the inline
+     * data, so a buffer which only ever holds short messages never touches
+     * the heap, while one which receives a large message grows like a
+     * dynamic_buffer.
+     *
+     * Once the buffer has overflowed, new data goes to the overflow buffer
+     * until it has all been read, then the inline storage is used again.
+     * Inline data is never moved into the overflow buffer, so readable
+     * ranges stay valid while more data is written.
+     *
+     * The overflow buffer is the `overflow` member, so its extent pool and
+     * max_extent_size can be configured as for any dynamic_buffer.  Its
+     * size_limit only applies to the data which overflows.
+     */
+
+    namespace detail {
+
+        // A range list for hybrid_buffer: a single range, which is skipped
+        // if it's empty, followed by the ranges in another range list.
+        template <typename Range, typename Inner>
+        struct hybrid_range_list
+            : std::ranges::view_interface<hybrid_range_list<Range, Inner>> {
+            using inner_iterator = std::ranges::iterator_t<Inner const>;
+
+            struct iterator {
+                using iterator_concept = std::forward_iterator_tag;
+                using iterator_category = std::input_iterator_tag;
+                using value_type = Range;
+                using difference_type = std::ptrdiff_t;
+
+                iterator() = default;
+                iterator(Range first_, inner_iterator it_)
+                    : first(first_), on_first(!first_.empty()), it(it_) {}
+
+                auto operator*() const -> Range {
+                    return on_first ? first : Range(*it);
+                }
+
+                auto operator++() -> iterator & {
+                    if (on_first)
+                        on_first = false;
+                    else
+                        ++it;
+                    return *this;
+                }
+
+                auto operator++(int) -> iterator {
+                    auto ret = *this;
+                    ++*this;
+                    return ret;
+                }
+
+                friend auto operator==(iterator const &a, iterator const &b)
+                    -> bool {
+                    return a.on_first == b.on_first && a.it == b.it;
+                }
+
+              private:
+                Range first{};
+                bool on_first = false;
+                inner_iterator it{};
+            };
+
+            hybrid_range_list() = default;
+            hybrid_range_list(Range first_, Inner inner_)
+                : first(first_), inner(std::move(inner_)) {}
+
+            auto begin() const -> iterator {
+                return iterator(first, std::ranges::begin(inner));
+            }
+
+            auto end() const -> iterator {
+                return iterator(Range(), std::ranges::end(inner));
+            }
+
+          private:
+            Range first{};
+            Inner inner{};
+        };
+
+    } // namespace detail
+
+    template <typename Char, std::size_t inline_size = 512,
+              std::size_t extent_bytes = 4096,
+              typename Allocator = std::allocator<Char>>
+    struct hybrid_buffer {
+        using size_type = std::size_t;
+        using value_type = Char;
+        using const_value_type = std::add_const_t<Char>;
+        using allocator_type = Allocator;
+
+        using overflow_buffer_type =
+            dynamic_buffer<value_type, extent_bytes, Allocator>;
+        using extent_provider_type =
+            typename overflow_buffer_type::extent_provider_type;
+
+        using readable_range_list = detail::hybrid_range_list<
+            std::span<const_value_type>,
+            typename overflow_buffer_type::readable_range_list>;
+        using writable_range_list = detail::hybrid_range_list<
+            std::span<value_type>,
+            typename overflow_buffer_type::writable_range_list>;
+
+        // The number of objects the inline storage holds.
+        static constexpr size_type inline_capacity = inline_size;
+
+        // Create a new, empty buffer.
+        hybrid_buffer() : hybrid_buffer(Allocator()) {}
+
+        // Create a new, empty buffer whose overflow buffer allocates memory
+        // using alloc.
+        explicit hybrid_buffer(Allocator const &alloc) : overflow(alloc) {}
+
+        // Create a new, empty buffer whose overflow buffer takes extents
+        // from the given provider.
+        explicit hybrid_buffer(extent_provider_type &upstream,
+                               Allocator const &alloc = Allocator())
+            : overflow(upstream, alloc) {}
+
+        // hybrid_buffer is not copyable, but can be moved.  Moving a buffer
+        // copies its inline data.
+        hybrid_buffer(hybrid_buffer const &) = delete;
+        hybrid_buffer &operator=(hybrid_buffer const &) = delete;
+
+        hybrid_buffer(hybrid_buffer &&other) noexcept
+            : overflow(std::move(other.overflow)) {
+            take_inline(other);
+        }
+
+        hybrid_buffer &operator=(hybrid_buffer &&other) {
+            if (this == &other)
+                return *this;
+
+            overflow = std::move(other.overflow);
+            take_inline(other);
+            return *this;
+        }
+
+        // Write data to the buffer.  All of the data will be written,
+        // unless the overflow buffer reaches its size limit.
+        template <std::ranges::contiguous_range Range>
+        auto write(Range &&) -> size_type requires std::same_as<
+            const_value_type,
+            std::add_const_t<std::ranges::range_value_t<Range>>>;
+
+        // Read data from the buffer.  Returns the number of objects read,
+        // which is less than requested if the buffer is now empty.
+        template <std::ranges::contiguous_range Range>
+        auto read(Range &&) -> size_type
+            requires std::same_as<value_type,
+                                  std::ranges::range_value_t<Range>>;
+
+        // Return the inline data, if any, followed by the overflow buffer's
+        // readable ranges.
+        auto readable_ranges() -> readable_range_list {
+            return readable_range_list(
+                std::span<const_value_type>(storage.data() + read_offset,
+                                            write_offset - read_offset),
+                overflow.readable_ranges());
+        }
+
+        // Discard up to n objects from the start of the buffer.
+        auto discard(size_type n) -> size_type;
+
+        // Return the free inline space, or the overflow buffer's writable
+        // ranges once the inline storage is full.
+        auto writable_ranges() -> writable_range_list;
+
+        // Mark n objects of the space returned by writable_ranges() as data.
+        auto commit(size_type n) -> size_type {
+            if (spilled)
+                return overflow.commit(n);
+
+            auto m = std::min(n, inline_size - write_offset);
+            write_offset += m;
+            return m;
+        }
+
+        // Return the number of objects which can be read.
+        auto size() const -> size_type {
+            return write_offset - read_offset + overflow.size();
+        }
+
+        // Return the number of objects the buffer can hold without
+        // allocating memory.
+        auto capacity() const -> size_type {
+            return write_offset - read_offset +
+                   (spilled ? 0 : inline_size - write_offset) +
+                   overflow.capacity();
+        }
+
+        // Return true if there is no data to read.
+        auto empty() const -> bool {
+            return read_offset == write_offset && overflow.empty();
+        }
+
+        // Return true if new data is being written to the overflow buffer.
+        auto overflowed() const -> bool {
+            return spilled;
+        }
+
+        // Discard all data in the buffer and release the overflow buffer's
+        // extents.
+        auto clear() -> void {
+            overflow.clear();
+            read_offset = write_offset = 0;
+            spilled = false;
+        }
+
+        // Release the overflow buffer's unused memory.
+        auto shrink_to_fit() -> void {
+            overflow.shrink_to_fit();
+        }
+
+        // The buffer holding data which didn't fit in the inline storage.
+        overflow_buffer_type overflow;
+
+      private:
+        // Return to the inline storage if it's possible.  This is done
+        // before writing rather than when data is discarded, so space
+        // returned by writable_ranges() stays valid until it's committed.
+        auto prepare_write() -> void {
+            if (spilled && overflow.empty())
+                spilled = false;
+
+            if (read_offset == write_offset)
+                read_offset = write_offset = 0;
+        }
+
+        auto take_inline(hybrid_buffer &other) noexcept -> void {
+            read_offset = other.read_offset;
+            write_offset = other.write_offset;
+            spilled = other.spilled;
+            copy_objects(storage.data() + read_offset,
+                         other.storage.data() + read_offset,
+                         write_offset - read_offset);
+
+            other.read_offset = other.write_offset = 0;
+            other.spilled = false;
+        }
+
+        // The inline storage; [read_offset, write_offset) is data.
+        std::array<value_type, inline_size> storage;
+        size_type read_offset = 0;
+        size_type write_offset = 0;
+
+        // True if data is being written to the overflow buffer, because
+        // the inline storage filled up.
+        bool spilled = false;
+    };
+
+    /* hybrid_buffer::write() */
+    template <typename Char, std::size_t inline_size, std::size_t extent_bytes,
+              typename Allocator>
+    template <std::ranges::contiguous_range Range>
+    auto hybrid_buffer<Char, inline_size, extent_bytes, Allocator>::write(
+        Range &&data) -> size_type requires std::same_as<
+            const_value_type,
+            std::add_const_t<std::ranges::range_value_t<Range>>> {
+        std::span<const_value_type> buf(data);
+        size_type nwritten = 0;
+
+        prepare_write();
+
+        if (!spilled) {
+            nwritten = std::min(buf.size(), inline_size - write_offset);
+            copy_objects(storage.data() + write_offset, buf.data(), nwritten);
+            write_offset += nwritten;
+            buf = buf.subspan(nwritten);
+
+            if (buf.empty())
+                return nwritten;
+
+            spilled = true;
+        }
+
+        return nwritten + overflow.write(buf);
+    }
+
+    /* hybrid_buffer::read() */
+    template <typename Char, std::size_t inline_size, std::size_t extent_bytes,
+              typename Allocator>
+    template <std::ranges::contiguous_range Range>
+    auto hybrid_buffer<Char, inline_size, extent_bytes, Allocator>::read(
+        Range &&data) -> size_type
+        requires std::same_as<value_type, std::ranges::range_value_t<Range>> {
+        std::span<value_type> buf(data);
+
+        auto n = std::min(buf.size(), write_offset - read_offset);
+        copy_objects(buf.data(), storage.data() + read_offset, n);
+        read_offset += n;
+
+        if (n == buf.size())
+            return n;
+
+        return n + overflow.read(buf.subspan(n));
+    }
+
+    /* hybrid_buffer::discard() */
+    template <typename Char, std::size_t inline_size, std::size_t extent_bytes,
+              typename Allocator>
+    auto hybrid_buffer<Char, inline_size, extent_bytes, Allocator>::discard(
+        size_type n) -> size_type {
+        auto m = std::min(n, write_offset - read_offset);
+        read_offset += m;
+
+        if (m == n)
+            return m;
+
+        return m + overflow.discard(n - m);
+    }
+
+    /* hybrid_buffer::writable_ranges() */
+    template <typename Char, std::size_t inline_size, std::size_t extent_bytes,
+              typename Allocator>
+    auto hybrid_buffer<Char, inline_size, extent_bytes,
+                       Allocator>::writable_ranges() -> writable_range_list {
+        prepare_write();
+
+        if (!spilled) {
+            if (write_offset < inline_size)
+                return writable_range_list(
+                    std::span(storage).subspan(write_offset),
+                    typename overflow_buffer_type::writable_range_list());
+
+            spilled = true;
+        }
+
+        return writable_range_list(std::span<value_type>(),
+                                   overflow.writable_ranges());
+    }
+
+    static_assert(buffer<hybrid_buffer<char>>);
+    static_assert(sized_buffer<hybrid_buffer<char>>);
+
+} // namespace sk
+
+#endif // SK_BUFFER_HYBRID_BUFFER_HXX_INCLUDED
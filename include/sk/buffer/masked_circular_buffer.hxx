@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SK_BUFFER_MASKED_CIRCULAR_BUFFER_HXX_INCLUDED
+#define SK_BUFFER_MASKED_CIRCULAR_BUFFER_HXX_INCLUDED
+
+#include <algorithm>
+#include <cstddef>
+#include <ranges>
+#include <span>
+#include <type_traits>
+
+#include "sk/buffer/buffer.hxx"
+
+namespace sk {
+
+    /*************************************************************************
+     *
+     * masked_circular_buffer: a circular_buffer whose size is a power of
+     * two.  The read and write positions are free-running counters which are
+     * masked to find the position in the buffer, so the amount of data is
+     * always write_index - read_index, and commit() and discard() just add
+     * to a counter without checking for wrap-around.  Unlike
+     * circular_buffer, there is no reserved slot to tell a full buffer from
+     * an empty one, so the buffer holds exactly buffer_size objects.
+     *
+     * The storage is aligned to a cache line, or to a page if it is at least
+     * a page in size.
+     */
+
+    template <typename Char, std::size_t buffer_size = 4096>
+    struct masked_circular_buffer {
+        static_assert(buffer_size > 0 &&
+                          (buffer_size & (buffer_size - 1)) == 0,
+                      "masked_circular_buffer size must be a power of two");
+
+        using size_type = std::size_t;
+        using value_type = Char;
+        using const_value_type = std::add_const_t<Char>;
+
+        // When the data wraps around the end of the buffer, the readable or
+        // writable space is split into two ranges.
+        using readable_range_list =
+            static_range_list<std::span<const_value_type>, 2>;
+        using writable_range_list = static_range_list<std::span<value_type>, 2>;
+
+        // Create a new, empty buffer.
+        masked_circular_buffer() = default;
+
+        // masked_circular_buffer cannot be copied or moved, because the
+        // buffer contains the entire array.
+        masked_circular_buffer(masked_circular_buffer const &) = delete;
+        masked_circular_buffer &
+        operator=(masked_circular_buffer const &) = delete;
+        masked_circular_buffer(masked_circular_buffer &&) = delete;
+        masked_circular_buffer &operator=(masked_circular_buffer &&) = delete;
+
+        // Reset the buffer.
+        auto clear() -> void {
+            read_index = 0;
+            write_index = 0;
+        }
+
+        // Write data to the buffer.  Returns the number of objects written,
+        // which might be less than the size of the range if the buffer is full.
+        template <std::ranges::contiguous_range Range>
+        auto write(Range &&) -> size_type requires std::same_as<
+            const_value_type,
+            std::add_const_t<std::ranges::range_value_t<Range>>>;
+
+        // Read data from the buffer.  Returns the number of objects read.
+        template <std::ranges::contiguous_range Range>
+        auto read(Range &&) -> size_type
+            requires std::same_as<value_type,
+                                  std::ranges::range_value_t<Range>>;
+
+        // Return the data in the buffer which can be read, as one range, or
+        // two if it wraps around the end of the buffer.
+        auto readable_ranges() -> readable_range_list {
+            return ranges_at<readable_range_list>(read_index, size());
+        }
+
+        // Discard up to n objects of readable data from the start of the
+        // buffer.  Returns the number of objects discarded.
+        auto discard(size_type n) -> size_type {
+            auto can_discard = std::min(n, size());
+            read_index += can_discard;
+            return can_discard;
+        }
+
+        // Return the space in the buffer which can be written to, as one
+        // range, or two if it wraps around the end of the buffer.
+        auto writable_ranges() -> writable_range_list {
+            return ranges_at<writable_range_list>(write_index,
+                                                  buffer_size - size());
+        }
+
+        // Mark n objects of previously empty space as containing data.
+        auto commit(size_type n) -> size_type {
+            auto can_commit = std::min(n, buffer_size - size());
+            write_index += can_commit;
+            return can_commit;
+        }
+
+        // Return the number of objects which can be read.
+        auto size() const -> size_type {
+            return write_index - read_index;
+        }
+
+        // Return the number of objects the buffer can hold.
+        auto capacity() const -> size_type {
+            return buffer_size;
+        }
+
+        // Return true if there is no data to read.
+        auto empty() const -> bool {
+            return read_index == write_index;
+        }
+
+      private:
+        static constexpr size_type mask = buffer_size - 1;
+
+        static constexpr std::size_t storage_alignment =
+            sizeof(Char) * buffer_size >= 4096 ? 4096
+            : alignof(Char) > 64               ? alignof(Char)
+                                               : 64;
+
+        // Return the n objects starting at the (unmasked) index as a range
+        // list.
+        template <typename RangeList>
+        auto ranges_at(size_type index, size_type n) -> RangeList {
+            using span_type = typename RangeList::value_type;
+
+            auto start = index & mask;
+            auto first = std::min(n, buffer_size - start);
+
+            RangeList ret;
+            if (first > 0)
+                ret.push_back(span_type(data + start, first));
+            if (n > first)
+                ret.push_back(span_type(data, n - first));
+            return ret;
+        }
+
+        // The data stored in this buffer.
+        alignas(storage_alignment) Char data[buffer_size];
+
+        // The total number of objects ever discarded and committed.  These
+        // wrap around at the maximum size_type, which is a multiple of
+        // buffer_size, so masking them still gives the right position.
+        size_type read_index = 0;
+        size_type write_index = 0;
+    };
+
+    static_assert(buffer<masked_circular_buffer<char>>);
+    static_assert(sized_buffer<masked_circular_buffer<char>>);
+
+    /*
+     * masked_circular_buffer::write()
+     */
+    template <typename Char, std::size_t buffer_size>
+    template <std::ranges::contiguous_range Range>
+    auto masked_circular_buffer<Char, buffer_size>::write(Range &&buf)
+        -> size_type requires std::same_as<
+            const_value_type,
+            std::add_const_t<std::ranges::range_value_t<Range>>> {
+
+        std::span<const_value_type> data_left(buf);
+        size_type nwritten = 0;
+
+        for (auto &&range : writable_ranges()) {
+            auto n = std::min(range.size(), data_left.size());
+            copy_objects(range.data(), data_left.data(), n);
+            data_left = data_left.subspan(n);
+            nwritten += n;
+        }
+
+        return commit(nwritten);
+    }
+
+    /*
+     * masked_circular_buffer::read()
+     */
+    template <typename Char, std::size_t buffer_size>
+    template <std::ranges::contiguous_range Range>
+    auto masked_circular_buffer<Char, buffer_size>::read(Range &&buf)
+        -> size_type
+        requires std::same_as<value_type, std::ranges::range_value_t<Range>> {
+
+        std::span<value_type> data_left(buf);
+        size_type nread = 0;
+
+        for (auto &&range : readable_ranges()) {
+            auto n = std::min(range.size(), data_left.size());
+            copy_objects(data_left.data(), range.data(), n);
+            data_left = data_left.subspan(n);
+            nread += n;
+        }
+
+        return discard(nread);
+    }
+
+} // namespace sk
+
+#endif // SK_BUFFER_MASKED_CIRCULAR_BUFFER_HXX_INCLUDED
@@ -0,0 +1,510 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SK_BUFFER_MIRRORED_CIRCULAR_BUFFER_HXX_INCLUDED
+#define SK_BUFFER_MIRRORED_CIRCULAR_BUFFER_HXX_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ranges>
+#include <span>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#if defined(_WIN32)
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <windows.h>
+#    ifdef _MSC_VER
+// VirtualAlloc2 and MapViewOfFile3 are only exported from onecore.
+#        pragma comment(lib, "onecore.lib")
+#    endif
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <unistd.h>
+#endif
+
+#include "sk/buffer/buffer.hxx"
+
+namespace sk {
+
+    namespace detail {
+
+        /*
+         * mirrored_mapping: a region of memory which is mapped twice,
+         * back-to-back, in the address space.  Writing to base[i] also
+         * writes to base[i + size] and vice versa, so any window of up to
+         * `size` bytes starting inside the first mapping is contiguous.
+         *
+         * The requested size is rounded up to the system's allocation
+         * granularity.  If the mapping can't be created, std::system_error
+         * is thrown.
+         */
+        struct mirrored_mapping {
+            std::byte *base = nullptr;
+            std::size_t size = 0;
+
+            mirrored_mapping() = default;
+            explicit mirrored_mapping(std::size_t min_size);
+
+            mirrored_mapping(mirrored_mapping const &) = delete;
+            mirrored_mapping &operator=(mirrored_mapping const &) = delete;
+
+            mirrored_mapping(mirrored_mapping &&other) noexcept
+                : base(std::exchange(other.base, nullptr)),
+                  size(std::exchange(other.size, 0)) {}
+
+            mirrored_mapping &operator=(mirrored_mapping &&other) noexcept {
+                if (this != &other) {
+                    unmap();
+                    base = std::exchange(other.base, nullptr);
+                    size = std::exchange(other.size, 0);
+                }
+                return *this;
+            }
+
+            ~mirrored_mapping() {
+                unmap();
+            }
+
+            // Return the size the mapping must be a multiple of.
+            static auto granularity() -> std::size_t;
+
+          private:
+            auto unmap() -> void;
+        };
+
+#if defined(_WIN32)
+
+        inline auto mirrored_mapping::granularity() -> std::size_t {
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            return info.dwAllocationGranularity;
+        }
+
+        inline mirrored_mapping::mirrored_mapping(std::size_t min_size) {
+            auto gran = granularity();
+            auto nbytes = ((std::max<std::size_t>(min_size, 1) + gran - 1) /
+                           gran) * gran;
+
+            auto section = CreateFileMappingW(
+                INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                static_cast<DWORD>(static_cast<std::uint64_t>(nbytes) >> 32),
+                static_cast<DWORD>(nbytes & 0xFFFFFFFFu), nullptr);
+            if (section == nullptr)
+                throw std::system_error(static_cast<int>(GetLastError()),
+                                        std::system_category(),
+                                        "CreateFileMapping");
+
+            // Reserve a placeholder for both views, then split it in two.
+            auto *placeholder = static_cast<std::byte *>(VirtualAlloc2(
+                nullptr, nullptr, 2 * nbytes,
+                MEM_RESERVE | MEM_RESERVE_PLACEHOLDER, PAGE_NOACCESS, nullptr,
+                0));
+            if (placeholder == nullptr) {
+                auto err = GetLastError();
+                CloseHandle(section);
+                throw std::system_error(static_cast<int>(err),
+                                        std::system_category(),
+                                        "VirtualAlloc2");
+            }
+
+            if (!VirtualFree(placeholder, nbytes,
+                             MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER)) {
+                auto err = GetLastError();
+                VirtualFree(placeholder, 0, MEM_RELEASE);
+                CloseHandle(section);
+                throw std::system_error(static_cast<int>(err),
+                                        std::system_category(), "VirtualFree");
+            }
+
+            auto *view1 = MapViewOfFile3(section, nullptr, placeholder, 0,
+                                         nbytes, MEM_REPLACE_PLACEHOLDER,
+                                         PAGE_READWRITE, nullptr, 0);
+            if (view1 == nullptr) {
+                auto err = GetLastError();
+                VirtualFree(placeholder, 0, MEM_RELEASE);
+                VirtualFree(placeholder + nbytes, 0, MEM_RELEASE);
+                CloseHandle(section);
+                throw std::system_error(static_cast<int>(err),
+                                        std::system_category(),
+                                        "MapViewOfFile3");
+            }
+
+            auto *view2 = MapViewOfFile3(section, nullptr, placeholder + nbytes,
+                                         0, nbytes, MEM_REPLACE_PLACEHOLDER,
+                                         PAGE_READWRITE, nullptr, 0);
+            if (view2 == nullptr) {
+                auto err = GetLastError();
+                UnmapViewOfFile(view1);
+                VirtualFree(placeholder + nbytes, 0, MEM_RELEASE);
+                CloseHandle(section);
+                throw std::system_error(static_cast<int>(err),
+                                        std::system_category(),
+                                        "MapViewOfFile3");
+            }
+
+            // The views keep the section alive.
+            CloseHandle(section);
+
+            base = placeholder;
+            size = nbytes;
+        }
+
+        inline auto mirrored_mapping::unmap() -> void {
+            if (base == nullptr)
+                return;
+
+            UnmapViewOfFile(base);
+            UnmapViewOfFile(base + size);
+            base = nullptr;
+            size = 0;
+        }
+
+#else // !_WIN32
+
+        inline auto mirrored_mapping::granularity() -> std::size_t {
+            return static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        }
+
+        inline mirrored_mapping::mirrored_mapping(std::size_t min_size) {
+            auto gran = granularity();
+            auto nbytes = ((std::max<std::size_t>(min_size, 1) + gran - 1) /
+                           gran) * gran;
+
+            // Create an anonymous file to hold the data.
+#    if defined(__linux__)
+            int fd = memfd_create("sk-buffer", MFD_CLOEXEC);
+            if (fd == -1)
+                throw std::system_error(errno, std::system_category(),
+                                        "memfd_create");
+#    else
+            static std::atomic<unsigned> counter;
+            char name[64];
+            std::snprintf(name, sizeof(name), "/sk-buffer-%ld-%u",
+                          static_cast<long>(getpid()), counter++);
+
+            int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+            if (fd == -1)
+                throw std::system_error(errno, std::system_category(),
+                                        "shm_open");
+            shm_unlink(name);
+#    endif
+
+            if (ftruncate(fd, static_cast<off_t>(nbytes)) == -1) {
+                auto err = errno;
+                close(fd);
+                throw std::system_error(err, std::system_category(),
+                                        "ftruncate");
+            }
+
+            // Reserve address space for both mappings.
+            auto *region = mmap(nullptr, 2 * nbytes, PROT_NONE,
+                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (region == MAP_FAILED) {
+                auto err = errno;
+                close(fd);
+                throw std::system_error(err, std::system_category(), "mmap");
+            }
+
+            auto *start = static_cast<std::byte *>(region);
+
+            // Map the file twice into the reserved space.
+            for (auto *p : {start, start + nbytes}) {
+                if (mmap(p, nbytes, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+                    auto err = errno;
+                    munmap(region, 2 * nbytes);
+                    close(fd);
+                    throw std::system_error(err, std::system_category(),
+                                            "mmap");
+                }
+            }
+
+            // The mappings keep the file alive.
+            close(fd);
+
+            base = start;
+            size = nbytes;
+        }
+
+        inline auto mirrored_mapping::unmap() -> void {
+            if (base == nullptr)
+                return;
+
+            munmap(base, 2 * size);
+            base = nullptr;
+            size = 0;
+        }
+
+#endif // _WIN32
+
+    } // namespace detail
+
+    /*************************************************************************
+     *
+     * mirrored_circular_buffer: a circular buffer whose storage is mapped
+     * twice, back-to-back, in virtual memory.  Data which wraps around the
+     * end of the buffer appears contiguously in the second mapping, so
+     * readable_ranges() and writable_ranges() always return a single range.
+     * This means the entire contents of the buffer can be passed to a parser
+     * or a single read() or write() call without being copied.
+     *
+     * The buffer can contain at least buffer_size objects; since the mapping
+     * is rounded up to the system page size (or allocation granularity on
+     * Windows), the actual capacity may be larger, and is returned by
+     * capacity().  Unlike circular_buffer, the storage is allocated in the
+     * constructor, which throws std::system_error if the mapping can't
+     * be created.
+     */
+
+    template <typename Char, std::size_t buffer_size = 4096>
+    struct mirrored_circular_buffer {
+        static_assert(std::is_trivially_copyable_v<Char>,
+                      "mirrored_circular_buffer stores objects in shared "
+                      "memory, so they must be trivially copyable");
+
+        // The mapping size is a multiple of the page size, which is a power
+        // of two, so objects must be as well to fit exactly.
+        static_assert((sizeof(Char) & (sizeof(Char) - 1)) == 0,
+                      "mirrored_circular_buffer requires the object size to "
+                      "be a power of two");
+
+        using size_type = std::size_t;
+        using value_type = Char;
+        using const_value_type = std::add_const_t<Char>;
+
+        // The readable and writable space is always contiguous.
+        using readable_range_list =
+            static_range_list<std::span<const_value_type>, 1>;
+        using writable_range_list = static_range_list<std::span<value_type>, 1>;
+
+        // Create a new, empty buffer.
+        mirrored_circular_buffer()
+            : mapping(buffer_size * sizeof(Char)),
+              data(reinterpret_cast<Char *>(mapping.base)),
+              buffer_capacity(mapping.size / sizeof(Char)) {}
+
+        // mirrored_circular_buffer is not copyable, but can be moved.
+        mirrored_circular_buffer(mirrored_circular_buffer const &) = delete;
+        mirrored_circular_buffer &
+        operator=(mirrored_circular_buffer const &) = delete;
+
+        mirrored_circular_buffer(mirrored_circular_buffer &&other) noexcept
+            : mapping(std::move(other.mapping)),
+              data(std::exchange(other.data, nullptr)),
+              buffer_capacity(std::exchange(other.buffer_capacity, 0)),
+              read_offset(std::exchange(other.read_offset, 0)),
+              read_size(std::exchange(other.read_size, 0)) {}
+
+        mirrored_circular_buffer &
+        operator=(mirrored_circular_buffer &&other) noexcept {
+            if (this != &other) {
+                mapping = std::move(other.mapping);
+                data = std::exchange(other.data, nullptr);
+                buffer_capacity = std::exchange(other.buffer_capacity, 0);
+                read_offset = std::exchange(other.read_offset, 0);
+                read_size = std::exchange(other.read_size, 0);
+            }
+            return *this;
+        }
+
+        // Reset the buffer.
+        auto clear() -> void {
+            read_offset = 0;
+            read_size = 0;
+        }
+
+        // Return the number of objects the buffer can hold.
+        auto capacity() const -> size_type {
+            return buffer_capacity;
+        }
+
+        // Return the number of objects which can be read.
+        auto size() const -> size_type {
+            return read_size;
+        }
+
+        // Return true if there is no data to read.
+        auto empty() const -> bool {
+            return read_size == 0;
+        }
+
+        // Write data to the buffer.  Returns the number of objects written,
+        // which might less than the size of the range if the buffer is full.
+        template <std::ranges::contiguous_range Range>
+        auto write(Range &&) -> size_type requires std::same_as<
+            const_value_type,
+            std::add_const_t<std::ranges::range_value_t<Range>>>;
+
+        // Read data from the buffer.  As much data will be read as possible,
+        // and the number of objects read will be returned.  If the return value
+        // is less than the requested number of objects, the buffer is now
+        // empty.
+        template <std::ranges::contiguous_range Range>
+        auto read(Range &&) -> size_type
+            requires std::same_as<value_type,
+                                  std::ranges::range_value_t<Range>>;
+
+        // Return the data in the buffer which can be read, which is always
+        // a single range.  Writing data to the buffer will not invalidate
+        // the range.
+        //
+        // After reading the data, discard() should be called to remove the
+        // data from the buffer.
+        auto readable_ranges() -> readable_range_list;
+
+        // Discard up to n bytes of readable data from the start of the buffer.
+        // Returns the number of bytes discarded.
+        auto discard(size_type n) -> size_type;
+
+        // Return the space in the buffer which can be written to, which is
+        // always a single range.  After writing the data, commit() should be
+        // called to mark the space as used.
+        auto writable_ranges() -> writable_range_list;
+
+        // Mark n bytes of previously empty space as containing data.
+        auto commit(size_type n) -> size_type;
+
+      private:
+        detail::mirrored_mapping mapping;
+
+        // The start of the first mapping.
+        Char *data;
+
+        // The number of objects in one mapping.
+        size_type buffer_capacity;
+
+        // The offset of the start of the readable data, which is always less
+        // than buffer_capacity.
+        size_type read_offset = 0;
+
+        // The number of objects of readable data.
+        size_type read_size = 0;
+    };
+
+    static_assert(buffer<mirrored_circular_buffer<char>>);
+    static_assert(sized_buffer<mirrored_circular_buffer<char>>);
+
+    /*
+     * mirrored_circular_buffer::write()
+     */
+    template <typename Char, std::size_t buffer_size>
+    template <std::ranges::contiguous_range InRange>
+    auto mirrored_circular_buffer<Char, buffer_size>::write(InRange &&buf)
+        -> size_type requires std::same_as<
+            const_value_type,
+            std::add_const_t<std::ranges::range_value_t<InRange>>> {
+
+        auto range = writable_ranges()[0];
+        auto can_write = std::min(std::ranges::size(buf), range.size());
+        copy_objects(range.data(), std::ranges::data(buf), can_write);
+        return commit(can_write);
+    }
+
+    /*
+     * mirrored_circular_buffer::read()
+     */
+    template <typename Char, std::size_t buffer_size>
+    template <std::ranges::contiguous_range InRange>
+    auto mirrored_circular_buffer<Char, buffer_size>::read(InRange &&buf)
+        -> size_type
+        requires std::same_as<value_type, std::ranges::range_value_t<InRange>> {
+
+        auto range = readable_ranges()[0];
+        auto can_read = std::min(std::ranges::size(buf), range.size());
+        copy_objects(std::ranges::data(buf), range.data(), can_read);
+        return discard(can_read);
+    }
+
+    /*
+     * mirrored_circular_buffer::readable_ranges()
+     */
+    template <typename Char, std::size_t buffer_size>
+    auto mirrored_circular_buffer<Char, buffer_size>::readable_ranges()
+        -> readable_range_list {
+        return {std::span<const_value_type>(data + read_offset, read_size)};
+    }
+
+    /*
+     * mirrored_circular_buffer::writable_ranges()
+     */
+    template <typename Char, std::size_t buffer_size>
+    auto mirrored_circular_buffer<Char, buffer_size>::writable_ranges()
+        -> writable_range_list {
+        // The write offset can be in the second mapping, which is fine since
+        // the free space always ends before the read offset + capacity.
+        return {std::span<value_type>(data + read_offset + read_size,
+                                      buffer_capacity - read_size)};
+    }
+
+    /*
+     * mirrored_circular_buffer::commit()
+     */
+    template <typename Char, std::size_t buffer_size>
+    auto mirrored_circular_buffer<Char, buffer_size>::commit(size_type n)
+        -> size_type {
+        auto can_commit = std::min(n, buffer_capacity - read_size);
+        read_size += can_commit;
+        return can_commit;
+    }
+
+    /*
+     * mirrored_circular_buffer::discard()
+     */
+    template <typename Char, std::size_t buffer_size>
+    auto mirrored_circular_buffer<Char, buffer_size>::discard(size_type n)
+        -> size_type {
+        auto can_discard = std::min(n, read_size);
+        read_size -= can_discard;
+        read_offset += can_discard;
+
+        // If the read offset moved into the second mapping, move it back to
+        // the same location in the first mapping.
+        if (read_offset >= buffer_capacity)
+            read_offset -= buffer_capacity;
+
+        // When the buffer is empty, start again from the beginning to keep
+        // subsequent writes in the first mapping.
+        if (read_size == 0)
+            read_offset = 0;
+
+        return can_discard;
+    }
+
+} // namespace sk
+
+#endif // SK_BUFFER_MIRRORED_CIRCULAR_BUFFER_HXX_INCLUDED
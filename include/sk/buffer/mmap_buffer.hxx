@@ -0,0 +1,540 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Buffers over memory-mapped files.
+ */
+
+#ifndef SK_BUFFER_MMAP_BUFFER_HXX_INCLUDED
+#define SK_BUFFER_MMAP_BUFFER_HXX_INCLUDED
+
+#if defined(_WIN32)
+#    error "sk/buffer/mmap_buffer.hxx requires a POSIX system"
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <ranges>
+#include <span>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sk/buffer/buffer.hxx"
+
+namespace sk {
+
+    namespace detail {
+
+        /*
+         * file_mapping: a shared mapping of part of a file.  The offset must
+         * be a multiple of the page size.  An empty mapping has no address.
+         * If the file can't be mapped, std::system_error is thrown.
+         */
+        struct file_mapping {
+            std::byte *base = nullptr;
+            std::size_t size = 0;
+
+            file_mapping() = default;
+
+            file_mapping(int fd, std::uint64_t offset, std::size_t size_,
+                         int prot)
+                : size(size_) {
+                if (size == 0)
+                    return;
+
+                auto *p = ::mmap(nullptr, size, prot, MAP_SHARED, fd,
+                                 static_cast<off_t>(offset));
+                if (p == MAP_FAILED)
+                    throw std::system_error(errno, std::system_category(),
+                                            "mmap");
+                base = static_cast<std::byte *>(p);
+            }
+
+            file_mapping(file_mapping const &) = delete;
+            file_mapping &operator=(file_mapping const &) = delete;
+
+            file_mapping(file_mapping &&other) noexcept
+                : base(std::exchange(other.base, nullptr)),
+                  size(std::exchange(other.size, 0)) {}
+
+            file_mapping &operator=(file_mapping &&other) noexcept {
+                if (this != &other) {
+                    unmap();
+                    base = std::exchange(other.base, nullptr);
+                    size = std::exchange(other.size, 0);
+                }
+                return *this;
+            }
+
+            ~file_mapping() {
+                unmap();
+            }
+
+            static auto page_size() -> std::size_t {
+                static auto const size =
+                    static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+                return size;
+            }
+
+            // Give the kernel a hint about the use of [begin, end) bytes
+            // into the mapping.  The range is widened to whole pages, and
+            // errors are ignored since this is only advice.
+            auto advise(std::size_t begin, std::size_t end, int advice) noexcept
+                -> void {
+                end = std::min(end, size);
+                begin -= begin % page_size();
+                if (base && begin < end)
+                    ::madvise(base + begin, end - begin, advice);
+            }
+
+            auto unmap() noexcept -> void {
+                if (base)
+                    ::munmap(base, size);
+                base = nullptr;
+                size = 0;
+            }
+        };
+
+        // Return the size of an open file.
+        inline auto file_size(int fd) -> std::uint64_t {
+            struct stat st;
+            if (::fstat(fd, &st) == -1)
+                throw std::system_error(errno, std::system_category(),
+                                        "fstat");
+            return static_cast<std::uint64_t>(st.st_size);
+        }
+
+    } // namespace detail
+
+    /*************************************************************************
+     *
+     * mmap_readable_buffer: a readable buffer over a memory-mapped file, or a
+     * region of one.  readable_ranges() returns the rest of the region as a
+     * single span directly from the page cache, so sending a file with
+     * buffer_write_to() doesn't copy it into the buffer first.
+     *
+     * The mapping is advised as sequential, and as discard() moves forward,
+     * the next readahead_size bytes are advised as needed soon, while pages
+     * which have been discarded are dropped from the mapping to limit the
+     * process's resident size.  (The data stays in the page cache.)
+     *
+     * The file descriptor is only used during construction and can be
+     * closed afterwards.  If the file is truncated while it is mapped,
+     * reading the missing data raises SIGBUS.
+     */
+
+    template <typename Char = char> struct mmap_readable_buffer {
+        static_assert(sizeof(Char) == 1 && std::is_trivially_copyable_v<Char>,
+                      "mmap_readable_buffer holds file data, so it must be a "
+                      "buffer of bytes");
+
+        using size_type = std::size_t;
+        using value_type = Char;
+        using const_value_type = std::add_const_t<Char>;
+        using readable_range_list =
+            static_range_list<std::span<const_value_type>, 1>;
+
+        // By default, advise the next 1MB as needed.
+        static constexpr size_type default_readahead_size = 1024 * 1024;
+
+        // Map the entire file.
+        explicit mmap_readable_buffer(int fd)
+            : mmap_readable_buffer(fd, 0, detail::file_size(fd)) {}
+
+        // Map `length` bytes starting at `offset`.  Throws std::system_error
+        // if the region extends past the end of the file.
+        mmap_readable_buffer(int fd, std::uint64_t offset, size_type length);
+
+        // mmap_readable_buffer is not copyable, but can be moved.
+        mmap_readable_buffer(mmap_readable_buffer const &) = delete;
+        mmap_readable_buffer &operator=(mmap_readable_buffer const &) = delete;
+
+        mmap_readable_buffer(mmap_readable_buffer &&other) noexcept
+            : readahead_size(other.readahead_size),
+              mapping(std::move(other.mapping)),
+              region_start(std::exchange(other.region_start, 0)),
+              read_offset(std::exchange(other.read_offset, 0)),
+              advised_to(std::exchange(other.advised_to, 0)),
+              released_to(std::exchange(other.released_to, 0)) {}
+
+        mmap_readable_buffer &operator=(mmap_readable_buffer &&other) noexcept {
+            if (this != &other) {
+                readahead_size = other.readahead_size;
+                mapping = std::move(other.mapping);
+                region_start = std::exchange(other.region_start, 0);
+                read_offset = std::exchange(other.read_offset, 0);
+                advised_to = std::exchange(other.advised_to, 0);
+                released_to = std::exchange(other.released_to, 0);
+            }
+            return *this;
+        }
+
+        // Read data from the buffer.  Returns the number of objects read.
+        template <std::ranges::contiguous_range Range>
+        auto read(Range &&buf) -> size_type
+            requires std::same_as<value_type,
+                                  std::ranges::range_value_t<Range>> {
+            auto can_read = std::min(std::ranges::size(buf), size());
+            copy_objects(std::ranges::data(buf), data() + read_offset,
+                         can_read);
+            return discard(can_read);
+        }
+
+        // Return the rest of the mapped region as a single range.
+        auto readable_ranges() -> readable_range_list {
+            return {std::span<const_value_type>(data() + read_offset, size())};
+        }
+
+        // Discard up to n objects from the start of the buffer.
+        auto discard(size_type n) -> size_type;
+
+        // Return the number of objects which can be read.
+        auto size() const -> size_type {
+            return mapping.size - region_start - read_offset;
+        }
+
+        // No data can be written, so the capacity is the size.
+        auto capacity() const -> size_type {
+            return size();
+        }
+
+        auto empty() const -> bool {
+            return size() == 0;
+        }
+
+        // The number of bytes ahead of the read position to advise the
+        // kernel to read in.
+        size_type readahead_size = default_readahead_size;
+
+      private:
+        auto data() const -> const_value_type * {
+            return reinterpret_cast<const_value_type *>(mapping.base +
+                                                        region_start);
+        }
+
+        // Update the kernel's advice for the current read position.
+        auto advise() noexcept -> void;
+
+        detail::file_mapping mapping;
+
+        // The offset of the region within the mapping, since the mapping
+        // must start on a page boundary.
+        size_type region_start = 0;
+
+        // The read position, relative to the start of the region.
+        size_type read_offset = 0;
+
+        // Offsets in the mapping up to which MADV_WILLNEED has been given,
+        // and discarded pages have been released.
+        size_type advised_to = 0;
+        size_type released_to = 0;
+    };
+
+    static_assert(readable_buffer<mmap_readable_buffer<char>>);
+    static_assert(sized_buffer<mmap_readable_buffer<char>>);
+
+    /*
+     * mmap_readable_buffer::mmap_readable_buffer()
+     */
+    template <typename Char>
+    mmap_readable_buffer<Char>::mmap_readable_buffer(int fd,
+                                                     std::uint64_t offset,
+                                                     size_type length) {
+        if (offset + length > detail::file_size(fd))
+            throw std::system_error(
+                std::make_error_code(std::errc::invalid_argument),
+                "mmap_readable_buffer: region extends past end of file");
+
+        // An empty region has no mapping.
+        if (length == 0)
+            return;
+
+        auto page = detail::file_mapping::page_size();
+        auto map_offset = offset - offset % page;
+        region_start = static_cast<size_type>(offset - map_offset);
+
+        mapping = detail::file_mapping(fd, map_offset, region_start + length,
+                                       PROT_READ);
+        mapping.advise(0, mapping.size, MADV_SEQUENTIAL);
+
+        advised_to = region_start;
+        advise();
+    }
+
+    /*
+     * mmap_readable_buffer::discard()
+     */
+    template <typename Char>
+    auto mmap_readable_buffer<Char>::discard(size_type n) -> size_type {
+        auto can_discard = std::min(n, size());
+        read_offset += can_discard;
+        advise();
+        return can_discard;
+    }
+
+    /*
+     * mmap_readable_buffer::advise()
+     */
+    template <typename Char>
+    auto mmap_readable_buffer<Char>::advise() noexcept -> void {
+        auto pos = region_start + read_offset;
+        auto page = detail::file_mapping::page_size();
+
+        // Drop the whole pages before the read position.
+        if (auto done = pos - pos % page; done > released_to) {
+            mapping.advise(released_to, done, MADV_DONTNEED);
+            released_to = done;
+        }
+
+        // Keep at least half the readahead window ahead of the reader, so
+        // the advice is given in large steps rather than on every discard.
+        if (advised_to < mapping.size &&
+            advised_to < pos + readahead_size / 2) {
+            auto end = std::min(pos + readahead_size, mapping.size);
+            mapping.advise(std::max(advised_to, pos), end, MADV_WILLNEED);
+            advised_to = end;
+        }
+    }
+
+    /*************************************************************************
+     *
+     * mmap_writable_buffer: a writable buffer which appends to a file
+     * through a memory mapping.  The file is extended chunk_size bytes at
+     * a time and the new space is mapped; writable_ranges() returns the
+     * unused part of the current chunk, so data can be read into it (with
+     * buffer_read_from(), for example) without copying it again.
+     *
+     * Data is appended after the existing contents of the file.  When the
+     * buffer is destroyed, or finish() is called, the file is truncated to
+     * the end of the committed data.  The file descriptor must remain open
+     * until then.
+     *
+     * Space is allocated with posix_fallocate() where available, so running
+     * out of disk space is reported as an exception rather than SIGBUS.
+     */
+
+    template <typename Char = char> struct mmap_writable_buffer {
+        static_assert(sizeof(Char) == 1 && std::is_trivially_copyable_v<Char>,
+                      "mmap_writable_buffer holds file data, so it must be a "
+                      "buffer of bytes");
+
+        using size_type = std::size_t;
+        using value_type = Char;
+        using const_value_type = std::add_const_t<Char>;
+        using writable_range_list = static_range_list<std::span<value_type>, 1>;
+
+        // By default, extend the file 1MB at a time.
+        static constexpr size_type default_chunk_size = 1024 * 1024;
+
+        // Append to the file open on fd, which must be open for reading and
+        // writing.  chunk_size is rounded up to a multiple of the page size.
+        explicit mmap_writable_buffer(int fd_,
+                                      size_type chunk_size_ = default_chunk_size)
+            : fd(fd_), chunk_size(round_to_page(chunk_size_)),
+              file_end(detail::file_size(fd_)) {}
+
+        // mmap_writable_buffer is not copyable, but can be moved.
+        mmap_writable_buffer(mmap_writable_buffer const &) = delete;
+        mmap_writable_buffer &operator=(mmap_writable_buffer const &) = delete;
+
+        mmap_writable_buffer(mmap_writable_buffer &&other) noexcept
+            : fd(std::exchange(other.fd, -1)), chunk_size(other.chunk_size),
+              file_end(other.file_end), mapping(std::move(other.mapping)),
+              map_offset(other.map_offset) {}
+
+        mmap_writable_buffer &operator=(mmap_writable_buffer &&other) noexcept {
+            if (this != &other) {
+                std::error_code ec;
+                finish(ec);
+                fd = std::exchange(other.fd, -1);
+                chunk_size = other.chunk_size;
+                file_end = other.file_end;
+                mapping = std::move(other.mapping);
+                map_offset = other.map_offset;
+            }
+            return *this;
+        }
+
+        ~mmap_writable_buffer() {
+            std::error_code ec;
+            finish(ec);
+        }
+
+        // Write data to the buffer, extending the file as needed.  Returns
+        // the number of objects written, which is the size of the range.
+        template <std::ranges::contiguous_range Range>
+        auto write(Range &&buf) -> size_type requires std::same_as<
+            const_value_type,
+            std::add_const_t<std::ranges::range_value_t<Range>>> {
+            std::span<const_value_type> data_left(buf);
+
+            while (!data_left.empty()) {
+                auto range = writable_ranges()[0];
+                auto n = std::min(range.size(), data_left.size());
+                copy_objects(range.data(), data_left.data(), n);
+                commit(n);
+                data_left = data_left.subspan(n);
+            }
+
+            return std::ranges::size(buf);
+        }
+
+        // Return the unused space in the current chunk, extending the file
+        // and mapping a new chunk if the current one is full.  Throws
+        // std::system_error if the file can't be extended or mapped.
+        auto writable_ranges() -> writable_range_list;
+
+        // Mark n objects at the start of the writable space as data.
+        auto commit(size_type n) -> size_type {
+            auto can_commit = std::min(n, window_size());
+            file_end += can_commit;
+            return can_commit;
+        }
+
+        // Return the size of the file's data, including what was in the file
+        // before the buffer was created.
+        auto file_size() const -> std::uint64_t {
+            return file_end;
+        }
+
+        // Unmap the file and truncate it to the end of the committed data.
+        // The buffer can't be used afterwards.
+        auto finish() -> void {
+            std::error_code ec;
+            finish(ec);
+            if (ec)
+                throw std::system_error(ec, "mmap_writable_buffer::finish");
+        }
+
+        auto finish(std::error_code &ec) noexcept -> void;
+
+      private:
+        static auto round_to_page(size_type n) -> size_type {
+            auto page = detail::file_mapping::page_size();
+            return (std::max<size_type>(n, 1) + page - 1) / page * page;
+        }
+
+        // The amount of space left in the current mapping.
+        auto window_size() const -> size_type {
+            auto mapped_end = map_offset + mapping.size;
+            return mapping.base ? static_cast<size_type>(mapped_end - file_end)
+                                : 0;
+        }
+
+        // Extend the file and map the next chunk.
+        auto map_next() -> void;
+
+        int fd;
+        size_type chunk_size;
+
+        // The end of the committed data in the file.
+        std::uint64_t file_end;
+
+        // The current chunk, which starts at map_offset in the file.
+        detail::file_mapping mapping;
+        std::uint64_t map_offset = 0;
+    };
+
+    static_assert(writable_buffer<mmap_writable_buffer<char>>);
+
+    /*
+     * mmap_writable_buffer::writable_ranges()
+     */
+    template <typename Char>
+    auto mmap_writable_buffer<Char>::writable_ranges() -> writable_range_list {
+        if (window_size() == 0)
+            map_next();
+
+        auto *start = mapping.base + (file_end - map_offset);
+        return {std::span<value_type>(reinterpret_cast<value_type *>(start),
+                                      window_size())};
+    }
+
+    /*
+     * mmap_writable_buffer::map_next()
+     */
+    template <typename Char>
+    auto mmap_writable_buffer<Char>::map_next() -> void {
+        assert(fd != -1);
+
+        auto page = detail::file_mapping::page_size();
+        auto offset = file_end - file_end % page;
+        auto end = offset + chunk_size;
+
+        mapping.unmap();
+
+        // Make sure the file covers the whole mapping.
+#if defined(__linux__) || defined(__FreeBSD__)
+        if (auto err = ::posix_fallocate(fd, static_cast<off_t>(file_end),
+                                         static_cast<off_t>(end - file_end)))
+            throw std::system_error(err, std::system_category(),
+                                    "posix_fallocate");
+#else
+        if (detail::file_size(fd) < end &&
+            ::ftruncate(fd, static_cast<off_t>(end)) == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "ftruncate");
+#endif
+
+        mapping = detail::file_mapping(fd, offset, chunk_size,
+                                       PROT_READ | PROT_WRITE);
+        mapping.advise(0, mapping.size, MADV_SEQUENTIAL);
+        map_offset = offset;
+    }
+
+    /*
+     * mmap_writable_buffer::finish()
+     */
+    template <typename Char>
+    auto mmap_writable_buffer<Char>::finish(std::error_code &ec) noexcept
+        -> void {
+        ec.clear();
+
+        if (fd == -1)
+            return;
+
+        mapping.unmap();
+
+        if (::ftruncate(fd, static_cast<off_t>(file_end)) == -1)
+            ec.assign(errno, std::system_category());
+
+        fd = -1;
+    }
+
+} // namespace sk
+
+#endif // SK_BUFFER_MMAP_BUFFER_HXX_INCLUDED
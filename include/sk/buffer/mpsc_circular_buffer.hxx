@@ -0,0 +1,505 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SK_BUFFER_MPSC_CIRCULAR_BUFFER_HXX_INCLUDED
+#define SK_BUFFER_MPSC_CIRCULAR_BUFFER_HXX_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <ranges>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "sk/buffer/buffer.hxx"
+#include "sk/buffer/spsc_circular_buffer.hxx"
+
+namespace sk {
+
+    /*************************************************************************
+     *
+     * mpsc_circular_buffer: a fixed-size circular buffer which can be
+     * written to by any number of threads and read from by one thread at
+     * the same time, without locking.
+     *
+     * A producer reserves space for a whole record with reserve(), which
+     * claims it with an atomic compare-and-swap on the reserve index, fills
+     * in the reservation's ranges, and publishes it with commit().  write()
+     * does all three with a copy.  A record is either reserved in full or
+     * not at all, so records from different producers never interleave.
+     *
+     * The consumer uses the ordinary readable_buffer interface:
+     * readable_ranges(), discard() and read().  It only sees data up to the
+     * commit index, which advances in reservation order: a producer whose
+     * reservation was made after another's waits in commit() until the
+     * earlier one has been published.  The consumer therefore never sees a
+     * partly written record, but one slow producer holds up publication
+     * (not reservation) for the producers behind it, so the time between
+     * reserve() and commit() should be short.
+     *
+     * A reservation which is destroyed without being committed is
+     * published as skipped space, so it doesn't stall the buffer: the
+     * consumer steps over it and never sees its contents.  The producer
+     * which abandons it records the skip in a small queue; if more than
+     * max_skipped reservations are abandoned before the consumer reaches
+     * them, it waits for the consumer to catch up, as commit() does.
+     *
+     * Like spsc_circular_buffer, there is no reserved slot, so the buffer
+     * can hold exactly buffer_size objects.  clear() is not thread-safe, and
+     * may only be called when no thread is using the buffer.
+     */
+
+    template <typename Char, std::size_t buffer_size = 65536>
+    struct mpsc_circular_buffer {
+        static_assert(buffer_size > 0);
+
+        using array_type = std::array<Char, buffer_size>;
+        using size_type = std::size_t;
+        using value_type = Char;
+        using const_value_type = std::add_const_t<Char>;
+
+        // When the data wraps around the end of the buffer, the readable or
+        // writable space is split into two ranges.
+        using readable_range_list =
+            static_range_list<std::span<const_value_type>, 2>;
+        using writable_range_list = static_range_list<std::span<value_type>, 2>;
+
+      private:
+        // The indices are 64 bits wide, as in spsc_circular_buffer, so they
+        // never wrap in practice.
+        using index_type = std::uint64_t;
+
+      public:
+        // Space reserved by a producer.  The reservation is published when
+        // commit() is called or it is destroyed.
+        struct reservation {
+            // An empty reservation, which converts to false.
+            reservation() = default;
+
+            reservation(reservation const &) = delete;
+            reservation &operator=(reservation const &) = delete;
+
+            reservation(reservation &&other) noexcept
+                : buf(std::exchange(other.buf, nullptr)), start(other.start),
+                  n(other.n) {}
+
+            reservation &operator=(reservation &&other) noexcept {
+                if (this != &other) {
+                    abandon();
+                    buf = std::exchange(other.buf, nullptr);
+                    start = other.start;
+                    n = other.n;
+                }
+                return *this;
+            }
+
+            ~reservation() {
+                abandon();
+            }
+
+            // Return true if this reservation holds space.
+            explicit operator bool() const {
+                return buf != nullptr;
+            }
+
+            // Return the number of objects reserved.
+            auto size() const -> size_type {
+                return buf ? n : 0;
+            }
+
+            // Return the reserved space, which should be filled in before
+            // calling commit().
+            auto ranges() const -> writable_range_list {
+                if (!buf)
+                    return {};
+                return buf->template ranges_at<std::span<value_type>>(start,
+                                                                      n);
+            }
+
+            // Publish the reserved space to the consumer, waiting for any
+            // earlier reservations to be published first.
+            auto commit() -> void {
+                if (auto *b = std::exchange(buf, nullptr))
+                    b->publish(start, n, false);
+            }
+
+          private:
+            friend struct mpsc_circular_buffer;
+
+            reservation(mpsc_circular_buffer *buf_, index_type start_,
+                        size_type n_)
+                : buf(buf_), start(start_), n(n_) {}
+
+            auto abandon() noexcept -> void {
+                if (auto *b = std::exchange(buf, nullptr))
+                    b->publish(start, n, true);
+            }
+
+            mpsc_circular_buffer *buf = nullptr;
+            index_type start = 0;
+            size_type n = 0;
+        };
+
+        // Create a new, empty buffer.
+        mpsc_circular_buffer() = default;
+
+        // mpsc_circular_buffer is shared between threads, so it can't be
+        // copied or moved.
+        mpsc_circular_buffer(mpsc_circular_buffer const &) = delete;
+        mpsc_circular_buffer &operator=(mpsc_circular_buffer const &) = delete;
+        mpsc_circular_buffer(mpsc_circular_buffer &&) = delete;
+        mpsc_circular_buffer &operator=(mpsc_circular_buffer &&) = delete;
+
+        // Reset the buffer.
+        auto clear() -> void {
+            reserve_index.store(0, std::memory_order_relaxed);
+            commit_index.store(0, std::memory_order_relaxed);
+            read_index.store(0, std::memory_order_relaxed);
+            cached_commit_index = 0;
+            skip_head.store(0, std::memory_order_relaxed);
+            skip_tail.store(0, std::memory_order_relaxed);
+        }
+
+        /*
+         * Producer interface.  Any thread may call these.
+         */
+
+        // Reserve space for n objects.  Returns an empty reservation if n is
+        // 0 or there isn't room for all of them.
+        auto reserve(size_type n) -> reservation;
+
+        // Write all of the data to the buffer and publish it.  Returns the
+        // size of the range, or 0 if there isn't room for all of it.
+        template <std::ranges::contiguous_range Range>
+        auto write(Range &&) -> size_type requires std::same_as<
+            const_value_type,
+            std::add_const_t<std::ranges::range_value_t<Range>>>;
+
+        /*
+         * Consumer interface.  Only one thread may call these.
+         */
+
+        // Read data from the buffer.  As much data will be read as possible,
+        // and the number of objects read will be returned.
+        template <std::ranges::contiguous_range Range>
+        auto read(Range &&) -> size_type
+            requires std::same_as<value_type,
+                                  std::ranges::range_value_t<Range>>;
+
+        // Return a list of ranges which represent published data in the
+        // buffer.  Writing data to the buffer will not invalidate the ranges.
+        //
+        // After reading the data, discard() should be called to return the
+        // space to the producers.
+        auto readable_ranges() -> readable_range_list;
+
+        // Discard up to n objects of readable data from the start of the
+        // buffer.  Returns the number of objects discarded.
+        auto discard(size_type n) -> size_type;
+
+        /*
+         * Any thread may call size() and empty(), but if another thread is
+         * using the buffer, the result may be out of date by the time it is
+         * returned.
+         */
+
+        // Return the number of published objects which can be read.  This
+        // includes abandoned space the consumer hasn't stepped over yet.
+        auto size() const -> size_type {
+            // Load the read index first, so it can't be ahead of the commit
+            // index.
+            auto r = read_index.load(std::memory_order_acquire);
+            auto c = commit_index.load(std::memory_order_acquire);
+            return static_cast<size_type>(c - r);
+        }
+
+        // Return the number of objects the buffer can hold.
+        auto capacity() const -> size_type {
+            return buffer_size;
+        }
+
+        // Return true if there is no published data to read.
+        auto empty() const -> bool {
+            return size() == 0;
+        }
+
+      private:
+        // The number of abandoned reservations which can be waiting for the
+        // consumer to step over them.
+        static constexpr std::size_t max_skipped = 32;
+
+        // Wait until everything before `start` has been published, then
+        // publish the n objects after it, as data or as skipped space.
+        auto publish(index_type start, size_type n, bool skip) -> void;
+
+        // Return the data the consumer can see, reloading the commit index
+        // if there's less than `wanted`.
+        auto consumer_data(size_type wanted) -> size_type;
+
+        // Split `n` objects starting at index `i` into at most two ranges.
+        template <typename Span>
+        auto ranges_at(index_type i, size_type n)
+            -> static_range_list<Span, 2>;
+
+        /*
+         * The indices are free-running counts of objects, as in
+         * spsc_circular_buffer.  reserve_index <= buffer_size + read_index
+         * and read_index <= commit_index <= reserve_index always hold.
+         */
+
+        // Producer data: space up to the reserve index has been claimed,
+        // and space up to the commit index has been published.
+        alignas(detail::cache_line_size)
+            std::atomic<index_type> reserve_index{0};
+        alignas(detail::cache_line_size)
+            std::atomic<index_type> commit_index{0};
+
+        // Consumer data: the read index, the consumer's copy of the commit
+        // index, and the number of skipped ranges it has stepped over.
+        alignas(detail::cache_line_size) std::atomic<index_type> read_index{0};
+        index_type cached_commit_index = 0;
+        std::atomic<std::size_t> skip_tail{0};
+
+        // Abandoned reservations, in reservation order.  Only the producer
+        // which is publishing adds to the queue, before it moves the commit
+        // index past the skipped range.  This is kept apart from the
+        // producer data because it rarely changes.
+        struct skipped_range {
+            index_type start;
+            size_type n;
+        };
+
+        alignas(detail::cache_line_size) std::atomic<std::size_t> skip_head{0};
+        std::array<skipped_range, max_skipped> skipped{};
+
+        // The data stored in this buffer.
+        alignas(detail::cache_line_size) array_type data;
+    };
+
+    static_assert(readable_buffer<mpsc_circular_buffer<char>>);
+    static_assert(sized_buffer<mpsc_circular_buffer<char>>);
+
+    /*
+     * mpsc_circular_buffer::ranges_at()
+     */
+    template <typename Char, std::size_t buffer_size>
+    template <typename Span>
+    auto mpsc_circular_buffer<Char, buffer_size>::ranges_at(index_type i,
+                                                            size_type n)
+        -> static_range_list<Span, 2> {
+        static_range_list<Span, 2> ret;
+
+        auto start = static_cast<size_type>(i % buffer_size);
+        auto first = std::min(n, buffer_size - start);
+
+        if (first > 0)
+            ret.push_back(Span(data.data() + start, first));
+        if (n > first)
+            ret.push_back(Span(data.data(), n - first));
+
+        return ret;
+    }
+
+    /*
+     * mpsc_circular_buffer::reserve()
+     */
+    template <typename Char, std::size_t buffer_size>
+    auto mpsc_circular_buffer<Char, buffer_size>::reserve(size_type n)
+        -> reservation {
+        if (n == 0 || n > buffer_size)
+            return {};
+
+        // The acquire load of the read index makes sure the consumer has
+        // finished with the space before we write to it.
+        auto w = reserve_index.load(std::memory_order_relaxed);
+        do {
+            auto r = read_index.load(std::memory_order_acquire);
+            if (buffer_size - (w - r) < n)
+                return {};
+        } while (!reserve_index.compare_exchange_weak(
+            w, w + n, std::memory_order_relaxed));
+
+        return reservation(this, w, n);
+    }
+
+    /*
+     * mpsc_circular_buffer::publish()
+     */
+    template <typename Char, std::size_t buffer_size>
+    auto mpsc_circular_buffer<Char, buffer_size>::publish(index_type start,
+                                                          size_type n,
+                                                          bool skip)
+        -> void {
+        // Spin briefly, since the earlier producer is usually just finishing
+        // its copy, then yield in case it has been descheduled.
+        for (unsigned spins = 0;
+             commit_index.load(std::memory_order_acquire) != start; ++spins)
+            if (spins >= 64)
+                std::this_thread::yield();
+
+        // Queue abandoned space before publishing it, so the consumer knows
+        // to skip it by the time it can see it.  Only one producer publishes
+        // at a time, so only one adds to the queue at a time.
+        if (skip) {
+            auto head = skip_head.load(std::memory_order_relaxed);
+            for (unsigned spins = 0;
+                 head - skip_tail.load(std::memory_order_acquire) ==
+                 max_skipped;
+                 ++spins)
+                if (spins >= 64)
+                    std::this_thread::yield();
+
+            skipped[head % max_skipped] = {start, n};
+            skip_head.store(head + 1, std::memory_order_release);
+        }
+
+        // Acquiring the previous commit and releasing ours makes the earlier
+        // producers' data visible to the consumer along with ours.
+        commit_index.store(start + n, std::memory_order_release);
+    }
+
+    /*
+     * mpsc_circular_buffer::write()
+     */
+    template <typename Char, std::size_t buffer_size>
+    template <std::ranges::contiguous_range InRange>
+    auto mpsc_circular_buffer<Char, buffer_size>::write(InRange &&buf)
+        -> size_type requires std::same_as<
+            const_value_type,
+            std::add_const_t<std::ranges::range_value_t<InRange>>> {
+
+        std::span<const_value_type> data_left{buf};
+        auto res = reserve(data_left.size());
+        if (!res)
+            return 0;
+
+        for (auto &&range : res.ranges()) {
+            copy_objects(range.data(), data_left.data(), range.size());
+            data_left = data_left.subspan(range.size());
+        }
+
+        auto n = res.size();
+        res.commit();
+        return n;
+    }
+
+    /*
+     * mpsc_circular_buffer::consumer_data()
+     */
+    template <typename Char, std::size_t buffer_size>
+    auto mpsc_circular_buffer<Char, buffer_size>::consumer_data(
+        size_type wanted) -> size_type {
+        auto r = read_index.load(std::memory_order_relaxed);
+        auto avail = static_cast<size_type>(cached_commit_index - r);
+
+        if (avail < wanted) {
+            cached_commit_index = commit_index.load(std::memory_order_acquire);
+            avail = static_cast<size_type>(cached_commit_index - r);
+        }
+
+        // Step over abandoned space at the read index, and stop before any
+        // further on.  A skipped range is queued before the commit index
+        // moves past it, so every one the consumer can see is in the queue.
+        for (;;) {
+            auto tail = skip_tail.load(std::memory_order_relaxed);
+            if (tail == skip_head.load(std::memory_order_acquire))
+                break;
+
+            auto next = skipped[tail % max_skipped];
+            if (next.start >= cached_commit_index)
+                break;
+
+            if (next.start != r) {
+                avail = std::min(avail, static_cast<size_type>(next.start - r));
+                break;
+            }
+
+            r += next.n;
+            read_index.store(r, std::memory_order_release);
+            skip_tail.store(tail + 1, std::memory_order_release);
+            avail = static_cast<size_type>(cached_commit_index - r);
+        }
+
+        assert(avail <= buffer_size);
+        return avail;
+    }
+
+    /*
+     * mpsc_circular_buffer::readable_ranges()
+     */
+    template <typename Char, std::size_t buffer_size>
+    auto mpsc_circular_buffer<Char, buffer_size>::readable_ranges()
+        -> readable_range_list {
+        auto avail = consumer_data(1);
+        return ranges_at<std::span<const_value_type>>(
+            read_index.load(std::memory_order_relaxed), avail);
+    }
+
+    /*
+     * mpsc_circular_buffer::discard()
+     */
+    template <typename Char, std::size_t buffer_size>
+    auto mpsc_circular_buffer<Char, buffer_size>::discard(size_type n)
+        -> size_type {
+        auto can_discard = std::min(n, consumer_data(n));
+        auto r = read_index.load(std::memory_order_relaxed);
+        read_index.store(r + can_discard, std::memory_order_release);
+        return can_discard;
+    }
+
+    /*
+     * mpsc_circular_buffer::read()
+     */
+    template <typename Char, std::size_t buffer_size>
+    template <std::ranges::contiguous_range InRange>
+    auto mpsc_circular_buffer<Char, buffer_size>::read(InRange &&buf)
+        -> size_type
+        requires std::same_as<value_type, std::ranges::range_value_t<InRange>> {
+
+        std::span<value_type> data_left{buf};
+        auto can_read =
+            std::min(data_left.size(), consumer_data(data_left.size()));
+
+        auto ranges = ranges_at<std::span<const_value_type>>(
+            read_index.load(std::memory_order_relaxed), can_read);
+
+        for (auto &&range : ranges) {
+            copy_objects(data_left.data(), range.data(), range.size());
+            data_left = data_left.subspan(range.size());
+        }
+
+        return discard(can_read);
+    }
+
+} // namespace sk
+
+#endif // SK_BUFFER_MPSC_CIRCULAR_BUFFER_HXX_INCLUDED
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Copying objects into and out of buffers.
+ */
+
+#ifndef SK_BUFFER_OBJECT_COPY_HXX_INCLUDED
+#define SK_BUFFER_OBJECT_COPY_HXX_INCLUDED
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__AVX__)
+#    include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) ||                                 \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#endif
+
+namespace sk {
+
+    /*************************************************************************
+     *
+     * copy_objects(dst, src, n): copy n objects from src to dst, which must
+     * not overlap.  Trivially copyable objects are copied with memcpy();
+     * other types are copied by assignment.
+     *
+     * The buffers use this for write() and read() instead of
+     * std::ranges::copy, which some compilers don't turn into memcpy().
+     */
+
+    template <typename T>
+    auto copy_objects(T *dst, T const *src, std::size_t n) -> void {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            if (n > 0)
+                std::memcpy(dst, src, n * sizeof(T));
+        } else {
+            std::copy_n(src, n, dst);
+        }
+    }
+
+    /*************************************************************************
+     *
+     * copy_objects_nontemporal(dst, src, n): like copy_objects(), but for
+     * trivially copyable objects, use non-temporal stores which bypass the
+     * cache where the target supports them.  This avoids evicting other data
+     * from the cache when copying a large amount of data that won't be read
+     * again soon, for example a file being written to disk.  For data that
+     * will be read soon, use copy_objects(), which is faster.
+     *
+     * Copies smaller than nontemporal_copy_threshold bytes always use
+     * copy_objects().
+     */
+
+    inline constexpr std::size_t nontemporal_copy_threshold = 64 * 1024;
+
+    namespace detail {
+
+        inline auto copy_bytes_nontemporal(std::byte *dst,
+                                           std::byte const *src,
+                                           std::size_t n) -> void {
+#if defined(__AVX__)
+            constexpr std::size_t block = 32;
+#elif defined(__SSE2__) || defined(_M_X64) ||                                 \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+            constexpr std::size_t block = 16;
+#else
+            constexpr std::size_t block = 0;
+#endif
+
+            if constexpr (block == 0) {
+                std::memcpy(dst, src, n);
+            } else {
+                // Copy up to the first aligned block normally.
+                auto misalign =
+                    reinterpret_cast<std::uintptr_t>(dst) & (block - 1);
+                if (misalign) {
+                    auto head = std::min(block - misalign, n);
+                    std::memcpy(dst, src, head);
+                    dst += head;
+                    src += head;
+                    n -= head;
+                }
+
+                // Stream the aligned blocks.
+                for (; n >= block; n -= block, dst += block, src += block) {
+#if defined(__AVX__)
+                    auto v = _mm256_loadu_si256(
+                        reinterpret_cast<__m256i const *>(src));
+                    _mm256_stream_si256(reinterpret_cast<__m256i *>(dst), v);
+#elif defined(__SSE2__) || defined(_M_X64) ||                                 \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+                    auto v = _mm_loadu_si128(
+                        reinterpret_cast<__m128i const *>(src));
+                    _mm_stream_si128(reinterpret_cast<__m128i *>(dst), v);
+#endif
+                }
+
+                // Non-temporal stores are weakly ordered; make them visible
+                // before any later stores, such as a commit() that another
+                // thread reads.
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) ||               \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+                _mm_sfence();
+#endif
+
+                // Copy the remaining tail normally.
+                if (n > 0)
+                    std::memcpy(dst, src, n);
+            }
+        }
+
+    } // namespace detail
+
+    template <typename T>
+    auto copy_objects_nontemporal(T *dst, T const *src, std::size_t n)
+        -> void {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            if (n * sizeof(T) >= nontemporal_copy_threshold) {
+                detail::copy_bytes_nontemporal(
+                    reinterpret_cast<std::byte *>(dst),
+                    reinterpret_cast<std::byte const *>(src), n * sizeof(T));
+                return;
+            }
+        }
+
+        copy_objects(dst, src, n);
+    }
+
+} // namespace sk
+
+#endif // SK_BUFFER_OBJECT_COPY_HXX_INCLUDED
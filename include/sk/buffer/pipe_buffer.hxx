@@ -0,0 +1,624 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * A buffer whose data is held in a kernel pipe, for forwarding data between
+ * file descriptors with splice() and tee().
+ */
+
+#ifndef SK_BUFFER_PIPE_BUFFER_HXX_INCLUDED
+#define SK_BUFFER_PIPE_BUFFER_HXX_INCLUDED
+
+#if !defined(__linux__)
+#    error "sk/buffer/pipe_buffer.hxx requires Linux"
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <limits>
+#include <ranges>
+#include <span>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "sk/buffer/buffer.hxx"
+#include "sk/buffer/buffer_io.hxx"
+#include "sk/buffer/dynamic_buffer.hxx"
+
+namespace sk {
+
+    /*************************************************************************
+     *
+     * pipe_buffer: a buffer of bytes which keeps its data in a kernel pipe.
+     * splice_from(fd) moves data from a file or socket into the pipe, and
+     * splice_to(fd) moves it out to another descriptor, so a proxy or a
+     * file server can forward data without it being copied into user space.
+     * tee_to(other) copies the data into another pipe_buffer without
+     * consuming it.
+     *
+     * pipe_buffer is also an ordinary buffer.  Data written with write() or
+     * writable_ranges() and commit() is kept in user space, and
+     * readable_ranges() materialises the data which is in the pipe by
+     * reading it into user space, so code which looks at the data still
+     * works; only the data it looks at loses the zero-copy path.  The data
+     * always stays in the order it was added, wherever it is held.
+     *
+     * Both ends of the pipe are non-blocking.  If the pipe is full,
+     * splice_from() fails with std::errc::operation_would_block or
+     * resource_unavailable_try_again; whether the other descriptor blocks
+     * depends on its own flags.  If a descriptor doesn't support splice(),
+     * the error is std::errc::invalid_argument, and the caller can fall back
+     * to buffer_read_from() or buffer_write_to(), which work on any buffer.
+     */
+
+    template <typename Char = char, std::size_t extent_bytes = 4096>
+    struct pipe_buffer {
+        static_assert(sizeof(Char) == 1 && std::is_trivially_copyable_v<Char>,
+                      "pipe_buffer holds data from the kernel, so it must be "
+                      "a buffer of bytes");
+
+        using size_type = std::size_t;
+        using value_type = Char;
+        using const_value_type = std::add_const_t<Char>;
+        using staging_buffer_type = dynamic_buffer<Char, extent_bytes>;
+        using readable_range_list =
+            typename staging_buffer_type::readable_range_list;
+        using writable_range_list =
+            typename staging_buffer_type::writable_range_list;
+
+        // Create an empty buffer.  If pipe_capacity is not 0, the pipe is
+        // resized to hold at least that many bytes; unprivileged processes
+        // are limited to /proc/sys/fs/pipe-max-size.  Throws
+        // std::system_error if the pipe can't be created or resized.
+        explicit pipe_buffer(size_type pipe_capacity = 0);
+
+        // pipe_buffer is not copyable, but can be moved.
+        pipe_buffer(pipe_buffer const &) = delete;
+        pipe_buffer &operator=(pipe_buffer const &) = delete;
+
+        pipe_buffer(pipe_buffer &&other) noexcept
+            : fds{std::exchange(other.fds[0], -1),
+                  std::exchange(other.fds[1], -1)},
+              pipe_limit(other.pipe_limit),
+              piped(std::exchange(other.piped, 0)),
+              head(std::move(other.head)), tail(std::move(other.tail)) {}
+
+        pipe_buffer &operator=(pipe_buffer &&other) {
+            if (this != &other) {
+                close();
+                fds[0] = std::exchange(other.fds[0], -1);
+                fds[1] = std::exchange(other.fds[1], -1);
+                pipe_limit = other.pipe_limit;
+                piped = std::exchange(other.piped, 0);
+                head = std::move(other.head);
+                tail = std::move(other.tail);
+            }
+            return *this;
+        }
+
+        ~pipe_buffer() {
+            close();
+        }
+
+        // Read data from the buffer.  Data in the pipe is read directly
+        // into buf.  Returns the number of objects read.
+        template <std::ranges::contiguous_range Range>
+        auto read(Range &&buf) -> size_type
+            requires std::same_as<value_type,
+                                  std::ranges::range_value_t<Range>>;
+
+        // Return the data in the buffer as a list of ranges.  Any data in
+        // the pipe is first read into user space.
+        auto readable_ranges() -> readable_range_list;
+
+        // Discard up to n objects from the start of the buffer.
+        auto discard(size_type n) -> size_type;
+
+        // Write data to the buffer.  The data is copied into user space;
+        // use splice_from() to add data without copying it.
+        template <std::ranges::contiguous_range Range>
+        auto write(Range &&buf) -> size_type requires std::same_as<
+            const_value_type,
+            std::add_const_t<std::ranges::range_value_t<Range>>> {
+            return write_target().write(std::forward<Range>(buf));
+        }
+
+        // Return space in user space which can be written to.
+        auto writable_ranges() -> writable_range_list {
+            return write_target().writable_ranges();
+        }
+
+        // Mark n objects of space as containing data.
+        auto commit(size_type n) -> size_type {
+            return write_target().commit(n);
+        }
+
+        // Return the number of objects which can be read, including the
+        // data in the pipe.
+        auto size() const -> size_type {
+            return head.size() + piped + tail.size();
+        }
+
+        // Return the number of objects the buffer can hold without
+        // allocating more memory, i.e. the capacity of the user-space
+        // storage plus the data in the pipe.
+        auto capacity() const -> size_type {
+            return head.capacity() + piped + tail.capacity();
+        }
+
+        auto empty() const -> bool {
+            return size() == 0;
+        }
+
+        // Discard all the data in the buffer.
+        auto clear() -> void;
+
+        // Move up to n bytes from fd into the pipe without copying them
+        // into user space.  Returns the number of bytes moved, or 0 at end
+        // of file.
+        auto splice_from(io_handle_type fd, size_type n, std::error_code &ec)
+            -> size_type;
+
+        auto splice_from(io_handle_type fd,
+                         size_type n = std::numeric_limits<size_type>::max())
+            -> size_type {
+            std::error_code ec;
+            auto r = splice_from(fd, n, ec);
+            if (ec)
+                throw std::system_error(ec, "pipe_buffer::splice_from");
+            return r;
+        }
+
+        // Move up to n bytes from the start of the buffer to fd, then
+        // discard them.  Data in the pipe is spliced; data in user space is
+        // written.  Returns the number of bytes moved.
+        auto splice_to(io_handle_type fd, size_type n, std::error_code &ec)
+            -> size_type;
+
+        auto splice_to(io_handle_type fd,
+                       size_type n = std::numeric_limits<size_type>::max())
+            -> size_type {
+            std::error_code ec;
+            auto r = splice_to(fd, n, ec);
+            if (ec)
+                throw std::system_error(ec, "pipe_buffer::splice_to");
+            return r;
+        }
+
+        // Copy up to n bytes from the start of the buffer to the end of
+        // other without consuming them.  Data in the pipe is duplicated with
+        // tee(), which shares the pages rather than copying them.  Returns
+        // the number of bytes copied; data written to this buffer while its
+        // pipe is not empty can't be copied until it has reached the pipe.
+        auto tee_to(pipe_buffer &other, size_type n, std::error_code &ec)
+            -> size_type;
+
+        auto tee_to(pipe_buffer &other,
+                    size_type n = std::numeric_limits<size_type>::max())
+            -> size_type {
+            std::error_code ec;
+            auto r = tee_to(other, n, ec);
+            if (ec)
+                throw std::system_error(ec, "pipe_buffer::tee_to");
+            return r;
+        }
+
+        // Return the number of bytes currently held in the pipe.
+        auto pipe_size() const -> size_type {
+            return piped;
+        }
+
+        // Return the number of bytes the pipe can hold.
+        auto pipe_capacity() const -> size_type {
+            return pipe_limit;
+        }
+
+      private:
+        // The buffer's data is the data in head, followed by the data in
+        // the pipe, followed by the data in tail.  Data written while the
+        // pipe is empty goes to head; otherwise it has to go after the
+        // pipe's data, in tail.  tail is moved into the pipe when more data
+        // is spliced in, or to head once the pipe is empty, so tail is
+        // always empty when the pipe is.
+        auto write_target() -> staging_buffer_type & {
+            return piped == 0 ? head : tail;
+        }
+
+        // Restore the invariant after data was removed from the pipe.
+        auto pipe_drained() -> void;
+
+        // Read up to buf.size() bytes of data from the pipe into buf.
+        auto read_pipe(std::span<value_type> buf) -> size_type;
+
+        // Write tail into the pipe, as far as it fits.
+        auto flush_tail(std::error_code &ec) -> void;
+
+        // Write up to n bytes from the start of head to fd, without
+        // discarding them.
+        auto write_head(io_handle_type fd, size_type n, std::error_code &ec)
+            -> size_type;
+
+        auto close() noexcept -> void {
+            for (auto &fd : fds) {
+                if (fd != -1)
+                    ::close(fd);
+                fd = -1;
+            }
+        }
+
+        // The read and write ends of the pipe.
+        int fds[2] = {-1, -1};
+
+        // The capacity of the pipe.
+        size_type pipe_limit = 0;
+
+        // The number of bytes in the pipe.  We own both ends, so this is
+        // exact.
+        size_type piped = 0;
+
+        staging_buffer_type head;
+        staging_buffer_type tail;
+    };
+
+    static_assert(buffer<pipe_buffer<char>>);
+    static_assert(sized_buffer<pipe_buffer<char>>);
+
+    /*
+     * pipe_buffer::pipe_buffer()
+     */
+    template <typename Char, std::size_t extent_bytes>
+    pipe_buffer<Char, extent_bytes>::pipe_buffer(size_type pipe_capacity) {
+        if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) == -1)
+            throw std::system_error(errno, std::system_category(), "pipe2");
+
+        if (pipe_capacity > 0) {
+            auto want = std::min<size_type>(pipe_capacity,
+                                            std::numeric_limits<int>::max());
+            if (::fcntl(fds[1], F_SETPIPE_SZ, static_cast<int>(want)) == -1) {
+                auto error = errno;
+                close();
+                throw std::system_error(error, std::system_category(),
+                                        "F_SETPIPE_SZ");
+            }
+        }
+
+        auto limit = ::fcntl(fds[1], F_GETPIPE_SZ);
+        if (limit == -1) {
+            auto error = errno;
+            close();
+            throw std::system_error(error, std::system_category(),
+                                    "F_GETPIPE_SZ");
+        }
+        pipe_limit = static_cast<size_type>(limit);
+    }
+
+    /*
+     * pipe_buffer::pipe_drained()
+     */
+    template <typename Char, std::size_t extent_bytes>
+    auto pipe_buffer<Char, extent_bytes>::pipe_drained() -> void {
+        if (piped > 0 || tail.empty())
+            return;
+
+        // If head is empty, tail's extents can be taken over as they are.
+        if (head.empty()) {
+            head = std::move(tail);
+            return;
+        }
+
+        for (auto &&range : tail.readable_ranges())
+            head.write(range);
+        tail.clear();
+    }
+
+    /*
+     * pipe_buffer::read_pipe()
+     */
+    template <typename Char, std::size_t extent_bytes>
+    auto pipe_buffer<Char, extent_bytes>::read_pipe(std::span<value_type> buf)
+        -> size_type {
+        auto want = std::min(buf.size(), piped);
+        if (want == 0)
+            return 0;
+
+        ssize_t n;
+        do {
+            n = ::read(fds[0], buf.data(), want);
+        } while (n == -1 && errno == EINTR);
+
+        // The pipe is known to contain at least `want` bytes, so this can
+        // only fail if the buffer has been moved from.
+        if (n == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "pipe_buffer: read");
+
+        piped -= static_cast<size_type>(n);
+        return static_cast<size_type>(n);
+    }
+
+    /*
+     * pipe_buffer::read()
+     */
+    template <typename Char, std::size_t extent_bytes>
+    template <std::ranges::contiguous_range Range>
+    auto pipe_buffer<Char, extent_bytes>::read(Range &&data) -> size_type
+        requires std::same_as<value_type, std::ranges::range_value_t<Range>> {
+        std::span<value_type> buf = data;
+
+        auto n = head.read(buf);
+        if (n < buf.size() && piped > 0) {
+            n += read_pipe(buf.subspan(n));
+            pipe_drained();
+        }
+
+        // If the pipe was emptied, the rest of the data is now in head.
+        if (n < buf.size())
+            n += head.read(buf.subspan(n));
+
+        return n;
+    }
+
+    /*
+     * pipe_buffer::readable_ranges()
+     */
+    template <typename Char, std::size_t extent_bytes>
+    auto pipe_buffer<Char, extent_bytes>::readable_ranges()
+        -> readable_range_list {
+        while (piped > 0) {
+            auto n = buffer_read_from(fds[0], head);
+            assert(n > 0);
+            piped -= n;
+        }
+
+        pipe_drained();
+        return head.readable_ranges();
+    }
+
+    /*
+     * pipe_buffer::discard()
+     */
+    template <typename Char, std::size_t extent_bytes>
+    auto pipe_buffer<Char, extent_bytes>::discard(size_type n) -> size_type {
+        auto discarded = head.discard(n);
+
+        if (discarded < n && piped > 0) {
+            value_type scratch[4096];
+
+            while (discarded < n && piped > 0)
+                discarded += read_pipe(std::span(scratch).first(
+                    std::min(n - discarded, sizeof(scratch))));
+
+            pipe_drained();
+        }
+
+        if (discarded < n)
+            discarded += head.discard(n - discarded);
+
+        return discarded;
+    }
+
+    /*
+     * pipe_buffer::clear()
+     */
+    template <typename Char, std::size_t extent_bytes>
+    auto pipe_buffer<Char, extent_bytes>::clear() -> void {
+        head.clear();
+        tail.clear();
+
+        value_type scratch[4096];
+        while (piped > 0)
+            read_pipe(scratch);
+    }
+
+    /*
+     * pipe_buffer::flush_tail()
+     */
+    template <typename Char, std::size_t extent_bytes>
+    auto pipe_buffer<Char, extent_bytes>::flush_tail(std::error_code &ec)
+        -> void {
+        ec.clear();
+
+        if (!tail.empty())
+            piped += buffer_write_to(fds[1], tail, ec);
+    }
+
+    /*
+     * pipe_buffer::write_head()
+     */
+    template <typename Char, std::size_t extent_bytes>
+    auto pipe_buffer<Char, extent_bytes>::write_head(io_handle_type fd,
+                                                     size_type n,
+                                                     std::error_code &ec)
+        -> size_type {
+        ec.clear();
+
+        io_vector_type vecs[io_max_ranges];
+        auto nvecs = detail::fill_io_vectors(head.readable_ranges(), vecs);
+
+        // Clip the vectors to n bytes.
+        std::size_t used = 0;
+        for (size_type total = 0; used < nvecs && total < n; ++used) {
+            vecs[used].iov_len = std::min(vecs[used].iov_len, n - total);
+            total += vecs[used].iov_len;
+        }
+
+        if (used == 0)
+            return 0;
+
+        ssize_t nbytes;
+        do {
+            nbytes = ::writev(fd, vecs, static_cast<int>(used));
+        } while (nbytes == -1 && errno == EINTR);
+
+        if (nbytes == -1) {
+            ec.assign(errno, std::system_category());
+            return 0;
+        }
+
+        return static_cast<size_type>(nbytes);
+    }
+
+    /*
+     * pipe_buffer::splice_from()
+     */
+    template <typename Char, std::size_t extent_bytes>
+    auto pipe_buffer<Char, extent_bytes>::splice_from(io_handle_type fd,
+                                                      size_type n,
+                                                      std::error_code &ec)
+        -> size_type {
+        // Data in tail must reach the pipe before anything spliced after it.
+        flush_tail(ec);
+        if (ec)
+            return 0;
+
+        if (!tail.empty()) {
+            ec = std::make_error_code(std::errc::operation_would_block);
+            return 0;
+        }
+
+        if (n == 0)
+            return 0;
+
+        // No more than the pipe's capacity can be moved at once, and files
+        // reject lengths which would overflow the file offset.
+        ssize_t nbytes;
+        do {
+            nbytes = ::splice(fd, nullptr, fds[1], nullptr,
+                              std::min(n, pipe_limit),
+                              SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        } while (nbytes == -1 && errno == EINTR);
+
+        if (nbytes == -1) {
+            ec.assign(errno, std::system_category());
+            return 0;
+        }
+
+        piped += static_cast<size_type>(nbytes);
+        return static_cast<size_type>(nbytes);
+    }
+
+    /*
+     * pipe_buffer::splice_to()
+     */
+    template <typename Char, std::size_t extent_bytes>
+    auto pipe_buffer<Char, extent_bytes>::splice_to(io_handle_type fd,
+                                                    size_type n,
+                                                    std::error_code &ec)
+        -> size_type {
+        ec.clear();
+
+        size_type moved = 0;
+
+        if (!head.empty()) {
+            auto want = std::min(n, head.size());
+            moved = head.discard(write_head(fd, want, ec));
+            if (ec || moved < want)
+                return moved;
+        }
+
+        if (moved == n || piped == 0)
+            return moved;
+
+        ssize_t nbytes;
+        do {
+            nbytes = ::splice(fds[0], nullptr, fd, nullptr,
+                              std::min(n - moved, piped),
+                              SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        } while (nbytes == -1 && errno == EINTR);
+
+        // If the user-space data was written, report the error next time.
+        if (nbytes == -1) {
+            if (moved == 0)
+                ec.assign(errno, std::system_category());
+            return moved;
+        }
+
+        piped -= static_cast<size_type>(nbytes);
+        pipe_drained();
+        return moved + static_cast<size_type>(nbytes);
+    }
+
+    /*
+     * pipe_buffer::tee_to()
+     */
+    template <typename Char, std::size_t extent_bytes>
+    auto pipe_buffer<Char, extent_bytes>::tee_to(pipe_buffer &other,
+                                                 size_type n,
+                                                 std::error_code &ec)
+        -> size_type {
+        assert(&other != this);
+
+        // Anything in other's tail must come before the copied data.
+        other.flush_tail(ec);
+        if (ec)
+            return 0;
+
+        if (!other.tail.empty()) {
+            ec = std::make_error_code(std::errc::operation_would_block);
+            return 0;
+        }
+
+        size_type copied = 0;
+
+        if (!head.empty()) {
+            auto want = std::min(n, head.size());
+            copied = write_head(other.fds[1], want, ec);
+            other.piped += copied;
+            if (ec || copied < want)
+                return copied;
+        }
+
+        if (copied == n || piped == 0)
+            return copied;
+
+        ssize_t nbytes;
+        do {
+            nbytes = ::tee(fds[0], other.fds[1], std::min(n - copied, piped),
+                           SPLICE_F_NONBLOCK);
+        } while (nbytes == -1 && errno == EINTR);
+
+        if (nbytes == -1) {
+            if (copied == 0)
+                ec.assign(errno, std::system_category());
+            return copied;
+        }
+
+        other.piped += static_cast<size_type>(nbytes);
+        return copied + static_cast<size_type>(nbytes);
+    }
+
+} // namespace sk
+
+#endif // SK_BUFFER_PIPE_BUFFER_HXX_INCLUDED
@@ -33,6 +33,16 @@
 #ifndef SK_BUFFER_PMR_BUFFER_HXX_INCLUDED
 #define SK_BUFFER_PMR_BUFFER_HXX_INCLUDED
 
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 #include "sk/buffer/buffer.hxx"
 
 namespace sk {
@@ -42,14 +52,48 @@ namespace sk {
      * pmr_buffer: buffer adapter for runtime polymorphism.  This allows a
      * buffer to be converted from compile-time polymorphism to runtime
      * polymorphism through type erasure.  Like any form of runtime
-     * polymorphism, overhead is incurred for virtual function calls.
+     * polymorphism, overhead is incurred for virtual function calls, and
+     * readable_ranges() and writable_ranges() return an std::vector since the
+     * wrapped buffer's range list type can't cross the virtual interface.
      *
      * A pmr_buffer still conforms to the buffer concept, so it can be passed
      * back to compile-time polymorphic users.  However, the only range type
      * supported for reading and writing the buffer is
      * std::span<value_type, std::dynamic_extent>.
+     *
+     * To avoid the std::vector, the batched interface fills a span of
+     * ranges supplied by the caller: fill_readable_ranges(out) and
+     * fill_writable_ranges(out) store up to out.size() non-empty ranges and
+     * return the number stored.  discard_and_fill_readable_ranges() and
+     * commit_and_fill_writable_ranges() combine a discard() or commit() with
+     * fetching the next ranges, so a typical I/O loop makes one virtual call
+     * per operation.  The base classes implement these in terms of the other
+     * functions; the adapters override them to call the wrapped buffer
+     * directly.
      */
 
+    namespace detail {
+
+        // Copy the non-empty ranges in a range list into out, stopping when
+        // out is full.  Returns the number of ranges stored.
+        template <typename RangeList, typename Span>
+        auto fill_ranges(RangeList &&ranges, std::span<Span> out)
+            -> std::size_t {
+            std::size_t n = 0;
+
+            for (auto &&range : ranges) {
+                if (n == out.size())
+                    break;
+
+                if (!std::ranges::empty(range))
+                    out[n++] = Span(range);
+            }
+
+            return n;
+        }
+
+    } // namespace detail
+
     /*
      * pmr_basic_buffer: basic types and virtual dtor for the pmr buffers.
      */
@@ -59,6 +103,13 @@ namespace sk {
         typedef std::size_t size_type;
         typedef Char value_type;
         typedef std::add_const_t<value_type> const_value_type;
+
+        // The result of a combined operation: the number of objects
+        // discarded or committed, and the number of ranges stored.
+        struct batch_result {
+            size_type count;
+            size_type nranges;
+        };
     };
 
     /*
@@ -75,6 +126,42 @@ namespace sk {
 
         virtual auto discard(typename pmr_basic_buffer<Char>::size_type) ->
             typename pmr_basic_buffer<Char>::size_type = 0;
+
+        // Return the number of objects that can be read.  By default, this
+        // is the total size of the readable ranges, as with buffer_size().
+        virtual auto size() const ->
+            typename pmr_basic_buffer<Char>::size_type {
+            // readable_ranges() isn't const, but doesn't change the data.
+            auto ranges =
+                const_cast<pmr_readable_buffer *>(this)->readable_ranges();
+            typename pmr_basic_buffer<Char>::size_type n = 0;
+            for (auto &&range : ranges)
+                n += range.size();
+            return n;
+        }
+
+        auto empty() const -> bool {
+            return size() == 0;
+        }
+
+        // Store up to out.size() of the non-empty readable ranges in out,
+        // and return the number stored.
+        virtual auto fill_readable_ranges(
+            std::span<std::span<
+                typename pmr_basic_buffer<Char>::const_value_type>> out) ->
+            typename pmr_basic_buffer<Char>::size_type {
+            return detail::fill_ranges(readable_ranges(), out);
+        }
+
+        // discard(n), then fill_readable_ranges(out).
+        virtual auto discard_and_fill_readable_ranges(
+            typename pmr_basic_buffer<Char>::size_type n,
+            std::span<std::span<
+                typename pmr_basic_buffer<Char>::const_value_type>> out) ->
+            typename pmr_basic_buffer<Char>::batch_result {
+            auto count = discard(n);
+            return {count, fill_readable_ranges(out)};
+        }
     };
 
     static_assert(readable_buffer_of<pmr_readable_buffer<char>, char>);
@@ -92,6 +179,35 @@ namespace sk {
 
         virtual auto commit(typename pmr_basic_buffer<Char>::size_type) ->
             typename pmr_basic_buffer<Char>::size_type = 0;
+
+        // Return the number of objects the buffer can hold.  By default,
+        // this is the total size of the writable ranges.
+        virtual auto capacity() const ->
+            typename pmr_basic_buffer<Char>::size_type {
+            auto ranges =
+                const_cast<pmr_writable_buffer *>(this)->writable_ranges();
+            typename pmr_basic_buffer<Char>::size_type n = 0;
+            for (auto &&range : ranges)
+                n += range.size();
+            return n;
+        }
+
+        // Store up to out.size() of the non-empty writable ranges in out,
+        // and return the number stored.
+        virtual auto fill_writable_ranges(
+            std::span<std::span<typename pmr_basic_buffer<Char>::value_type>>
+                out) -> typename pmr_basic_buffer<Char>::size_type {
+            return detail::fill_ranges(writable_ranges(), out);
+        }
+
+        // commit(n), then fill_writable_ranges(out).
+        virtual auto commit_and_fill_writable_ranges(
+            typename pmr_basic_buffer<Char>::size_type n,
+            std::span<std::span<typename pmr_basic_buffer<Char>::value_type>>
+                out) -> typename pmr_basic_buffer<Char>::batch_result {
+            auto count = commit(n);
+            return {count, fill_writable_ranges(out)};
+        }
     };
 
     static_assert(writable_buffer_of<pmr_writable_buffer<char>, char>);
@@ -100,7 +216,15 @@ namespace sk {
      * pmr_buffer: interface for pmr buffer<>.
      */
     template <typename Char>
-    struct pmr_buffer : pmr_readable_buffer<Char>, pmr_writable_buffer<Char> {};
+    struct pmr_buffer : pmr_readable_buffer<Char>, pmr_writable_buffer<Char> {
+        // By default, the capacity includes the data already in the buffer.
+        auto capacity() const ->
+            typename pmr_basic_buffer<Char>::size_type override {
+            return this->size() + pmr_writable_buffer<Char>::capacity();
+        }
+    };
+
+    static_assert(sized_buffer<pmr_buffer<char>>);
 
     /*************************************************************************
      *
@@ -129,7 +253,8 @@ namespace sk {
         auto readable_ranges()
             -> std::vector<std::span<typename pmr_readable_buffer<
                 buffer_value_t<Buffer>>::const_value_type>> final {
-            return buffer_base.readable_ranges();
+            auto ranges = buffer_base.readable_ranges();
+            return {std::ranges::begin(ranges), std::ranges::end(ranges)};
         }
 
         auto discard(
@@ -138,8 +263,54 @@ namespace sk {
             final {
             return buffer_base.discard(n);
         }
+
+        auto size() const ->
+            typename pmr_readable_buffer<buffer_value_t<Buffer>>::size_type
+            final {
+            return buffer_size(buffer_base);
+        }
+
+        auto fill_readable_ranges(
+            std::span<std::span<typename pmr_readable_buffer<
+                buffer_value_t<Buffer>>::const_value_type>> out) ->
+            typename pmr_readable_buffer<buffer_value_t<Buffer>>::size_type
+            final {
+            return detail::fill_ranges(buffer_base.readable_ranges(), out);
+        }
+
+        auto discard_and_fill_readable_ranges(
+            typename pmr_readable_buffer<buffer_value_t<Buffer>>::size_type n,
+            std::span<std::span<typename pmr_readable_buffer<
+                buffer_value_t<Buffer>>::const_value_type>> out) ->
+            typename pmr_readable_buffer<buffer_value_t<Buffer>>::batch_result
+            final {
+            auto count = buffer_base.discard(n);
+            return {count,
+                    detail::fill_ranges(buffer_base.readable_ranges(), out)};
+        }
     };
 
+    namespace detail {
+
+        // The capacity of a buffer, for pmr_writable_buffer::capacity().
+        template <writable_buffer Buffer>
+        auto pmr_capacity(Buffer &buf) -> std::size_t {
+            if constexpr (sized_buffer<Buffer>) {
+                return buf.capacity();
+            } else {
+                std::size_t n = 0;
+
+                if constexpr (readable_buffer<Buffer>)
+                    n = buffer_size(buf);
+
+                for (auto &&range : buf.writable_ranges())
+                    n += std::ranges::size(range);
+                return n;
+            }
+        }
+
+    } // namespace detail
+
     /*
      * PMR adapter for writable_buffer.
      */
@@ -161,7 +332,8 @@ namespace sk {
         auto writable_ranges()
             -> std::vector<std::span<typename pmr_writable_buffer<
                 buffer_value_t<Buffer>>::value_type>> final {
-            return buffer_base.writable_ranges();
+            auto ranges = buffer_base.writable_ranges();
+            return {std::ranges::begin(ranges), std::ranges::end(ranges)};
         }
 
         auto commit(
@@ -170,6 +342,31 @@ namespace sk {
             final {
             return buffer_base.commit(n);
         }
+
+        auto capacity() const ->
+            typename pmr_writable_buffer<buffer_value_t<Buffer>>::size_type
+            final {
+            return detail::pmr_capacity(buffer_base);
+        }
+
+        auto fill_writable_ranges(
+            std::span<std::span<typename pmr_writable_buffer<
+                buffer_value_t<Buffer>>::value_type>> out) ->
+            typename pmr_writable_buffer<buffer_value_t<Buffer>>::size_type
+            final {
+            return detail::fill_ranges(buffer_base.writable_ranges(), out);
+        }
+
+        auto commit_and_fill_writable_ranges(
+            typename pmr_writable_buffer<buffer_value_t<Buffer>>::size_type n,
+            std::span<std::span<typename pmr_writable_buffer<
+                buffer_value_t<Buffer>>::value_type>> out) ->
+            typename pmr_writable_buffer<buffer_value_t<Buffer>>::batch_result
+            final {
+            auto count = buffer_base.commit(n);
+            return {count,
+                    detail::fill_ranges(buffer_base.writable_ranges(), out)};
+        }
     };
 
     /*
@@ -208,6 +405,286 @@ namespace sk {
         return pmr_writable_buffer_adapter<Buffer>(buf);
     }
 
+    /*************************************************************************
+     *
+     * any_buffer: an owning, type-erased buffer.  Unlike pmr_buffer_adapter,
+     * any_buffer holds the wrapped buffer itself, so it can be returned from
+     * functions and stored in containers.  A buffer which fits in
+     * inline_size bytes and can be moved without throwing is stored inside
+     * the any_buffer; otherwise it is allocated on the heap.
+     *
+     * any_buffer conforms to the buffer concept, and get() returns the
+     * pmr_buffer interface of the wrapped buffer for callers that only know
+     * about pmr_buffer.  Each call is a single virtual call on the wrapped
+     * buffer.
+     */
+
+    namespace detail {
+
+        template <typename Char> struct any_buffer_holder : pmr_buffer<Char> {
+            // Move-construct this holder at `to`, and return the new holder.
+            virtual auto relocate(void *to) noexcept
+                -> any_buffer_holder * = 0;
+        };
+
+        template <buffer Buffer>
+        struct any_buffer_model final
+            : any_buffer_holder<buffer_value_t<Buffer>> {
+            using value_type = buffer_value_t<Buffer>;
+            using const_value_type = buffer_const_value_t<Buffer>;
+            using size_type = std::size_t;
+            using batch_result =
+                typename pmr_basic_buffer<value_type>::batch_result;
+
+            template <typename... Args>
+            explicit any_buffer_model(Args &&...args)
+                : buffer_base(std::forward<Args>(args)...) {}
+
+            auto relocate(void *to) noexcept
+                -> any_buffer_holder<value_type> * final {
+                if constexpr (std::is_nothrow_move_constructible_v<Buffer>) {
+                    return ::new (to) any_buffer_model(std::move(buffer_base));
+                } else {
+                    // Only called for buffers stored inline, which must be
+                    // nothrow movable.
+                    (void)to;
+                    std::terminate();
+                }
+            }
+
+            auto read(std::span<value_type> const &buf) -> size_type final {
+                return buffer_base.read(buf);
+            }
+
+            auto readable_ranges()
+                -> std::vector<std::span<const_value_type>> final {
+                auto ranges = buffer_base.readable_ranges();
+                return {std::ranges::begin(ranges), std::ranges::end(ranges)};
+            }
+
+            auto discard(size_type n) -> size_type final {
+                return buffer_base.discard(n);
+            }
+
+            auto size() const -> size_type final {
+                return buffer_size(buffer_base);
+            }
+
+            auto fill_readable_ranges(std::span<std::span<const_value_type>> out)
+                -> size_type final {
+                return fill_ranges(buffer_base.readable_ranges(), out);
+            }
+
+            auto discard_and_fill_readable_ranges(
+                size_type n, std::span<std::span<const_value_type>> out)
+                -> batch_result final {
+                auto count = buffer_base.discard(n);
+                return {count, fill_ranges(buffer_base.readable_ranges(), out)};
+            }
+
+            auto write(std::span<const_value_type> const &buf)
+                -> size_type final {
+                return buffer_base.write(buf);
+            }
+
+            auto writable_ranges()
+                -> std::vector<std::span<value_type>> final {
+                auto ranges = buffer_base.writable_ranges();
+                return {std::ranges::begin(ranges), std::ranges::end(ranges)};
+            }
+
+            auto commit(size_type n) -> size_type final {
+                return buffer_base.commit(n);
+            }
+
+            auto capacity() const -> size_type final {
+                return pmr_capacity(buffer_base);
+            }
+
+            auto fill_writable_ranges(std::span<std::span<value_type>> out)
+                -> size_type final {
+                return fill_ranges(buffer_base.writable_ranges(), out);
+            }
+
+            auto commit_and_fill_writable_ranges(
+                size_type n, std::span<std::span<value_type>> out)
+                -> batch_result final {
+                auto count = buffer_base.commit(n);
+                return {count, fill_ranges(buffer_base.writable_ranges(), out)};
+            }
+
+            // Mutable because the buffers' size() and capacity() may need
+            // to walk their (non-const) range lists.
+            mutable Buffer buffer_base;
+        };
+
+    } // namespace detail
+
+    template <typename Char, std::size_t inline_size = 256>
+    struct any_buffer {
+        using value_type = Char;
+        using const_value_type = std::add_const_t<value_type>;
+        using size_type = std::size_t;
+        using interface_type = pmr_buffer<value_type>;
+        using batch_result =
+            typename pmr_basic_buffer<value_type>::batch_result;
+
+        // Construct a Buffer from args inside the any_buffer.
+        template <buffer Buffer, typename... Args>
+            requires std::same_as<buffer_value_t<Buffer>, value_type>
+        explicit any_buffer(std::in_place_type_t<Buffer>, Args &&...args) {
+            using model_type = detail::any_buffer_model<Buffer>;
+
+            if constexpr (stores_inline<Buffer>())
+                impl = ::new (static_cast<void *>(storage))
+                    model_type(std::forward<Args>(args)...);
+            else
+                impl = new model_type(std::forward<Args>(args)...);
+        }
+
+        // Move an existing buffer into the any_buffer.
+        template <buffer Buffer>
+            requires(!std::same_as<std::remove_cvref_t<Buffer>, any_buffer> &&
+                     std::same_as<buffer_value_t<std::remove_cvref_t<Buffer>>,
+                                  value_type>)
+        any_buffer(Buffer &&buf)
+            : any_buffer(std::in_place_type<std::remove_cvref_t<Buffer>>,
+                         std::forward<Buffer>(buf)) {}
+
+        any_buffer(any_buffer const &) = delete;
+        any_buffer &operator=(any_buffer const &) = delete;
+
+        // A moved-from any_buffer is empty and can only be destroyed or
+        // assigned to.
+        any_buffer(any_buffer &&other) noexcept {
+            take(other);
+        }
+
+        any_buffer &operator=(any_buffer &&other) noexcept {
+            if (this != &other) {
+                reset();
+                take(other);
+            }
+            return *this;
+        }
+
+        ~any_buffer() {
+            reset();
+        }
+
+        // Return true if the any_buffer holds a buffer.
+        explicit operator bool() const {
+            return impl != nullptr;
+        }
+
+        // Return true if the buffer is stored inside the any_buffer rather
+        // than on the heap.
+        auto is_inline() const -> bool {
+            return impl == static_cast<void const *>(storage);
+        }
+
+        // Return the pmr_buffer interface of the wrapped buffer.
+        auto get() -> interface_type & {
+            assert(impl);
+            return *impl;
+        }
+
+        auto get() const -> interface_type const & {
+            assert(impl);
+            return *impl;
+        }
+
+        auto read(std::span<value_type> const &buf) -> size_type {
+            return get().read(buf);
+        }
+
+        auto readable_ranges() -> std::vector<std::span<const_value_type>> {
+            return get().readable_ranges();
+        }
+
+        auto discard(size_type n) -> size_type {
+            return get().discard(n);
+        }
+
+        auto size() const -> size_type {
+            return get().size();
+        }
+
+        auto empty() const -> bool {
+            return get().empty();
+        }
+
+        auto fill_readable_ranges(std::span<std::span<const_value_type>> out)
+            -> size_type {
+            return get().fill_readable_ranges(out);
+        }
+
+        auto discard_and_fill_readable_ranges(
+            size_type n, std::span<std::span<const_value_type>> out)
+            -> batch_result {
+            return get().discard_and_fill_readable_ranges(n, out);
+        }
+
+        auto write(std::span<const_value_type> const &buf) -> size_type {
+            return get().write(buf);
+        }
+
+        auto writable_ranges() -> std::vector<std::span<value_type>> {
+            return get().writable_ranges();
+        }
+
+        auto commit(size_type n) -> size_type {
+            return get().commit(n);
+        }
+
+        auto capacity() const -> size_type {
+            return get().capacity();
+        }
+
+        auto fill_writable_ranges(std::span<std::span<value_type>> out)
+            -> size_type {
+            return get().fill_writable_ranges(out);
+        }
+
+        auto commit_and_fill_writable_ranges(
+            size_type n, std::span<std::span<value_type>> out)
+            -> batch_result {
+            return get().commit_and_fill_writable_ranges(n, out);
+        }
+
+      private:
+        using holder_type = detail::any_buffer_holder<value_type>;
+
+        template <typename Buffer> static constexpr auto stores_inline() {
+            using model_type = detail::any_buffer_model<Buffer>;
+            return sizeof(model_type) <= inline_size &&
+                   alignof(model_type) <= alignof(std::max_align_t) &&
+                   std::is_nothrow_move_constructible_v<Buffer>;
+        }
+
+        auto take(any_buffer &other) noexcept -> void {
+            if (other.is_inline()) {
+                impl = other.impl->relocate(storage);
+                other.reset();
+            } else {
+                impl = std::exchange(other.impl, nullptr);
+            }
+        }
+
+        auto reset() noexcept -> void {
+            if (is_inline())
+                impl->~holder_type();
+            else
+                delete impl;
+            impl = nullptr;
+        }
+
+        alignas(std::max_align_t) std::byte storage[inline_size];
+        holder_type *impl = nullptr;
+    };
+
+    static_assert(sized_buffer<any_buffer<char>>);
+
 } // namespace sk
 
 #endif // SK_BUFFER_PMR_BUFFER_HXX_INCLUDED
@@ -60,6 +60,8 @@ namespace sk {
             std::remove_const_t<std::ranges::range_value_t<Range>>;
         using const_value_type = std::add_const_t<value_type>;
         using size_type = std::ranges::range_size_t<Range>;
+        using readable_range_list =
+            static_range_list<std::span<const_value_type>, 1>;
 
         std::span<const_value_type> read_window;
 
@@ -72,13 +74,12 @@ namespace sk {
             auto can_read =
                 std::min(std::ranges::size(buf), read_window.size());
 
-            auto will_read = read_window.subspan(0, can_read);
-            std::ranges::copy(will_read, std::ranges::begin(buf));
+            copy_objects(std::ranges::data(buf), read_window.data(), can_read);
             discard(can_read);
             return can_read;
         }
 
-        auto readable_ranges() -> std::vector<std::span<const_value_type>> {
+        auto readable_ranges() -> readable_range_list {
             return {read_window};
         }
 
@@ -87,10 +88,24 @@ namespace sk {
             read_window = read_window.subspan(will_discard);
             return will_discard;
         }
+
+        auto size() const -> size_type {
+            return read_window.size();
+        }
+
+        // No data can be written, so the capacity is the size.
+        auto capacity() const -> size_type {
+            return read_window.size();
+        }
+
+        auto empty() const -> bool {
+            return read_window.empty();
+        }
     };
 
     static_assert(
         readable_buffer_of<readable_range_buffer<std::span<char>>, char>);
+    static_assert(sized_buffer<readable_range_buffer<std::span<char>>>);
 
     // Create a readable_range_buffer from a range.
     template <std::ranges::contiguous_range Range>
@@ -109,6 +124,7 @@ namespace sk {
         using value_type = std::ranges::range_value_t<Range>;
         using const_value_type = std::add_const_t<value_type>;
         using size_type = typename std::span<value_type>::size_type;
+        using writable_range_list = static_range_list<std::span<value_type>, 1>;
 
         std::span<value_type> write_window;
 
@@ -124,14 +140,14 @@ namespace sk {
 
             auto can_write =
                 std::min(write_window.size(), std::ranges::size(buf));
-            auto will_write = buf | std::ranges::views::take(can_write);
-            std::ranges::copy(will_write, write_window.begin());
+            copy_objects(write_window.data(), std::ranges::data(buf),
+                         can_write);
             commit(can_write);
             return can_write;
         }
         // clang-format on
 
-        auto writable_ranges() -> std::vector<std::span<value_type>> {
+        auto writable_ranges() -> writable_range_list {
             return {write_window};
         }
 
@@ -140,9 +156,23 @@ namespace sk {
             write_window = write_window.subspan(will_commit);
             return will_commit;
         }
+
+        // Written data can't be read back, so the size is always zero.
+        auto size() const -> size_type {
+            return 0;
+        }
+
+        auto capacity() const -> size_type {
+            return write_window.size();
+        }
+
+        auto empty() const -> bool {
+            return true;
+        }
     };
 
     static_assert(writable_buffer<writable_range_buffer<std::span<char>>>);
+    static_assert(sized_buffer<writable_range_buffer<std::span<char>>>);
 
     // Create a writable_range_buffer from a range.
     template <std::ranges::contiguous_range Range>
@@ -0,0 +1,376 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SK_BUFFER_SPSC_CIRCULAR_BUFFER_HXX_INCLUDED
+#define SK_BUFFER_SPSC_CIRCULAR_BUFFER_HXX_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <ranges>
+#include <span>
+#include <type_traits>
+
+#include "sk/buffer/buffer.hxx"
+
+namespace sk {
+
+    namespace detail {
+
+        // The cache line size used to keep the producer's and consumer's
+        // data apart.  std::hardware_destructive_interference_size would be
+        // the obvious choice, but its value is not stable across compiler
+        // flags, so it shouldn't be used in a header.
+        inline constexpr std::size_t cache_line_size = 64;
+
+    } // namespace detail
+
+    /*************************************************************************
+     *
+     * spsc_circular_buffer: a fixed-size circular buffer which can be written
+     * to by one thread and read from by another thread at the same time,
+     * without locking.
+     *
+     * The producer thread may call writable_ranges(), commit() and write();
+     * the consumer thread may call readable_ranges(), discard() and read().
+     * Data committed by the producer becomes visible to the consumer, and
+     * space discarded by the consumer becomes available to the producer,
+     * through acquire/release operations on the read and write indices.
+     *
+     * Each side keeps a cached copy of the other side's index and only
+     * reloads it when the cached value doesn't show enough data or space, so
+     * in the common case neither side touches the other's cache line.  This
+     * means writable_ranges() and readable_ranges() can return less than is
+     * actually available; they only reload the other index when the cached
+     * value shows no space or data at all.
+     *
+     * Unlike circular_buffer, there is no reserved slot, so the buffer can
+     * hold exactly buffer_size objects.
+     *
+     * clear() is not thread-safe, and may only be called when neither thread
+     * is using the buffer.
+     */
+
+    template <typename Char, std::size_t buffer_size = 4096>
+    struct spsc_circular_buffer {
+        static_assert(buffer_size > 0);
+
+        using array_type = std::array<Char, buffer_size>;
+        using size_type = std::size_t;
+        using value_type = Char;
+        using const_value_type = std::add_const_t<Char>;
+
+        // When the data wraps around the end of the buffer, the readable or
+        // writable space is split into two ranges.
+        using readable_range_list =
+            static_range_list<std::span<const_value_type>, 2>;
+        using writable_range_list = static_range_list<std::span<value_type>, 2>;
+
+        // Create a new, empty buffer.
+        spsc_circular_buffer() = default;
+
+        // spsc_circular_buffer is shared between threads, so it can't be
+        // copied or moved.
+        spsc_circular_buffer(spsc_circular_buffer const &) = delete;
+        spsc_circular_buffer &operator=(spsc_circular_buffer const &) = delete;
+        spsc_circular_buffer(spsc_circular_buffer &&) = delete;
+        spsc_circular_buffer &operator=(spsc_circular_buffer &&) = delete;
+
+        // Reset the buffer.
+        auto clear() -> void {
+            write_index.store(0, std::memory_order_relaxed);
+            cached_read_index = 0;
+            read_index.store(0, std::memory_order_relaxed);
+            cached_write_index = 0;
+        }
+
+        /*
+         * Producer interface.
+         */
+
+        // Write data to the buffer.  Returns the number of objects written,
+        // which might less than the size of the range if the buffer is full.
+        template <std::ranges::contiguous_range Range>
+        auto write(Range &&) -> size_type requires std::same_as<
+            const_value_type,
+            std::add_const_t<std::ranges::range_value_t<Range>>>;
+
+        // Return a list of ranges representing space in the buffer
+        // which can be written to.  After writing the data, commit() should be
+        // called to make the data visible to the consumer.
+        auto writable_ranges() -> writable_range_list;
+
+        // Mark n objects of previously empty space as containing data.
+        auto commit(size_type n) -> size_type;
+
+        /*
+         * Consumer interface.
+         */
+
+        // Read data from the buffer.  As much data will be read as possible,
+        // and the number of objects read will be returned.
+        template <std::ranges::contiguous_range Range>
+        auto read(Range &&) -> size_type
+            requires std::same_as<value_type,
+                                  std::ranges::range_value_t<Range>>;
+
+        // Return a list of ranges which represent data in the buffer
+        // which can be read.  Writing data to the buffer will not invalidate
+        // the ranges.
+        //
+        // After reading the data, discard() should be called to return the
+        // space to the producer.
+        auto readable_ranges() -> readable_range_list;
+
+        // Discard up to n objects of readable data from the start of the
+        // buffer.  Returns the number of objects discarded.
+        auto discard(size_type n) -> size_type;
+
+        /*
+         * Either thread may call size() and empty(), but if the other thread
+         * is using the buffer, the result may be out of date by the time it
+         * is returned.
+         */
+
+        // Return the number of objects which can be read.
+        auto size() const -> size_type {
+            // Load the read index first, so it can't be ahead of the write
+            // index.
+            auto r = read_index.load(std::memory_order_acquire);
+            auto w = write_index.load(std::memory_order_acquire);
+            return static_cast<size_type>(w - r);
+        }
+
+        // Return the number of objects the buffer can hold.
+        auto capacity() const -> size_type {
+            return buffer_size;
+        }
+
+        // Return true if there is no data to read.
+        auto empty() const -> bool {
+            return size() == 0;
+        }
+
+      private:
+        /*
+         * The read and write indices are free-running counts of the number
+         * of objects that have been read resp. written; the position in the
+         * buffer is the index modulo buffer_size.  They are 64 bits wide
+         * even where size_t is 32 bits: if buffer_size is not a power of
+         * two, the position jumps when the index wraps, so the index must
+         * never wrap in practice.
+         */
+        using index_type = std::uint64_t;
+
+        // Return the free space the producer can see, reloading the read
+        // index if there's less than `wanted`.
+        auto producer_space(size_type wanted) -> size_type;
+
+        // Return the data the consumer can see, reloading the write index if
+        // there's less than `wanted`.
+        auto consumer_data(size_type wanted) -> size_type;
+
+        // Split `n` objects starting at index `i` into at most two ranges.
+        template <typename Span>
+        auto ranges_at(index_type i, size_type n)
+            -> static_range_list<Span, 2>;
+
+        // Producer data: the write index and the producer's copy of the read
+        // index.
+        alignas(detail::cache_line_size) std::atomic<index_type> write_index{0};
+        index_type cached_read_index = 0;
+
+        // Consumer data: the read index and the consumer's copy of the write
+        // index.
+        alignas(detail::cache_line_size) std::atomic<index_type> read_index{0};
+        index_type cached_write_index = 0;
+
+        // The data stored in this buffer.
+        alignas(detail::cache_line_size) array_type data;
+    };
+
+    static_assert(buffer<spsc_circular_buffer<char>>);
+    static_assert(sized_buffer<spsc_circular_buffer<char>>);
+
+    template <typename Char, std::size_t buffer_size>
+    template <typename Span>
+    auto spsc_circular_buffer<Char, buffer_size>::ranges_at(index_type i,
+                                                            size_type n)
+        -> static_range_list<Span, 2> {
+        static_range_list<Span, 2> ret;
+
+        auto start = static_cast<size_type>(i % buffer_size);
+        auto first = std::min(n, buffer_size - start);
+
+        if (first > 0)
+            ret.push_back(Span(data.data() + start, first));
+        if (n > first)
+            ret.push_back(Span(data.data(), n - first));
+
+        return ret;
+    }
+
+    /*
+     * spsc_circular_buffer::producer_space()
+     */
+    template <typename Char, std::size_t buffer_size>
+    auto spsc_circular_buffer<Char, buffer_size>::producer_space(
+        size_type wanted) -> size_type {
+        auto w = write_index.load(std::memory_order_relaxed);
+        auto space =
+            buffer_size - static_cast<size_type>(w - cached_read_index);
+
+        if (space < wanted) {
+            cached_read_index = read_index.load(std::memory_order_acquire);
+            space =
+                buffer_size - static_cast<size_type>(w - cached_read_index);
+        }
+
+        assert(space <= buffer_size);
+        return space;
+    }
+
+    /*
+     * spsc_circular_buffer::consumer_data()
+     */
+    template <typename Char, std::size_t buffer_size>
+    auto spsc_circular_buffer<Char, buffer_size>::consumer_data(
+        size_type wanted) -> size_type {
+        auto r = read_index.load(std::memory_order_relaxed);
+        auto avail = static_cast<size_type>(cached_write_index - r);
+
+        if (avail < wanted) {
+            cached_write_index = write_index.load(std::memory_order_acquire);
+            avail = static_cast<size_type>(cached_write_index - r);
+        }
+
+        assert(avail <= buffer_size);
+        return avail;
+    }
+
+    /*
+     * spsc_circular_buffer::writable_ranges()
+     */
+    template <typename Char, std::size_t buffer_size>
+    auto spsc_circular_buffer<Char, buffer_size>::writable_ranges()
+        -> writable_range_list {
+        auto space = producer_space(1);
+        return ranges_at<std::span<value_type>>(
+            write_index.load(std::memory_order_relaxed), space);
+    }
+
+    /*
+     * spsc_circular_buffer::commit()
+     */
+    template <typename Char, std::size_t buffer_size>
+    auto spsc_circular_buffer<Char, buffer_size>::commit(size_type n)
+        -> size_type {
+        auto can_commit = std::min(n, producer_space(n));
+        auto w = write_index.load(std::memory_order_relaxed);
+        write_index.store(w + can_commit, std::memory_order_release);
+        return can_commit;
+    }
+
+    /*
+     * spsc_circular_buffer::write()
+     */
+    template <typename Char, std::size_t buffer_size>
+    template <std::ranges::contiguous_range InRange>
+    auto spsc_circular_buffer<Char, buffer_size>::write(InRange &&buf)
+        -> size_type requires std::same_as<
+            const_value_type,
+            std::add_const_t<std::ranges::range_value_t<InRange>>> {
+
+        std::span<const_value_type> data_left{buf};
+        auto can_write = std::min(data_left.size(),
+                                  producer_space(data_left.size()));
+
+        auto ranges = ranges_at<std::span<value_type>>(
+            write_index.load(std::memory_order_relaxed), can_write);
+
+        for (auto &&range : ranges) {
+            copy_objects(range.data(), data_left.data(), range.size());
+            data_left = data_left.subspan(range.size());
+        }
+
+        return commit(can_write);
+    }
+
+    /*
+     * spsc_circular_buffer::readable_ranges()
+     */
+    template <typename Char, std::size_t buffer_size>
+    auto spsc_circular_buffer<Char, buffer_size>::readable_ranges()
+        -> readable_range_list {
+        auto avail = consumer_data(1);
+        return ranges_at<std::span<const_value_type>>(
+            read_index.load(std::memory_order_relaxed), avail);
+    }
+
+    /*
+     * spsc_circular_buffer::discard()
+     */
+    template <typename Char, std::size_t buffer_size>
+    auto spsc_circular_buffer<Char, buffer_size>::discard(size_type n)
+        -> size_type {
+        auto can_discard = std::min(n, consumer_data(n));
+        auto r = read_index.load(std::memory_order_relaxed);
+        read_index.store(r + can_discard, std::memory_order_release);
+        return can_discard;
+    }
+
+    /*
+     * spsc_circular_buffer::read()
+     */
+    template <typename Char, std::size_t buffer_size>
+    template <std::ranges::contiguous_range InRange>
+    auto spsc_circular_buffer<Char, buffer_size>::read(InRange &&buf)
+        -> size_type
+        requires std::same_as<value_type, std::ranges::range_value_t<InRange>> {
+
+        std::span<value_type> data_left{buf};
+        auto can_read =
+            std::min(data_left.size(), consumer_data(data_left.size()));
+
+        auto ranges = ranges_at<std::span<const_value_type>>(
+            read_index.load(std::memory_order_relaxed), can_read);
+
+        for (auto &&range : ranges) {
+            copy_objects(data_left.data(), range.data(), range.size());
+            data_left = data_left.subspan(range.size());
+        }
+
+        return discard(can_read);
+    }
+
+} // namespace sk
+
+#endif // SK_BUFFER_SPSC_CIRCULAR_BUFFER_HXX_INCLUDED
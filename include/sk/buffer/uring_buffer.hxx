@@ -0,0 +1,648 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * io_uring I/O between buffers and file descriptors, using extents which
+ * are registered with the kernel as fixed buffers.
+ */
+
+#ifndef SK_BUFFER_URING_BUFFER_HXX_INCLUDED
+#define SK_BUFFER_URING_BUFFER_HXX_INCLUDED
+
+#if !defined(__linux__)
+#    error "sk/buffer/uring_buffer.hxx requires Linux"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <ranges>
+#include <span>
+#include <system_error>
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "sk/buffer/buffer.hxx"
+#include "sk/buffer/buffer_io.hxx"
+#include "sk/buffer/extent_pool.hxx"
+
+namespace sk {
+
+    /*************************************************************************
+     *
+     * uring: a minimal io_uring instance.  This talks to the kernel directly
+     * using <linux/io_uring.h>, so it doesn't require liburing.  It provides
+     * only what's needed to submit and complete buffer I/O: getting SQEs,
+     * submitting them, reaping CQEs and registering fixed buffers.
+     *
+     * A uring is not thread-safe; each ring should be used by one thread at
+     * a time.  The constructor throws std::system_error if the ring can't be
+     * created (for example, if io_uring is disabled on this system).
+     */
+
+    struct uring {
+        explicit uring(unsigned entries = 64);
+
+        // The ring is mapped into memory, so it cannot be copied or moved.
+        uring(uring const &) = delete;
+        uring &operator=(uring const &) = delete;
+        uring(uring &&) = delete;
+        uring &operator=(uring &&) = delete;
+
+        ~uring();
+
+        // Return the next free SQE, cleared to zero, or nullptr if the
+        // submission queue is full.  The SQE is submitted by submit().
+        auto get_sqe() -> io_uring_sqe *;
+
+        // Submit all SQEs returned by get_sqe() since the last submit(), and
+        // wait until at least wait_nr CQEs are available.  Returns the number
+        // of SQEs submitted.
+        auto submit(unsigned wait_nr = 0) -> unsigned;
+
+        // Return the next CQE without waiting, or nullptr if there is none.
+        auto peek_cqe() -> io_uring_cqe *;
+
+        // Return the next CQE, waiting for one if necessary.
+        auto wait_cqe() -> io_uring_cqe *;
+
+        // Mark the CQE returned by peek_cqe() or wait_cqe() as consumed.
+        auto cqe_seen() -> void;
+
+        // Register memory as fixed buffers, with indices starting at 0.
+        // Only one set of buffers can be registered at a time: registering
+        // again fails with EBUSY until unregister_buffers() is called.  To
+        // use several regions, such as several uring_extent_providers,
+        // register all of them in one call.
+        auto register_buffers(std::span<struct iovec const> iovecs) -> void;
+
+        // Unregister all fixed buffers.
+        auto unregister_buffers() -> void;
+
+        // Return the ring's file descriptor.
+        auto native_handle() const -> int {
+            return ring_fd;
+        }
+
+      private:
+        // Unmap the rings and close the ring descriptor.
+        auto unmap() -> void;
+
+        auto enter(unsigned to_submit, unsigned min_complete, unsigned flags)
+            -> unsigned;
+
+        static auto load_acquire(unsigned *p) -> unsigned {
+            return std::atomic_ref<unsigned>(*p).load(
+                std::memory_order_acquire);
+        }
+
+        static auto store_release(unsigned *p, unsigned v) -> void {
+            std::atomic_ref<unsigned>(*p).store(v, std::memory_order_release);
+        }
+
+        int ring_fd = -1;
+
+        // The mapped rings.  If the kernel supports IORING_FEAT_SINGLE_MMAP,
+        // both rings are in a single mapping and cq_ring == sq_ring.
+        void *sq_ring = nullptr;
+        std::size_t sq_ring_size = 0;
+        void *cq_ring = nullptr;
+        std::size_t cq_ring_size = 0;
+        io_uring_sqe *sqes = nullptr;
+        std::size_t sqes_size = 0;
+
+        // Pointers into the submission ring.
+        unsigned *sq_khead = nullptr;
+        unsigned *sq_ktail = nullptr;
+        unsigned *sq_array = nullptr;
+        unsigned sq_mask = 0;
+        unsigned sq_entries = 0;
+
+        // Pointers into the completion ring.
+        unsigned *cq_khead = nullptr;
+        unsigned *cq_ktail = nullptr;
+        io_uring_cqe *cqes = nullptr;
+        unsigned cq_mask = 0;
+
+        // SQEs in [sqe_head, sqe_tail) have been returned by get_sqe() but
+        // not yet added to the submission ring.
+        unsigned sqe_head = 0;
+        unsigned sqe_tail = 0;
+    };
+
+    namespace detail {
+
+        inline auto uring_mmap(int fd, std::size_t size, off_t offset)
+            -> void * {
+            auto *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, fd, offset);
+            if (p == MAP_FAILED)
+                throw std::system_error(errno, std::system_category(),
+                                        "mmap");
+            return p;
+        }
+
+        template <typename T>
+        auto uring_ptr(void *base, unsigned offset) -> T * {
+            return reinterpret_cast<T *>(static_cast<char *>(base) + offset);
+        }
+
+    } // namespace detail
+
+    /* uring::uring() */
+    inline uring::uring(unsigned entries) {
+        io_uring_params params{};
+
+        auto fd = static_cast<int>(
+            ::syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0)
+            throw std::system_error(errno, std::system_category(),
+                                    "io_uring_setup");
+
+        ring_fd = fd;
+
+        try {
+            sq_ring_size =
+                params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_ring_size = params.cq_off.cqes +
+                           params.cq_entries * sizeof(io_uring_cqe);
+
+            if (params.features & IORING_FEAT_SINGLE_MMAP) {
+                sq_ring_size = cq_ring_size =
+                    std::max(sq_ring_size, cq_ring_size);
+                sq_ring = detail::uring_mmap(ring_fd, sq_ring_size,
+                                             IORING_OFF_SQ_RING);
+                cq_ring = sq_ring;
+            } else {
+                sq_ring = detail::uring_mmap(ring_fd, sq_ring_size,
+                                             IORING_OFF_SQ_RING);
+                cq_ring = detail::uring_mmap(ring_fd, cq_ring_size,
+                                             IORING_OFF_CQ_RING);
+            }
+
+            sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+            sqes = static_cast<io_uring_sqe *>(
+                detail::uring_mmap(ring_fd, sqes_size, IORING_OFF_SQES));
+        } catch (...) {
+            unmap();
+            throw;
+        }
+
+        sq_khead = detail::uring_ptr<unsigned>(sq_ring, params.sq_off.head);
+        sq_ktail = detail::uring_ptr<unsigned>(sq_ring, params.sq_off.tail);
+        sq_array = detail::uring_ptr<unsigned>(sq_ring, params.sq_off.array);
+        sq_mask =
+            *detail::uring_ptr<unsigned>(sq_ring, params.sq_off.ring_mask);
+        sq_entries = params.sq_entries;
+
+        cq_khead = detail::uring_ptr<unsigned>(cq_ring, params.cq_off.head);
+        cq_ktail = detail::uring_ptr<unsigned>(cq_ring, params.cq_off.tail);
+        cqes = detail::uring_ptr<io_uring_cqe>(cq_ring, params.cq_off.cqes);
+        cq_mask =
+            *detail::uring_ptr<unsigned>(cq_ring, params.cq_off.ring_mask);
+
+        sqe_head = sqe_tail = *sq_ktail;
+    }
+
+    /* uring::~uring() */
+    inline uring::~uring() {
+        unmap();
+    }
+
+    /* uring::unmap() */
+    inline auto uring::unmap() -> void {
+        if (sqes)
+            ::munmap(sqes, sqes_size);
+        if (cq_ring && cq_ring != sq_ring)
+            ::munmap(cq_ring, cq_ring_size);
+        if (sq_ring)
+            ::munmap(sq_ring, sq_ring_size);
+        if (ring_fd != -1)
+            ::close(ring_fd);
+    }
+
+    /* uring::get_sqe() */
+    inline auto uring::get_sqe() -> io_uring_sqe * {
+        if (sqe_tail - load_acquire(sq_khead) >= sq_entries)
+            return nullptr;
+
+        auto *sqe = &sqes[sqe_tail & sq_mask];
+        ++sqe_tail;
+        std::memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    /* uring::enter() */
+    inline auto uring::enter(unsigned to_submit, unsigned min_complete,
+                             unsigned flags) -> unsigned {
+        long ret;
+
+        do {
+            ret = ::syscall(__NR_io_uring_enter, ring_fd, to_submit,
+                            min_complete, flags, nullptr, 0);
+        } while (ret == -1 && errno == EINTR);
+
+        if (ret == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "io_uring_enter");
+
+        return static_cast<unsigned>(ret);
+    }
+
+    /* uring::submit() */
+    inline auto uring::submit(unsigned wait_nr) -> unsigned {
+        // Move pending SQEs to the submission ring.  We are the only
+        // writer of the tail, so it can be read without synchronisation.
+        auto tail = *sq_ktail;
+        auto to_submit = sqe_tail - sqe_head;
+
+        for (; sqe_head != sqe_tail; ++sqe_head, ++tail)
+            sq_array[tail & sq_mask] = sqe_head & sq_mask;
+
+        store_release(sq_ktail, tail);
+
+        if (to_submit == 0 && wait_nr == 0)
+            return 0;
+
+        return enter(to_submit, wait_nr,
+                     wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0);
+    }
+
+    /* uring::peek_cqe() */
+    inline auto uring::peek_cqe() -> io_uring_cqe * {
+        auto head = *cq_khead;
+        if (head == load_acquire(cq_ktail))
+            return nullptr;
+        return &cqes[head & cq_mask];
+    }
+
+    /* uring::wait_cqe() */
+    inline auto uring::wait_cqe() -> io_uring_cqe * {
+        for (;;) {
+            if (auto *cqe = peek_cqe())
+                return cqe;
+            enter(0, 1, IORING_ENTER_GETEVENTS);
+        }
+    }
+
+    /* uring::cqe_seen() */
+    inline auto uring::cqe_seen() -> void {
+        store_release(cq_khead, *cq_khead + 1);
+    }
+
+    /* uring::register_buffers() */
+    inline auto uring::register_buffers(std::span<struct iovec const> iovecs)
+        -> void {
+        if (::syscall(__NR_io_uring_register, ring_fd,
+                      IORING_REGISTER_BUFFERS, iovecs.data(),
+                      static_cast<unsigned>(iovecs.size())) == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "io_uring_register");
+    }
+
+    /* uring::unregister_buffers() */
+    inline auto uring::unregister_buffers() -> void {
+        if (::syscall(__NR_io_uring_register, ring_fd,
+                      IORING_UNREGISTER_BUFFERS, nullptr, 0) == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "io_uring_register");
+    }
+
+    /*************************************************************************
+     *
+     * uring_extent_provider: an extent_provider whose extents live in a single
+     * region of memory registered with a uring as a fixed buffer.  Reads and
+     * writes on those extents can use IORING_OP_READ_FIXED and
+     * IORING_OP_WRITE_FIXED, which saves the kernel from mapping and pinning
+     * the pages on every operation.
+     *
+     * Constructed with a ring, the provider registers its region as fixed
+     * buffer 0, and unregisters it when destroyed; since a ring only allows
+     * one registration at a time, nothing else can be registered with the
+     * ring meanwhile.  To use several providers, or a provider and other
+     * fixed buffers, construct each provider with the index it should have
+     * instead, and register a table with each provider's iovec() at its
+     * index with uring::register_buffers().
+     *
+     * A dynamic_buffer constructed with the provider takes its extents from
+     * the region, and discard() returns them to the provider once they are
+     * empty, so the same registered memory is reused indefinitely.  The
+     * region holds a fixed number of extents; allocate() throws
+     * std::bad_alloc when they are all in use.
+     *
+     * The provider must outlive any buffer using it, and the ring must
+     * outlive the provider.  A provider which didn't register itself must
+     * stay registered while I/O on its extents is in progress.
+     */
+
+    template <typename Extent>
+    struct uring_extent_provider final : extent_provider<Extent> {
+        using extent_type = Extent;
+        using size_type = std::size_t;
+
+        // Create a provider with room for nextents extents, and register
+        // its memory with the ring as fixed buffer 0.
+        uring_extent_provider(uring &ring, size_type nextents);
+
+        // Create a provider with room for nextents extents, whose memory the
+        // caller registers as fixed buffer buffer_index.
+        uring_extent_provider(size_type nextents, unsigned buffer_index);
+
+        uring_extent_provider(uring_extent_provider const &) = delete;
+        uring_extent_provider &
+        operator=(uring_extent_provider const &) = delete;
+
+        ~uring_extent_provider();
+
+        auto allocate() -> extent_type * override;
+        auto deallocate(extent_type *ext) -> void override;
+
+        // Return true if the given memory is inside the registered region.
+        auto contains(void const *p, size_type n) const -> bool {
+            auto const *begin = static_cast<char const *>(region);
+            auto const *q = static_cast<char const *>(p);
+            return q >= begin && q + n <= begin + region_size;
+        }
+
+        // The index of the registered fixed buffer.
+        auto buffer_index() const -> unsigned {
+            return index;
+        }
+
+        // Return the region, for registering with uring::register_buffers().
+        auto iovec() const -> struct iovec {
+            return {region, region_size};
+        }
+
+        // Return the number of extents which can still be allocated.
+        auto available() const -> size_type {
+            return free_slots.size();
+        }
+
+      private:
+        // Size of each slot in the region; rounded to a cache line, or the
+        // extent alignment if that's larger, so extents don't share lines.
+        static constexpr size_type slot_align =
+            std::max(size_type(64), size_type(alignof(extent_type)));
+        static constexpr size_type slot_size =
+            (sizeof(extent_type) + slot_align - 1) & ~(slot_align - 1);
+        static_assert(slot_align <= 4096,
+                      "extent alignment must not exceed the page size");
+
+        // Map the region and set up the free list.
+        auto map(size_type nextents) -> void;
+
+        // The ring the provider registered itself with, if any.
+        uring *ring = nullptr;
+        unsigned index = 0;
+        void *region = nullptr;
+        size_type region_size = 0;
+        std::vector<void *> free_slots;
+    };
+
+    /* uring_extent_provider::uring_extent_provider() */
+    template <typename Extent>
+    uring_extent_provider<Extent>::uring_extent_provider(uring &ring_,
+                                                         size_type nextents) {
+        map(nextents);
+
+        try {
+            auto iov = iovec();
+            ring_.register_buffers(std::span(&iov, 1));
+        } catch (...) {
+            ::munmap(region, region_size);
+            throw;
+        }
+
+        ring = &ring_;
+    }
+
+    template <typename Extent>
+    uring_extent_provider<Extent>::uring_extent_provider(
+        size_type nextents, unsigned buffer_index)
+        : index(buffer_index) {
+        map(nextents);
+    }
+
+    /* uring_extent_provider::map() */
+    template <typename Extent>
+    auto uring_extent_provider<Extent>::map(size_type nextents) -> void {
+        auto page_size = static_cast<size_type>(::sysconf(_SC_PAGESIZE));
+        region_size =
+            (nextents * slot_size + page_size - 1) & ~(page_size - 1);
+
+        region = ::mmap(nullptr, region_size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region == MAP_FAILED)
+            throw std::system_error(errno, std::system_category(), "mmap");
+
+        try {
+            free_slots.reserve(nextents);
+            // Push in reverse so extents are handed out in address order.
+            for (auto i = nextents; i > 0; --i)
+                free_slots.push_back(static_cast<char *>(region) +
+                                     (i - 1) * slot_size);
+        } catch (...) {
+            ::munmap(region, region_size);
+            throw;
+        }
+    }
+
+    /* uring_extent_provider::~uring_extent_provider() */
+    template <typename Extent>
+    uring_extent_provider<Extent>::~uring_extent_provider() {
+        if (ring) {
+            try {
+                ring->unregister_buffers();
+            } catch (std::system_error const &) {
+                // Nothing useful can be done here; the region is still freed.
+            }
+        }
+        ::munmap(region, region_size);
+    }
+
+    /* uring_extent_provider::allocate() */
+    template <typename Extent>
+    auto uring_extent_provider<Extent>::allocate() -> extent_type * {
+        if (free_slots.empty())
+            throw std::bad_alloc();
+
+        auto *ext = ::new (free_slots.back()) extent_type();
+        free_slots.pop_back();
+        return ext;
+    }
+
+    /* uring_extent_provider::deallocate() */
+    template <typename Extent>
+    auto uring_extent_provider<Extent>::deallocate(extent_type *ext) -> void {
+        assert(ext && contains(ext, sizeof(*ext)));
+
+        ext->~extent_type();
+        // The vector's capacity is the number of slots, so this can't throw.
+        free_slots.push_back(ext);
+    }
+
+    /*************************************************************************
+     *
+     * Submission helpers.  uring_prep_read() prepares an SQE which reads into
+     * the first non-empty writable range of a buffer, and uring_prep_write()
+     * one which writes the first non-empty readable range.  If a provider is
+     * given and the range is inside its region, the fixed-buffer opcode is
+     * used; otherwise a plain IORING_OP_READ/IORING_OP_WRITE.  Each returns
+     * the number of objects the operation will transfer, or 0 if the buffer
+     * has no space resp. data, in which case the SQE is left unchanged.
+     *
+     * When the CQE arrives, uring_complete_read() commits the data that was
+     * read and uring_complete_write() discards the data that was written.
+     * Both return the number of objects transferred, with errors reported in
+     * ec.
+     *
+     * The buffer must not be written to (for a read) or discarded from (for
+     * a write) while the operation is in progress, and only one read and
+     * one write should be in progress on a buffer at a time.
+     *
+     * For files, `offset` is the file offset; the default of -1 uses (and
+     * updates) the current file position, as for pipes and sockets.
+     */
+
+    namespace detail {
+
+        template <typename RangeList>
+        auto uring_first_range(RangeList &&ranges) {
+            for (auto &&range : ranges)
+                if (!std::ranges::empty(range))
+                    return std::span(range);
+            return decltype(std::span(*std::ranges::begin(ranges))){};
+        }
+
+        template <typename Range, typename Provider>
+        auto uring_prep_rw(io_uring_sqe &sqe, std::uint8_t op,
+                           std::uint8_t fixed_op, int fd, Range range,
+                           std::uint64_t offset, Provider const *provider)
+            -> std::size_t {
+            // The kernel transfers at most 2GB in a single operation.
+            auto n = std::min<std::size_t>(
+                range.size(), std::numeric_limits<std::int32_t>::max());
+
+            sqe.opcode = op;
+            sqe.fd = fd;
+            sqe.off = offset;
+            sqe.addr = reinterpret_cast<std::uintptr_t>(range.data());
+            sqe.len = static_cast<std::uint32_t>(n);
+
+            if (provider && provider->contains(range.data(), n)) {
+                sqe.opcode = fixed_op;
+                sqe.buf_index =
+                    static_cast<std::uint16_t>(provider->buffer_index());
+            }
+
+            return n;
+        }
+
+        // A placeholder provider type for helpers called without one.
+        struct no_uring_provider {
+            auto contains(void const *, std::size_t) const -> bool {
+                return false;
+            }
+            auto buffer_index() const -> unsigned {
+                return 0;
+            }
+        };
+
+    } // namespace detail
+
+    template <writable_buffer Buffer,
+              typename Provider = detail::no_uring_provider>
+    auto uring_prep_read(io_uring_sqe &sqe, int fd, Buffer &buf,
+                         Provider const *provider = nullptr,
+                         std::uint64_t offset = std::uint64_t(-1))
+        -> buffer_size_t<Buffer> requires io_buffer<Buffer> {
+        auto range = detail::uring_first_range(buf.writable_ranges());
+        if (range.empty())
+            return 0;
+
+        return static_cast<buffer_size_t<Buffer>>(
+            detail::uring_prep_rw(sqe, IORING_OP_READ, IORING_OP_READ_FIXED,
+                                  fd, range, offset, provider));
+    }
+
+    template <readable_buffer Buffer,
+              typename Provider = detail::no_uring_provider>
+    auto uring_prep_write(io_uring_sqe &sqe, int fd, Buffer &buf,
+                          Provider const *provider = nullptr,
+                          std::uint64_t offset = std::uint64_t(-1))
+        -> buffer_size_t<Buffer> requires io_buffer<Buffer> {
+        auto range = detail::uring_first_range(buf.readable_ranges());
+        if (range.empty())
+            return 0;
+
+        return static_cast<buffer_size_t<Buffer>>(
+            detail::uring_prep_rw(sqe, IORING_OP_WRITE, IORING_OP_WRITE_FIXED,
+                                  fd, range, offset, provider));
+    }
+
+    template <writable_buffer Buffer>
+    auto uring_complete_read(Buffer &buf, io_uring_cqe const &cqe,
+                             std::error_code &ec)
+        -> buffer_size_t<Buffer> requires io_buffer<Buffer> {
+        if (cqe.res < 0) {
+            ec.assign(-cqe.res, std::system_category());
+            return 0;
+        }
+
+        ec.clear();
+        return buf.commit(static_cast<buffer_size_t<Buffer>>(cqe.res));
+    }
+
+    template <readable_buffer Buffer>
+    auto uring_complete_write(Buffer &buf, io_uring_cqe const &cqe,
+                              std::error_code &ec)
+        -> buffer_size_t<Buffer> requires io_buffer<Buffer> {
+        if (cqe.res < 0) {
+            ec.assign(-cqe.res, std::system_category());
+            return 0;
+        }
+
+        ec.clear();
+        return buf.discard(static_cast<buffer_size_t<Buffer>>(cqe.res));
+    }
+
+} // namespace sk
+
+#endif // SK_BUFFER_URING_BUFFER_HXX_INCLUDED
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <array>
+#include <span>
+#include <string>
+
+#include <catch.hpp>
+
+#include "sk/buffer/buffer.hxx"
+#include "sk/buffer/circular_buffer.hxx"
+#include "sk/buffer/dynamic_buffer.hxx"
+#include "sk/buffer/fixed_buffer.hxx"
+
+TEST_CASE("static_range_list") {
+    std::string s("test");
+    sk::static_range_list<std::span<char>, 2> list;
+
+    REQUIRE(list.empty());
+    REQUIRE(list.capacity() == 2);
+
+    list.push_back(std::span<char>(s).subspan(0, 2));
+    list.push_back(std::span<char>(s).subspan(2));
+    REQUIRE(list.size() == 2);
+
+    std::string ret;
+    for (auto &&range : list)
+        ret.append(range.begin(), range.end());
+    REQUIRE(ret == "test");
+}
+
+TEST_CASE("buffer_copy") {
+    std::string input_string("this is a test string");
+    sk::dynamic_buffer<char, 4> from;
+    from.write(input_string);
+
+    // Copying into a buffer which is too small returns a short count.
+    sk::fixed_buffer<char, 8> small;
+    auto n = sk::buffer_copy(from, small);
+    REQUIRE(n == 8);
+
+    // Copying into a large enough buffer copies everything.
+    sk::circular_buffer<char, 64> to;
+    n = sk::buffer_copy(from, to);
+    REQUIRE(n == input_string.size());
+
+    std::string output_string(input_string.size(), 'X');
+    REQUIRE(to.read(output_string) == input_string.size());
+    REQUIRE(output_string == input_string);
+
+    // The data should still be in the source buffer.
+    REQUIRE(from.read(output_string) == input_string.size());
+    REQUIRE(output_string == input_string);
+}
+
+TEST_CASE("buffer_move") {
+    std::string input_string("this is a test string");
+    sk::dynamic_buffer<char, 4> from;
+    from.write(input_string);
+
+    sk::dynamic_buffer<char, 8> to;
+    auto n = sk::buffer_move(from, to);
+    REQUIRE(n == input_string.size());
+
+    std::string output_string(input_string.size(), 'X');
+    REQUIRE(to.read(output_string) == input_string.size());
+    REQUIRE(output_string == input_string);
+
+    // The source buffer should now be empty.
+    REQUIRE(from.read(output_string) == 0);
+}
+
+TEST_CASE("sized_buffer") {
+    std::string input_string("this is a test string");
+
+    sk::dynamic_buffer<char, 4> dbuf;
+    REQUIRE(dbuf.empty());
+    REQUIRE(dbuf.size() == 0);
+
+    dbuf.write(input_string);
+    REQUIRE(!dbuf.empty());
+    REQUIRE(dbuf.size() == input_string.size());
+    REQUIRE(dbuf.capacity() >= dbuf.size());
+    REQUIRE(sk::buffer_size(dbuf) == input_string.size());
+
+    // Commit through writable_ranges().
+    auto ranges = dbuf.writable_ranges();
+    auto writable = (*std::ranges::begin(ranges)).size();
+    dbuf.commit(writable);
+    REQUIRE(dbuf.size() == input_string.size() + writable);
+
+    // Discarding more than the buffer contains is a short discard.
+    REQUIRE(dbuf.discard(1000) == input_string.size() + writable);
+    REQUIRE(dbuf.empty());
+
+    sk::circular_buffer<char, 8> cbuf;
+    REQUIRE(cbuf.capacity() == 8);
+    REQUIRE(cbuf.write(std::string("abcdef")) == 6);
+    REQUIRE(cbuf.discard(5) == 5);
+    REQUIRE(cbuf.size() == 1);
+
+    // Wrap the data around the end of the buffer.
+    REQUIRE(cbuf.write(std::string("ghijk")) == 5);
+    REQUIRE(cbuf.size() == 6);
+    REQUIRE(cbuf.discard(6) == 6);
+    REQUIRE(cbuf.empty());
+
+    sk::fixed_buffer<char, 8> fbuf;
+    REQUIRE(fbuf.write(std::string("abc")) == 3);
+    REQUIRE(fbuf.discard(1) == 1);
+    REQUIRE(fbuf.size() == 2);
+    REQUIRE(fbuf.capacity() == 7);
+}
+
+TEST_CASE("buffer_peek_contiguous") {
+    std::array<char, 8> scratch{};
+
+    sk::circular_buffer<char, 8> cbuf;
+    cbuf.write(std::string("abcdef"));
+
+    // Contiguous data is returned in place.
+    auto span = sk::buffer_peek_contiguous(cbuf, 4, scratch);
+    REQUIRE(std::string(span.begin(), span.end()) == "abcd");
+    REQUIRE(span.data() != scratch.data());
+
+    // Data which wraps around is copied into the scratch space.
+    cbuf.discard(5);
+    cbuf.write(std::string("ghijk"));
+    span = sk::buffer_peek_contiguous(cbuf, 5, scratch);
+    REQUIRE(std::string(span.begin(), span.end()) == "fghij");
+    REQUIRE(span.data() == scratch.data());
+
+    // Peeking doesn't remove the data.
+    REQUIRE(cbuf.size() == 6);
+
+    // Not enough data, or not enough scratch space.
+    REQUIRE(sk::buffer_peek_contiguous(cbuf, 7, scratch).empty());
+    REQUIRE(sk::buffer_peek_contiguous(cbuf, 5, std::span<char>()).empty());
+    REQUIRE(!sk::buffer_peek_contiguous(cbuf, 1, std::span<char>()).empty());
+
+    // Across dynamic_buffer extents.
+    sk::dynamic_buffer<char, 4> dbuf;
+    dbuf.write(std::string("0123456789"));
+    span = sk::buffer_peek_contiguous(dbuf, 6, scratch);
+    REQUIRE(std::string(span.begin(), span.end()) == "012345");
+    REQUIRE(dbuf.discard(6) == 6);
+    REQUIRE(dbuf.size() == 4);
+}
@@ -0,0 +1,447 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#if !defined(_WIN32)
+
+#    include <coroutine>
+#    include <limits>
+#    include <string>
+#    include <string_view>
+#    include <system_error>
+
+#    include <fcntl.h>
+#    include <unistd.h>
+
+#    include <catch.hpp>
+
+#    include "sk/buffer/buffer_async.hxx"
+#    include "sk/buffer/dynamic_buffer.hxx"
+#    include "sk/buffer/fixed_buffer.hxx"
+
+using namespace std::literals;
+
+namespace {
+
+    // A non-blocking pipe which is closed on destruction.
+    struct test_pipe {
+        int fds[2];
+
+        test_pipe() {
+            REQUIRE(::pipe(fds) == 0);
+            for (auto fd : fds)
+                REQUIRE(::fcntl(fd, F_SETFL, O_NONBLOCK) == 0);
+        }
+
+        ~test_pipe() {
+            for (auto fd : fds)
+                if (fd != -1)
+                    ::close(fd);
+        }
+
+        auto close_write() -> void {
+            ::close(fds[1]);
+            fds[1] = -1;
+        }
+
+        auto write(std::string_view s) -> void {
+            REQUIRE(::write(fds[1], s.data(), s.size()) ==
+                    static_cast<ssize_t>(s.size()));
+        }
+
+        auto read_all() -> std::string {
+            std::string ret;
+            char buf[4096];
+            ssize_t n;
+            while ((n = ::read(fds[0], buf, sizeof(buf))) > 0)
+                ret.append(buf, static_cast<std::size_t>(n));
+            return ret;
+        }
+    };
+
+    // Read all the data in a buffer into a string.
+    auto read_string(sk::dynamic_buffer<char, 8> &buf) -> std::string {
+        std::string ret(buf.size(), ' ');
+        buf.read(ret);
+        return ret;
+    }
+
+    auto read_string(sk::dynamic_buffer<char> &buf) -> std::string {
+        std::string ret(buf.size(), ' ');
+        buf.read(ret);
+        return ret;
+    }
+
+    // A stream which suspends when the descriptor isn't ready and records
+    // the suspended coroutine, like an event loop would.
+    struct manual_stream {
+        int fd;
+        std::coroutine_handle<> waiting = nullptr;
+        int nwaits = 0;
+
+        explicit manual_stream(int fd_) : fd(fd_) {}
+
+        auto native_handle() const -> int {
+            return fd;
+        }
+
+        struct wait_awaiter {
+            manual_stream &stream;
+
+            auto await_ready() -> bool {
+                return false;
+            }
+
+            auto await_suspend(std::coroutine_handle<> h) -> void {
+                stream.waiting = h;
+                ++stream.nwaits;
+            }
+
+            auto await_resume() -> void {}
+        };
+
+        auto wait_readable() -> wait_awaiter {
+            return {*this};
+        }
+
+        auto wait_writable() -> wait_awaiter {
+            return {*this};
+        }
+
+        // Resume the waiting coroutine, as if the descriptor became ready.
+        auto resume() -> void {
+            REQUIRE(waiting);
+            std::exchange(waiting, nullptr).resume();
+        }
+    };
+
+    static_assert(sk::async_stream<manual_stream>);
+
+    // An allocator which counts its allocations.
+    struct allocation_counts {
+        int nallocs = 0;
+        int nfrees = 0;
+    };
+
+    template <typename T> struct counting_allocator {
+        using value_type = T;
+
+        allocation_counts *counts;
+
+        explicit counting_allocator(allocation_counts *counts_)
+            : counts(counts_) {}
+
+        template <typename U>
+        counting_allocator(counting_allocator<U> const &other)
+            : counts(other.counts) {}
+
+        auto allocate(std::size_t n) -> T * {
+            ++counts->nallocs;
+            return std::allocator<T>().allocate(n);
+        }
+
+        auto deallocate(T *p, std::size_t n) -> void {
+            ++counts->nfrees;
+            std::allocator<T>().deallocate(p, n);
+        }
+
+        friend auto operator==(counting_allocator const &,
+                               counting_allocator const &) -> bool {
+            return true;
+        }
+    };
+
+    // Read a line and echo it back, to test awaiting one task from another.
+    auto echo_line(manual_stream &in, manual_stream &out,
+                   sk::dynamic_buffer<char> &buf)
+        -> sk::async_task<std::size_t> {
+        auto end = co_await sk::async_read_until(in, buf, "\n"sv);
+        if (!end)
+            co_return 0;
+
+        sk::dynamic_buffer<char> line;
+        line.splice(buf, *end);
+        co_return co_await sk::async_drain(out, line);
+    }
+
+} // namespace
+
+TEST_CASE("async_fill waits for min_size") {
+    test_pipe pipe;
+    manual_stream stream{pipe.fds[0]};
+    sk::dynamic_buffer<char, 8> buf;
+
+    pipe.write("abcd");
+    auto task = sk::async_fill(stream, buf, 10);
+    task.start();
+
+    // The data so far has been read, and the task is waiting for more.
+    REQUIRE(!task.done());
+    REQUIRE(stream.nwaits == 1);
+    REQUIRE(buf.size() == 4);
+
+    pipe.write("efghijkl");
+    stream.resume();
+    REQUIRE(task.done());
+    REQUIRE(task.get() == 12);
+    REQUIRE(read_string(buf) == "abcdefghijkl");
+}
+
+TEST_CASE("async_fill end of file") {
+    test_pipe pipe;
+    manual_stream stream{pipe.fds[0]};
+    sk::dynamic_buffer<char> buf;
+
+    pipe.write("abc");
+    pipe.close_write();
+
+    auto task = sk::async_fill(stream, buf, 10);
+    task.start();
+    REQUIRE(task.done());
+    REQUIRE(task.get() == 3);
+    REQUIRE(stream.nwaits == 0);
+}
+
+TEST_CASE("async_fill stops when the buffer is full") {
+    test_pipe pipe;
+    manual_stream stream{pipe.fds[0]};
+    sk::fixed_buffer<char, 4> buf;
+
+    pipe.write("abcdef");
+    auto task = sk::async_fill(stream, buf, 10);
+    task.start();
+    REQUIRE(task.done());
+    REQUIRE(task.get() == 4);
+}
+
+TEST_CASE("async_fill errors") {
+    manual_stream stream{-1};
+    sk::dynamic_buffer<char> buf;
+
+    std::error_code ec;
+    auto task = sk::async_fill(stream, buf, 1, ec);
+    task.start();
+    REQUIRE(task.done());
+    REQUIRE(task.get() == 0);
+    REQUIRE(ec == std::errc::bad_file_descriptor);
+
+    auto throwing = sk::async_fill(stream, buf);
+    throwing.start();
+    REQUIRE(throwing.done());
+    REQUIRE_THROWS_AS(throwing.get(), std::system_error);
+}
+
+TEST_CASE("async_drain waits for the stream") {
+    test_pipe pipe;
+    manual_stream stream{pipe.fds[1]};
+
+    // Write more than the pipe can hold.
+    std::string input_string(1024 * 1024, 'x');
+    for (std::size_t i = 0; i < input_string.size(); ++i)
+        input_string[i] = static_cast<char>('a' + i % 26);
+
+    sk::dynamic_buffer<char> buf;
+    buf.write(input_string);
+
+    auto task = sk::async_drain(stream, buf);
+    task.start();
+
+    std::string output;
+    while (!task.done()) {
+        REQUIRE(stream.waiting);
+        output += pipe.read_all();
+        stream.resume();
+    }
+
+    output += pipe.read_all();
+    REQUIRE(stream.nwaits > 0);
+    REQUIRE(task.get() == input_string.size());
+    REQUIRE(buf.empty());
+    REQUIRE(output == input_string);
+}
+
+TEST_CASE("async_read_until") {
+    test_pipe pipe;
+    manual_stream stream{pipe.fds[0]};
+    sk::dynamic_buffer<char, 8> buf;
+
+    pipe.write("GET / HTTP/1.1\r");
+    auto task = sk::async_read_until(stream, buf, "\r\n"sv);
+    task.start();
+    REQUIRE(!task.done());
+
+    // The delimiter is split between two reads.
+    pipe.write("\nHost: x\r\n");
+    stream.resume();
+    REQUIRE(task.done());
+
+    auto end = task.get();
+    REQUIRE(end);
+    REQUIRE(*end == 16);
+
+    std::string line(*end, ' ');
+    REQUIRE(buf.read(line) == *end);
+    REQUIRE(line == "GET / HTTP/1.1\r\n");
+
+    // The rest of the data can be parsed without waiting.
+    auto next = sk::async_read_until(stream, buf, std::string("\r\n"));
+    next.start();
+    REQUIRE(next.done());
+    REQUIRE(next.get() == 9);
+}
+
+TEST_CASE("async_read_until end of file") {
+    test_pipe pipe;
+    manual_stream stream{pipe.fds[0]};
+    sk::dynamic_buffer<char> buf;
+
+    pipe.write("no newline");
+    pipe.close_write();
+
+    auto task = sk::async_read_until(stream, buf, "\n"sv);
+    task.start();
+    REQUIRE(task.done());
+    REQUIRE(!task.get());
+    REQUIRE(buf.size() == 10);
+}
+
+TEST_CASE("async_read_until max_size") {
+    test_pipe pipe;
+    manual_stream stream{pipe.fds[0]};
+    sk::dynamic_buffer<char> buf;
+
+    // The line is read all at once, but it's too long.
+    pipe.write("a line which is much too long\n");
+
+    std::error_code ec;
+    auto task = sk::async_read_until(stream, buf, "\n"sv, 8, ec);
+    task.start();
+    REQUIRE(task.done());
+    REQUIRE(!task.get());
+    REQUIRE(ec == std::errc::message_size);
+
+    // Without a delimiter either.
+    buf.clear();
+    pipe.write("no delimiter");
+    auto throwing = sk::async_read_until(stream, buf, "\n"sv, 8);
+    throwing.start();
+    REQUIRE(throwing.done());
+    REQUIRE_THROWS_AS(throwing.get(), std::system_error);
+}
+
+TEST_CASE("async_read_until full buffer") {
+    test_pipe pipe;
+    manual_stream stream{pipe.fds[0]};
+    sk::fixed_buffer<char, 8> buf;
+
+    // The buffer fills up before the delimiter arrives, which isn't end of
+    // file.
+    pipe.write("no delimiter here\n");
+
+    std::error_code ec;
+    auto task = sk::async_read_until(stream, buf, "\n"sv,
+                                     std::numeric_limits<std::size_t>::max(),
+                                     ec);
+    task.start();
+    REQUIRE(task.done());
+    REQUIRE(!task.get());
+    REQUIRE(ec == std::errc::message_size);
+    REQUIRE(buf.size() == 8);
+}
+
+TEST_CASE("async tasks awaiting tasks") {
+    test_pipe in_pipe, out_pipe;
+    manual_stream in{in_pipe.fds[0]}, out{out_pipe.fds[1]};
+    sk::dynamic_buffer<char> buf;
+
+    auto task = echo_line(in, out, buf);
+    task.start();
+    REQUIRE(!task.done());
+
+    in_pipe.write("hello\nworld");
+    in.resume();
+    REQUIRE(task.done());
+    REQUIRE(task.get() == 6);
+    REQUIRE(out_pipe.read_all() == "hello\n");
+    REQUIRE(read_string(buf) == "world");
+}
+
+TEST_CASE("async tasks with a frame allocator") {
+    test_pipe pipe;
+    manual_stream stream{pipe.fds[0]};
+    sk::dynamic_buffer<char> buf;
+    allocation_counts counts;
+
+    {
+        pipe.write("abc");
+        auto task = sk::async_fill(std::allocator_arg,
+                                   counting_allocator<char>(&counts), stream,
+                                   buf, 3);
+        REQUIRE(counts.nallocs == 1);
+        task.start();
+        REQUIRE(task.get() == 3);
+    }
+
+    {
+        pipe.write("d\n");
+        auto task = sk::async_read_until(
+            std::allocator_arg, counting_allocator<char>(&counts), stream,
+            buf, "\n"sv);
+        task.start();
+        REQUIRE(task.get() == 5);
+    }
+
+    REQUIRE(counts.nallocs == 2);
+    REQUIRE(counts.nfrees == 2);
+}
+
+TEST_CASE("recycling_frame_allocator reuses blocks") {
+    sk::recycling_frame_allocator<std::byte> alloc;
+
+    auto *p = alloc.allocate(190);
+    alloc.deallocate(p, 190);
+
+    // A block of the same size class is reused.
+    auto *q = alloc.allocate(180);
+    REQUIRE(q == p);
+    alloc.deallocate(q, 180);
+}
+
+TEST_CASE("blocking_stream") {
+    test_pipe pipe;
+    sk::blocking_stream stream{pipe.fds[0]};
+    sk::dynamic_buffer<char> buf;
+
+    pipe.write("abc\n");
+    auto task = sk::async_read_until(stream, buf, "\n"sv);
+    task.start();
+    REQUIRE(task.done());
+    REQUIRE(task.get() == 4);
+}
+
+#endif // !_WIN32
@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "sk/buffer/buffer_checksum.hxx"
+#include "sk/buffer/circular_buffer.hxx"
+#include "sk/buffer/dynamic_buffer.hxx"
+#include "sk/buffer/fixed_buffer.hxx"
+
+namespace {
+
+    auto bytes_of(std::string_view s) -> std::span<std::byte const> {
+        return std::as_bytes(std::span(s));
+    }
+
+    // 0, 1, 2... 250, 0, 1...
+    auto test_data(std::size_t n) -> std::vector<std::byte> {
+        std::vector<std::byte> data(n);
+        for (std::size_t i = 0; i < n; ++i)
+            data[i] = static_cast<std::byte>(i % 251);
+        return data;
+    }
+
+    template <typename Checksum>
+    auto checksum_of(std::span<std::byte const> data, Checksum sum)
+        -> typename Checksum::value_type {
+        sum.update(data);
+        return sum.value();
+    }
+
+    // A buffer which offers all of its space but only accepts `limit`
+    // objects per commit().
+    struct short_commit_buffer {
+        using value_type = char;
+        using const_value_type = char const;
+        using size_type = std::size_t;
+
+        sk::fixed_buffer<char, 16> buf;
+        std::size_t limit;
+
+        template <std::ranges::contiguous_range Range>
+        auto write(Range &&data) -> size_type {
+            return buf.write(std::forward<Range>(data));
+        }
+
+        auto writable_ranges() {
+            return buf.writable_ranges();
+        }
+
+        auto commit(size_type n) -> size_type {
+            return buf.commit(std::min(n, limit));
+        }
+    };
+
+} // namespace
+
+static_assert(sk::buffer<
+              sk::checksummed_buffer<sk::dynamic_buffer<char>, sk::crc32c>>);
+static_assert(sk::writable_buffer<
+              sk::checksummed_buffer<sk::fixed_buffer<char, 16>, sk::xxh3_64>>);
+
+TEST_CASE("crc32c known values") {
+    REQUIRE(checksum_of(bytes_of(""), sk::crc32c()) == 0);
+    REQUIRE(checksum_of(bytes_of("123456789"), sk::crc32c()) == 0xE3069283U);
+
+    std::vector<std::byte> zeros(32, std::byte(0));
+    REQUIRE(checksum_of(zeros, sk::crc32c()) == 0x8A9136AAU);
+
+    std::vector<std::byte> ones(32, std::byte(0xFF));
+    REQUIRE(checksum_of(ones, sk::crc32c()) == 0x62A8AB43U);
+}
+
+TEST_CASE("crc32c incremental") {
+    auto data = test_data(1000);
+    auto expected = checksum_of(data, sk::crc32c());
+
+    for (std::size_t chunk : {1, 3, 7, 8, 64, 333}) {
+        sk::crc32c sum;
+        for (std::size_t i = 0; i < data.size(); i += chunk)
+            sum.update(std::span(data).subspan(
+                i, std::min(chunk, data.size() - i)));
+        REQUIRE(sum.value() == expected);
+    }
+
+    // The hardware and software paths agree.
+    REQUIRE(~sk::detail::crc32c_update_software(~0U, data.data(),
+                                                data.size()) == expected);
+
+    sk::crc32c sum;
+    sum.update(data);
+    sum.reset();
+    sum.update(bytes_of("123456789"));
+    REQUIRE(sum.value() == 0xE3069283U);
+}
+
+TEST_CASE("xxh3_64 known values") {
+    // Values from the reference implementation, XXH3_64bits_withSeed().
+    REQUIRE(checksum_of(bytes_of(""), sk::xxh3_64()) ==
+            0x2D06800538D394C2ULL);
+    REQUIRE(checksum_of(bytes_of("a"), sk::xxh3_64()) ==
+            0xE6C632B61E964E1FULL);
+    REQUIRE(checksum_of(bytes_of("abc"), sk::xxh3_64()) ==
+            0x78AF5F94892F3950ULL);
+    REQUIRE(checksum_of(bytes_of("hello world"), sk::xxh3_64()) ==
+            0xD447B1EA40E6988BULL);
+    REQUIRE(checksum_of(
+                bytes_of("The quick brown fox jumps over the lazy dog"),
+                sk::xxh3_64()) == 0xCE7D19A5418FB365ULL);
+
+    auto data = test_data(5000);
+    auto prefix = [&](std::size_t n) { return std::span(data).subspan(0, n); };
+
+    REQUIRE(checksum_of(prefix(100), sk::xxh3_64()) == 0x004E4F921A64BD1CULL);
+    REQUIRE(checksum_of(prefix(100), sk::xxh3_64(42)) ==
+            0xA5CD98C344A5633AULL);
+    REQUIRE(checksum_of(prefix(200), sk::xxh3_64()) == 0xF42A8864FEAF0703ULL);
+    REQUIRE(checksum_of(prefix(200), sk::xxh3_64(42)) ==
+            0xC335A2DE8A09A90EULL);
+    REQUIRE(checksum_of(prefix(1000), sk::xxh3_64()) ==
+            0x33EF703FB2B20ED1ULL);
+    REQUIRE(checksum_of(prefix(1000), sk::xxh3_64(42)) ==
+            0x0F580BFA20541114ULL);
+    REQUIRE(checksum_of(prefix(5000), sk::xxh3_64()) ==
+            0xB418500FC42320EEULL);
+    REQUIRE(checksum_of(prefix(5000), sk::xxh3_64(42)) ==
+            0xCBB923D7FCF9CD33ULL);
+}
+
+TEST_CASE("xxh3_64 incremental") {
+    auto data = test_data(5000);
+
+    // Cover the short-input cases, the internal buffer boundary and
+    // several blocks.
+    for (std::size_t len : {0, 16, 240, 241, 256, 257, 1024, 1025, 5000}) {
+        auto input = std::span(data).subspan(0, len);
+        auto expected = checksum_of(input, sk::xxh3_64(7));
+
+        for (std::size_t chunk : {1, 13, 64, 255, 256, 257, 4096}) {
+            sk::xxh3_64 sum(7);
+            for (std::size_t i = 0; i < len; i += chunk)
+                sum.update(input.subspan(i, std::min(chunk, len - i)));
+            REQUIRE(sum.value() == expected);
+        }
+    }
+}
+
+TEST_CASE("xxh3_64 vector and scalar paths agree") {
+    auto data = test_data(64 * 16);
+    std::uint64_t acc1[8], acc2[8];
+    std::iota(std::begin(acc1), std::end(acc1), 1);
+    std::iota(std::begin(acc2), std::end(acc2), 1);
+
+    for (std::size_t i = 0; i < 16; ++i) {
+        auto secret = sk::detail::xxh3_secret_bytes(i * 8);
+        sk::detail::xxh3_accumulate_512(acc1, data.data() + i * 64, secret);
+        sk::detail::xxh3_accumulate_512_scalar(acc2, data.data() + i * 64,
+                                               secret);
+    }
+
+    sk::detail::xxh3_scramble(acc1, sk::detail::xxh3_secret_bytes(128));
+    sk::detail::xxh3_scramble_scalar(acc2, sk::detail::xxh3_secret_bytes(128));
+
+    REQUIRE(std::equal(std::begin(acc1), std::end(acc1), std::begin(acc2)));
+}
+
+TEST_CASE("buffer_checksum over readable ranges") {
+    sk::dynamic_buffer<std::byte, 64> buf;
+    auto data = test_data(1000);
+    REQUIRE(buf.write(data) == data.size());
+
+    sk::crc32c crc;
+    REQUIRE(sk::buffer_checksum(buf, crc) == data.size());
+    REQUIRE(crc.value() == checksum_of(data, sk::crc32c()));
+
+    // The data stays in the buffer.
+    REQUIRE(buf.size() == data.size());
+
+    // Checksum the first part of the data only.
+    sk::xxh3_64 hash;
+    REQUIRE(sk::buffer_checksum(buf, hash, 300) == 300);
+    REQUIRE(hash.value() ==
+            checksum_of(std::span(data).subspan(0, 300), sk::xxh3_64()));
+
+    // Asking for more than the buffer holds checksums all of it.
+    sk::crc32c crc2;
+    REQUIRE(sk::buffer_checksum(buf, crc2, 5000) == data.size());
+    REQUIRE(crc2.value() == crc.value());
+}
+
+TEST_CASE("buffer_checksum over wrapped circular_buffer") {
+    sk::circular_buffer<char, 8> buf;
+    REQUIRE(buf.write(std::string("abcdef")) == 6);
+    REQUIRE(buf.discard(6) == 6);
+    REQUIRE(buf.write(std::string("1234")) == 4);
+    REQUIRE(buf.readable_ranges().size() == 2);
+
+    sk::crc32c crc;
+    REQUIRE(sk::buffer_checksum(buf, crc) == 4);
+    REQUIRE(crc.value() == checksum_of(bytes_of("1234"), sk::crc32c()));
+}
+
+TEST_CASE("checksummed_buffer write") {
+    sk::dynamic_buffer<char, 16> buf;
+    sk::checksummed_buffer wrapped(buf, sk::crc32c());
+
+    REQUIRE(wrapped.write(std::string("1234")) == 4);
+    REQUIRE(wrapped.write(std::string("56789")) == 5);
+    REQUIRE(wrapped.checksum.value() == 0xE3069283U);
+
+    // Reading doesn't affect the checksum.
+    std::string out(9, 'X');
+    REQUIRE(wrapped.read(out) == 9);
+    REQUIRE(out == "123456789");
+    REQUIRE(wrapped.checksum.value() == 0xE3069283U);
+}
+
+TEST_CASE("checksummed_buffer commit") {
+    sk::dynamic_buffer<std::byte, 64> buf;
+    sk::checksummed_buffer wrapped(buf, sk::xxh3_64(42));
+    auto data = test_data(1000);
+
+    // Fill the writable ranges in pieces, crossing extent boundaries.
+    std::size_t done = 0;
+    while (done < data.size()) {
+        auto ranges = wrapped.writable_ranges();
+        auto range = *std::ranges::begin(ranges);
+        auto n = std::min<std::size_t>({range.size(), data.size() - done, 50});
+        std::copy_n(data.data() + done, n, range.data());
+        REQUIRE(wrapped.commit(n) == n);
+        done += n;
+    }
+
+    REQUIRE(buf.size() == data.size());
+    REQUIRE(wrapped.checksum.value() == checksum_of(data, sk::xxh3_64(42)));
+}
+
+TEST_CASE("checksummed_buffer on a full buffer") {
+    sk::fixed_buffer<char, 4> buf;
+    sk::checksummed_buffer wrapped(buf, sk::crc32c());
+
+    // Only what fits is added to the checksum.
+    REQUIRE(wrapped.write(std::string("123456789")) == 4);
+    REQUIRE(wrapped.commit(10) == 0);
+    REQUIRE(wrapped.checksum.value() ==
+            checksum_of(bytes_of("1234"), sk::crc32c()));
+}
+
+TEST_CASE("checksummed_buffer short commit") {
+    short_commit_buffer buf{{}, 3};
+    sk::checksummed_buffer wrapped(buf, sk::crc32c());
+
+    // Only the data the underlying buffer accepted is in the checksum.
+    auto ranges = wrapped.writable_ranges();
+    auto range = *std::ranges::begin(ranges);
+    std::ranges::copy(std::string_view("123456789"), range.begin());
+    REQUIRE(wrapped.commit(9) == 3);
+    REQUIRE(wrapped.checksum.value() ==
+            checksum_of(bytes_of("123"), sk::crc32c()));
+}
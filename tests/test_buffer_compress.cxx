@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <catch.hpp>
+
+#include "sk/buffer/buffer_compress.hxx"
+#include "sk/buffer/dynamic_buffer.hxx"
+#include "sk/buffer/fixed_buffer.hxx"
+
+namespace {
+
+    // A codec which copies at most 3 bytes per call, and ends each frame
+    // with a '!'.
+    struct test_codec {
+        bool trailer_pending = false;
+
+        auto process(std::span<std::byte const> in, std::span<std::byte> out,
+                     sk::codec_flush flush, std::error_code &)
+            -> sk::codec_result {
+            auto n = std::min({in.size(), out.size(), std::size_t(3)});
+            if (n > 0)
+                std::memcpy(out.data(), in.data(), n);
+
+            sk::codec_result ret{n, n};
+            if (n < in.size() || flush == sk::codec_flush::none)
+                return ret;
+
+            if (flush == sk::codec_flush::finish) {
+                if (n == out.size()) {
+                    trailer_pending = true;
+                    return ret;
+                }
+                out[n] = std::byte('!');
+                ++ret.produced;
+                trailer_pending = false;
+            }
+
+            ret.finished = true;
+            return ret;
+        }
+    };
+
+    static_assert(sk::buffer_codec<test_codec>);
+
+    // A buffer which offers all of its space but only accepts `limit`
+    // objects per commit().
+    struct short_commit_buffer {
+        using value_type = char;
+        using const_value_type = char const;
+        using size_type = std::size_t;
+
+        sk::fixed_buffer<char, 16> buf;
+        std::size_t limit;
+
+        template <std::ranges::contiguous_range Range>
+        auto write(Range &&data) -> size_type {
+            return buf.write(std::forward<Range>(data));
+        }
+
+        auto writable_ranges() {
+            return buf.writable_ranges();
+        }
+
+        auto commit(size_type n) -> size_type {
+            return buf.commit(std::min(n, limit));
+        }
+    };
+
+    template <typename Buffer> auto read_all(Buffer &buf) -> std::string {
+        std::string ret;
+        for (auto &&range : buf.readable_ranges())
+            ret.append(range.begin(), range.end());
+        buf.discard(ret.size());
+        return ret;
+    }
+
+    auto test_input() -> std::string {
+        std::string ret;
+        for (int i = 0; i < 2000; ++i)
+            ret += "line " + std::to_string(i % 37) + " of the test input\n";
+        return ret;
+    }
+
+    // Compress the input into buffers with small extents, decompress it
+    // again, and check the result.
+    template <typename Compressor, typename Decompressor>
+    auto round_trip(Compressor &compressor, Decompressor &decompressor)
+        -> void {
+        auto input = test_input();
+
+        sk::dynamic_buffer<char, 64> plain, unpacked;
+        sk::dynamic_buffer<char, 1024> packed;
+        plain.write(input);
+
+        auto c = sk::buffer_compress(compressor, plain, packed,
+                                     sk::codec_flush::finish);
+        REQUIRE(c.finished);
+        REQUIRE(c.consumed == input.size());
+        REQUIRE(c.produced == packed.size());
+        REQUIRE(packed.size() < input.size() / 4);
+        REQUIRE(plain.empty());
+
+        auto d = sk::buffer_decompress(decompressor, packed, unpacked);
+        REQUIRE(d.finished);
+        REQUIRE(packed.empty());
+        REQUIRE(read_all(unpacked) == input);
+    }
+
+    // Check that data compressed with a flush can be decompressed before
+    // the frame is finished.
+    template <typename Compressor, typename Decompressor>
+    auto check_flush(Compressor &compressor, Decompressor &decompressor)
+        -> void {
+        sk::dynamic_buffer<char, 16> plain, packed, unpacked;
+
+        plain.write(std::string("first message"));
+        auto r = sk::buffer_compress(compressor, plain, packed,
+                                     sk::codec_flush::flush);
+        REQUIRE(r.finished);
+
+        auto d = sk::buffer_decompress(decompressor, packed, unpacked);
+        REQUIRE(!d.finished);
+        REQUIRE(read_all(unpacked) == "first message");
+
+        plain.write(std::string(", second message"));
+        r = sk::buffer_compress(compressor, plain, packed,
+                                sk::codec_flush::finish);
+        REQUIRE(r.finished);
+
+        d = sk::buffer_decompress(decompressor, packed, unpacked);
+        REQUIRE(d.finished);
+        REQUIRE(read_all(unpacked) == ", second message");
+    }
+
+} // namespace
+
+TEST_CASE("buffer_compress walks every range") {
+    sk::dynamic_buffer<char, 4> in;
+    sk::dynamic_buffer<char, 5> out;
+    in.write(std::string("hello, world"));
+    test_codec codec;
+
+    auto r = sk::buffer_compress(codec, in, out);
+    REQUIRE(r.consumed == 12);
+    REQUIRE(r.produced == 12);
+    REQUIRE(!r.finished);
+    REQUIRE(in.empty());
+
+    // Finishing with no input just writes the trailer.
+    r = sk::buffer_compress(codec, in, out, sk::codec_flush::finish);
+    REQUIRE(r.finished);
+    REQUIRE(r.produced == 1);
+    REQUIRE(read_all(out) == "hello, world!");
+}
+
+TEST_CASE("buffer_compress resumes when the output is full") {
+    sk::dynamic_buffer<char, 4> in;
+    sk::fixed_buffer<char, 8> out;
+    in.write(std::string("0123456789"));
+    test_codec codec;
+
+    auto r = sk::buffer_compress(codec, in, out, sk::codec_flush::finish);
+    REQUIRE(!r.finished);
+    REQUIRE(r.consumed == 8);
+    REQUIRE(read_all(out) == "01234567");
+    REQUIRE(in.size() == 2);
+
+    out.reset();
+    r = sk::buffer_compress(codec, in, out, sk::codec_flush::finish);
+    REQUIRE(r.finished);
+    REQUIRE(read_all(out) == "89!");
+}
+
+TEST_CASE("buffer_compress reports output the buffer refused") {
+    sk::dynamic_buffer<char, 4> in;
+    short_commit_buffer out{{}, 4};
+    in.write(std::string("0123456789"));
+    test_codec codec;
+
+    // The codec produced more than `out` accepted, so the output is lost.
+    std::error_code ec;
+    auto r = sk::buffer_compress(codec, in, out, sk::codec_flush::none, ec);
+    REQUIRE(ec == std::errc::no_buffer_space);
+    REQUIRE(r.produced == 4);
+    REQUIRE(read_all(out.buf) == "0123");
+
+    in.write(std::string("0123456789"));
+    REQUIRE_THROWS_AS(sk::buffer_compress(codec, in, out), std::system_error);
+}
+
+#if defined(SK_BUFFER_TEST_ZLIB)
+
+TEST_CASE("zlib round trip") {
+    sk::zlib_compressor compressor;
+    sk::zlib_decompressor decompressor;
+    round_trip(compressor, decompressor);
+
+    // The codecs can be reused for another stream.
+    round_trip(compressor, decompressor);
+}
+
+TEST_CASE("zlib gzip round trip") {
+    sk::zlib_compressor compressor(Z_BEST_SPEED, 31);
+    sk::zlib_decompressor decompressor(47);
+    round_trip(compressor, decompressor);
+}
+
+TEST_CASE("zlib flush makes the data so far readable") {
+    sk::zlib_compressor compressor;
+    sk::zlib_decompressor decompressor;
+    check_flush(compressor, decompressor);
+}
+
+TEST_CASE("zlib decompression stops at the end of a stream") {
+    sk::zlib_compressor compressor;
+    sk::zlib_decompressor decompressor;
+    sk::dynamic_buffer<char, 16> plain, packed, unpacked;
+
+    plain.write(std::string("one"));
+    sk::buffer_compress(compressor, plain, packed, sk::codec_flush::finish);
+    plain.write(std::string("two"));
+    sk::buffer_compress(compressor, plain, packed, sk::codec_flush::finish);
+
+    REQUIRE(sk::buffer_decompress(decompressor, packed, unpacked).finished);
+    REQUIRE(read_all(unpacked) == "one");
+    REQUIRE(!packed.empty());
+
+    REQUIRE(sk::buffer_decompress(decompressor, packed, unpacked).finished);
+    REQUIRE(read_all(unpacked) == "two");
+    REQUIRE(packed.empty());
+}
+
+TEST_CASE("zlib decompression error") {
+    sk::zlib_decompressor decompressor;
+    sk::dynamic_buffer<char, 16> packed, unpacked;
+    packed.write(std::string("this is not zlib data"));
+
+    std::error_code ec;
+    sk::buffer_decompress(decompressor, packed, unpacked, ec);
+    REQUIRE(ec);
+    REQUIRE(&ec.category() == &sk::zlib_category());
+    REQUIRE(ec.value() == Z_DATA_ERROR);
+
+    sk::zlib_decompressor other;
+    REQUIRE_THROWS_AS(sk::buffer_decompress(other, packed, unpacked),
+                      std::system_error);
+}
+
+#endif // defined(SK_BUFFER_TEST_ZLIB)
+
+#if defined(SK_BUFFER_TEST_ZSTD)
+
+TEST_CASE("zstd round trip") {
+    sk::zstd_compressor compressor;
+    sk::zstd_decompressor decompressor;
+    round_trip(compressor, decompressor);
+    round_trip(compressor, decompressor);
+}
+
+TEST_CASE("zstd flush makes the data so far readable") {
+    sk::zstd_compressor compressor;
+    sk::zstd_decompressor decompressor;
+    check_flush(compressor, decompressor);
+}
+
+#endif // defined(SK_BUFFER_TEST_ZSTD)
+
+#if defined(SK_BUFFER_TEST_LZ4)
+
+TEST_CASE("lz4 round trip") {
+    sk::lz4_compressor compressor;
+    sk::lz4_decompressor decompressor;
+    round_trip(compressor, decompressor);
+    round_trip(compressor, decompressor);
+}
+
+TEST_CASE("lz4 flush makes the data so far readable") {
+    sk::lz4_compressor compressor;
+    sk::lz4_decompressor decompressor;
+    check_flush(compressor, decompressor);
+}
+
+TEST_CASE("lz4 with an output smaller than a block") {
+    // Every output range is smaller than direct_min, so the staging area
+    // is used throughout.
+    sk::lz4_compressor compressor;
+    sk::lz4_decompressor decompressor;
+    auto input = test_input();
+
+    sk::dynamic_buffer<char, 64> plain, unpacked;
+    sk::dynamic_buffer<char, 7> packed;
+    plain.write(input);
+
+    REQUIRE(sk::buffer_compress(compressor, plain, packed,
+                                sk::codec_flush::finish)
+                .finished);
+    REQUIRE(sk::buffer_decompress(decompressor, packed, unpacked).finished);
+    REQUIRE(read_all(unpacked) == input);
+}
+
+#endif // defined(SK_BUFFER_TEST_LZ4)
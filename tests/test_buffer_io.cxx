@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#if !defined(_WIN32)
+
+#    include <string>
+
+#    include <fcntl.h>
+#    include <unistd.h>
+
+#    include <catch.hpp>
+
+#    include "sk/buffer/buffer_io.hxx"
+#    include "sk/buffer/circular_buffer.hxx"
+#    include "sk/buffer/dynamic_buffer.hxx"
+
+namespace {
+
+    // A pipe which is closed on destruction.
+    struct test_pipe {
+        int fds[2];
+
+        test_pipe() {
+            REQUIRE(::pipe(fds) == 0);
+        }
+
+        ~test_pipe() {
+            for (auto fd : fds)
+                if (fd != -1)
+                    ::close(fd);
+        }
+
+        auto close_write() -> void {
+            ::close(fds[1]);
+            fds[1] = -1;
+        }
+    };
+
+} // namespace
+
+TEST_CASE("buffer_write_to and buffer_read_from") {
+    std::string input_string =
+        "this is a long test string that will fill several extents";
+    test_pipe pipe;
+
+    // Write a multi-extent buffer with a single call.
+    sk::dynamic_buffer<char, 8> out;
+    out.write(input_string);
+    REQUIRE(out.extents.size() > 1);
+
+    auto n = sk::buffer_write_to(pipe.fds[1], out);
+    REQUIRE(n == input_string.size());
+    REQUIRE(out.empty());
+
+    // Read it back into a circular buffer.
+    sk::circular_buffer<char, 128> in;
+    n = sk::buffer_read_from(pipe.fds[0], in);
+    REQUIRE(n == input_string.size());
+
+    std::string output_string(input_string.size(), 'X');
+    REQUIRE(in.read(output_string) == input_string.size());
+    REQUIRE(output_string == input_string);
+}
+
+TEST_CASE("buffer_read_from end of file") {
+    test_pipe pipe;
+    pipe.close_write();
+
+    sk::dynamic_buffer<char> in;
+    std::error_code ec;
+    auto n = sk::buffer_read_from(pipe.fds[0], in, ec);
+    REQUIRE(!ec);
+    REQUIRE(n == 0);
+}
+
+TEST_CASE("buffer_read_from would block") {
+    test_pipe pipe;
+    REQUIRE(::fcntl(pipe.fds[0], F_SETFL, O_NONBLOCK) == 0);
+
+    sk::dynamic_buffer<char> in;
+    std::error_code ec;
+    auto n = sk::buffer_read_from(pipe.fds[0], in, ec);
+    REQUIRE(n == 0);
+    REQUIRE((ec == std::errc::operation_would_block ||
+             ec == std::errc::resource_unavailable_try_again));
+
+    // The throwing overload should throw.
+    REQUIRE_THROWS_AS(sk::buffer_read_from(pipe.fds[0], in),
+                      std::system_error);
+}
+
+#endif // !_WIN32
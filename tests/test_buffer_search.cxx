@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "sk/buffer/buffer_search.hxx"
+#include "sk/buffer/circular_buffer.hxx"
+#include "sk/buffer/dynamic_buffer.hxx"
+#include "sk/buffer/range_buffer.hxx"
+
+using namespace std::literals;
+
+namespace {
+
+    // Convert a std::string position to the result of a buffer search.
+    auto expected(std::size_t pos) -> std::optional<std::size_t> {
+        if (pos == std::string::npos)
+            return std::nullopt;
+        return pos;
+    }
+
+} // namespace
+
+TEST_CASE("buffer_find single value across extents") {
+    std::string input_string =
+        "this is a long test string that will fill several extents";
+    sk::dynamic_buffer<char, 8> buf;
+    buf.write(input_string);
+
+    REQUIRE(sk::buffer_find(buf, 't') == 0);
+    REQUIRE(sk::buffer_find(buf, 'l') == input_string.find('l'));
+    REQUIRE(sk::buffer_find(buf, 's', 1) == input_string.find('s', 1));
+    REQUIRE(sk::buffer_find(buf, 's', 50) == input_string.find('s', 50));
+    REQUIRE(!sk::buffer_find(buf, 'Z'));
+    REQUIRE(!sk::buffer_find(buf, 't', 1000));
+
+    // The result can be passed to discard().
+    buf.discard(*sk::buffer_find(buf, 'w'));
+    std::string rest(buf.size(), 'X');
+    buf.read(rest);
+    REQUIRE(rest == input_string.substr(input_string.find('w')));
+}
+
+TEST_CASE("buffer_find matches std::string::find on large data") {
+    // Use enough data for the SIMD loops to run, with extents of a size
+    // which isn't a multiple of the vector size.
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> dist('a', 'z');
+    std::string input_string(10000, ' ');
+    for (auto &c : input_string)
+        c = static_cast<char>(dist(rng));
+
+    sk::dynamic_buffer<char, 1000> buf;
+    buf.write(input_string);
+
+    for (auto from : {0u, 1u, 15u, 999u, 1000u, 5000u, 9999u}) {
+        for (char c : "aqzZ"sv)
+            REQUIRE(sk::buffer_find(buf, c, from) ==
+                    expected(input_string.find(c, from)));
+
+        for (auto needle : {"ab"sv, "xyz"sv, "q"sv, "zzzz"sv})
+            REQUIRE(sk::buffer_find(buf, needle, from) ==
+                    expected(input_string.find(needle, from)));
+
+        for (auto set : {"xy"sv, "q"sv, "0z"sv, "0123456789"sv,
+                         "0123456789ABCDEFGHIJa"sv})
+            REQUIRE(sk::buffer_find_first_of(buf, set, from) ==
+                    expected(input_string.find_first_of(set, from)));
+    }
+}
+
+TEST_CASE("buffer_find needle straddling extents") {
+    sk::dynamic_buffer<char, 4> buf;
+    buf.write("GET / HTTP/1.1\r\nHost: x\r\n\r\nbody"sv);
+
+    // The first \r\n is split across two extents.
+    REQUIRE(sk::buffer_find(buf, "\r\n"sv) == 14);
+    REQUIRE(sk::buffer_find(buf, "\r\n"sv, 15) == 23);
+    REQUIRE(sk::buffer_find(buf, "\r\n\r\n"sv) == 23);
+    REQUIRE(!sk::buffer_find(buf, "\r\n\r\n\r\n"sv));
+
+    // A partial match at the end of the data is not a match.
+    REQUIRE(!sk::buffer_find(buf, "bodyx"sv));
+    REQUIRE(sk::buffer_find(buf, "body"sv) == 27);
+
+    // An empty needle matches at the starting offset.
+    REQUIRE(sk::buffer_find(buf, ""sv, 3) == 3);
+}
+
+TEST_CASE("buffer_find at the circular_buffer wrap point") {
+    sk::circular_buffer<char, 16> buf;
+
+    // Move the read and write pointers near the end of the buffer.
+    std::string padding(12, 'x');
+    buf.write(padding);
+    buf.discard(padding.size());
+
+    buf.write("ab\r\ncd"sv);
+    auto ranges = buf.readable_ranges();
+    REQUIRE(ranges.size() == 2);
+
+    REQUIRE(sk::buffer_find(buf, "\r\n"sv) == 2);
+    REQUIRE(sk::buffer_find(buf, 'd') == 5);
+    REQUIRE(sk::buffer_find_first_of(buf, "\nc"sv) == 3);
+}
+
+TEST_CASE("buffer_find with non-byte values") {
+    std::vector<std::uint32_t> data{1, 2, 3, 4, 5, 3, 4};
+    auto buf = sk::make_readable_range_buffer(data);
+
+    REQUIRE(sk::buffer_find(buf, 4u) == 3);
+    REQUIRE(sk::buffer_find(buf, std::vector<std::uint32_t>{3, 4}, 3) == 5);
+    REQUIRE(sk::buffer_find_first_of(buf, std::vector<std::uint32_t>{9, 5}) ==
+            4);
+}
+
+TEST_CASE("buffer_split") {
+    sk::dynamic_buffer<char, 4> buf;
+    buf.write("one\r\ntwo\r\n\r\nthree\r\npartial"sv);
+
+    std::vector<std::string> segments;
+    auto end = sk::buffer_split(buf, "\r\n"sv, [&](auto offset, auto size) {
+        std::string segment(offset + size, 'X');
+        sk::dynamic_buffer<char, 4> copy;
+        sk::buffer_copy(buf, copy);
+        copy.read(segment);
+        segments.push_back(segment.substr(offset));
+    });
+
+    REQUIRE(segments == std::vector<std::string>{"one", "two", "", "three"});
+    REQUIRE(end == 19);
+
+    buf.discard(end);
+    std::string rest(buf.size(), 'X');
+    buf.read(rest);
+    REQUIRE(rest == "partial");
+}
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "sk/buffer/buffer_serialize.hxx"
+#include "sk/buffer/dynamic_buffer.hxx"
+#include "sk/buffer/fixed_buffer.hxx"
+
+namespace {
+
+    enum struct colour : std::uint16_t { red = 1, green = 0x1234 };
+
+    template <typename Buffer> auto contents(Buffer &buf) -> std::string {
+        std::string data(buf.size(), '\0');
+        std::size_t n = 0;
+        for (auto &&range : buf.readable_ranges()) {
+            std::ranges::copy(range, data.begin() + n);
+            n += std::ranges::size(range);
+        }
+        return data;
+    }
+
+} // namespace
+
+TEST_CASE("buffer_put byte order") {
+    sk::dynamic_buffer<char> buf;
+
+    REQUIRE(sk::buffer_put(buf, std::uint32_t{0x01020304}));
+    REQUIRE(sk::buffer_put(buf, std::uint32_t{0x01020304},
+                           std::endian::little));
+    REQUIRE(sk::buffer_put(buf, std::int16_t{-2}));
+    REQUIRE(sk::buffer_put(buf, colour::green));
+
+    REQUIRE(contents(buf) ==
+            std::string("\x01\x02\x03\x04\x04\x03\x02\x01\xff\xfe\x12\x34",
+                        12));
+
+    REQUIRE(sk::buffer_get<std::uint32_t>(buf) == 0x01020304u);
+    REQUIRE(sk::buffer_get<std::uint32_t>(buf, std::endian::little) ==
+            0x01020304u);
+    REQUIRE(sk::buffer_get<std::int16_t>(buf) == -2);
+    REQUIRE(sk::buffer_get<colour>(buf) == colour::green);
+    REQUIRE(buf.empty());
+}
+
+TEST_CASE("buffer_put floating point") {
+    sk::dynamic_buffer<std::byte> buf;
+
+    REQUIRE(sk::buffer_put(buf, 1.5));
+    REQUIRE(sk::buffer_put(buf, -0.25f, std::endian::little));
+    REQUIRE(sk::buffer_put(buf, std::numeric_limits<double>::infinity()));
+
+    REQUIRE(sk::buffer_get<double>(buf) == 1.5);
+    REQUIRE(sk::buffer_get<float>(buf, std::endian::little) == -0.25f);
+    REQUIRE(sk::buffer_get<double>(buf) ==
+            std::numeric_limits<double>::infinity());
+}
+
+TEST_CASE("buffer_put across extent boundaries") {
+    // With 3-byte extents, every 8-byte value crosses a boundary.
+    sk::dynamic_buffer<char, 3> buf;
+
+    for (std::uint64_t i = 0; i < 100; ++i)
+        REQUIRE(sk::buffer_put(buf, i * 0x0101010101010101ull));
+
+    REQUIRE(buf.size() == 800);
+
+    for (std::uint64_t i = 0; i < 100; ++i)
+        REQUIRE(sk::buffer_get<std::uint64_t>(buf) ==
+                i * 0x0101010101010101ull);
+}
+
+TEST_CASE("buffer_get with incomplete data") {
+    sk::dynamic_buffer<char, 4> buf;
+    buf.write(std::string("\x01\x02\x03", 3));
+
+    REQUIRE(!sk::buffer_get<std::uint32_t>(buf));
+    REQUIRE(buf.size() == 3);
+
+    buf.write(std::string("\x04"));
+    REQUIRE(sk::buffer_get<std::uint32_t>(buf) == 0x01020304u);
+}
+
+TEST_CASE("buffer_put into a full buffer") {
+    sk::fixed_buffer<char, 6> buf;
+    REQUIRE(sk::buffer_put(buf, std::uint32_t{1}));
+    REQUIRE(!sk::buffer_put(buf, std::uint32_t{2}));
+}
+
+TEST_CASE("buffer_put_varint unsigned") {
+    sk::dynamic_buffer<char, 5> buf;
+
+    REQUIRE(sk::buffer_put_varint(buf, 0u));
+    REQUIRE(sk::buffer_put_varint(buf, 127u));
+    REQUIRE(sk::buffer_put_varint(buf, 128u));
+    REQUIRE(sk::buffer_put_varint(buf, 624485u));
+    REQUIRE(contents(buf) == std::string("\x00\x7f\x80\x01\xe5\x8e\x26", 7));
+
+    REQUIRE(sk::buffer_get_varint<unsigned>(buf) == 0u);
+    REQUIRE(sk::buffer_get_varint<unsigned>(buf) == 127u);
+    REQUIRE(sk::buffer_get_varint<unsigned>(buf) == 128u);
+    REQUIRE(sk::buffer_get_varint<unsigned>(buf) == 624485u);
+    REQUIRE(buf.empty());
+
+    auto max = std::numeric_limits<std::uint64_t>::max();
+    REQUIRE(sk::buffer_put_varint(buf, max));
+    REQUIRE(buf.size() == 10);
+    REQUIRE(sk::buffer_get_varint<std::uint64_t>(buf) == max);
+}
+
+TEST_CASE("buffer_put_varint signed") {
+    sk::dynamic_buffer<char, 5> buf;
+
+    REQUIRE(sk::buffer_put_varint(buf, -1));
+    REQUIRE(sk::buffer_put_varint(buf, 63));
+    REQUIRE(sk::buffer_put_varint(buf, 64));
+    REQUIRE(sk::buffer_put_varint(buf, -123456));
+    REQUIRE(contents(buf) ==
+            std::string("\x7f\x3f\xc0\x00\xc0\xbb\x78", 7));
+
+    REQUIRE(sk::buffer_get_varint<int>(buf) == -1);
+    REQUIRE(sk::buffer_get_varint<int>(buf) == 63);
+    REQUIRE(sk::buffer_get_varint<int>(buf) == 64);
+    REQUIRE(sk::buffer_get_varint<int>(buf) == -123456);
+
+    for (auto v : {std::numeric_limits<std::int64_t>::min(),
+                   std::numeric_limits<std::int64_t>::max()}) {
+        REQUIRE(sk::buffer_put_varint(buf, v));
+        REQUIRE(sk::buffer_get_varint<std::int64_t>(buf) == v);
+    }
+
+    for (int v = -128; v < 128; ++v) {
+        REQUIRE(sk::buffer_put_varint(buf, static_cast<std::int8_t>(v)));
+        REQUIRE(sk::buffer_get_varint<std::int8_t>(buf) == v);
+    }
+}
+
+TEST_CASE("buffer_get_varint incomplete and malformed") {
+    sk::dynamic_buffer<char, 4> buf;
+
+    // A continuation byte with nothing after it.
+    buf.write(std::string("\x80\x80"));
+    REQUIRE(!sk::buffer_get_varint<unsigned>(buf));
+    REQUIRE(buf.size() == 2);
+    buf.write(std::string("\x01", 1));
+    REQUIRE(sk::buffer_get_varint<unsigned>(buf) == 1u << 14);
+
+    // 256 doesn't fit in a uint8_t.
+    buf.write(std::string("\x80\x02"));
+    std::error_code ec;
+    REQUIRE(!sk::buffer_get_varint<std::uint8_t>(buf, ec));
+    REQUIRE(ec == std::errc::value_too_large);
+    REQUIRE_THROWS_AS(sk::buffer_get_varint<std::uint8_t>(buf),
+                      std::system_error);
+    REQUIRE(sk::buffer_get_varint<std::uint16_t>(buf) == 256u);
+
+    // Too many bytes.
+    buf.write(std::string("\x80\x80\x80\x80\x80\x00", 6));
+    REQUIRE(!sk::buffer_get_varint<std::uint32_t>(buf, ec));
+    REQUIRE(ec == std::errc::value_too_large);
+}
+
+TEST_CASE("buffer_put_blob") {
+    std::string input_string =
+        "this is a longer blob which will cross several extents";
+    sk::dynamic_buffer<char, 8> buf;
+
+    REQUIRE(sk::buffer_put_blob(buf, input_string));
+    REQUIRE(sk::buffer_put_blob(buf, std::string()));
+    REQUIRE(buf.size() == input_string.size() + 2);
+
+    std::string output_string;
+    REQUIRE(sk::buffer_get_blob(buf, output_string));
+    REQUIRE(output_string == input_string);
+    REQUIRE(sk::buffer_get_blob(buf, output_string));
+    REQUIRE(output_string.empty());
+    REQUIRE(buf.empty());
+}
+
+TEST_CASE("buffer_get_blob incomplete and too large") {
+    sk::dynamic_buffer<char, 8> buf;
+    buf.write(std::string("\x05hel"));
+
+    std::vector<char> out;
+    REQUIRE(!sk::buffer_get_blob(buf, out));
+    REQUIRE(buf.size() == 4);
+
+    buf.write(std::string("lo"));
+    REQUIRE(sk::buffer_get_blob(buf, out));
+    REQUIRE(std::string(out.begin(), out.end()) == "hello");
+
+    buf.write(std::string("\x05hello"));
+    std::error_code ec;
+    REQUIRE(!sk::buffer_get_blob(buf, out, ec, 4));
+    REQUIRE(ec == std::errc::message_size);
+    REQUIRE(buf.size() == 6);
+}
+
+TEST_CASE("buffer_writer and buffer_reader") {
+    // Small extents, so values cross extent boundaries.
+    sk::dynamic_buffer<char, 7> buf;
+
+    {
+        sk::buffer_writer writer(buf);
+        for (std::uint32_t i = 0; i < 50; ++i) {
+            REQUIRE(writer.put(i));
+            REQUIRE(writer.put_varint(i * 1000));
+            REQUIRE(writer.put(static_cast<std::uint8_t>(i),
+                               std::endian::little));
+        }
+        REQUIRE(writer.put_blob(std::string("end")));
+        REQUIRE(writer.put(std::uint16_t{0xBEEF}));
+    }
+
+    sk::buffer_reader reader(buf);
+    for (std::uint32_t i = 0; i < 50; ++i) {
+        REQUIRE(reader.get<std::uint32_t>() == i);
+        REQUIRE(reader.get_varint<std::uint32_t>() == i * 1000);
+        REQUIRE(reader.get<std::uint8_t>(std::endian::little) == i);
+    }
+
+    std::string blob;
+    REQUIRE(reader.get_blob(blob));
+    REQUIRE(blob == "end");
+    REQUIRE(reader.get<std::uint16_t>() == 0xBEEF);
+    REQUIRE(!reader.get<std::uint8_t>());
+
+    reader.discard();
+    REQUIRE(buf.empty());
+}
+
+TEST_CASE("buffer_writer commits on demand") {
+    sk::dynamic_buffer<char> buf;
+    sk::buffer_writer writer(buf);
+
+    writer.put(std::uint32_t{1});
+    writer.put(std::uint32_t{2});
+    REQUIRE(buf.empty());
+
+    writer.commit();
+    REQUIRE(buf.size() == 8);
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include <catch.hpp>
+
+#include "sk/buffer/buffer_stats.hxx"
+#include "sk/buffer/circular_buffer.hxx"
+#include "sk/buffer/dynamic_buffer.hxx"
+
+namespace {
+
+    using counted_dynamic_buffer =
+        sk::dynamic_buffer<char, 16, std::allocator<char>, sk::buffer_stats>;
+
+} // namespace
+
+TEST_CASE("null_buffer_stats takes no space") {
+    REQUIRE(std::is_empty_v<sk::null_buffer_stats>);
+    REQUIRE(sizeof(sk::circular_buffer<char, 15>) ==
+            sizeof(sk::circular_buffer<char, 15>::array_type) +
+                2 * sizeof(char *));
+}
+
+TEST_CASE("buffer_stats counts dynamic_buffer copies and zero-copy data") {
+    counted_dynamic_buffer buf;
+    auto const &stats = buf.stats;
+
+    buf.write(std::string("0123456789"));
+    REQUIRE(stats.writes == 1);
+    REQUIRE(stats.copied_in == 10);
+    REQUIRE(stats.committed == 10);
+
+    // Writing through writable_ranges() isn't a copy.
+    auto ranges = buf.writable_ranges();
+    auto range = *std::ranges::begin(ranges);
+    range[0] = 'x';
+    range[1] = 'y';
+    buf.commit(2);
+    REQUIRE(stats.committed == 12);
+    REQUIRE(stats.zero_copy_in() == 2);
+    REQUIRE(stats.peak_size == 12);
+
+    char out[4];
+    REQUIRE(buf.read(out) == 4);
+    REQUIRE(stats.reads == 1);
+    REQUIRE(stats.copied_out == 4);
+    REQUIRE(stats.discarded == 4);
+
+    buf.discard(3);
+    REQUIRE(stats.discarded == 7);
+    REQUIRE(stats.zero_copy_out() == 3);
+
+    buf.clear();
+    REQUIRE(stats.discarded == 12);
+    REQUIRE(stats.peak_size == 12);
+    REQUIRE(stats.short_writes == 0);
+}
+
+TEST_CASE("buffer_stats counts dynamic_buffer extent churn") {
+    counted_dynamic_buffer buf;
+    auto const &stats = buf.stats;
+
+    // 40 objects in three 16-object extents.
+    buf.write(std::string(40, 'x'));
+    REQUIRE(stats.extents_added == 3);
+    REQUIRE(stats.largest_extent == 16);
+    REQUIRE(stats.extents_removed == 0);
+
+    buf.discard(16);
+    REQUIRE(stats.extents_removed == 1);
+
+    buf.clear();
+    REQUIRE(stats.extents_removed == stats.extents_added);
+}
+
+TEST_CASE("buffer_stats counts shared data as zero-copy") {
+    counted_dynamic_buffer a, b;
+    a.write(std::string(20, 'x'));
+
+    REQUIRE(b.append_shared(a) == 20);
+    REQUIRE(b.stats.committed == 20);
+    REQUIRE(b.stats.copied_in == 0);
+    REQUIRE(b.stats.extents_added == 2);
+}
+
+TEST_CASE("buffer_stats counts short writes to a dynamic_buffer") {
+    counted_dynamic_buffer buf;
+    buf.size_limit = 8;
+
+    REQUIRE(buf.write(std::string(10, 'x')) == 8);
+    REQUIRE(buf.write(std::string(1, 'x')) == 0);
+    REQUIRE(buf.stats.writes == 2);
+    REQUIRE(buf.stats.short_writes == 2);
+    REQUIRE(buf.stats.copied_in == 8);
+}
+
+TEST_CASE("buffer_stats counts circular_buffer operations") {
+    sk::circular_buffer<char, 8, alignof(char), sk::buffer_stats> buf;
+    auto const &stats = buf.stats;
+
+    REQUIRE(buf.write(std::string("0123456789")) == 8);
+    REQUIRE(stats.short_writes == 1);
+    REQUIRE(stats.copied_in == 8);
+    REQUIRE(stats.committed == 8);
+    REQUIRE(stats.peak_size == 8);
+
+    std::string out(5, '\0');
+    REQUIRE(buf.read(out) == 5);
+    REQUIRE(stats.copied_out == 5);
+    REQUIRE(stats.discarded == 5);
+
+    // Wrap around using the zero-copy interface.
+    for (auto &&range : buf.writable_ranges())
+        for (auto &c : range)
+            c = 'z';
+    REQUIRE(buf.commit(5) == 5);
+    REQUIRE(stats.zero_copy_in() == 5);
+    REQUIRE(stats.peak_size == 8);
+
+    REQUIRE(buf.discard(8) == 8);
+    REQUIRE(stats.zero_copy_out() == 8);
+    REQUIRE(stats.extents_added == 0);
+}
+
+TEST_CASE("thread_buffer_stats totals every buffer on the thread") {
+    using buffer_type = sk::dynamic_buffer<char, 16, std::allocator<char>,
+                                           sk::thread_buffer_stats>;
+
+    auto &totals = sk::thread_buffer_stats::thread_totals();
+    auto before = totals;
+
+    {
+        buffer_type a, b;
+        a.write(std::string(10, 'x'));
+        b.write(std::string(20, 'y'));
+        b.discard(5);
+    }
+
+    REQUIRE(totals.writes - before.writes == 2);
+    REQUIRE(totals.copied_in - before.copied_in == 30);
+    REQUIRE(totals.discarded - before.discarded == 30);
+    REQUIRE(totals.extents_removed - before.extents_removed ==
+            totals.extents_added - before.extents_added);
+
+    sk::buffer_stats sum;
+    sum += before;
+    sum += before;
+    REQUIRE(sum.writes == 2 * before.writes);
+    REQUIRE(sum.peak_size == before.peak_size);
+}
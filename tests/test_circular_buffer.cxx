@@ -26,6 +26,7 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <cstdint>
 #include <numeric>
 #include <catch.hpp>
 
@@ -112,3 +113,37 @@ TEST_CASE("circular_buffer reads") {
         }
     }
 }
+
+TEST_CASE("circular_buffer wrapped ranges") {
+    sk::circular_buffer<char, 4> buf;
+
+    // Move the read and write pointers forward so the next write wraps.
+    REQUIRE(buf.write(std::string("abc")) == 3);
+    std::string ret(3, 'X');
+    REQUIRE(buf.read(ret) == 3);
+
+    REQUIRE(buf.write(std::string("test")) == 4);
+
+    // The data now wraps around the end of the buffer, so there should be
+    // two readable ranges.
+    auto ranges = buf.readable_ranges();
+    REQUIRE(ranges.size() == 2);
+
+    std::string data;
+    for (auto &&range : ranges)
+        data.append(range.begin(), range.end());
+    REQUIRE(data == "test");
+
+    // The buffer is full, so there's nothing to write to.
+    REQUIRE(buf.writable_ranges().empty());
+}
+
+TEST_CASE("aligned circular_buffer") {
+    sk::circular_buffer<char, 4096, 64> buf;
+
+    auto ranges = buf.writable_ranges();
+    auto addr = reinterpret_cast<std::uintptr_t>(
+        std::ranges::data(*std::ranges::begin(ranges)));
+    REQUIRE(addr % 64 == 0);
+    REQUIRE(buf.write(std::string("test")) == 4);
+}
@@ -26,8 +26,12 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <cstdint>
 #include <ranges>
 #include <algorithm>
+#include <memory_resource>
+#include <set>
+#include <vector>
 #include <catch.hpp>
 
 #include "sk/buffer/dynamic_buffer.hxx"
@@ -293,4 +297,719 @@ namespace yarrow::test_buffer {
         REQUIRE(nbytes == 0);
     }
 
-} // namespace yarrow::test_buffer
\ No newline at end of file
+    // A memory resource which counts how many allocations it has made.
+    struct counting_resource : std::pmr::memory_resource {
+        std::size_t nallocs = 0;
+        std::size_t nfrees = 0;
+
+        auto do_allocate(std::size_t bytes, std::size_t align)
+            -> void * override {
+            ++nallocs;
+            return std::pmr::new_delete_resource()->allocate(bytes, align);
+        }
+
+        auto do_deallocate(void *p, std::size_t bytes, std::size_t align)
+            -> void override {
+            ++nfrees;
+            std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+        }
+
+        auto do_is_equal(std::pmr::memory_resource const &other) const noexcept
+            -> bool override {
+            return this == &other;
+        }
+    };
+
+    TEST_CASE("pmr_dynamic_buffer") {
+        std::string input_string =
+            "this is a long test string that will fill several extents";
+        counting_resource resource;
+
+        {
+            sk::pmr_dynamic_buffer<char, 3> buf(&resource);
+            buf.write(input_string);
+
+            // The extents and the extent list should come from our resource.
+            REQUIRE(resource.nallocs > buf.extents.size());
+
+            std::string output_string(input_string.size(), 'A');
+            auto nbytes = buf.read(output_string);
+            REQUIRE(nbytes == input_string.size());
+            REQUIRE(output_string == input_string);
+        }
+
+        // Destroying the buffer should free everything.
+        REQUIRE(resource.nfrees == resource.nallocs);
+    }
+
+    TEST_CASE("pmr_dynamic_buffer move") {
+        std::string input_string =
+            "this is a long test string that will fill several extents";
+        counting_resource resource1, resource2;
+
+        sk::pmr_dynamic_buffer<char, 3> buf1(&resource1);
+        buf1.write(input_string);
+
+        // Moving to a buffer with the same resource takes the extents.
+        sk::pmr_dynamic_buffer<char, 3> buf2(&resource1);
+        buf2 = std::move(buf1);
+        REQUIRE(buf1.extents.empty());
+
+        // Moving to a buffer with a different resource copies the data.
+        sk::pmr_dynamic_buffer<char, 3> buf3(&resource2);
+        buf3 = std::move(buf2);
+        REQUIRE(buf2.extents.empty());
+        REQUIRE(resource2.nallocs > 0);
+
+        std::string output_string(input_string.size(), 'A');
+        auto nbytes = buf3.read(output_string);
+        REQUIRE(nbytes == input_string.size());
+        REQUIRE(output_string == input_string);
+    }
+
+    TEST_CASE("pmr_dynamic_buffer with monotonic_buffer_resource") {
+        std::string input_string =
+            "this is a long test string that will fill several extents";
+        // Allocate everything from a local arena; if the buffer tries to
+        // allocate from anywhere else, null_memory_resource will throw.
+        std::array<std::byte, 16384> storage;
+        std::pmr::monotonic_buffer_resource local_arena(
+            storage.data(), storage.size(), std::pmr::null_memory_resource());
+
+        sk::pmr_dynamic_buffer<char, 64> buf(&local_arena);
+        buf.write(input_string);
+
+        std::string output_string(input_string.size(), 'A');
+        auto nbytes = buf.read(output_string);
+        REQUIRE(nbytes == input_string.size());
+        REQUIRE(output_string == input_string);
+    }
+
+    // Read everything in a buffer into a string.
+    template <typename Buffer> auto read_all(Buffer &buf) -> std::string {
+        std::string ret(buf.size(), 'X');
+        REQUIRE(buf.read(ret) == ret.size());
+        return ret;
+    }
+
+    TEST_CASE("pmr_dynamic_buffer move to a buffer with a smaller limit") {
+        std::string input_string =
+            "this is a long test string that will fill several extents";
+        counting_resource resource1, resource2;
+
+        sk::pmr_dynamic_buffer<char, 3> buf1(&resource1);
+        buf1.size_limit = 1000;
+        buf1.write(input_string);
+
+        // Copying the data moves all of it and takes buf1's limit.
+        sk::pmr_dynamic_buffer<char, 3> buf2(&resource2);
+        buf2.size_limit = 10;
+        buf2 = std::move(buf1);
+        REQUIRE(buf1.size() == 0);
+        REQUIRE(buf2.size_limit == 1000);
+        REQUIRE(read_all(buf2) == input_string);
+
+        // So does taking the extents.
+        buf2.write(input_string);
+        sk::pmr_dynamic_buffer<char, 3> buf3(&resource2);
+        buf3.size_limit = 10;
+        buf3 = std::move(buf2);
+        REQUIRE(buf3.size_limit == 1000);
+        REQUIRE(read_all(buf3) == input_string);
+    }
+
+    TEST_CASE("dynamic_buffer splice") {
+        std::string input_string =
+            "this is a long test string that will fill several extents";
+        sk::dynamic_buffer<char, 8> from, to;
+
+        from.write(input_string);
+        to.write(std::string("prefix:"));
+        auto from_ranges = from.readable_ranges();
+        auto const *first_data = (*std::ranges::begin(from_ranges)).data();
+
+        // Splice all but the last 5 characters.
+        auto n = input_string.size() - 5;
+        REQUIRE(to.splice(from, n) == n);
+        REQUIRE(from.size() == 5);
+        REQUIRE(to.size() == n + 7);
+
+        // The data was not copied: the spliced ranges point into the same
+        // extents.
+        auto to_ranges = to.readable_ranges();
+        auto found = std::ranges::any_of(
+            to_ranges, [&](auto const &r) { return r.data() == first_data; });
+        REQUIRE(found);
+
+        // Writing to either buffer doesn't affect the other.
+        to.write(std::string("!"));
+        from.write(std::string("?"));
+
+        REQUIRE(read_all(to) == "prefix:" + input_string.substr(0, n) + "!");
+        REQUIRE(read_all(from) == input_string.substr(n) + "?");
+    }
+
+    TEST_CASE("dynamic_buffer append_shared to several buffers") {
+        std::string input_string =
+            "this is a long test string that will fill several extents";
+        sk::dynamic_buffer<char, 8> from;
+        from.write(input_string);
+
+        std::vector<sk::dynamic_buffer<char, 8>> subscribers(3);
+        for (auto &sub : subscribers)
+            REQUIRE(sub.append_shared(from, 5, 10) == 10);
+
+        // The source is unchanged, and can be discarded independently.
+        REQUIRE(read_all(from) == input_string);
+
+        for (auto &sub : subscribers) {
+            sub.write(std::string("."));
+            REQUIRE(read_all(sub) == input_string.substr(5, 10) + ".");
+        }
+
+        // Offsets past the end of the data share nothing.
+        REQUIRE(subscribers[0].append_shared(from, 1000) == 0);
+    }
+
+    TEST_CASE("dynamic_buffer shared extents are released once") {
+        std::string input_string = "0123456789abcdef";
+        auto &shared =
+            sk::dynamic_buffer<char, 4>::shared_extent_pool_type::global();
+        shared.release();
+
+        {
+            sk::dynamic_buffer<char, 4> from(shared), to(shared);
+            from.pool.set_high_water(0);
+            to.pool.set_high_water(0);
+
+            from.write(input_string);
+            to.append_shared(from);
+
+            // Dropping the source's references keeps the data alive.
+            from.clear();
+            REQUIRE(read_all(to) == input_string);
+        }
+
+        // Every extent was returned to the shared pool exactly once.
+        std::set<sk::dynamic_buffer<char, 4>::extent_type *> extents;
+        while (extents.size() < 8) {
+            auto *ext = shared.allocate();
+            if (!extents.insert(ext).second)
+                FAIL("extent returned twice");
+            if (ext->refs != 0)
+                FAIL("extent still referenced");
+        }
+        for (auto *ext : extents)
+            shared.deallocate(ext);
+    }
+
+    TEST_CASE("pmr_dynamic_buffer splice with different resources copies") {
+        std::string input_string =
+            "this is a long test string that will fill several extents";
+        counting_resource resource1, resource2;
+
+        sk::pmr_dynamic_buffer<char, 8> from(&resource1);
+        sk::pmr_dynamic_buffer<char, 8> to(&resource2);
+        from.write(input_string);
+
+        REQUIRE(!to.can_share_with(from));
+        REQUIRE(to.splice(from, 10) == 10);
+        REQUIRE(from.size() == input_string.size() - 10);
+        REQUIRE(read_all(to) == input_string.substr(0, 10));
+    }
+
+    TEST_CASE("dynamic_buffer linearize") {
+        std::string input_string = "0123456789abcdef";
+        sk::dynamic_buffer<char, 4> buf;
+        buf.write(input_string);
+        buf.discard(1);
+
+        // Already contiguous.
+        auto ranges = buf.readable_ranges();
+        auto front = (*std::ranges::begin(ranges)).data();
+        auto span = buf.linearize(3);
+        REQUIRE(span.data() == front);
+        REQUIRE(std::string(span.begin(), span.end()) == "123");
+
+        // Crossing extents: the data is moved to a new front extent.
+        span = buf.linearize(4);
+        REQUIRE(std::string(span.begin(), span.end()) == "1234");
+        ranges = buf.readable_ranges();
+        REQUIRE(span.data() == (*std::ranges::begin(ranges)).data());
+        REQUIRE(buf.size() == input_string.size() - 1);
+
+        // Larger than an extent, or more than the buffer holds.
+        REQUIRE(buf.linearize(5).empty());
+        REQUIRE(buf.linearize(100).empty());
+
+        // The buffer still holds the same data, and can be written to.
+        buf.write(std::string("!"));
+        REQUIRE(read_all(buf) == input_string.substr(1) + "!");
+    }
+
+    TEST_CASE("dynamic_buffer geometric extent growth") {
+        std::string input_string(1000, 'x');
+        for (std::size_t i = 0; i < input_string.size(); ++i)
+            input_string[i] = static_cast<char>('a' + i % 26);
+
+        sk::dynamic_buffer<char, 4> buf;
+        buf.max_extent_size = 64;
+
+        REQUIRE(buf.write(input_string) == input_string.size());
+
+        // Extents grow 4, 8, 16, 32, 64, 64...
+        std::vector<std::size_t> sizes;
+        for (auto &ref : buf.extents)
+            sizes.push_back(ref.read_window().size() +
+                            ref.write_window().size());
+
+        REQUIRE(sizes.size() < 25);
+        REQUIRE(sizes[0] == 4);
+        REQUIRE(sizes[1] == 8);
+        REQUIRE(sizes[2] == 16);
+        REQUIRE(sizes[3] == 32);
+        for (std::size_t i = 4; i < sizes.size(); ++i)
+            REQUIRE(sizes[i] == 64);
+
+        REQUIRE(std::ranges::distance(buf.readable_ranges()) ==
+                static_cast<std::ptrdiff_t>(sizes.size()));
+        REQUIRE(read_all(buf) == input_string);
+
+        // Once the buffer is empty, new extents start small again.
+        REQUIRE(buf.empty());
+        auto nkept = buf.extents.size();
+        buf.write(input_string);
+        REQUIRE(buf.extents.size() > nkept + 1);
+        auto &next = buf.extents[nkept];
+        REQUIRE(next.read_window().size() + next.write_window().size() == 4);
+        REQUIRE(read_all(buf) == input_string);
+    }
+
+    TEST_CASE("dynamic_buffer without growth uses fixed extents") {
+        std::string input_string(100, 'x');
+        sk::dynamic_buffer<char, 4> buf;
+        buf.write(input_string);
+        for (auto &ref : buf.extents)
+            REQUIRE(ref.read_window().size() + ref.write_window().size() == 4);
+        REQUIRE(read_all(buf) == input_string);
+    }
+
+    TEST_CASE("pmr_dynamic_buffer geometric extent growth") {
+        std::string input_string(500, 'x');
+        counting_resource resource;
+
+        {
+            sk::pmr_dynamic_buffer<char, 8> buf(&resource);
+            buf.max_extent_size = 256;
+
+            buf.write(input_string);
+            auto nallocs = resource.nallocs;
+            REQUIRE(nallocs > 0);
+
+            // Large extents are shared like pooled ones.
+            sk::pmr_dynamic_buffer<char, 8> other(&resource);
+            other.splice(buf, 300);
+            REQUIRE(read_all(other) == input_string.substr(0, 300));
+            REQUIRE(read_all(buf) == input_string.substr(300));
+        }
+
+        REQUIRE(resource.nallocs == resource.nfrees);
+    }
+
+    TEST_CASE("dynamic_buffer commit exactly filling an extent") {
+        sk::dynamic_buffer<char, 4> buf;
+
+        // Leave one object free in the first extent, which adds a second.
+        buf.write(std::string("abc"));
+        REQUIRE(buf.extents.size() == 2);
+
+        // Fill the first extent exactly through writable_ranges().
+        auto ranges = buf.writable_ranges();
+        auto range = *std::ranges::begin(ranges);
+        REQUIRE(range.size() == 1);
+        range[0] = 'd';
+        buf.commit(1);
+
+        // The next writable range is the start of the second extent.
+        ranges = buf.writable_ranges();
+        range = *std::ranges::begin(ranges);
+        REQUIRE(range.size() == 4);
+        range[0] = 'e';
+        buf.commit(1);
+
+        REQUIRE(read_all(buf) == "abcde");
+    }
+
+    TEST_CASE("dynamic_buffer size limit") {
+        sk::dynamic_buffer<char, 4> buf;
+        buf.size_limit = 10;
+
+        // write() returns a short count once the limit is reached.
+        REQUIRE(buf.write(std::string("abcdefgh")) == 8);
+        REQUIRE(buf.write(std::string("ijkl")) == 2);
+        REQUIRE(buf.write(std::string("m")) == 0);
+        REQUIRE(buf.size() == 10);
+
+        // The buffer doesn't hold much more memory than the limit.
+        REQUIRE(buf.capacity() < 10 + 2 * buf.extent_size);
+
+        // writable_ranges() doesn't offer more space than the limit
+        // allows, so everything it offers can be committed.
+        REQUIRE(buf.discard(3) == 3);
+        std::size_t offered = 0;
+        for (auto &&range : buf.writable_ranges()) {
+            std::ranges::fill(range, 'x');
+            offered += range.size();
+        }
+        REQUIRE(offered > 0);
+        REQUIRE(offered <= 3);
+        REQUIRE(buf.commit(offered) == offered);
+
+        REQUIRE(read_all(buf) ==
+                "defghij" + std::string(offered, 'x'));
+    }
+
+    TEST_CASE("dynamic_buffer size limit with no space left") {
+        sk::dynamic_buffer<char, 4> buf;
+        buf.size_limit = 8;
+
+        // Fill the buffer exactly to the limit, with no free space.
+        REQUIRE(buf.write(std::string("abcdefgh")) == 8);
+        for (auto &&range : buf.writable_ranges())
+            REQUIRE(range.empty());
+        REQUIRE(buf.commit(1) == 0);
+
+        // Raising the limit allows writing again.
+        buf.size_limit = 12;
+        REQUIRE(buf.write(std::string("ijkl")) == 4);
+        REQUIRE(read_all(buf) == "abcdefghijkl");
+    }
+
+    TEST_CASE("dynamic_buffer size limit with geometric growth") {
+        sk::dynamic_buffer<char, 4> buf;
+        buf.max_extent_size = 1024;
+        buf.size_limit = 100;
+
+        std::string input_string(200, 'x');
+        REQUIRE(buf.write(input_string) == 100);
+
+        // Extents don't grow past the limit.
+        REQUIRE(buf.capacity() < 100 + 2 * buf.extent_size);
+        REQUIRE(read_all(buf) == input_string.substr(0, 100));
+    }
+
+    TEST_CASE("dynamic_buffer size limit with splice") {
+        sk::dynamic_buffer<char, 4> from, to;
+        from.write(std::string("abcdefghij"));
+        to.size_limit = 6;
+
+        REQUIRE(to.splice(from) == 6);
+        REQUIRE(read_all(to) == "abcdef");
+        REQUIRE(read_all(from) == "ghij");
+    }
+
+    TEST_CASE("dynamic_buffer watermarks") {
+        sk::dynamic_buffer<char, 4> buf;
+        buf.high_watermark = 10;
+        buf.low_watermark = 4;
+        REQUIRE(!buf.above_high_watermark());
+
+        buf.write(std::string("abcdefghi"));
+        REQUIRE(!buf.above_high_watermark());
+
+        // Reaching the high watermark sets the state...
+        buf.write(std::string("j"));
+        REQUIRE(buf.above_high_watermark());
+
+        // ...which stays set until the low watermark is reached.
+        REQUIRE(buf.discard(5) == 5);
+        REQUIRE(buf.above_high_watermark());
+        buf.write(std::string("klm"));
+        REQUIRE(buf.above_high_watermark());
+
+        std::string out(4, ' ');
+        REQUIRE(buf.read(out) == 4);
+        REQUIRE(buf.size() == 4);
+        REQUIRE(!buf.above_high_watermark());
+
+        // Below the high watermark, the state stays clear.
+        buf.write(std::string("nop"));
+        REQUIRE(!buf.above_high_watermark());
+
+        // commit() also updates the state.
+        auto ranges = buf.writable_ranges();
+        auto range = *std::ranges::begin(ranges);
+        REQUIRE(buf.commit(std::min<std::size_t>(range.size(), 3)) > 0);
+        buf.write(std::string("qrstu"));
+        REQUIRE(buf.above_high_watermark());
+
+        buf.clear();
+        REQUIRE(!buf.above_high_watermark());
+    }
+
+    TEST_CASE("dynamic_buffer shrink_to_fit") {
+        sk::dynamic_buffer<char, 4> buf;
+        buf.pool.set_high_water(8);
+
+        std::string input_string(40, 'x');
+        buf.write(input_string);
+        REQUIRE(buf.discard(38) == 38);
+
+        // The buffer keeps spare space after its data, and the pool keeps
+        // the discarded extents.
+        REQUIRE(buf.capacity() > 2);
+        REQUIRE(buf.pool.spare() > 0);
+
+        buf.shrink_to_fit();
+        REQUIRE(buf.pool.spare() == 0);
+        REQUIRE(buf.size() == 2);
+        REQUIRE(buf.capacity() < 2 + buf.extent_size);
+        for (auto &ref : buf.extents)
+            REQUIRE(!ref.read_window().empty());
+
+        // The buffer still works.
+        buf.write(std::string("abcdef"));
+        REQUIRE(read_all(buf) == "xxabcdef");
+
+        // An empty buffer releases all its extents.
+        buf.shrink_to_fit();
+        REQUIRE(buf.extents.empty());
+        REQUIRE(buf.capacity() == 0);
+
+        buf.write(std::string("ghi"));
+        REQUIRE(read_all(buf) == "ghi");
+
+        // The writable ranges work after shrinking too.
+        buf.shrink_to_fit();
+        auto ranges = buf.writable_ranges();
+        auto range = *std::ranges::begin(ranges);
+        range[0] = 'j';
+        REQUIRE(buf.commit(1) == 1);
+        REQUIRE(read_all(buf) == "j");
+    }
+
+    TEST_CASE("dynamic_buffer shrink_to_fit releases large extents") {
+        counting_resource resource;
+        sk::pmr_dynamic_buffer<char, 8> buf(&resource);
+        buf.max_extent_size = 256;
+
+        buf.write(std::string(500, 'x'));
+        REQUIRE(buf.discard(500) == 500);
+        buf.shrink_to_fit();
+
+        // All the extents have been released, including the large ones.
+        REQUIRE(buf.extents.empty());
+        buf.write(std::string("abc"));
+        REQUIRE(read_all(buf) == "abc");
+    }
+
+    TEST_CASE("dynamic_buffer append_external") {
+        std::string const payload = "external payload";
+        int released = 0;
+
+        sk::dynamic_buffer<char, 8> buf;
+        buf.write(std::string("ab"));
+        REQUIRE(buf.append_external(payload, [&] { ++released; }) ==
+                payload.size());
+        buf.write(std::string("cd"));
+        REQUIRE(buf.size() == 4 + payload.size());
+
+        // The external data is referred to, not copied.
+        auto found = false;
+        for (auto &&range : buf.readable_ranges())
+            if (range.data() == payload.data())
+                found = range.size() == payload.size();
+        REQUIRE(found);
+
+        // Data written afterwards follows it.
+        REQUIRE(buf.discard(2) == 2);
+        REQUIRE(buf.discard(payload.size() - 1) == payload.size() - 1);
+        REQUIRE(released == 0);
+        REQUIRE(read_all(buf) == "dcd");
+        REQUIRE(released == 1);
+    }
+
+    TEST_CASE("dynamic_buffer append_external passes the data to the "
+              "releaser") {
+        std::string const payload = "0123456789";
+        std::span<char const> released_data;
+
+        {
+            sk::dynamic_buffer<char, 8> buf;
+            buf.size_limit = 4;
+            REQUIRE(buf.append_external(payload, [&](auto data) {
+                released_data = data;
+            }) == 4);
+            REQUIRE(read_all(buf) == "0123");
+        }
+
+        // The releaser gets all the data, even if only part was appended.
+        REQUIRE(released_data.data() == payload.data());
+        REQUIRE(released_data.size() == payload.size());
+    }
+
+    TEST_CASE("dynamic_buffer append_external with no room") {
+        sk::dynamic_buffer<char, 8> buf;
+        buf.size_limit = 2;
+        buf.write(std::string("ab"));
+
+        int released = 0;
+        REQUIRE(buf.append_external(std::string_view("cd"),
+                                    [&] { ++released; }) == 0);
+        REQUIRE(released == 1);
+    }
+
+    TEST_CASE("dynamic_buffer append_external shared between buffers") {
+        static char const payload[] = "shared data";
+        int released = 0;
+
+        sk::dynamic_buffer<char, 8> a, b;
+        a.append_external(std::span(payload, sizeof(payload) - 1),
+                          [&] { ++released; });
+        REQUIRE(b.append_shared(a) == sizeof(payload) - 1);
+
+        a.clear();
+        REQUIRE(released == 0);
+        REQUIRE(read_all(b) == "shared data");
+        REQUIRE(released == 1);
+
+        // Without a releaser, the data must outlive the buffer.
+        b.append_external(std::string_view("static"));
+        REQUIRE(read_all(b) == "static");
+    }
+
+    TEST_CASE("aligned_dynamic_buffer extents are aligned") {
+        sk::aligned_dynamic_buffer<char, 64, 16> buf;
+        auto aligned = [](auto const &range) {
+            auto p = reinterpret_cast<std::uintptr_t>(std::ranges::data(range));
+            return p % 64 == 0;
+        };
+
+        // Let the extents grow, so later ones are large extents.
+        buf.max_extent_size = 256;
+
+        std::string input(1000, 'x');
+        REQUIRE(buf.write(input) == input.size());
+
+        auto ranges = buf.readable_ranges();
+        REQUIRE(std::ranges::distance(ranges) > 3);
+        for (auto &&range : ranges)
+            REQUIRE(aligned(range));
+        REQUIRE(read_all(buf) == input);
+    }
+
+    TEST_CASE("dynamic_buffer reserve") {
+        counting_resource resource;
+        sk::pmr_dynamic_buffer<char, 16> buf(&resource);
+        std::string input(100, 'x');
+
+        buf.reserve(input.size());
+        REQUIRE(buf.capacity() >= input.size());
+        auto nallocs = resource.nallocs;
+
+        for (int i = 0; i < 10; ++i) {
+            // Half with write(), half with commit().
+            REQUIRE(buf.write(std::string_view(input).substr(0, 50)) == 50);
+
+            std::size_t n = 0;
+            while (n < 50) {
+                for (auto &&range : buf.writable_ranges()) {
+                    auto m = std::min<std::size_t>(range.size(), 50 - n);
+                    std::ranges::fill(range.first(m), 'x');
+                    REQUIRE(buf.commit(m) == m);
+                    n += m;
+                    if (n == 50)
+                        break;
+                }
+            }
+
+            REQUIRE(read_all(buf) == input);
+        }
+
+        REQUIRE(resource.nallocs == nallocs);
+    }
+
+    TEST_CASE("dynamic_buffer without allocation") {
+        counting_resource resource;
+        sk::pmr_dynamic_buffer<char, 16> buf(&resource);
+        buf.allow_allocation = false;
+
+        // With nothing reserved, nothing can be written.
+        std::string input(100, 'x');
+        REQUIRE(buf.write(input) == 0);
+        REQUIRE(std::ranges::distance(buf.writable_ranges()) == 0);
+        REQUIRE(resource.nallocs == 0);
+
+        buf.reserve(40);
+        auto nallocs = resource.nallocs;
+        REQUIRE(buf.capacity() >= 40);
+
+        // Writes stop once the reserved space is used up.
+        for (int i = 0; i < 10; ++i) {
+            auto n = buf.write(input);
+            REQUIRE(n >= 40);
+            REQUIRE(n < input.size());
+            REQUIRE(buf.write(input) == 0);
+            REQUIRE(std::ranges::distance(buf.writable_ranges()) == 0);
+            REQUIRE(read_all(buf) == input.substr(0, n));
+        }
+
+        REQUIRE(resource.nallocs == nallocs);
+
+        // Allowing allocation lets the buffer grow again.
+        buf.allow_allocation = true;
+        REQUIRE(buf.write(input) == input.size());
+        REQUIRE(read_all(buf) == input);
+    }
+
+    TEST_CASE("dynamic_buffer without allocation after a move") {
+        counting_resource resource;
+        sk::pmr_dynamic_buffer<char, 16> buf1(&resource);
+        buf1.reserve(40);
+        buf1.allow_allocation = false;
+        auto nallocs = resource.nallocs;
+
+        // The moved-to buffer keeps the reserved extents and still doesn't
+        // allocate.
+        auto buf2 = std::move(buf1);
+        REQUIRE(!buf2.allow_allocation);
+
+        std::string input(100, 'x');
+        auto n = buf2.write(input);
+        REQUIRE(n >= 40);
+        REQUIRE(n < input.size());
+        REQUIRE(buf2.write(input) == 0);
+        REQUIRE(read_all(buf2) == input.substr(0, n));
+        REQUIRE(resource.nallocs == nallocs);
+    }
+
+    TEST_CASE("dynamic_buffer extent list entries are compact") {
+        // An extent pointer, a data pointer and three 32-bit offsets.
+        static_assert(sizeof(sk::dynamic_buffer<char>::extent_ref) <=
+                      4 * sizeof(void *));
+    }
+
+    TEST_CASE("dynamic_buffer readable ranges survive adding extents") {
+        sk::dynamic_buffer<char, 4> buf;
+        std::string first = "abcdefghij";
+        REQUIRE(buf.write(first) == first.size());
+
+        auto ranges = buf.readable_ranges();
+        auto nranges = std::ranges::distance(ranges);
+
+        // Add enough extents that the extent list has to grow.
+        std::string more(1000, 'x');
+        REQUIRE(buf.write(more) == more.size());
+
+        // The ranges are the same extents; the last one now also includes
+        // the new data written into it.
+        std::string seen;
+        for (auto &&range : ranges)
+            seen.append(range.begin(), range.end());
+        REQUIRE(std::ranges::distance(ranges) == nranges);
+        REQUIRE(seen.starts_with(first));
+        REQUIRE(seen.size() <= first.size() + 4);
+        REQUIRE(read_all(buf) == first + more);
+    }
+
+} // namespace yarrow::test_buffer
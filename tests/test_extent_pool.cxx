@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+
+#include <catch.hpp>
+
+#include "sk/buffer/dynamic_buffer.hxx"
+#include "sk/buffer/extent_pool.hxx"
+#include "sk/buffer/fixed_buffer.hxx"
+
+using test_extent = sk::fixed_buffer<char, 16>;
+
+TEST_CASE("extent_pool reuses extents") {
+    sk::extent_pool<test_extent> pool(2);
+
+    auto *a = pool.allocate();
+    auto *b = pool.allocate();
+    auto *c = pool.allocate();
+
+    // Write some data so we can check the extent is reset on reuse.
+    a->write(std::string("test"));
+
+    pool.deallocate(a);
+    pool.deallocate(b);
+    REQUIRE(pool.spare() == 2);
+
+    // The pool is full, so this extent is freed.
+    pool.deallocate(c);
+    REQUIRE(pool.spare() == 2);
+
+    auto *d = pool.allocate();
+    auto *e = pool.allocate();
+    REQUIRE(pool.spare() == 0);
+    REQUIRE(std::set{d, e} == std::set{a, b});
+    REQUIRE(d->read_window.size() == 0);
+    REQUIRE(e->read_window.size() == 0);
+
+    pool.deallocate(d);
+    pool.deallocate(e);
+
+    // Lowering the high water mark releases spare extents.
+    pool.set_high_water(1);
+    REQUIRE(pool.spare() == 1);
+}
+
+TEST_CASE("extent_pool reserve") {
+    sk::extent_pool<test_extent> pool(1);
+
+    pool.reserve(3);
+    REQUIRE(pool.spare() == 3);
+    REQUIRE(pool.high_water == 3);
+
+    // The reserved extents can all be taken and given back.
+    std::set<test_extent *> taken;
+    for (int i = 0; i < 3; ++i)
+        taken.insert(pool.allocate());
+    REQUIRE(pool.spare() == 0);
+    for (auto *ext : taken)
+        pool.deallocate(ext);
+    REQUIRE(pool.spare() == 3);
+
+    // Reserving fewer does nothing.
+    pool.reserve(2);
+    REQUIRE(pool.spare() == 3);
+    REQUIRE(pool.high_water == 3);
+}
+
+TEST_CASE("extent_pool with upstream") {
+    sk::shared_extent_pool<test_extent> shared(4, 0);
+    sk::extent_pool<test_extent> pool(0, &shared);
+
+    // With no local spares, extents go straight to the shared pool.
+    auto *a = pool.allocate();
+    pool.deallocate(a);
+    REQUIRE(pool.spare() == 0);
+    REQUIRE(shared.spare() == 1);
+
+    auto *b = pool.allocate();
+    REQUIRE(a == b);
+    REQUIRE(shared.spare() == 0);
+    pool.deallocate(b);
+}
+
+TEST_CASE("shared_extent_pool is thread-safe") {
+    sk::shared_extent_pool<test_extent> shared(8, 2);
+
+    auto worker = [&] {
+        for (int i = 0; i < 1000; ++i) {
+            sk::extent_pool<test_extent> pool(1, &shared);
+            auto *a = pool.allocate();
+            auto *b = pool.allocate();
+            pool.deallocate(a);
+            pool.deallocate(b);
+        }
+    };
+
+    std::thread t1(worker), t2(worker);
+    t1.join();
+    t2.join();
+
+    REQUIRE(shared.spare() <= 8);
+}
+
+TEST_CASE("shared_extent_pool frees its thread cache for the next pool") {
+    // Use a new thread, so its cache isn't already owned by another pool.
+    std::thread([] {
+        std::optional<sk::shared_extent_pool<test_extent>> first, second;
+
+        // The first pool takes the thread cache, and gives it up when it is
+        // destroyed.
+        first.emplace(8, 2);
+        first->deallocate(first->allocate());
+        REQUIRE(first->spare() == 0);
+        first.reset();
+
+        // So the next pool's extents go to the thread cache too.
+        second.emplace(8, 2);
+        second->deallocate(second->allocate());
+        REQUIRE(second->spare() == 0);
+    }).join();
+}
+
+TEST_CASE("dynamic_buffer recycles extents") {
+    std::string input_string("0123456789");
+    sk::dynamic_buffer<char, 4> buf;
+    buf.pool.set_high_water(4);
+
+    std::set<sk::dynamic_buffer<char, 4>::extent_base_type *> seen;
+
+    // Stream data through the buffer; since each write needs no more than
+    // four extents, it should keep reusing the same ones.
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(buf.write(input_string) == input_string.size());
+        for (auto &ref : buf.extents)
+            seen.insert(ref.ext);
+
+        std::string output_string(input_string.size(), 'X');
+        REQUIRE(buf.read(output_string) == input_string.size());
+        REQUIRE(output_string == input_string);
+    }
+
+    REQUIRE(seen.size() <= 8);
+}
+
+TEST_CASE("dynamic_buffer with shared pool") {
+    auto &shared = sk::dynamic_buffer<char, 4>::shared_extent_pool_type::global();
+
+    std::string input_string("this is a long test string");
+    {
+        sk::dynamic_buffer<char, 4> buf(shared);
+        buf.write(input_string);
+    }
+
+    // Destroying the buffer returns its extents to the shared pool, or to
+    // this thread's cache.
+    sk::dynamic_buffer<char, 4> buf(shared);
+    buf.write(input_string);
+
+    std::string output_string(input_string.size(), 'X');
+    REQUIRE(buf.read(output_string) == input_string.size());
+    REQUIRE(output_string == input_string);
+}
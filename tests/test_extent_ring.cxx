@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <memory_resource>
+#include <ranges>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "sk/buffer/extent_ring.hxx"
+
+namespace {
+
+    auto contents(sk::extent_ring<int> const &ring) -> std::vector<int> {
+        return std::vector<int>(ring.begin(), ring.end());
+    }
+
+} // namespace
+
+TEST_CASE("extent_ring push and pop at both ends") {
+    sk::extent_ring<int> ring;
+    REQUIRE(ring.empty());
+    REQUIRE(ring.capacity() == 0);
+
+    for (int i = 0; i < 5; ++i) {
+        ring.push_back(i);
+        ring.push_front(-i - 1);
+    }
+
+    REQUIRE(ring.size() == 10);
+    REQUIRE(contents(ring) ==
+            std::vector{-5, -4, -3, -2, -1, 0, 1, 2, 3, 4});
+    REQUIRE(ring.front() == -5);
+    REQUIRE(ring.back() == 4);
+    REQUIRE(ring[5] == 0);
+
+    ring.pop_front();
+    ring.pop_back();
+    REQUIRE(contents(ring) == std::vector{-4, -3, -2, -1, 0, 1, 2, 3});
+
+    ring.clear();
+    REQUIRE(ring.empty());
+    REQUIRE(ring.capacity() >= 10);
+}
+
+TEST_CASE("extent_ring keeps its order when it grows while wrapped") {
+    sk::extent_ring<int> ring;
+
+    // Move the front around the ring, so the elements wrap around the end
+    // of the storage when it grows.
+    for (int i = 0; i < 5; ++i)
+        ring.push_back(i);
+    for (int i = 0; i < 3; ++i)
+        ring.pop_front();
+
+    auto capacity = ring.capacity();
+    std::vector<int> expected{3, 4};
+    for (int i = 5; ring.capacity() == capacity; ++i) {
+        ring.push_back(i);
+        expected.push_back(i);
+    }
+
+    REQUIRE(contents(ring) == expected);
+}
+
+TEST_CASE("extent_ring iterators survive changes at the ends") {
+    sk::extent_ring<int> ring;
+    for (int i = 0; i < 4; ++i)
+        ring.push_back(i);
+
+    auto it = ring.begin() + 2;
+    auto range = std::ranges::subrange(ring.begin() + 1, ring.end());
+    REQUIRE(it - ring.begin() == 2);
+
+    // Growing the ring and removing other elements from the front doesn't
+    // move the elements.
+    for (int i = 4; i < 100; ++i)
+        ring.push_back(i);
+    ring.pop_front();
+    ring.push_front(-1);
+    ring.pop_front();
+
+    REQUIRE(*it == 2);
+    REQUIRE(std::vector<int>(range.begin(), range.end()) ==
+            std::vector{1, 2, 3});
+    REQUIRE(ring.begin() < it);
+    REQUIRE(it[1] == 3);
+}
+
+TEST_CASE("extent_ring insert and erase") {
+    sk::extent_ring<int> ring;
+    for (int i = 0; i < 6; ++i)
+        ring.push_back(i * 10);
+
+    // Near the front, then near the back.
+    ring.insert(1, 5);
+    ring.insert(6, 45);
+    ring.insert(ring.size(), 60);
+    ring.insert(0, -10);
+    REQUIRE(contents(ring) ==
+            std::vector{-10, 0, 5, 10, 20, 30, 40, 45, 50, 60});
+
+    ring.erase(2);
+    ring.erase(6);
+    ring.erase(0);
+    ring.erase(ring.size() - 1);
+    REQUIRE(contents(ring) == std::vector{0, 10, 20, 30, 40, 50});
+
+    // Inserting into a full ring makes it grow.
+    sk::extent_ring<int> full;
+    while (full.size() < sk::extent_ring<int>::min_capacity)
+        full.push_back(static_cast<int>(full.size()));
+    full.insert(3, 100);
+    REQUIRE(contents(full) == std::vector{0, 1, 2, 100, 3, 4, 5, 6, 7});
+}
+
+TEST_CASE("extent_ring move") {
+    sk::extent_ring<int> a;
+    a.push_back(1);
+    a.push_back(2);
+
+    sk::extent_ring<int> b(std::move(a));
+    REQUIRE(a.empty());
+    REQUIRE(contents(b) == std::vector{1, 2});
+
+    a.push_back(3);
+    a = std::move(b);
+    REQUIRE(b.empty());
+    REQUIRE(contents(a) == std::vector{1, 2});
+}
+
+TEST_CASE("extent_ring move with unequal allocators copies") {
+    std::pmr::monotonic_buffer_resource res1, res2;
+    using alloc_type = std::pmr::polymorphic_allocator<int>;
+
+    sk::extent_ring<int, alloc_type> a{alloc_type(&res1)};
+    sk::extent_ring<int, alloc_type> b{alloc_type(&res2)};
+    for (int i = 0; i < 3; ++i)
+        a.push_back(i);
+
+    b = std::move(a);
+    REQUIRE(a.empty());
+    REQUIRE(b.get_allocator().resource() == &res2);
+    REQUIRE(std::vector<int>(b.begin(), b.end()) == std::vector{0, 1, 2});
+}
@@ -26,6 +26,7 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <cstdint>
 #include <catch.hpp>
 
 #include "sk/buffer/fixed_buffer.hxx"
@@ -77,3 +78,13 @@ TEST_CASE("small fixed_buffer") {
     // Reset the buffer.
     buf.reset();
 }
+
+TEST_CASE("aligned fixed_buffer") {
+    sk::fixed_buffer<char, 4096, 512> buf;
+
+    auto ranges = buf.writable_ranges();
+    auto addr = reinterpret_cast<std::uintptr_t>(
+        std::ranges::data(*std::ranges::begin(ranges)));
+    REQUIRE(addr % 512 == 0);
+    REQUIRE(alignof(decltype(buf)) == 512);
+}
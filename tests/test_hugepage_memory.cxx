@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#if defined(__linux__)
+
+#    include <cstdint>
+#    include <new>
+#    include <string>
+
+#    include <catch.hpp>
+
+#    include "sk/buffer/circular_buffer.hxx"
+#    include "sk/buffer/dynamic_buffer.hxx"
+#    include "sk/buffer/hugepage_memory.hxx"
+
+namespace {
+
+    auto is_hugepage_aligned(void const *p) -> bool {
+        return reinterpret_cast<std::uintptr_t>(p) %
+                   sk::detail::hugepage_size ==
+               0;
+    }
+
+} // namespace
+
+TEST_CASE("map_hugepages returns aligned memory") {
+    auto m = sk::detail::map_hugepages(1);
+    REQUIRE(m.base != nullptr);
+    REQUIRE(m.size == sk::detail::hugepage_size);
+    REQUIRE(is_hugepage_aligned(m.base));
+
+    // The whole mapping must be writable.
+    m.base[0] = std::byte{1};
+    m.base[m.size - 1] = std::byte{2};
+    sk::detail::unmap_hugepages(m);
+}
+
+TEST_CASE("dynamic_buffer with a hugepage_extent_provider") {
+    using buffer_type = sk::dynamic_buffer<char, 4096>;
+    sk::hugepage_extent_provider<buffer_type::extent_type> provider;
+
+    std::string input(3 * 4096 + 100, 'x');
+    for (std::size_t i = 0; i < input.size(); ++i)
+        input[i] = static_cast<char>('a' + i % 26);
+
+    {
+        buffer_type buf(provider);
+        REQUIRE(buf.write(input) == input.size());
+        REQUIRE(provider.capacity() > 4);
+        REQUIRE(provider.available() == provider.capacity() - 4);
+
+        std::string output(input.size(), 'X');
+        REQUIRE(buf.read(output) == input.size());
+        REQUIRE(output == input);
+    }
+
+    // Every extent went back to the provider.
+    REQUIRE(provider.available() == provider.capacity());
+}
+
+TEST_CASE("hugepage_extent_provider maps more chunks as needed") {
+    using buffer_type = sk::dynamic_buffer<char, 4096>;
+    sk::hugepage_extent_provider<buffer_type::extent_type> provider;
+
+    buffer_type buf(provider);
+    std::string input(4 << 20, 'x');
+    REQUIRE(buf.write(input) == input.size());
+    REQUIRE(provider.capacity() >= input.size() / 4096);
+
+    std::string output(input.size(), 'X');
+    REQUIRE(buf.read(output) == input.size());
+    REQUIRE(output == input);
+}
+
+TEST_CASE("make_hugepage constructs a buffer in huge pages") {
+    auto buf = sk::make_hugepage<sk::circular_buffer<char, 1 << 20>>();
+    REQUIRE(is_hugepage_aligned(buf.get()));
+
+    REQUIRE(buf->write(std::string("test")) == 4);
+    std::string output(4, 'X');
+    REQUIRE(buf->read(output) == 4);
+    REQUIRE(output == "test");
+}
+
+#endif // defined(__linux__)
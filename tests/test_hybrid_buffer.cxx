@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <memory_resource>
+#include <ranges>
+#include <span>
+#include <string>
+
+#include <catch.hpp>
+
+#include "sk/buffer/hybrid_buffer.hxx"
+
+namespace {
+
+    // A memory resource which counts how many allocations it has made.
+    struct counting_resource : std::pmr::memory_resource {
+        std::size_t nallocs = 0;
+
+        auto do_allocate(std::size_t bytes, std::size_t align)
+            -> void * override {
+            ++nallocs;
+            return std::pmr::new_delete_resource()->allocate(bytes, align);
+        }
+
+        auto do_deallocate(void *p, std::size_t bytes, std::size_t align)
+            -> void override {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+        }
+
+        auto do_is_equal(std::pmr::memory_resource const &other) const
+            noexcept -> bool override {
+            return this == &other;
+        }
+    };
+
+    template <std::size_t inline_size, std::size_t extent_bytes = 16>
+    using pmr_hybrid_buffer =
+        sk::hybrid_buffer<char, inline_size, extent_bytes,
+                          std::pmr::polymorphic_allocator<char>>;
+
+    template <typename Buffer> auto read_all(Buffer &buf) -> std::string {
+        std::string ret(buf.size(), 'X');
+        REQUIRE(buf.read(ret) == ret.size());
+        REQUIRE(buf.empty());
+        return ret;
+    }
+
+    template <typename Buffer> auto ranges_string(Buffer &buf) -> std::string {
+        std::string ret;
+        for (auto &&range : buf.readable_ranges())
+            ret.append(range.begin(), range.end());
+        return ret;
+    }
+
+} // namespace
+
+TEST_CASE("hybrid_buffer holds short messages inline") {
+    counting_resource resource;
+    pmr_hybrid_buffer<64> buf(&resource);
+
+    for (int i = 0; i < 100; ++i) {
+        std::string message = "message " + std::to_string(i);
+        REQUIRE(buf.write(message) == message.size());
+        REQUIRE(buf.size() == message.size());
+        REQUIRE(!buf.overflowed());
+        REQUIRE(std::ranges::distance(buf.readable_ranges()) == 1);
+        REQUIRE(read_all(buf) == message);
+    }
+
+    // Filling the inline storage exactly doesn't overflow.
+    std::string full(64, 'f');
+    REQUIRE(buf.write(full) == full.size());
+    REQUIRE(!buf.overflowed());
+    REQUIRE(buf.capacity() == 64);
+    REQUIRE(read_all(buf) == full);
+
+    REQUIRE(resource.nallocs == 0);
+}
+
+TEST_CASE("hybrid_buffer overflows to a dynamic_buffer") {
+    counting_resource resource;
+    pmr_hybrid_buffer<16> buf(&resource);
+
+    std::string input;
+    for (int i = 0; i < 50; ++i)
+        input += "line " + std::to_string(i) + "\n";
+
+    REQUIRE(buf.write(std::string_view(input).substr(0, 10)) == 10);
+    auto first = *buf.readable_ranges().begin();
+
+    REQUIRE(buf.write(std::string_view(input).substr(10)) ==
+            input.size() - 10);
+    REQUIRE(buf.overflowed());
+    REQUIRE(resource.nallocs > 0);
+    REQUIRE(buf.size() == input.size());
+
+    // The inline data comes first, and hasn't moved.
+    auto ranges = buf.readable_ranges();
+    REQUIRE(std::ranges::distance(ranges) > 2);
+    REQUIRE((*ranges.begin()).size() == 16);
+    REQUIRE((*ranges.begin()).data() == first.data());
+    REQUIRE(ranges_string(buf) == input);
+
+    // Data written while any overflow data is left goes after it.
+    REQUIRE(buf.discard(20) == 20);
+    REQUIRE(buf.write(std::string("tail")) == 4);
+    REQUIRE(buf.overflowed());
+    REQUIRE(read_all(buf) == input.substr(20) + "tail");
+
+    // Once it's empty, the buffer uses its inline storage again.
+    REQUIRE(buf.write(std::string("short")) == 5);
+    REQUIRE(!buf.overflowed());
+    REQUIRE(buf.overflow.empty());
+    REQUIRE(read_all(buf) == "short");
+}
+
+TEST_CASE("hybrid_buffer commit/discard") {
+    std::string input_string =
+        "this is a long test string that will fill several extents";
+    sk::hybrid_buffer<char, 8, 4> buf;
+
+    std::span<char const> inbuf(input_string);
+    while (!inbuf.empty()) {
+        for (auto &&range : buf.writable_ranges()) {
+            if (inbuf.empty())
+                break;
+
+            auto n = std::min(range.size(), inbuf.size());
+            std::ranges::copy(inbuf.first(n), range.begin());
+            REQUIRE(buf.commit(n) == n);
+            inbuf = inbuf.subspan(n);
+        }
+    }
+
+    REQUIRE(buf.overflowed());
+    REQUIRE(buf.size() == input_string.size());
+
+    std::string output_string;
+    while (!buf.empty()) {
+        auto range = *buf.readable_ranges().begin();
+        auto n = std::min<std::size_t>(range.size(), 3);
+        output_string.append(range.begin(), range.begin() + n);
+        REQUIRE(buf.discard(n) == n);
+    }
+
+    REQUIRE(output_string == input_string);
+    REQUIRE(buf.discard(1) == 0);
+}
+
+TEST_CASE("hybrid_buffer move") {
+    sk::hybrid_buffer<char, 16, 16> a;
+    REQUIRE(a.write(std::string("inline")) == 6);
+
+    auto b(std::move(a));
+    REQUIRE(a.empty());
+    REQUIRE(read_all(b) == "inline");
+
+    std::string input(100, 'x');
+    REQUIRE(b.write(input) == input.size());
+    REQUIRE(b.overflowed());
+
+    a = std::move(b);
+    REQUIRE(b.empty());
+    REQUIRE(!b.overflowed());
+    REQUIRE(a.overflowed());
+    REQUIRE(read_all(a) == input);
+}
+
+TEST_CASE("hybrid_buffer clear") {
+    sk::hybrid_buffer<char, 4, 16> buf;
+    REQUIRE(buf.write(std::string("more than four")) == 14);
+    REQUIRE(buf.overflowed());
+
+    buf.clear();
+    REQUIRE(buf.empty());
+    REQUIRE(!buf.overflowed());
+    REQUIRE(buf.overflow.capacity() == 0);
+    REQUIRE(buf.capacity() == 4);
+}
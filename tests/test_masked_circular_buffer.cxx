@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "sk/buffer/masked_circular_buffer.hxx"
+
+TEST_CASE("masked_circular_buffer writes") {
+    sk::masked_circular_buffer<char, 4> buf;
+
+    REQUIRE(buf.capacity() == 4);
+    REQUIRE(buf.empty());
+
+    // There is no sentinel slot, so the buffer holds exactly 4 objects.
+    auto n = buf.write(std::string("testx"));
+    REQUIRE(n == 4);
+    REQUIRE(buf.size() == 4);
+    REQUIRE(buf.writable_ranges().empty());
+    REQUIRE(buf.commit(1) == 0);
+
+    std::string ret(4, 'X');
+    REQUIRE(buf.read(ret) == 4);
+    REQUIRE(ret == "test");
+    REQUIRE(buf.empty());
+    REQUIRE(buf.readable_ranges().empty());
+    REQUIRE(buf.discard(1) == 0);
+}
+
+TEST_CASE("masked_circular_buffer wrapped ranges") {
+    sk::masked_circular_buffer<char, 4> buf;
+
+    REQUIRE(buf.write(std::string("abc")) == 3);
+    REQUIRE(buf.discard(3) == 3);
+    REQUIRE(buf.write(std::string("test")) == 4);
+
+    auto ranges = buf.readable_ranges();
+    REQUIRE(ranges.size() == 2);
+    REQUIRE(ranges[0].size() == 1);
+    REQUIRE(ranges[1].size() == 3);
+
+    std::string data;
+    for (auto &&range : ranges)
+        data.append(range.begin(), range.end());
+    REQUIRE(data == "test");
+
+    // Commit and discard through the ranges interface.
+    REQUIRE(buf.discard(2) == 2);
+    auto writable = buf.writable_ranges();
+    REQUIRE(writable.size() == 2);
+    REQUIRE(writable[0].size() == 1);
+    REQUIRE(writable[1].size() == 1);
+    writable[0][0] = 'x';
+    writable[1][0] = 'y';
+    REQUIRE(buf.commit(2) == 2);
+
+    std::string ret(4, ' ');
+    REQUIRE(buf.read(ret) == 4);
+    REQUIRE(ret == "stxy");
+}
+
+TEST_CASE("masked_circular_buffer clear") {
+    sk::masked_circular_buffer<char, 4> buf;
+
+    REQUIRE(buf.write(std::string("abc")) == 3);
+    buf.clear();
+    REQUIRE(buf.empty());
+
+    auto writable = buf.writable_ranges();
+    REQUIRE(writable.size() == 1);
+    REQUIRE(writable[0].size() == 4);
+}
+
+TEST_CASE("masked_circular_buffer streaming") {
+    sk::masked_circular_buffer<std::uint32_t, 64> buf;
+
+    // Use chunk sizes which don't divide the buffer size, so the data wraps
+    // at every possible position.
+    std::vector<std::uint32_t> in(37), out(23);
+    std::uint32_t next_in = 0, next_out = 0;
+
+    while (next_out < 100000) {
+        std::iota(in.begin(), in.end(), next_in);
+        next_in += static_cast<std::uint32_t>(buf.write(in));
+        REQUIRE(buf.size() <= buf.capacity());
+
+        auto n = buf.read(out);
+        for (std::size_t i = 0; i < n; ++i)
+            REQUIRE(out[i] == next_out + i);
+        next_out += static_cast<std::uint32_t>(n);
+    }
+}
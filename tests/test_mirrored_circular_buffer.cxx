@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "sk/buffer/mirrored_circular_buffer.hxx"
+
+TEST_CASE("mirrored_circular_buffer writes") {
+    sk::mirrored_circular_buffer<char, 4> buf;
+
+    // The capacity is rounded up to the page size.
+    REQUIRE(buf.capacity() >= 4);
+
+    auto n = buf.write(std::string("test"));
+    REQUIRE(n == 4);
+
+    std::string ret(4, 'X');
+    REQUIRE(buf.read(ret) == 4);
+    REQUIRE(ret == "test");
+
+    // Writing more than the capacity should return a short write.
+    std::string big(buf.capacity() + 1, 'X');
+    n = buf.write(big);
+    REQUIRE(n == buf.capacity());
+    REQUIRE(buf.writable_ranges()[0].empty());
+
+    buf.clear();
+    REQUIRE(buf.readable_ranges()[0].empty());
+}
+
+TEST_CASE("mirrored_circular_buffer wrapped data is contiguous") {
+    sk::mirrored_circular_buffer<char, 4> buf;
+    auto capacity = buf.capacity();
+
+    // Move the read pointer to just before the end of the buffer.
+    std::string filler(capacity - 2, 'X');
+    REQUIRE(buf.write(filler) == filler.size());
+    REQUIRE(buf.discard(filler.size() - 1) == filler.size() - 1);
+
+    // Now write some data that wraps around the end.
+    REQUIRE(buf.write(std::string("wrapped")) == 7);
+
+    auto readable = buf.readable_ranges();
+    REQUIRE(readable.size() == 1);
+    REQUIRE(std::string(readable[0].begin(), readable[0].end()) ==
+            "Xwrapped");
+
+    // The free space should also be a single range.
+    auto writable = buf.writable_ranges();
+    REQUIRE(writable.size() == 1);
+    REQUIRE(writable[0].size() == capacity - 8);
+
+    std::string ret(8, ' ');
+    REQUIRE(buf.read(ret) == 8);
+    REQUIRE(ret == "Xwrapped");
+}
+
+TEST_CASE("mirrored_circular_buffer reads") {
+    sk::mirrored_circular_buffer<std::uint32_t, 1024> buf;
+    std::uint32_t next_write = 0, next_read = 0;
+
+    // Stream data through the buffer in chunks which don't divide the
+    // capacity, so the data wraps at many different offsets.
+    for (int pass = 0; pass < 100; ++pass) {
+        std::vector<std::uint32_t> input(777);
+        std::iota(input.begin(), input.end(), next_write);
+        auto n = buf.write(input);
+        next_write += static_cast<std::uint32_t>(n);
+
+        std::vector<std::uint32_t> output(500);
+        auto m = buf.read(output);
+        for (std::size_t i = 0; i < m; ++i)
+            REQUIRE(output[i] == next_read++);
+    }
+}
+
+TEST_CASE("mirrored_circular_buffer move") {
+    sk::mirrored_circular_buffer<char> buf1;
+    buf1.write(std::string("test"));
+
+    auto buf2 = std::move(buf1);
+    std::string ret(4, 'X');
+    REQUIRE(buf2.read(ret) == 4);
+    REQUIRE(ret == "test");
+}
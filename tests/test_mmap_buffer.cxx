@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#if !defined(_WIN32)
+
+#    include <cstdlib>
+#    include <string>
+#    include <system_error>
+
+#    include <fcntl.h>
+#    include <unistd.h>
+
+#    include <catch.hpp>
+
+#    include "sk/buffer/buffer_io.hxx"
+#    include "sk/buffer/dynamic_buffer.hxx"
+#    include "sk/buffer/mmap_buffer.hxx"
+
+namespace {
+
+    // A temporary file which is removed on destruction.
+    struct temp_file {
+        int fd = -1;
+
+        temp_file() {
+            char name[] = "/tmp/test_mmap_buffer.XXXXXX";
+            fd = ::mkstemp(name);
+            REQUIRE(fd != -1);
+            ::unlink(name);
+        }
+
+        explicit temp_file(std::string const &data) : temp_file() {
+            REQUIRE(::write(fd, data.data(), data.size()) ==
+                    static_cast<ssize_t>(data.size()));
+        }
+
+        ~temp_file() {
+            ::close(fd);
+        }
+
+        auto contents() -> std::string {
+            std::string data(static_cast<std::size_t>(
+                                 ::lseek(fd, 0, SEEK_END)),
+                             '\0');
+            REQUIRE(::pread(fd, data.data(), data.size(), 0) ==
+                    static_cast<ssize_t>(data.size()));
+            return data;
+        }
+    };
+
+    auto make_data(std::size_t n) -> std::string {
+        std::string data(n, '\0');
+        for (std::size_t i = 0; i < n; ++i)
+            data[i] = static_cast<char>('a' + i % 26 + i / 4096 % 3);
+        return data;
+    }
+
+} // namespace
+
+TEST_CASE("mmap_readable_buffer whole file") {
+    auto input_string = make_data(100000);
+    temp_file file(input_string);
+
+    sk::mmap_readable_buffer<char> buf(file.fd);
+    buf.readahead_size = 8192;
+    REQUIRE(buf.size() == input_string.size());
+    REQUIRE(buf.capacity() == input_string.size());
+
+    // The whole file is one range.
+    auto ranges = buf.readable_ranges();
+    auto range = *std::ranges::begin(ranges);
+    REQUIRE(std::string(range.begin(), range.end()) == input_string);
+
+    // Read and discard through it in small steps, which moves the advice
+    // window forward.
+    std::size_t pos = 0;
+    while (!buf.empty()) {
+        std::string chunk(1000, 'X');
+        chunk.resize(buf.read(chunk));
+        REQUIRE(chunk == input_string.substr(pos, chunk.size()));
+        pos += chunk.size();
+        pos += buf.discard(333);
+    }
+    REQUIRE(pos == input_string.size());
+    REQUIRE(buf.discard(1) == 0);
+}
+
+TEST_CASE("mmap_readable_buffer region") {
+    auto input_string = make_data(20000);
+    temp_file file(input_string);
+
+    // An offset which isn't page-aligned.
+    sk::mmap_readable_buffer<char> buf(file.fd, 5000, 10000);
+    REQUIRE(buf.size() == 10000);
+
+    std::string output_string(10000, 'X');
+    REQUIRE(buf.read(output_string) == 10000);
+    REQUIRE(output_string == input_string.substr(5000, 10000));
+    REQUIRE(buf.empty());
+
+    // The region can't extend past the end of the file.
+    REQUIRE_THROWS_AS(sk::mmap_readable_buffer<char>(file.fd, 15000, 10000),
+                      std::system_error);
+}
+
+TEST_CASE("mmap_readable_buffer empty file") {
+    temp_file file;
+    sk::mmap_readable_buffer<char> buf(file.fd);
+    REQUIRE(buf.empty());
+
+    auto ranges = buf.readable_ranges();
+    REQUIRE((*std::ranges::begin(ranges)).empty());
+}
+
+TEST_CASE("mmap_readable_buffer move") {
+    auto input_string = make_data(5000);
+    temp_file file(input_string);
+
+    sk::mmap_readable_buffer<char> buf(file.fd);
+    buf.discard(100);
+
+    auto other = std::move(buf);
+    REQUIRE(other.size() == input_string.size() - 100);
+
+    std::string output_string(other.size(), 'X');
+    other.read(output_string);
+    REQUIRE(output_string == input_string.substr(100));
+}
+
+TEST_CASE("mmap_readable_buffer buffer_write_to") {
+    auto input_string = make_data(50000);
+    temp_file in(input_string), out;
+
+    sk::mmap_readable_buffer<char> buf(in.fd);
+    while (!buf.empty())
+        sk::buffer_write_to(out.fd, buf);
+
+    REQUIRE(out.contents() == input_string);
+}
+
+TEST_CASE("mmap_writable_buffer appends to a file") {
+    auto existing = make_data(1234);
+    auto input_string = make_data(30000);
+    temp_file file(existing);
+
+    {
+        sk::mmap_writable_buffer<char> buf(file.fd, 4096);
+
+        // Write across several chunks.
+        REQUIRE(buf.write(input_string.substr(0, 20000)) == 20000);
+
+        // Commit through writable_ranges().
+        auto rest = input_string.substr(20000);
+        auto ranges = buf.writable_ranges();
+        auto range = *std::ranges::begin(ranges);
+        auto n = std::min(range.size(), rest.size());
+        std::copy_n(rest.data(), n, range.data());
+        REQUIRE(buf.commit(n) == n);
+        buf.write(rest.substr(n));
+
+        REQUIRE(buf.file_size() == existing.size() + input_string.size());
+    }
+
+    // The file was truncated to the data written.
+    REQUIRE(file.contents() == existing + input_string);
+}
+
+TEST_CASE("mmap_writable_buffer buffer_read_from") {
+    auto input_string = make_data(10000);
+    temp_file in(input_string), out;
+    ::lseek(in.fd, 0, SEEK_SET);
+
+    sk::mmap_writable_buffer<char> buf(out.fd);
+    while (sk::buffer_read_from(in.fd, buf) > 0)
+        ;
+    buf.finish();
+
+    REQUIRE(out.contents() == input_string);
+}
+
+#endif // !defined(_WIN32)
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "sk/buffer/mpsc_circular_buffer.hxx"
+
+TEST_CASE("mpsc_circular_buffer writes") {
+    sk::mpsc_circular_buffer<char, 8> buf;
+
+    REQUIRE(buf.write(std::string("test")) == 4);
+    REQUIRE(buf.size() == 4);
+
+    // A record which doesn't fit is not written at all.
+    REQUIRE(buf.write(std::string("toolong")) == 0);
+    REQUIRE(buf.write(std::string("abcd")) == 4);
+    REQUIRE(buf.write(std::string("x")) == 0);
+
+    std::string ret(8, 'X');
+    REQUIRE(buf.read(ret) == 8);
+    REQUIRE(ret == "testabcd");
+    REQUIRE(buf.empty());
+}
+
+TEST_CASE("mpsc_circular_buffer reservations") {
+    sk::mpsc_circular_buffer<char, 8> buf;
+
+    REQUIRE(!buf.reserve(0));
+    REQUIRE(!buf.reserve(9));
+
+    // Move the indices forward so the next reservation wraps.
+    REQUIRE(buf.write(std::string("abcdef")) == 6);
+    REQUIRE(buf.discard(6) == 6);
+
+    auto first = buf.reserve(3);
+    auto second = buf.reserve(2);
+    REQUIRE(first);
+    REQUIRE(second);
+
+    auto ranges = first.ranges();
+    REQUIRE(ranges.size() == 2);
+    REQUIRE(ranges[0].size() == 2);
+    REQUIRE(ranges[1].size() == 1);
+    ranges[0][0] = 'x';
+    ranges[0][1] = 'y';
+    ranges[1][0] = 'z';
+
+    second.ranges()[0][0] = '1';
+    second.ranges()[0][1] = '2';
+
+    // Nothing is visible until the first reservation is published.
+    REQUIRE(buf.readable_ranges().empty());
+    first.commit();
+    REQUIRE(!first);
+    REQUIRE(buf.size() == 3);
+    second.commit();
+    REQUIRE(buf.size() == 5);
+
+    std::string ret(5, ' ');
+    REQUIRE(buf.read(ret) == 5);
+    REQUIRE(ret == "xyz12");
+}
+
+TEST_CASE("mpsc_circular_buffer abandoned reservation") {
+    sk::mpsc_circular_buffer<char, 8> buf;
+
+    REQUIRE(buf.write(std::string("xy")) == 2);
+    {
+        auto res = buf.reserve(2);
+        REQUIRE(res.size() == 2);
+        for (auto &&range : res.ranges())
+            std::ranges::fill(range, '!');
+    }
+    REQUIRE(buf.write(std::string("ab")) == 2);
+
+    // The consumer never sees the abandoned space, but it is returned to
+    // the producers.
+    std::string ret(8, 'X');
+    REQUIRE(buf.read(ret) == 2);
+    REQUIRE(ret.substr(0, 2) == "xy");
+    REQUIRE(buf.read(ret) == 2);
+    REQUIRE(ret.substr(0, 2) == "ab");
+    REQUIRE(buf.empty());
+    REQUIRE(buf.write(std::string("12345678")) == 8);
+
+    // Abandoning more reservations than fit in the skip queue waits for
+    // the consumer to step over them.
+    sk::mpsc_circular_buffer<char, 256> big;
+    std::thread producer([&] {
+        for (int i = 0; i < 100; ++i) {
+            while (!big.reserve(1))
+                std::this_thread::yield();
+            while (big.write(std::string("a")) != 1)
+                std::this_thread::yield();
+        }
+    });
+
+    std::string all;
+    while (all.size() < 100) {
+        std::string chunk(256, 'X');
+        all.append(chunk, 0, big.read(chunk));
+    }
+    producer.join();
+    REQUIRE(all == std::string(100, 'a'));
+}
+
+TEST_CASE("mpsc_circular_buffer threads") {
+    // Each record is a producer number followed by a sequence number.
+    sk::mpsc_circular_buffer<std::uint32_t, 1000> buf;
+    constexpr std::uint32_t nproducers = 4;
+    constexpr std::uint32_t count = 100000;
+
+    std::vector<std::thread> producers;
+    for (std::uint32_t p = 0; p < nproducers; ++p) {
+        producers.emplace_back([&, p] {
+            for (std::uint32_t i = 0; i < count;) {
+                std::uint32_t record[2] = {p, i};
+                if (buf.write(std::span(record)) == 2)
+                    ++i;
+                else
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    // Consume using the zero-copy interface, checking that each producer's
+    // records arrive whole and in order.
+    std::vector<std::uint32_t> next(nproducers, 0);
+    std::vector<std::uint32_t> pending;
+    std::size_t received = 0;
+    bool ok = true;
+
+    while (received < nproducers * count) {
+        std::size_t n = 0;
+        for (auto &&range : buf.readable_ranges()) {
+            pending.insert(pending.end(), range.begin(), range.end());
+            n += range.size();
+        }
+        buf.discard(n);
+
+        std::size_t i = 0;
+        for (; i + 2 <= pending.size(); i += 2) {
+            auto p = pending[i];
+            ok = ok && p < nproducers && pending[i + 1] == next[p]++;
+            ++received;
+        }
+        pending.erase(pending.begin(), pending.begin() + i);
+
+        if (n == 0)
+            std::this_thread::yield();
+    }
+
+    for (auto &t : producers)
+        t.join();
+
+    REQUIRE(ok);
+    REQUIRE(pending.empty());
+    REQUIRE(buf.empty());
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "sk/buffer/circular_buffer.hxx"
+#include "sk/buffer/dynamic_buffer.hxx"
+#include "sk/buffer/fixed_buffer.hxx"
+#include "sk/buffer/object_copy.hxx"
+
+namespace {
+
+    auto make_bytes(std::size_t n) -> std::vector<std::uint8_t> {
+        std::vector<std::uint8_t> v(n);
+        for (std::size_t i = 0; i < n; ++i)
+            v[i] = static_cast<std::uint8_t>(i * 7 + i / 251);
+        return v;
+    }
+
+} // namespace
+
+TEST_CASE("copy_objects trivially copyable") {
+    auto src = make_bytes(1000);
+    std::vector<std::uint8_t> dst(1000);
+
+    sk::copy_objects(dst.data(), src.data(), src.size());
+    REQUIRE(dst == src);
+
+    // Copying nothing from a null pointer is allowed.
+    sk::copy_objects<std::uint8_t>(nullptr, nullptr, 0);
+}
+
+TEST_CASE("copy_objects non-trivial type") {
+    std::vector<std::string> src{"one", "two", "a string too long for SSO"};
+    std::vector<std::string> dst(3);
+
+    sk::copy_objects(dst.data(), src.data(), src.size());
+    REQUIRE(dst == src);
+}
+
+TEST_CASE("copy_objects_nontemporal at every alignment") {
+    auto size = sk::nontemporal_copy_threshold + 100;
+    auto src = make_bytes(size + 64);
+
+    for (std::size_t dst_off = 0; dst_off < 33; dst_off += 3) {
+        for (std::size_t src_off = 0; src_off < 33; src_off += 5) {
+            std::vector<std::uint8_t> dst(size + 64, 0xFF);
+            sk::copy_objects_nontemporal(dst.data() + dst_off,
+                                         src.data() + src_off, size);
+
+            REQUIRE(std::equal(dst.begin() + dst_off,
+                               dst.begin() + dst_off + size,
+                               src.begin() + src_off));
+
+            // Nothing outside the destination was touched.
+            for (std::size_t i = 0; i < dst_off; ++i)
+                REQUIRE(dst[i] == 0xFF);
+            for (std::size_t i = dst_off + size; i < dst.size(); ++i)
+                REQUIRE(dst[i] == 0xFF);
+        }
+    }
+}
+
+TEST_CASE("copy_objects_nontemporal small and non-trivial copies") {
+    auto src = make_bytes(10);
+    std::vector<std::uint8_t> dst(10);
+    sk::copy_objects_nontemporal(dst.data(), src.data(), src.size());
+    REQUIRE(dst == src);
+
+    std::vector<std::string> strings{"x", "y"}, copies(2);
+    sk::copy_objects_nontemporal(copies.data(), strings.data(), 2);
+    REQUIRE(copies == strings);
+}
+
+TEST_CASE("fixed_buffer of a non-trivial type") {
+    sk::fixed_buffer<std::string, 4> buf;
+    std::vector<std::string> in{"a", "b", "c", "d", "e"};
+
+    REQUIRE(buf.write(in) == 4);
+
+    std::vector<std::string> out(4);
+    REQUIRE(buf.read(out) == 4);
+    REQUIRE(out == std::vector<std::string>{"a", "b", "c", "d"});
+}
+
+TEST_CASE("buffer_write_nontemporal") {
+    auto input = make_bytes(3 * sk::nontemporal_copy_threshold + 17);
+
+    SECTION("dynamic_buffer") {
+        sk::dynamic_buffer<std::uint8_t, 65536> buf;
+        REQUIRE(sk::buffer_write_nontemporal(buf, input) == input.size());
+
+        std::vector<std::uint8_t> output(input.size());
+        REQUIRE(buf.read(output) == input.size());
+        REQUIRE(output == input);
+    }
+
+    SECTION("circular_buffer which wraps") {
+        sk::circular_buffer<std::uint8_t, 4 * 65536> buf;
+
+        std::vector<std::uint8_t> skip(100000);
+        buf.write(skip);
+        buf.discard(skip.size());
+
+        auto n = sk::buffer_write_nontemporal(buf, input);
+        REQUIRE(n == input.size());
+
+        std::vector<std::uint8_t> output(input.size());
+        REQUIRE(buf.read(output) == input.size());
+        REQUIRE(output == input);
+    }
+
+    SECTION("full buffer") {
+        sk::fixed_buffer<std::uint8_t, 100> buf;
+        REQUIRE(sk::buffer_write_nontemporal(buf, input) == 100);
+        REQUIRE(sk::buffer_write_nontemporal(buf, input) == 0);
+    }
+}
@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#if defined(__linux__)
+
+#    include <cerrno>
+#    include <cstdio>
+#    include <string>
+#    include <system_error>
+
+#    include <fcntl.h>
+#    include <sys/socket.h>
+#    include <unistd.h>
+
+#    include <catch.hpp>
+
+#    include "sk/buffer/pipe_buffer.hxx"
+
+namespace {
+
+    // A non-blocking pipe which is closed on destruction.
+    struct test_pipe {
+        int fds[2];
+
+        test_pipe() {
+            REQUIRE(::pipe2(fds, O_NONBLOCK) == 0);
+        }
+
+        ~test_pipe() {
+            for (auto fd : fds)
+                if (fd != -1)
+                    ::close(fd);
+        }
+
+        auto put(std::string const &s) -> void {
+            REQUIRE(::write(fds[1], s.data(), s.size()) ==
+                    static_cast<ssize_t>(s.size()));
+        }
+
+        auto get() -> std::string {
+            std::string s;
+            char buf[4096];
+            ssize_t n;
+            while ((n = ::read(fds[0], buf, sizeof(buf))) > 0)
+                s.append(buf, static_cast<std::size_t>(n));
+            return s;
+        }
+
+        auto close_write() -> void {
+            ::close(fds[1]);
+            fds[1] = -1;
+        }
+    };
+
+    // Return the readable data without removing it.
+    template <typename Buffer> auto contents(Buffer &buf) -> std::string {
+        std::string s;
+        for (auto &&range : buf.readable_ranges())
+            s.append(range.data(), range.size());
+        return s;
+    }
+
+    // Read all the data out of the buffer.
+    template <typename Buffer> auto read_all(Buffer &buf) -> std::string {
+        std::string s(buf.size(), '\0');
+        s.resize(buf.read(s));
+        return s;
+    }
+
+} // namespace
+
+TEST_CASE("pipe_buffer works as a user-space buffer") {
+    sk::pipe_buffer<char> buf;
+    REQUIRE(buf.empty());
+    REQUIRE(buf.pipe_capacity() > 0);
+
+    std::string data = "hello, world";
+    REQUIRE(buf.write(data) == data.size());
+    REQUIRE(buf.size() == data.size());
+    REQUIRE(buf.pipe_size() == 0);
+    REQUIRE(contents(buf) == data);
+
+    REQUIRE(buf.discard(7) == 7);
+    REQUIRE(read_all(buf) == "world");
+    REQUIRE(buf.empty());
+}
+
+TEST_CASE("pipe_buffer forwards data between pipes without copying") {
+    test_pipe source, sink;
+    sk::pipe_buffer<char> buf;
+
+    source.put("abcdefghij");
+    REQUIRE(buf.splice_from(source.fds[0]) == 10);
+    REQUIRE(buf.size() == 10);
+    REQUIRE(buf.pipe_size() == 10);
+
+    REQUIRE(buf.splice_to(sink.fds[1], 4) == 4);
+    REQUIRE(buf.size() == 6);
+    REQUIRE(sink.get() == "abcd");
+
+    REQUIRE(buf.splice_to(sink.fds[1]) == 6);
+    REQUIRE(buf.empty());
+    REQUIRE(sink.get() == "efghij");
+
+    // An empty non-blocking source would block.
+    std::error_code ec;
+    REQUIRE(buf.splice_from(source.fds[0], 100, ec) == 0);
+    REQUIRE(ec == std::errc::operation_would_block);
+
+    // At end of file, splice_from() returns 0 without an error.
+    source.close_write();
+    REQUIRE(buf.splice_from(source.fds[0], 100, ec) == 0);
+    REQUIRE(!ec);
+}
+
+TEST_CASE("pipe_buffer keeps user-space and spliced data in order") {
+    test_pipe source, sink;
+    sk::pipe_buffer<char> buf;
+
+    buf.write(std::string("ab"));
+    source.put("cd");
+    REQUIRE(buf.splice_from(source.fds[0]) == 2);
+
+    // This is written while the pipe has data, so it goes after it.
+    buf.write(std::string("ef"));
+    source.put("gh");
+    REQUIRE(buf.splice_from(source.fds[0]) == 2);
+    buf.write(std::string("ij"));
+    REQUIRE(buf.size() == 10);
+    REQUIRE(buf.pipe_size() == 6);
+
+    SECTION("readable_ranges() materialises the pipe") {
+        REQUIRE(contents(buf) == "abcdefghij");
+        REQUIRE(buf.pipe_size() == 0);
+        REQUIRE(buf.size() == 10);
+    }
+
+    SECTION("splice_to() sends every part in order") {
+        std::string sent;
+        while (!buf.empty()) {
+            REQUIRE(buf.splice_to(sink.fds[1], 3) > 0);
+            sent += sink.get();
+        }
+        REQUIRE(sent == "abcdefghij");
+    }
+
+    SECTION("read() reads across every part") {
+        char out[3];
+        REQUIRE(buf.read(out) == 3);
+        REQUIRE(std::string(out, 3) == "abc");
+        REQUIRE(read_all(buf) == "defghij");
+    }
+
+    SECTION("discard() discards across every part") {
+        REQUIRE(buf.discard(5) == 5);
+        REQUIRE(read_all(buf) == "fghij");
+    }
+
+    SECTION("clear() empties the pipe") {
+        buf.clear();
+        REQUIRE(buf.empty());
+        REQUIRE(buf.pipe_size() == 0);
+        buf.write(std::string("x"));
+        REQUIRE(contents(buf) == "x");
+    }
+}
+
+TEST_CASE("pipe_buffer splices from a file to a socket") {
+    std::FILE *file = std::tmpfile();
+    REQUIRE(file);
+    std::string data(100000, '\0');
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<char>('a' + i % 26);
+    REQUIRE(std::fwrite(data.data(), 1, data.size(), file) == data.size());
+    std::fflush(file);
+    std::rewind(file);
+
+    int sockets[2];
+    REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+    REQUIRE(::fcntl(sockets[1], F_SETFL, O_NONBLOCK) == 0);
+
+    sk::pipe_buffer<char> buf;
+    std::string received;
+    bool eof = false;
+
+    while (!eof || !buf.empty()) {
+        if (!eof) {
+            std::error_code ec;
+            auto n = buf.splice_from(::fileno(file), 4096, ec);
+            if (!ec && n == 0)
+                eof = true;
+        }
+
+        buf.splice_to(sockets[0]);
+
+        char tmp[65536];
+        ssize_t n;
+        while ((n = ::read(sockets[1], tmp, sizeof(tmp))) > 0)
+            received.append(tmp, static_cast<std::size_t>(n));
+    }
+
+    REQUIRE(received == data);
+
+    ::close(sockets[0]);
+    ::close(sockets[1]);
+    std::fclose(file);
+}
+
+TEST_CASE("pipe_buffer::tee_to() copies without consuming") {
+    test_pipe source;
+    sk::pipe_buffer<char> buf, copy;
+
+    buf.write(std::string("ab"));
+    source.put("cdef");
+    REQUIRE(buf.splice_from(source.fds[0]) == 4);
+
+    copy.write(std::string("xy"));
+    REQUIRE(buf.tee_to(copy, 5) == 5);
+    REQUIRE(buf.size() == 6);
+    REQUIRE(copy.size() == 7);
+
+    REQUIRE(buf.tee_to(copy) == 6);
+    REQUIRE(contents(copy) == "xyabcdeabcdef");
+    REQUIRE(contents(buf) == "abcdef");
+}
+
+TEST_CASE("pipe_buffer can be resized and moved") {
+    sk::pipe_buffer<char> buf(256 * 1024);
+    REQUIRE(buf.pipe_capacity() >= 256 * 1024);
+
+    test_pipe source;
+    source.put("data");
+    buf.splice_from(source.fds[0]);
+    buf.write(std::string("more"));
+
+    sk::pipe_buffer<char> moved(std::move(buf));
+    REQUIRE(moved.size() == 8);
+    REQUIRE(moved.pipe_size() == 4);
+    REQUIRE(read_all(moved) == "datamore");
+
+    // A moved-from buffer is empty, and splicing fails.
+    std::error_code ec;
+    REQUIRE(buf.empty());
+    REQUIRE(buf.splice_from(source.fds[0], 1, ec) == 0);
+    REQUIRE(ec == std::errc::bad_file_descriptor);
+}
+
+#endif // defined(__linux__)
@@ -26,8 +26,19 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <array>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
 #include <catch.hpp>
 
+#include "sk/buffer/circular_buffer.hxx"
+#include "sk/buffer/dynamic_buffer.hxx"
+#include "sk/buffer/fixed_buffer.hxx"
 #include "sk/buffer/pmr_buffer.hxx"
 #include "sk/buffer/range_buffer.hxx"
 
@@ -54,3 +65,165 @@ TEST_CASE("pmr_writable_buffer") {
 
     REQUIRE(output_string == input_string);
 }
+
+TEST_CASE("pmr_buffer size") {
+    std::string input_string("testing");
+    sk::dynamic_buffer<char> buf;
+    auto pbuf = sk::make_pmr_buffer_adapter(buf);
+    REQUIRE(pbuf.empty());
+
+    pbuf.write(input_string);
+    REQUIRE(pbuf.size() == input_string.size());
+    REQUIRE(pbuf.capacity() == buf.capacity());
+}
+
+TEST_CASE("pmr_buffer batched ranges") {
+    std::string input_string("this is a test string spanning extents");
+    sk::dynamic_buffer<char, 8> buf;
+    auto adapter = sk::make_pmr_buffer_adapter(buf);
+    sk::pmr_readable_buffer<char> &reader = adapter;
+    sk::pmr_writable_buffer<char> &writer = adapter;
+
+    // Fill the writable ranges and commit, a few ranges at a time.
+    std::array<std::span<char>, 2> wranges;
+    std::size_t written = 0;
+    auto nw = writer.fill_writable_ranges(wranges);
+    while (written < input_string.size()) {
+        REQUIRE(nw > 0);
+        auto n = std::min(wranges[0].size(), input_string.size() - written);
+        std::copy_n(input_string.data() + written, n, wranges[0].data());
+        written += n;
+        auto result = writer.commit_and_fill_writable_ranges(n, wranges);
+        REQUIRE(result.count == n);
+        nw = result.nranges;
+    }
+    REQUIRE(buf.size() == input_string.size());
+
+    // Only as many ranges as fit are returned.
+    std::array<std::span<char const>, 3> rranges;
+    REQUIRE(reader.fill_readable_ranges(rranges) == 3);
+
+    std::string output_string;
+    auto nr = reader.fill_readable_ranges(rranges);
+    while (nr > 0) {
+        output_string.append(rranges[0].begin(), rranges[0].end());
+        auto result =
+            reader.discard_and_fill_readable_ranges(rranges[0].size(), rranges);
+        REQUIRE(result.count > 0);
+        nr = result.nranges;
+    }
+    REQUIRE(output_string == input_string);
+    REQUIRE(reader.empty());
+}
+
+namespace {
+
+    // A buffer which implements only the required pmr_buffer functions, to
+    // test the default batched implementations and size() and capacity().
+    struct minimal_pmr_buffer final : sk::pmr_buffer<char> {
+        sk::dynamic_buffer<char, 4> buf;
+
+        auto read(std::span<char> const &data) -> size_type override {
+            return buf.read(data);
+        }
+        auto readable_ranges()
+            -> std::vector<std::span<char const>> override {
+            auto ranges = buf.readable_ranges();
+            return {std::ranges::begin(ranges), std::ranges::end(ranges)};
+        }
+        auto discard(size_type n) -> size_type override {
+            return buf.discard(n);
+        }
+        auto write(std::span<char const> const &data) -> size_type override {
+            return buf.write(data);
+        }
+        auto writable_ranges() -> std::vector<std::span<char>> override {
+            auto ranges = buf.writable_ranges();
+            return {std::ranges::begin(ranges), std::ranges::end(ranges)};
+        }
+        auto commit(size_type n) -> size_type override {
+            return buf.commit(n);
+        }
+    };
+
+} // namespace
+
+TEST_CASE("pmr_buffer default batched implementation") {
+    minimal_pmr_buffer pbuf;
+    pbuf.write(std::string_view("0123456789"));
+
+    std::array<std::span<char const>, 8> ranges;
+    REQUIRE(pbuf.fill_readable_ranges(ranges) == 3);
+    REQUIRE(std::string(ranges[2].begin(), ranges[2].end()) == "89");
+
+    auto result = pbuf.discard_and_fill_readable_ranges(5, ranges);
+    REQUIRE(result.count == 5);
+    REQUIRE(result.nranges == 2);
+    REQUIRE(std::string(ranges[0].begin(), ranges[0].end()) == "567");
+
+    std::array<std::span<char>, 1> wranges;
+    REQUIRE(pbuf.fill_writable_ranges(wranges) == 1);
+    wranges[0][0] = '!';
+    auto wresult = pbuf.commit_and_fill_writable_ranges(1, wranges);
+    REQUIRE(wresult.count == 1);
+    REQUIRE(pbuf.size() == 6);
+    REQUIRE(pbuf.capacity() == pbuf.buf.capacity());
+}
+
+TEST_CASE("any_buffer stores small buffers inline") {
+    std::string input_string("testing any_buffer");
+    sk::any_buffer<char> buf(sk::dynamic_buffer<char, 8>{});
+    REQUIRE(buf.is_inline());
+    REQUIRE(buf.empty());
+
+    buf.write(input_string);
+    REQUIRE(buf.size() == input_string.size());
+
+    // Moving relocates the wrapped buffer.
+    auto moved = std::move(buf);
+    REQUIRE(!buf);
+    REQUIRE(moved.is_inline());
+    REQUIRE(moved.size() == input_string.size());
+
+    // Pass it to code which only knows about pmr_buffer.
+    sk::pmr_buffer<char> &pbuf = moved.get();
+    std::string output_string(input_string.size(), 'X');
+    REQUIRE(pbuf.read(output_string) == input_string.size());
+    REQUIRE(output_string == input_string);
+}
+
+TEST_CASE("any_buffer stores large or immovable buffers on the heap") {
+    std::string input_string("testing");
+
+    sk::any_buffer<char> buf(std::in_place_type<sk::circular_buffer<char, 1024>>);
+    REQUIRE(!buf.is_inline());
+    buf.write(input_string);
+
+    sk::any_buffer<char> other(std::in_place_type<sk::fixed_buffer<char, 8>>);
+    REQUIRE(!other.is_inline());
+
+    // Move assignment replaces the old buffer.
+    other = std::move(buf);
+    REQUIRE(!buf);
+    REQUIRE(other.size() == input_string.size());
+    REQUIRE(other.capacity() == 1024);
+
+    std::array<std::span<char const>, 2> ranges;
+    REQUIRE(other.fill_readable_ranges(ranges) == 1);
+    REQUIRE(std::string(ranges[0].begin(), ranges[0].end()) == input_string);
+}
+
+TEST_CASE("any_buffer in a container") {
+    std::vector<sk::any_buffer<char>> buffers;
+    buffers.emplace_back(sk::dynamic_buffer<char>{});
+    buffers.emplace_back(std::in_place_type<sk::circular_buffer<char, 64>>);
+
+    for (auto &buf : buffers)
+        buf.write(std::string_view("hello"));
+
+    for (auto &buf : buffers) {
+        std::string output_string(5, 'X');
+        REQUIRE(buf.read(output_string) == 5);
+        REQUIRE(output_string == "hello");
+    }
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "sk/buffer/spsc_circular_buffer.hxx"
+
+TEST_CASE("spsc_circular_buffer writes") {
+    sk::spsc_circular_buffer<char, 4> buf;
+
+    // The buffer can hold exactly 4 objects.
+    auto n = buf.write(std::string("testx"));
+    REQUIRE(n == 4);
+    REQUIRE(buf.writable_ranges().empty());
+
+    std::string ret(4, 'X');
+    REQUIRE(buf.read(ret) == 4);
+    REQUIRE(ret == "test");
+    REQUIRE(buf.readable_ranges().empty());
+}
+
+TEST_CASE("spsc_circular_buffer wrapped ranges") {
+    sk::spsc_circular_buffer<char, 4> buf;
+
+    REQUIRE(buf.write(std::string("abc")) == 3);
+    REQUIRE(buf.discard(3) == 3);
+    REQUIRE(buf.write(std::string("test")) == 4);
+
+    auto ranges = buf.readable_ranges();
+    REQUIRE(ranges.size() == 2);
+
+    std::string data;
+    for (auto &&range : ranges)
+        data.append(range.begin(), range.end());
+    REQUIRE(data == "test");
+
+    // Commit and discard through the ranges interface.
+    REQUIRE(buf.discard(2) == 2);
+    auto writable = buf.writable_ranges();
+    REQUIRE(writable.size() == 2);
+    REQUIRE(writable[0].size() == 1);
+    REQUIRE(writable[1].size() == 1);
+    writable[0][0] = 'x';
+    writable[1][0] = 'y';
+    REQUIRE(buf.commit(2) == 2);
+
+    std::string ret(4, ' ');
+    REQUIRE(buf.read(ret) == 4);
+    REQUIRE(ret == "stxy");
+}
+
+TEST_CASE("spsc_circular_buffer threads") {
+    sk::spsc_circular_buffer<std::uint32_t, 1000> buf;
+    constexpr std::uint32_t count = 1000000;
+
+    std::thread producer([&] {
+        std::uint32_t next = 0;
+        std::vector<std::uint32_t> chunk(137);
+
+        while (next < count) {
+            auto n = std::min<std::size_t>(chunk.size(), count - next);
+            std::iota(chunk.begin(), chunk.begin() + n, next);
+            auto written = buf.write(std::span(chunk).subspan(0, n));
+            next += static_cast<std::uint32_t>(written);
+
+            if (written == 0)
+                std::this_thread::yield();
+        }
+    });
+
+    // Consume using the zero-copy interface.
+    std::uint32_t expected = 0;
+    bool ok = true;
+    while (expected < count) {
+        std::size_t n = 0;
+        for (auto &&range : buf.readable_ranges()) {
+            for (auto v : range)
+                ok = ok && (v == expected++);
+            n += range.size();
+        }
+        buf.discard(n);
+
+        if (n == 0)
+            std::this_thread::yield();
+    }
+
+    producer.join();
+    REQUIRE(ok);
+    REQUIRE(expected == count);
+}
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#if defined(__linux__)
+
+#    include <memory>
+#    include <string>
+#    include <system_error>
+
+#    include <unistd.h>
+
+#    include <catch.hpp>
+
+#    include "sk/buffer/dynamic_buffer.hxx"
+#    include "sk/buffer/uring_buffer.hxx"
+
+namespace {
+
+    // A pipe which is closed on destruction.
+    struct test_pipe {
+        int fds[2];
+
+        test_pipe() {
+            REQUIRE(::pipe(fds) == 0);
+        }
+
+        ~test_pipe() {
+            for (auto fd : fds)
+                if (fd != -1)
+                    ::close(fd);
+        }
+
+        auto close_write() -> void {
+            ::close(fds[1]);
+            fds[1] = -1;
+        }
+    };
+
+    // Create a ring, or return nullptr if io_uring isn't available here.
+    auto make_ring() -> std::unique_ptr<sk::uring> {
+        try {
+            return std::make_unique<sk::uring>(8);
+        } catch (std::system_error const &e) {
+            WARN("io_uring not available: " << e.what());
+            return nullptr;
+        }
+    }
+
+    using buffer_type = sk::dynamic_buffer<char, 16>;
+    using provider_type = sk::uring_extent_provider<buffer_type::extent_type>;
+
+} // namespace
+
+TEST_CASE("uring_extent_provider allocates extents in the region") {
+    auto ring = make_ring();
+    if (!ring)
+        return;
+
+    provider_type provider(*ring, 4);
+    REQUIRE(provider.available() == 4);
+
+    auto *a = provider.allocate();
+    auto *b = provider.allocate();
+    REQUIRE(a != b);
+    REQUIRE(provider.contains(a, sizeof(*a)));
+    REQUIRE(provider.contains(b->data.data(), b->data.size()));
+    REQUIRE(provider.available() == 2);
+
+    auto *c = provider.allocate();
+    auto *d = provider.allocate();
+    REQUIRE_THROWS_AS(provider.allocate(), std::bad_alloc);
+
+    for (auto *ext : {a, b, c, d})
+        provider.deallocate(ext);
+    REQUIRE(provider.available() == 4);
+}
+
+TEST_CASE("uring fixed-buffer read and write through a dynamic_buffer") {
+    auto ring = make_ring();
+    if (!ring)
+        return;
+
+    provider_type provider(*ring, 8);
+    std::string input_string = "this string spans several small extents";
+    test_pipe in_pipe, out_pipe;
+
+    REQUIRE(::write(in_pipe.fds[1], input_string.data(),
+                    input_string.size()) ==
+            static_cast<ssize_t>(input_string.size()));
+
+    {
+        buffer_type buf(provider);
+        std::error_code ec;
+
+        // Read the pipe one extent at a time using READ_FIXED.
+        while (buf.size() < input_string.size()) {
+            buf.ensure_minfree();
+
+            auto *sqe = ring->get_sqe();
+            REQUIRE(sqe);
+            REQUIRE(sk::uring_prep_read(*sqe, in_pipe.fds[0], buf,
+                                        &provider) > 0);
+            REQUIRE(sqe->opcode == IORING_OP_READ_FIXED);
+            REQUIRE(ring->submit(1) == 1);
+
+            auto *cqe = ring->wait_cqe();
+            REQUIRE(sk::uring_complete_read(buf, *cqe, ec) > 0);
+            REQUIRE(!ec);
+            ring->cqe_seen();
+        }
+
+        REQUIRE(buf.size() == input_string.size());
+        REQUIRE(buf.extents.size() > 1);
+
+        // Write it all to the other pipe with WRITE_FIXED.  Each write
+        // discards an extent, returning it to the provider.
+        while (!buf.empty()) {
+            auto *sqe = ring->get_sqe();
+            REQUIRE(sqe);
+            REQUIRE(sk::uring_prep_write(*sqe, out_pipe.fds[1], buf,
+                                         &provider) > 0);
+            REQUIRE(sqe->opcode == IORING_OP_WRITE_FIXED);
+            REQUIRE(ring->submit(1) == 1);
+
+            auto *cqe = ring->wait_cqe();
+            REQUIRE(sk::uring_complete_write(buf, *cqe, ec) > 0);
+            REQUIRE(!ec);
+            ring->cqe_seen();
+        }
+    }
+
+    // All the extents are back in the provider.
+    REQUIRE(provider.available() == 8);
+
+    std::string output_string(input_string.size(), 'X');
+    REQUIRE(::read(out_pipe.fds[0], output_string.data(),
+                   output_string.size()) ==
+            static_cast<ssize_t>(input_string.size()));
+    REQUIRE(output_string == input_string);
+}
+
+TEST_CASE("uring with two providers registered together") {
+    auto ring = make_ring();
+    if (!ring)
+        return;
+
+    // Each provider has its own index, and the caller registers both.
+    provider_type first(4, 0), second(4, 1);
+    REQUIRE(second.buffer_index() == 1);
+    struct iovec iovecs[] = {first.iovec(), second.iovec()};
+    ring->register_buffers(iovecs);
+
+    std::string input_string = "fixed buffer 1";
+    test_pipe pipe;
+    REQUIRE(::write(pipe.fds[1], input_string.data(), input_string.size()) ==
+            static_cast<ssize_t>(input_string.size()));
+
+    {
+        buffer_type buf(second);
+        std::error_code ec;
+
+        auto *sqe = ring->get_sqe();
+        REQUIRE(sqe);
+        REQUIRE(sk::uring_prep_read(*sqe, pipe.fds[0], buf, &second) > 0);
+        REQUIRE(sqe->opcode == IORING_OP_READ_FIXED);
+        REQUIRE(sqe->buf_index == 1);
+        REQUIRE(ring->submit(1) == 1);
+
+        auto *cqe = ring->wait_cqe();
+        REQUIRE(sk::uring_complete_read(buf, *cqe, ec) ==
+                input_string.size());
+        REQUIRE(!ec);
+        ring->cqe_seen();
+
+        std::string output_string(input_string.size(), 'X');
+        REQUIRE(buf.read(output_string) == input_string.size());
+        REQUIRE(output_string == input_string);
+    }
+
+    ring->unregister_buffers();
+}
+
+TEST_CASE("uring read without a provider uses IORING_OP_READ") {
+    auto ring = make_ring();
+    if (!ring)
+        return;
+
+    test_pipe pipe;
+    pipe.close_write();
+
+    buffer_type buf;
+    buf.ensure_minfree();
+
+    auto *sqe = ring->get_sqe();
+    REQUIRE(sk::uring_prep_read(*sqe, pipe.fds[0], buf) > 0);
+    REQUIRE(sqe->opcode == IORING_OP_READ);
+    ring->submit(1);
+
+    // The pipe has no writer, so the read completes at end of file.
+    std::error_code ec;
+    REQUIRE(sk::uring_complete_read(buf, *ring->wait_cqe(), ec) == 0);
+    REQUIRE(!ec);
+    ring->cqe_seen();
+    REQUIRE(buf.empty());
+}
+
+#endif // defined(__linux__)